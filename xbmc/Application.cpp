@@ -3440,6 +3440,10 @@ bool CApplication::Cleanup()
     m_perfStats.DumpStats();
 #endif
 
+#ifdef _DEBUG
+    g_directoryCache.PrintStats();
+#endif
+
     //  Shutdown as much as possible of the
     //  application, to reduce the leaks dumped
     //  to the vc output window before calling
@@ -3513,6 +3517,9 @@ void CApplication::Stop(int exitCode)
     else
       CLog::Log(LOGNOTICE, "Not saving settings (settings.xml is not present)");
 
+    // keep the listings of remote shares for the next start
+    g_directoryCache.Save();
+
     m_bStop = true;
     m_AppActive = false;
     m_AppFocused = false;
@@ -65,6 +65,9 @@ using namespace MUSIC_INFO;
 using namespace PVR;
 using namespace EPG;
 
+// caches written before this started with a bool, so the low byte never was 2 or more
+#define DISC_CACHE_VERSION 2
+
 CFileItem::CFileItem(const CSong& song)
 {
   m_musicInfoTag = NULL;
@@ -138,15 +141,17 @@ CFileItem::CFileItem(const CEpgInfoTag& tag)
 
   Reset();
 
-  m_strPath = tag.Path();
-  m_bIsFolder = false;
+  // the tag may be changed while we're reading it, so set everything from our own copy
   *GetEPGInfoTag() = tag;
-  SetLabel(tag.Title());
-  m_strLabel2 = tag.Plot();
-  m_dateTime = tag.StartAsLocalTime();
+  const CEpgInfoTag &copy = *GetEPGInfoTag();
+  m_strPath = copy.Path();
+  m_bIsFolder = false;
+  SetLabel(copy.Title());
+  m_strLabel2 = copy.Plot();
+  m_dateTime = copy.StartAsLocalTime();
 
-  if (!tag.Icon().IsEmpty())
-    SetIconImage(tag.Icon());
+  if (!copy.Icon().IsEmpty())
+    SetIconImage(copy.Icon());
 }
 
 CFileItem::CFileItem(const CPVRChannel& channel)
@@ -395,6 +400,9 @@ CFileItem::~CFileItem(void)
 const CFileItem& CFileItem::operator=(const CFileItem& item)
 {
   if (this == &item) return * this;
+  item.LoadRecord();
+  m_records.reset();
+  m_recordLoaded = false;
   CGUIListItem::operator=(item);
   m_bLabelPreformated=item.m_bLabelPreformated;
   FreeMemory();
@@ -560,12 +568,20 @@ void CFileItem::Reset()
   m_pictureInfoTag=NULL;
   m_extrainfo.Empty();
   m_specialSort = SortSpecialNone;
+  m_records.reset();
+  m_recordRow = 0;
+  m_recordLoaded = false;
   ClearProperties();
   SetInvalid();
 }
 
 void CFileItem::Archive(CArchive& ar)
 {
+  if (ar.IsStoring())
+    LoadRecord();
+  else
+    m_records.reset();
+
   CGUIListItem::Archive(ar);
 
   if (ar.IsStoring())
@@ -662,6 +678,7 @@ void CFileItem::Serialize(CVariant& value) const
 {
   //CGUIListItem::Serialize(value["CGUIListItem"]);
 
+  LoadRecord();
   value["strPath"] = m_strPath;
   value["dateTime"] = (m_dateTime.IsValid()) ? m_dateTime.GetAsRFC1123DateTime() : "";
   value["size"] = (int) m_dwSize / 1000;
@@ -682,6 +699,7 @@ void CFileItem::Serialize(CVariant& value) const
 
 void CFileItem::ToSortable(SortItem &sortable)
 {
+  LoadRecord();
   sortable[FieldPath] = m_strPath;
   sortable[FieldDate] = (m_dateTime.IsValid()) ? m_dateTime.GetAsDBDateTime() : "";
   sortable[FieldSize] = m_dwSize;
@@ -1517,6 +1535,7 @@ void CFileItem::SetFromSong(const CSong &song)
 CFileItemList::CFileItemList()
 {
   m_fastLookup = false;
+  m_recordBacked = false;
   m_bIsFolder = true;
   m_cacheToDisc = CACHE_IF_SLOW;
   m_sortMethod = SORT_METHOD_NONE;
@@ -1528,6 +1547,7 @@ CFileItemList::CFileItemList()
 CFileItemList::CFileItemList(const CStdString& strPath) : CFileItem(strPath, true)
 {
   m_fastLookup = false;
+  m_recordBacked = false;
   m_cacheToDisc = CACHE_IF_SLOW;
   m_sortMethod = SORT_METHOD_NONE;
   m_sortOrder = SortOrderNone;
@@ -2539,6 +2559,14 @@ bool CFileItemList::Load(int windowID)
   {
     CLog::Log(LOGDEBUG,"Loading fileitems [%s]",GetPath().c_str());
     CArchive ar(&file, CArchive::load);
+    int version = 0;
+    ar >> version;
+    if (version != DISC_CACHE_VERSION)
+    {
+      CLog::Log(LOGDEBUG,"  -- ignoring cache of version %i", version);
+      return false;
+    }
+    ar.EnableStringTable();
     ar >> *this;
     CLog::Log(LOGDEBUG,"  -- items: %i, directory: %s sort method: %i, ascending: %s",Size(),GetPath().c_str(), m_sortMethod, m_sortOrder ? "true" : "false");
     ar.Close();
@@ -2561,6 +2589,8 @@ bool CFileItemList::Save(int windowID)
   if (file.OpenForWrite(GetDiscFileCache(windowID), true)) // overwrite always
   {
     CArchive ar(&file, CArchive::store);
+    ar << (int)DISC_CACHE_VERSION;
+    ar.EnableStringTable();
     ar << *this;
     CLog::Log(LOGDEBUG,"  -- items: %i, sort method: %i, ascending: %s",iSize,m_sortMethod, m_sortOrder ? "true" : "false");
     ar.Close();
@@ -3054,6 +3084,7 @@ void CFileItemList::ClearSortState()
 
 CVideoInfoTag* CFileItem::GetVideoInfoTag()
 {
+  LoadRecord();
   if (!m_videoInfoTag)
     m_videoInfoTag = new CVideoInfoTag;
 
@@ -3102,12 +3133,41 @@ CPictureInfoTag* CFileItem::GetPictureInfoTag()
 
 MUSIC_INFO::CMusicInfoTag* CFileItem::GetMusicInfoTag()
 {
+  LoadRecord();
   if (!m_musicInfoTag)
     m_musicInfoTag = new MUSIC_INFO::CMusicInfoTag;
 
   return m_musicInfoTag;
 }
 
+void CFileItem::SetRecord(const CFileItemRecordsPtr &records, unsigned int row)
+{
+  m_records = records;
+  m_recordRow = row;
+  m_recordLoaded = false;
+}
+
+void CFileItem::LoadFromRecord() const
+{
+  CFileItem *item = const_cast<CFileItem *>(this);
+  item->m_recordLoaded = true; // first, as filling in asks for the info tags
+  m_records->LoadRecord(m_recordRow, *item);
+}
+
+void CFileItem::UnloadRecord()
+{
+  if (!m_records || !m_recordLoaded)
+    return;
+
+  delete m_musicInfoTag;
+  m_musicInfoTag = NULL;
+  delete m_videoInfoTag;
+  m_videoInfoTag = NULL;
+  m_strPath.Empty();
+  ClearProperties();
+  m_recordLoaded = false;
+}
+
 CStdString CFileItem::FindTrailer() const
 {
   CStdString strFile2;
@@ -65,6 +65,26 @@ class CURL;
 #define STARTOFFSET_RESUME (-1)
 
 class CMediaSource;
+class CFileItem;
+
+/*!
+  \brief Result set record backed items are filled in from
+  \sa CFileItem::SetRecord
+  */
+class IFileItemRecords
+{
+public:
+  virtual ~IFileItemRecords() {}
+
+  /*!
+    \brief Fill in an item from one of the records
+    \param row the record
+    \param item the item to fill in
+    */
+  virtual void LoadRecord(unsigned int row, CFileItem &item) const = 0;
+};
+
+typedef boost::shared_ptr<const IFileItemRecords> CFileItemRecordsPtr;
 
 /*!
   \brief Represents a file on a share
@@ -93,7 +113,7 @@ public:
   virtual ~CFileItem(void);
   virtual CGUIListItem *Clone() const { return new CFileItem(*this); };
 
-  const CStdString &GetPath() const { return m_strPath; };
+  const CStdString &GetPath() const { LoadRecord(); return m_strPath; };
   void SetPath(const CStdString &path) { m_strPath = path; };
 
   void Reset();
@@ -181,8 +201,40 @@ public:
   bool SortsOnBottom() const { return m_specialSort == SortSpecialOnBottom; }
   void SetSpecialSort(SortSpecial sort) { m_specialSort = sort; }
 
+  /*!
+    \brief Back the item by a record of a result set
+    Path, info tags and properties of the item are only filled in from the record
+    when the path or one of the info tags is first asked for, so listings with many
+    items that are never looked at in detail stay small.  Filling in isn't thread safe,
+    so record backed items must stay with the thread that created them.
+    The accessors of CGUIListItem aren't hooked, so GetLabel(), GetLabel2() and the art
+    of an item that isn't filled in yet are empty: call LoadRecord() before using them.
+    \param records the result set, kept alive by the item until it is filled in
+    \param row the record of the item
+    \sa CFileItemList::SetRecordBacked
+    */
+  void SetRecord(const CFileItemRecordsPtr &records, unsigned int row);
+
+  /*!
+    \brief Fill in the item from its record, if it is record backed and not filled in yet
+    */
+  inline void LoadRecord() const
+  {
+    if (m_records && !m_recordLoaded)
+      LoadFromRecord();
+  }
+
+  /*!
+    \brief Drop what was filled in from the record, it is filled in again when next needed
+    Only for items nobody changed since they were filled in.
+    */
+  void UnloadRecord();
+
+  bool IsRecordBacked() const { return m_records != NULL; }
+
   inline bool HasMusicInfoTag() const
   {
+    LoadRecord();
     return m_musicInfoTag != NULL;
   }
 
@@ -190,11 +242,13 @@ public:
 
   inline const MUSIC_INFO::CMusicInfoTag* GetMusicInfoTag() const
   {
+    LoadRecord();
     return m_musicInfoTag;
   }
 
   inline bool HasVideoInfoTag() const
   {
+    LoadRecord();
     return m_videoInfoTag != NULL;
   }
 
@@ -202,6 +256,7 @@ public:
 
   inline const CVideoInfoTag* GetVideoInfoTag() const
   {
+    LoadRecord();
     return m_videoInfoTag;
   }
 
@@ -403,6 +458,11 @@ private:
   PVR::CPVRTimerInfoTag * m_pvrTimerInfoTag;
   CPictureInfoTag* m_pictureInfoTag;
   bool m_bIsAlbum;
+
+  void LoadFromRecord() const;
+  CFileItemRecordsPtr m_records;   ///< result set the item is filled in from, if record backed
+  unsigned int m_recordRow;
+  bool m_recordLoaded;
 };
 
 /*!
@@ -498,6 +558,12 @@ public:
   bool Contains(const CStdString& fileName) const;
   bool GetFastLookup() const { return m_fastLookup; };
 
+  /*! \brief Have database queries fill the list with record backed items
+   Only for lists that stay with the thread that asked for them, see CFileItem::SetRecord.
+   */
+  void SetRecordBacked(bool recordBacked) { m_recordBacked = recordBacked; };
+  bool GetRecordBacked() const { return m_recordBacked; };
+
   /*! \brief stack a CFileItemList
    By default we stack all items (files and folders) in a CFileItemList
    \param stackFiles whether to stack all items or just collapse folders (defaults to true)
@@ -595,6 +661,7 @@ private:
   bool m_sortIgnoreFolders;
   CACHE_TYPE m_cacheToDisc;
   bool m_replaceListing;
+  bool m_recordBacked;
   CStdString m_content;
 
   std::vector<SORT_METHOD_DETAILS> m_sortDetails;
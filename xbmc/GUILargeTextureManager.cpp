@@ -28,13 +28,18 @@
 #include "guilib/GraphicContext.h"
 #include "utils/log.h"
 #include "TextureCache.h"
+#include "utils/URIUtils.h"
+
+#include <algorithm>
 
 using namespace std;
 
 
-CImageLoader::CImageLoader(const CStdString &path)
+CImageLoader::CImageLoader(const CStdString &path, unsigned int width, unsigned int height)
 {
   m_path = path;
+  m_width = width;
+  m_height = height;
   m_texture = NULL;
 }
 
@@ -55,13 +60,31 @@ bool CImageLoader::DoWork()
     // not in our texture cache, so try and load directly and then cache the result
     loadPath = CTextureCache::Get().CacheImage(texturePath, &m_texture);
     if (m_texture)
+    { // loaded at screen resolution
+      m_width = m_height = 0;
       return true; // we're done
+    }
   }
   if (!loadPath.IsEmpty())
   {
+    // jpegs can be downscaled cheaply while decoding, so only decode them as large as they are displayed.
+    // other formats get scaled to fit inside the given size, so we load those at screen resolution.
+    unsigned int width = g_graphicsContext.GetWidth();
+    unsigned int height = g_graphicsContext.GetHeight();
+    CStdString extension = URIUtils::GetExtension(loadPath);
+    extension.ToLower();
+    if (m_width && m_height && m_width < width && m_height < height &&
+        (extension == ".jpg" || extension == ".jpeg" || extension == ".tbn"))
+    {
+      width = m_width;
+      height = m_height;
+    }
+    else
+      m_width = m_height = 0;
+
     // direct route - load the image
     unsigned int start = XbmcThreads::SystemClockMillis();
-    m_texture = CBaseTexture::LoadFromFile(loadPath, g_graphicsContext.GetWidth(), g_graphicsContext.GetHeight(), g_guiSettings.GetBool("pictures.useexifrotation"));
+    m_texture = CBaseTexture::LoadFromFile(loadPath, width, height, g_guiSettings.GetBool("pictures.useexifrotation"));
     if (!m_texture)
       return false;
     if (XbmcThreads::SystemClockMillis() - start > 100)
@@ -73,17 +96,25 @@ bool CImageLoader::DoWork()
   return true;
 }
 
-CGUILargeTextureManager::CLargeTexture::CLargeTexture(const CStdString &path)
+CGUILargeTextureManager::CLargeTexture::CLargeTexture(const CStdString &path, unsigned int width, unsigned int height)
 {
   m_path = path;
   m_refCount = 1;
-  m_timeToDelete = 0;
+  m_jobID = 0;
+  m_width = 0;
+  m_height = 0;
+  m_fullSize = false;
+  m_loadedWidth = 0;
+  m_loadedHeight = 0;
+  m_memoryUsage = 0;
+  Request(width, height);
 }
 
 CGUILargeTextureManager::CLargeTexture::~CLargeTexture()
 {
   assert(m_refCount == 0);
   m_texture.Free();
+  FreeReplaced();
 }
 
 void CGUILargeTextureManager::CLargeTexture::AddRef()
@@ -91,40 +122,67 @@ void CGUILargeTextureManager::CLargeTexture::AddRef()
   m_refCount++;
 }
 
-bool CGUILargeTextureManager::CLargeTexture::DecrRef(bool deleteImmediately)
+bool CGUILargeTextureManager::CLargeTexture::DecrRef()
 {
   assert(m_refCount);
   m_refCount--;
-  if (m_refCount == 0)
-  {
-    if (deleteImmediately)
-      delete this;
-    else
-      m_timeToDelete = CTimeUtils::GetFrameTime() + TIME_TO_DELETE;
-    return true;
-  }
-  return false;
+  return m_refCount == 0;
 }
 
-bool CGUILargeTextureManager::CLargeTexture::DeleteIfRequired(bool deleteImmediately)
+void CGUILargeTextureManager::CLargeTexture::Request(unsigned int width, unsigned int height)
 {
-  if (m_refCount == 0 && (deleteImmediately || m_timeToDelete < CTimeUtils::GetFrameTime()))
+  m_lastRequest = CTimeUtils::GetFrameTime();
+  if (m_fullSize)
+    return;
+  // an unknown size means we need it at full resolution, otherwise load it large enough for everyone
+  if (!width || !height)
+  {
+    m_fullSize = true;
+    m_width = m_height = 0;
+  }
+  else
   {
-    delete this;
-    return true;
+    m_width = std::max(m_width, width);
+    m_height = std::max(m_height, height);
   }
-  return false;
 }
 
-void CGUILargeTextureManager::CLargeTexture::SetTexture(CBaseTexture* texture)
+void CGUILargeTextureManager::CLargeTexture::SetTexture(CBaseTexture* texture, unsigned int width, unsigned int height)
 {
-  assert(!m_texture.size());
+  // a failed load isn't retried at another size
+  m_loadedWidth = texture ? width : 0;
+  m_loadedHeight = texture ? height : 0;
   if (texture)
+  {
+    // a reload - whoever got the previous texture may still be displaying it
+    if (m_texture.size())
+    {
+      m_replaced.push_back(m_texture);
+      m_texture.Reset();
+    }
     m_texture.Set(texture, texture->GetWidth(), texture->GetHeight());
+    m_memoryUsage = texture->GetPitch() * texture->GetRows();
+  }
+}
+
+bool CGUILargeTextureManager::CLargeTexture::NeedsReload() const
+{
+  if (!m_texture.size() || !m_loadedWidth || !m_loadedHeight)
+    return false; // not loaded yet, or not downscaled
+  return m_fullSize || m_width > m_loadedWidth || m_height > m_loadedHeight;
+}
+
+void CGUILargeTextureManager::CLargeTexture::FreeReplaced()
+{
+  for (std::vector<CTextureArray>::iterator it = m_replaced.begin(); it != m_replaced.end(); ++it)
+    it->Free();
+  m_replaced.clear();
 }
 
 CGUILargeTextureManager::CGUILargeTextureManager()
 {
+  m_unusedMemory = 0;
+  m_loading = 0;
 }
 
 CGUILargeTextureManager::~CGUILargeTextureManager()
@@ -134,37 +192,60 @@ CGUILargeTextureManager::~CGUILargeTextureManager()
 void CGUILargeTextureManager::CleanupUnusedImages(bool immediately)
 {
   CSingleLock lock(m_listSection);
-  // check for items to remove from allocated list, and remove
-  listIterator it = m_allocated.begin();
-  while (it != m_allocated.end())
+  FreeUnused(immediately ? 0 : UNUSED_MEMORY_BUDGET);
+}
+
+void CGUILargeTextureManager::FreeUnused(size_t budget)
+{
+  while (!m_unused.empty() && (m_unusedMemory > budget || budget == 0))
   {
-    CLargeTexture *image = *it;
-    if (image->DeleteIfRequired(immediately))
-      it = m_allocated.erase(it);
-    else
-      ++it;
+    CLargeTexture *image = m_unused.front();
+    m_unused.pop_front();
+    m_unusedMemory -= image->GetMemoryUsage();
+    m_allocated.erase(image->GetPath());
+    delete image;
   }
 }
 
 // if available, increment reference count, and return the image.
 // else, add to the queue list if appropriate.
-bool CGUILargeTextureManager::GetImage(const CStdString &path, CTextureArray &texture, bool firstRequest)
+bool CGUILargeTextureManager::GetImage(const CStdString &path, CTextureArray &texture, bool firstRequest, unsigned int width, unsigned int height, bool *reloading)
 {
   CSingleLock lock(m_listSection);
-  for (listIterator it = m_allocated.begin(); it != m_allocated.end(); ++it)
+  if (reloading)
+    *reloading = false;
+  mapIterator it = m_allocated.find(path);
+  if (it != m_allocated.end())
   {
-    CLargeTexture *image = *it;
-    if (image->GetPath() == path)
+    CLargeTexture *image = it->second;
+    if (firstRequest)
     {
-      if (firstRequest)
-        image->AddRef();
-      texture = image->GetTexture();
-      return texture.size() > 0;
+      if (image->IsUnused())
+      { // back in use again
+        m_unused.remove(image);
+        m_unusedMemory -= image->GetMemoryUsage();
+      }
+      image->AddRef();
+
+      // decoded smaller than this request wants, so decode it again
+      image->Request(width, height);
+      if (image->NeedsReload() && m_reload.insert(make_pair(path, image)).second)
+        ProcessQueue();
     }
+    texture = image->GetTexture();
+    if (reloading)
+      *reloading = m_reload.find(path) != m_reload.end();
+    return texture.size() > 0;
   }
 
   if (firstRequest)
-    QueueImage(path);
+    QueueImage(path, width, height);
+  else
+  { // still waiting on this one, so bump it up the queue
+    it = m_queued.find(path);
+    if (it != m_queued.end())
+      it->second->Request(width, height);
+  }
 
   return true;
 }
@@ -172,68 +253,147 @@ bool CGUILargeTextureManager::GetImage(const CStdString &path, CTextureArray &te
 void CGUILargeTextureManager::ReleaseImage(const CStdString &path, bool immediately)
 {
   CSingleLock lock(m_listSection);
-  for (listIterator it = m_allocated.begin(); it != m_allocated.end(); ++it)
+  mapIterator it = m_allocated.find(path);
+  if (it != m_allocated.end())
   {
-    CLargeTexture *image = *it;
-    if (image->GetPath() == path)
+    CLargeTexture *image = it->second;
+    if (image->DecrRef())
     {
-      if (image->DecrRef(immediately) && immediately)
+      // nobody displays this image anymore, so neither a larger version nor the replaced textures are needed
+      CancelReload(image);
+      image->FreeReplaced();
+      if (immediately)
+      {
         m_allocated.erase(it);
-      return;
+        delete image;
+      }
+      else
+      {
+        m_unused.push_back(image);
+        m_unusedMemory += image->GetMemoryUsage();
+      }
     }
+    return;
   }
-  for (queueIterator it = m_queued.begin(); it != m_queued.end(); ++it)
+  it = m_queued.find(path);
+  if (it != m_queued.end())
   {
-    unsigned int id = it->first;
     CLargeTexture *image = it->second;
-    if (image->GetPath() == path && image->DecrRef(true))
+    if (image->DecrRef())
     {
-      // cancel this job
-      CJobManager::GetInstance().CancelJob(id);
+      // cancel the job if we have started it, and give the slot to another image
+      if (image->m_jobID)
+      {
+        CJobManager::GetInstance().CancelJob(image->m_jobID);
+        m_loading--;
+      }
       m_queued.erase(it);
-      return;
+      delete image;
+      ProcessQueue();
     }
   }
 }
 
 // queue the image, and start the background loader if necessary
-void CGUILargeTextureManager::QueueImage(const CStdString &path)
+void CGUILargeTextureManager::QueueImage(const CStdString &path, unsigned int width, unsigned int height)
 {
   CSingleLock lock(m_listSection);
-  for (queueIterator it = m_queued.begin(); it != m_queued.end(); ++it)
+  mapIterator it = m_queued.find(path);
+  if (it != m_queued.end())
   {
     CLargeTexture *image = it->second;
-    if (image->GetPath() == path)
-    {
-      image->AddRef();
-      return; // already queued
-    }
+    image->AddRef();
+    image->Request(width, height);
+    return; // already queued
   }
 
   // queue the item
-  CLargeTexture *image = new CLargeTexture(path);
-  unsigned int jobID = CJobManager::GetInstance().AddJob(new CImageLoader(path), this, CJob::PRIORITY_NORMAL);
-  m_queued.push_back(make_pair(jobID, image));
+  m_queued.insert(make_pair(path, new CLargeTexture(path, width, height)));
+  ProcessQueue();
+}
+
+void CGUILargeTextureManager::CancelReload(CLargeTexture *image)
+{
+  mapIterator it = m_reload.find(image->GetPath());
+  if (it == m_reload.end())
+    return;
+  if (image->m_jobID)
+  {
+    CJobManager::GetInstance().CancelJob(image->m_jobID);
+    image->m_jobID = 0;
+    m_loading--;
+  }
+  m_reload.erase(it);
+  ProcessQueue();
+}
+
+CGUILargeTextureManager::CLargeTexture *CGUILargeTextureManager::GetNextToLoad(TextureMap &images) const
+{
+  CLargeTexture *next = NULL;
+  for (mapIterator it = images.begin(); it != images.end(); ++it)
+  {
+    CLargeTexture *image = it->second;
+    if (!image->m_jobID && (!next || image->GetLastRequest() > next->GetLastRequest()))
+      next = image;
+  }
+  return next;
+}
+
+void CGUILargeTextureManager::ProcessQueue()
+{
+  while (m_loading < MAX_LOADING)
+  {
+    // find the most recently requested image that we haven't started on yet,
+    // images that aren't displayed at all go before those that are just displayed too small
+    CLargeTexture *next = GetNextToLoad(m_queued);
+    if (!next)
+      next = GetNextToLoad(m_reload);
+    if (!next)
+      return;
+
+    next->m_jobID = CJobManager::GetInstance().AddJob(new CImageLoader(next->GetPath(), next->GetWidth(), next->GetHeight()), this, CJob::PRIORITY_NORMAL);
+    m_loading++;
+  }
 }
 
 void CGUILargeTextureManager::OnJobComplete(unsigned int jobID, bool success, CJob *job)
 {
   // see if we still have this job id
   CSingleLock lock(m_listSection);
-  for (queueIterator it = m_queued.begin(); it != m_queued.end(); ++it)
+  for (mapIterator it = m_queued.begin(); it != m_queued.end(); ++it)
   {
-    if (it->first == jobID)
+    CLargeTexture *image = it->second;
+    if (image->m_jobID == jobID)
     { // found our job
       CImageLoader *loader = (CImageLoader *)job;
-      CLargeTexture *image = it->second;
-      image->SetTexture(loader->m_texture);
+      image->SetTexture(loader->m_texture, loader->m_width, loader->m_height);
       loader->m_texture = NULL; // we want to keep the texture, and jobs are auto-deleted.
+      image->m_jobID = 0;
       m_queued.erase(it);
-      m_allocated.push_back(image);
+      m_allocated.insert(make_pair(image->GetPath(), image));
+      m_loading--;
+      // requested larger while it was loading
+      if (image->NeedsReload())
+        m_reload.insert(make_pair(image->GetPath(), image));
+      ProcessQueue();
+      return;
+    }
+  }
+  for (mapIterator it = m_reload.begin(); it != m_reload.end(); ++it)
+  {
+    CLargeTexture *image = it->second;
+    if (image->m_jobID == jobID)
+    { // reloaded at a larger size
+      CImageLoader *loader = (CImageLoader *)job;
+      image->SetTexture(loader->m_texture, loader->m_width, loader->m_height);
+      loader->m_texture = NULL;
+      image->m_jobID = 0;
+      m_reload.erase(it);
+      m_loading--;
+      if (image->NeedsReload())
+        m_reload.insert(make_pair(image->GetPath(), image));
+      ProcessQueue();
       return;
     }
   }
 }
-
-
-
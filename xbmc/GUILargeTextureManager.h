@@ -20,6 +20,10 @@
  *
  */
 
+#include <list>
+#include <map>
+#include <vector>
+
 #include "threads/CriticalSection.h"
 #include "utils/Job.h"
 #include "guilib/TextureManager.h"
@@ -35,7 +39,7 @@
 class CImageLoader : public CJob
 {
 public:
-  CImageLoader(const CStdString &path);
+  CImageLoader(const CStdString &path, unsigned int width = 0, unsigned int height = 0);
   virtual ~CImageLoader();
 
   /*!
@@ -44,6 +48,8 @@ public:
   virtual bool DoWork();
 
   CStdString    m_path; ///< path of image to load
+  unsigned int  m_width; ///< minimum width the image is displayed at, 0 to load at screen resolution. Reset to 0 if the image wasn't downscaled to it.
+  unsigned int  m_height; ///< minimum height the image is displayed at, 0 to load at screen resolution. Reset to 0 if the image wasn't downscaled to it.
   CBaseTexture *m_texture; ///< Texture object to load the image into \sa CBaseTexture.
 };
 
@@ -54,6 +60,14 @@ public:
  Used to load textures for the user interface asynchronously, allowing fluid framerates
  while background loading textures.
 
+ Only a few images are loaded at once.  Waiting images are started in order of when they were last
+ requested, so that images currently on screen load before those that have been scrolled past, and
+ images that are released before their load has started are never decoded at all.
+
+ Images are decoded only as large as they are displayed.  When an image is later requested at a larger
+ size it is decoded again, and the new requests get the larger texture while the textures already handed
+ out stay valid until the image is released by everyone.
+
  \sa IJobCallback, CGUITexture
  */
 class CGUILargeTextureManager : public IJobCallback
@@ -78,25 +92,31 @@ public:
    object filled if the texture has been previously loaded, else will return with an empty texture
    object if it is being loaded.
 
+   Callers should keep calling this while they are visible and waiting on the texture, as this is
+   used to prioritise the loading of textures that are currently on screen.
+
    \param path path of the image to load.
    \param texture texture object to hold the resulting texture
-   \param orientation orientation of resulting texture
    \param firstRequest true if this is the first time we are requesting this texture
+   \param width width (in screen pixels) the texture will be displayed at, or 0 if unknown.
+   \param height height (in screen pixels) the texture will be displayed at, or 0 if unknown.
+   \param reloading [out] set to whether a larger version of the returned texture is being decoded.  Keep
+                    calling (with firstRequest false) while it is, to pick up the larger texture once it's there.
    \return true if the image exists, else false.
    \sa CGUITextureArray and CGUITexture
    */
-  bool GetImage(const CStdString &path, CTextureArray &texture, bool firstRequest);
+  bool GetImage(const CStdString &path, CTextureArray &texture, bool firstRequest, unsigned int width = 0, unsigned int height = 0, bool *reloading = NULL);
 
   /*!
    \brief Request a texture to be unloaded.
 
    When textures are finished with, this function should be called.  This decrements the texture's
-   reference count, and schedules it to be unloaded once the reference count reaches zero.  If the
+   reference count, and marks it as unused once the reference count reaches zero.  If the
    texture is still queued for loading, or is in the process of loading, the image load is cancelled.
 
    \param path path of the image to release.
    \param immediately if set true the image is immediately unloaded once its reference count reaches zero
-                      rather than being unloaded after a delay.
+                      rather than being kept around as an unused image.
    */
   void ReleaseImage(const CStdString &path, bool immediately = false);
 
@@ -104,10 +124,11 @@ public:
    \brief Cleanup images that are no longer in use.
 
    Loaded textures are reference counted, and upon reaching reference count 0 through ReleaseImage()
-   they are flagged as unused with the current time.  After a delay they may be unloaded, hence
+   they are kept around in case they are requested again.  Once the memory used by these unused
+   images exceeds UNUSED_MEMORY_BUDGET the least recently used are unloaded, hence
    CleanupUnusedImages() should be called periodically to ensure this occurs.
 
-   \param immediately set to true to cleanup images regardless of whether the delay has passed
+   \param immediately set to true to cleanup all unused images regardless of the memory they use
    */
   void CleanupUnusedImages(bool immediately = false);
 
@@ -115,36 +136,88 @@ private:
   class CLargeTexture
   {
   public:
-    CLargeTexture(const CStdString &path);
+    CLargeTexture(const CStdString &path, unsigned int width, unsigned int height);
     virtual ~CLargeTexture();
 
     void AddRef();
-    bool DecrRef(bool deleteImmediately);
-    bool DeleteIfRequired(bool deleteImmediately = false);
-    void SetTexture(CBaseTexture* texture);
+    bool DecrRef();
+    bool IsUnused() const { return m_refCount == 0; };
+
+    /*! \brief Set the texture once it is loaded
+     A texture that is already set is kept until FreeReplaced(), as it may still be displayed.
+     \param texture the texture, NULL if it couldn't be loaded
+     \param width,height size the texture was decoded for, 0 if it wasn't downscaled
+     */
+    void SetTexture(CBaseTexture* texture, unsigned int width, unsigned int height);
+
+    /*! \brief Whether the texture was decoded smaller than it has since been requested at
+     */
+    bool NeedsReload() const;
+
+    /*! \brief Free the textures replaced by a reload, call once nobody holds them anymore
+     */
+    void FreeReplaced();
+
+    /*! \brief Note that the texture has been asked for, and the size it is to be displayed at
+     */
+    void Request(unsigned int width, unsigned int height);
 
     const CStdString &GetPath() const { return m_path; };
     const CTextureArray &GetTexture() const { return m_texture; };
+    unsigned int GetLastRequest() const { return m_lastRequest; };
+    unsigned int GetWidth() const { return m_width; };
+    unsigned int GetHeight() const { return m_height; };
+    size_t GetMemoryUsage() const { return m_memoryUsage; };
 
-  private:
-    static const unsigned int TIME_TO_DELETE = 2000;
+    unsigned int m_jobID; ///< id of the loader job, 0 if not yet started
 
+  private:
     unsigned int m_refCount;
     CStdString m_path;
     CTextureArray m_texture;
-    unsigned int m_timeToDelete;
+    std::vector<CTextureArray> m_replaced; ///< textures handed out before a reload
+    unsigned int m_lastRequest;
+    unsigned int m_width;
+    unsigned int m_height;
+    bool m_fullSize;
+    unsigned int m_loadedWidth; ///< size the texture was decoded for, 0 if not downscaled
+    unsigned int m_loadedHeight;
+    size_t m_memoryUsage;
   };
 
-  void QueueImage(const CStdString &path);
+  typedef std::map<CStdString, CLargeTexture *> TextureMap;
+  typedef TextureMap::iterator mapIterator;
+
+  static const unsigned int MAX_LOADING = 3;
+  static const size_t UNUSED_MEMORY_BUDGET = 32 * 1024 * 1024;
 
-  std::vector< std::pair<unsigned int, CLargeTexture *> > m_queued;
-  std::vector<CLargeTexture *> m_allocated;
-  typedef std::vector<CLargeTexture *>::iterator listIterator;
-  typedef std::vector< std::pair<unsigned int, CLargeTexture *> >::iterator queueIterator;
+  void QueueImage(const CStdString &path, unsigned int width, unsigned int height);
+
+  /*! \brief Start loader jobs for the most recently requested queued images, up to MAX_LOADING at once
+   */
+  void ProcessQueue();
+
+  /*! \brief The most recently requested image of the given ones whose loader hasn't been started
+   */
+  CLargeTexture *GetNextToLoad(TextureMap &images) const;
+
+  /*! \brief Stop reloading an image at a larger size, if it is waiting to or being reloaded
+   */
+  void CancelReload(CLargeTexture *image);
+
+  /*! \brief Unload unused images, least recently used first, until they take no more than the given memory
+   */
+  void FreeUnused(size_t budget);
+
+  TextureMap m_queued;    ///< images waiting to be loaded or being loaded
+  TextureMap m_allocated; ///< loaded images, whether or not they are in use
+  TextureMap m_reload;    ///< loaded images in use that were requested larger than they were decoded
+  std::list<CLargeTexture *> m_unused; ///< loaded images with no references, least recently used first
+  size_t m_unusedMemory;
+  unsigned int m_loading;
 
   CCriticalSection m_listSection;
 };
 
 extern CGUILargeTextureManager g_largeTextureManager;
 
-
@@ -98,7 +98,8 @@ bool CTextureCacheJob::CacheTexture(CBaseTexture **out_texture)
 
     CLog::Log(LOGDEBUG, "%s image '%s' to '%s':", m_oldHash.IsEmpty() ? "Caching" : "Recaching", image.c_str(), m_details.file.c_str());
 
-    if (CPicture::CacheTexture(texture, width, height, CTextureCache::GetCachedPath(m_details.file)))
+    // create the .dds version while we have the decoded pixels, rather than decoding the cached image again later
+    if (CPicture::CacheTexture(texture, width, height, CTextureCache::GetCachedPath(m_details.file), g_advancedSettings.m_useDDSFanart))
     {
       m_details.width = width;
       m_details.height = height;
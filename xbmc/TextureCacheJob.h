@@ -73,6 +73,8 @@ public:
    \param url location of the image
    \return a hash string for this image
    */
+  static CStdString GetImageHash(const CStdString &url);
+
   bool CacheTexture(CBaseTexture **texture = NULL);
 
   CStdString m_url;
@@ -81,13 +83,6 @@ public:
 private:
   friend class CEdenVideoArtUpdater;
 
-  /*! \brief retrieve a hash for the given image
-   Combines the size, ctime and mtime of the image file into a "unique" hash
-   \param url location of the image
-   \return a hash string for this image
-   */
-  static CStdString GetImageHash(const CStdString &url);
-
   /*! \brief Check whether a given URL represents an image that can be updated
    We currently don't check http:// and https:// URLs for updates, under the assumption that
    a image URL is much more likely to be static and the actual image at the URL is unlikely
@@ -105,6 +105,8 @@ CDatabase::CDatabase(void)
   m_openCount = 0;
   m_sqlite = true;
   m_bMultiWrite = false;
+  m_bulkImport = false;
+  m_bulkDepth = 0;
 }
 
 CDatabase::~CDatabase(void)
@@ -412,7 +414,12 @@ bool CDatabase::Update(const DatabaseSettings &settings)
 
       // yay - we have a copy of our db, now do our worst with it
       if (UpdateVersion(latestDb))
+      {
+        // restore any indexes dropped by a bulk import that never finished
+        if (m_sqlite)
+          CreateBulkImportIndexes();
         return true;
+      }
 
       // update failed - loop around and see if we have another one available
       Close();
@@ -576,6 +583,9 @@ void CDatabase::Close()
 
   m_openCount = 0;
 
+  if (m_bulkImport)
+    EndBulkImport();
+
   if (NULL == m_pDB.get() ) return ;
   if (NULL != m_pDS.get()) m_pDS->close();
   m_pDB->disconnect();
@@ -627,6 +637,12 @@ void CDatabase::Interupt()
 
 void CDatabase::BeginTransaction()
 {
+  if (m_bulkImport)
+  { // nested transactions become savepoints, so they can still be rolled back on their own
+    ExecSavepoint("SAVEPOINT bulk%u", ++m_bulkDepth);
+    return;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -640,6 +656,13 @@ void CDatabase::BeginTransaction()
 
 bool CDatabase::CommitTransaction()
 {
+  if (m_bulkImport)
+  {
+    if (m_bulkDepth == 0)
+      return false;
+    return ExecSavepoint("RELEASE SAVEPOINT bulk%u", m_bulkDepth--);
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -655,6 +678,17 @@ bool CDatabase::CommitTransaction()
 
 void CDatabase::RollbackTransaction()
 {
+  if (m_bulkImport)
+  {
+    if (m_bulkDepth == 0)
+      return;
+    // undo everything since the matching BeginTransaction(), keeping what was imported before it
+    ExecSavepoint("ROLLBACK TO SAVEPOINT bulk%u", m_bulkDepth);
+    ExecSavepoint("RELEASE SAVEPOINT bulk%u", m_bulkDepth--);
+    ClearBulkImportCaches();
+    return;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -666,12 +700,123 @@ void CDatabase::RollbackTransaction()
   }
 }
 
+bool CDatabase::ExecSavepoint(const char *statement, unsigned int depth)
+{
+  CStdString strSQL = PrepareSQL(statement, depth);
+  try
+  {
+    std::auto_ptr<dbiplus::Dataset> pDS(m_pDB->CreateDataset());
+    pDS->exec(strSQL.c_str());
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s failed (%s)", __FUNCTION__, strSQL.c_str());
+    return false;
+  }
+  return true;
+}
+
 bool CDatabase::InTransaction()
 {
   if (NULL != m_pDB.get()) return false;
   return m_pDB->in_transaction();
 }
 
+bool CDatabase::BeginBulkImport()
+{
+  if (NULL == m_pDB.get() || NULL == m_pDS.get() || m_bulkImport)
+    return false;
+
+  // mysql can't drop indexes inside a transaction, so leave them alone there
+  if (m_sqlite)
+  {
+    std::vector<std::string> indexes;
+    GetBulkImportIndexes(indexes);
+    for (std::vector<std::string>::const_iterator i = indexes.begin(); i != indexes.end(); ++i)
+    {
+      size_t end = i->find(" ON ");
+      size_t start = i->rfind(' ', end - 1);
+      if (end == std::string::npos || start == std::string::npos)
+        continue;
+      try
+      {
+        m_pDS->exec(("DROP INDEX IF EXISTS " + i->substr(start + 1, end - start - 1)).c_str());
+      }
+      catch (...)
+      {
+        CLog::Log(LOGERROR, "%s unable to drop index (%s)", __FUNCTION__, i->c_str());
+      }
+    }
+    CLog::Log(LOGDEBUG, "%s deferred %u indexes", __FUNCTION__, (unsigned int)indexes.size());
+  }
+
+  BeginTransaction();
+  m_bulkImport = true;
+  return true;
+}
+
+bool CDatabase::FlushBulkImport()
+{
+  if (!m_bulkImport)
+    return false;
+
+  // the savepoints of transactions that are still open would be lost
+  if (m_bulkDepth > 0)
+    return true;
+
+  m_bulkImport = false;
+  bool ret = CDatabase::CommitTransaction();
+  BeginTransaction();
+  m_bulkImport = true;
+  return ret;
+}
+
+bool CDatabase::EndBulkImport()
+{
+  if (!m_bulkImport)
+    return false;
+
+  m_bulkImport = false;
+  m_bulkDepth = 0;
+  ClearBulkImportCaches();
+  bool ret = CommitTransaction();
+
+  if (m_sqlite)
+  {
+    CreateBulkImportIndexes();
+    try
+    {
+      m_pDS->exec("ANALYZE");
+    }
+    catch (...)
+    {
+      CLog::Log(LOGERROR, "%s unable to analyze the database", __FUNCTION__);
+    }
+  }
+  return ret;
+}
+
+void CDatabase::CreateBulkImportIndexes()
+{
+  std::vector<std::string> indexes;
+  GetBulkImportIndexes(indexes);
+  for (std::vector<std::string>::iterator i = indexes.begin(); i != indexes.end(); ++i)
+  {
+    size_t pos = i->find("INDEX ");
+    if (pos == std::string::npos)
+      continue;
+    i->insert(pos + 6, "IF NOT EXISTS ");
+    try
+    {
+      m_pDS->exec(i->c_str());
+    }
+    catch (...)
+    {
+      CLog::Log(LOGERROR, "%s unable to create index (%s)", __FUNCTION__, i->c_str());
+    }
+  }
+}
+
 bool CDatabase::CreateTables()
 {
 
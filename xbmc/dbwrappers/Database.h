@@ -28,6 +28,8 @@ namespace dbiplus {
 }
 
 #include <memory>
+#include <string>
+#include <vector>
 
 class DatabaseSettings; // forward
 class CDbUrl;
@@ -71,6 +73,31 @@ public:
   void RollbackTransaction();
   bool InTransaction();
 
+  /*! \brief Start importing a large number of items, e.g. on the first scan of a library.
+   Everything up to EndBulkImport() is written in one large transaction. Transactions begun in
+   between become savepoints inside it, so rolling one back only undoes its own changes. On sqlite the indexes returned by
+   GetBulkImportIndexes() are dropped, so they're built once at the end rather than updated for
+   every row.
+   \return true if the import was started, false otherwise.
+   \sa FlushBulkImport, EndBulkImport, GetBulkImportIndexes
+   */
+  bool BeginBulkImport();
+
+  /*! \brief Commit what has been imported so far and carry on importing.
+   Lets other writers in every now and then during a long import. Nothing is committed while
+   a nested transaction is still open.
+   \return true if the items were committed, false otherwise.
+   */
+  bool FlushBulkImport();
+
+  /*! \brief Finish a bulk import, rebuilding the deferred indexes and committing everything.
+   The database statistics are refreshed afterwards, as the import usually changes them a lot.
+   \return true if the import was committed, false otherwise.
+   \sa BeginBulkImport
+   */
+  virtual bool EndBulkImport();
+  bool InBulkImport() const { return m_bulkImport; };
+
   static CStdString FormatSQL(CStdString strStmt, ...);
   CStdString PrepareSQL(CStdString strStmt, ...) const;
 
@@ -152,6 +179,22 @@ protected:
   virtual void CreateViews() {};
   virtual bool UpdateOldVersion(int version) { return true; };
 
+  /*! \brief Retrieve the indexes that may be dropped during a bulk import.
+   Only indexes that aren't used for the lookups done while adding items should be listed,
+   as those would otherwise turn into table scans. The statements must match those in CreateTables()
+   and UpdateOldVersion(), as they're also used to restore the indexes should an import not finish.
+   \param indexes [out] the sqlite statements creating the indexes.
+   \sa BeginBulkImport
+   */
+  virtual void GetBulkImportIndexes(std::vector<std::string> &indexes) const {};
+
+  /*! \brief Forget the ids cached while importing in bulk.
+   Called when the import ends and when a transaction nested in it is rolled back, as the cached
+   ids may belong to rows that were rolled back.
+   \sa BeginBulkImport, RollbackTransaction
+   */
+  virtual void ClearBulkImportCaches() {};
+
   virtual int GetMinVersion() const=0;
   virtual const char *GetBaseDBName() const=0;
 
@@ -173,4 +216,9 @@ private:
 
   bool m_bMultiWrite; /*!< True if there are any queries in the queue, false otherwise */
   unsigned int m_openCount;
+  void CreateBulkImportIndexes();
+  bool ExecSavepoint(const char *statement, unsigned int depth);
+
+  bool m_bulkImport; /*!< True while a bulk import is in progress */
+  unsigned int m_bulkDepth; /*!< Number of transactions nested in the bulk import, each of them a savepoint */
 };
@@ -0,0 +1,47 @@
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DatabaseRecords.h"
+#include "dataset.h"
+
+using namespace dbiplus;
+
+CDatabaseRecords::CDatabaseRecords(LoadFunction load, const CStdString &baseDir)
+  : m_load(load), m_baseDir(baseDir)
+{
+}
+
+CDatabaseRecords::~CDatabaseRecords()
+{
+  for (query_data::iterator it = m_records.begin(); it != m_records.end(); ++it)
+    delete *it;
+}
+
+unsigned int CDatabaseRecords::Add(Dataset *dataset, int index)
+{
+  m_records.push_back(dataset->release_record(index));
+  return m_records.size() - 1;
+}
+
+void CDatabaseRecords::LoadRecord(unsigned int row, CFileItem &item) const
+{
+  if (row < m_records.size() && m_records[row])
+    m_load(m_records[row], &item, m_baseDir);
+}
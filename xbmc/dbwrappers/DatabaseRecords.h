@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FileItem.h"
+#include "qry_dat.h"
+#include "utils/StdString.h"
+
+namespace dbiplus
+{
+  class Dataset;
+}
+
+/*!
+ \brief Records of a query kept for the record backed items built from them
+
+ The records are taken over from the dataset rather than copied, so the
+ result set of a query is only held once, however many items refer to it.
+ */
+class CDatabaseRecords : public IFileItemRecords
+{
+public:
+  /*!
+   \brief Function filling in an item from a record, must not need the database
+   */
+  typedef void (*LoadFunction)(const dbiplus::sql_record* const record, CFileItem* item, const CStdString &baseDir);
+
+  CDatabaseRecords(LoadFunction load, const CStdString &baseDir);
+  virtual ~CDatabaseRecords();
+
+  /*!
+   \brief Take a record out of a dataset
+   \param dataset the dataset holding the record
+   \param index index of the record in the dataset
+   \return the row of the record, to pass to CFileItem::SetRecord()
+   */
+  unsigned int Add(dbiplus::Dataset *dataset, int index);
+
+  virtual void LoadRecord(unsigned int row, CFileItem &item) const;
+
+private:
+  LoadFunction m_load;
+  CStdString m_baseDir;
+  dbiplus::query_data m_records;
+};
@@ -365,6 +365,16 @@ const sql_record* const Dataset::get_sql_record()
   return result.records[frecno];
 }
 
+sql_record* Dataset::release_record(int index)
+{
+  if (index < 0 || index >= (int)result.records.size())
+    return NULL;
+
+  sql_record *record = result.records[index];
+  result.records[index] = NULL;
+  return record;
+}
+
 const field_value Dataset::f_old(const char *f_name) {
   if (ds_state != dsInactive)
     for (int unsigned i=0; i < fields_object->size(); i++) 
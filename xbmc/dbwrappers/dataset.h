@@ -391,6 +391,8 @@ public:
 /* --------------- for fast access ---------------- */
   const result_set& get_result_set() { return result; }
   const sql_record* const get_sql_record();
+/* take a record out of the result set, the caller has to delete it */
+  sql_record* release_record(int index);
 
  private:
   void set_ds_state(dsStates new_state) {ds_state = new_state;};	
@@ -0,0 +1,141 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "dbwrappers/Database.h"
+#include "dbwrappers/sqlitedataset.h"
+#include "filesystem/File.h"
+#include "test/TestUtils.h"
+#include "threads/SystemClock.h"
+#include "utils/URIUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+#define BENCHMARK_ITEMS 5000
+
+/* a database with a single table of items, imported like a library scan would import them */
+class TestDatabase : public CDatabase
+{
+public:
+  TestDatabase() : m_file(NULL) {}
+  ~TestDatabase()
+  {
+    m_pDS2.reset();
+    m_pDS.reset();
+    m_pDB.reset();
+    XBMC_DELETETEMPFILE(m_file);
+  }
+
+  bool Connect()
+  {
+    m_file = XBMC_CREATETEMPFILE(".db");
+    if (!m_file)
+      return false;
+    m_file->Close();
+
+    CStdString path = XBMC_TEMPFILEPATH(m_file);
+    m_pDB.reset(new dbiplus::SqliteDatabase());
+    m_pDB->setHostName(URIUtils::GetDirectory(path).c_str());
+    m_pDB->setDatabase(URIUtils::GetFileName(path).c_str());
+    if (m_pDB->connect(true) != DB_CONNECTION_OK)
+      return false;
+    m_pDS.reset(m_pDB->CreateDataset());
+    m_pDS2.reset(m_pDB->CreateDataset());
+
+    m_pDS->exec("CREATE TABLE item (idItem integer primary key, strName text, iValue integer)");
+    m_pDS->exec("CREATE INDEX ix_item_1 ON item (strName)");
+    m_pDS->exec("CREATE INDEX ix_item_2 ON item (iValue)");
+    return true;
+  }
+
+  /* adds an item in its own transaction, rolling it back if asked to */
+  void AddItem(int item, bool rollback = false)
+  {
+    BeginTransaction();
+    m_pDS->exec(PrepareSQL("INSERT INTO item (idItem, strName, iValue) VALUES (NULL, 'item %i', %i)", item, item).c_str());
+    if (rollback)
+      RollbackTransaction();
+    else
+      CommitTransaction();
+  }
+
+  int CountItems(const CStdString &where = "")
+  {
+    m_pDS->query(("SELECT COUNT(1) FROM item" + where).c_str());
+    int count = m_pDS->fv(0).get_asInt();
+    m_pDS->close();
+    return count;
+  }
+
+protected:
+  virtual void GetBulkImportIndexes(std::vector<std::string> &indexes) const
+  {
+    indexes.push_back("CREATE INDEX ix_item_2 ON item (iValue)");
+  }
+  virtual int GetMinVersion() const { return 1; }
+  virtual const char *GetBaseDBName() const { return "Test"; }
+
+private:
+  XFILE::CFile *m_file;
+};
+
+TEST(TestDatabase, BulkImportRollback)
+{
+  TestDatabase db;
+  ASSERT_TRUE(db.Connect());
+
+  EXPECT_TRUE(db.BeginBulkImport());
+  db.AddItem(1);
+  db.AddItem(2, true);
+  db.AddItem(3);
+  EXPECT_TRUE(db.FlushBulkImport());
+  db.AddItem(4, true);
+  db.AddItem(5);
+  EXPECT_TRUE(db.EndBulkImport());
+
+  /* only the rolled back items are missing */
+  EXPECT_EQ(3, db.CountItems());
+  EXPECT_EQ(0, db.CountItems(" WHERE iValue IN (2, 4)"));
+}
+
+TEST(TestDatabase, BulkImportBenchmark)
+{
+  TestDatabase single, bulk;
+  ASSERT_TRUE(single.Connect());
+  ASSERT_TRUE(bulk.Connect());
+
+  unsigned int start = XbmcThreads::SystemClockMillis();
+  for (int item = 0; item < BENCHMARK_ITEMS; item++)
+    single.AddItem(item);
+  unsigned int singleTime = XbmcThreads::SystemClockMillis() - start;
+
+  start = XbmcThreads::SystemClockMillis();
+  EXPECT_TRUE(bulk.BeginBulkImport());
+  for (int item = 0; item < BENCHMARK_ITEMS; item++)
+    bulk.AddItem(item);
+  EXPECT_TRUE(bulk.EndBulkImport());
+  unsigned int bulkTime = XbmcThreads::SystemClockMillis() - start;
+
+  EXPECT_EQ(BENCHMARK_ITEMS, single.CountItems());
+  EXPECT_EQ(BENCHMARK_ITEMS, bulk.CountItems());
+  std::cout << BENCHMARK_ITEMS << " items took " << singleTime << " ms one transaction each, " <<
+    bulkTime << " ms imported in bulk" << std::endl;
+}
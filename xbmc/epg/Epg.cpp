@@ -34,6 +34,8 @@
 
 #include "../addons/include/xbmc_pvr_types.h" // TODO extract the epg specific stuff
 
+#include <algorithm>
+
 using namespace PVR;
 using namespace EPG;
 using namespace std;
@@ -45,7 +47,9 @@ CEpg::CEpg(int iEpgID, const CStdString &strName /* = "" */, const CStdString &s
     m_bUpdatePending(false),
     m_iEpgID(iEpgID),
     m_strName(strName),
-    m_strScraperName(strScraperName)
+    m_strScraperName(strScraperName),
+    m_bSnapshotStale(true),
+    m_iSnapshotMaxDuration(0)
 {
   CPVRChannelPtr empty;
   m_pvrChannel = empty;
@@ -59,7 +63,9 @@ CEpg::CEpg(CPVRChannelPtr channel, bool bLoadedFromDb /* = false */) :
     m_iEpgID(channel->EpgID()),
     m_strName(channel->ChannelName()),
     m_strScraperName(channel->EPGScraper()),
-    m_pvrChannel(channel)
+    m_pvrChannel(channel),
+    m_bSnapshotStale(true),
+    m_iSnapshotMaxDuration(0)
 {
 }
 
@@ -68,7 +74,9 @@ CEpg::CEpg(void) :
     m_bTagsChanged(false),
     m_bLoaded(false),
     m_bUpdatePending(false),
-    m_iEpgID(0)
+    m_iEpgID(0),
+    m_bSnapshotStale(true),
+    m_iSnapshotMaxDuration(0)
 {
   CPVRChannelPtr empty;
   m_pvrChannel = empty;
@@ -88,12 +96,16 @@ CEpg &CEpg::operator =(const CEpg &right)
   m_iEpgID            = right.m_iEpgID;
   m_strName           = right.m_strName;
   m_strScraperName    = right.m_strScraperName;
-  m_nowActiveStart    = right.m_nowActiveStart;
   m_lastScanTime      = right.m_lastScanTime;
   m_pvrChannel        = right.m_pvrChannel;
 
   for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = right.m_tags.begin(); it != right.m_tags.end(); it++)
-    m_tags.insert(make_pair(it->first, new CEpgInfoTag(*it->second)));
+  {
+    CEpgInfoTagPtr tag(new CEpgInfoTag(*it->second));
+    m_tags.insert(make_pair(it->first, tag));
+    m_searchIndex.Add(tag);
+  }
+  InvalidateTags();
 
   return *this;
 }
@@ -141,17 +153,23 @@ void CEpg::ForceUpdate(void)
 
 bool CEpg::HasValidEntries(void) const
 {
-  CSingleLock lock(m_critSection);
+  EpgTagsPtr tags = GetTags();
 
+  CSingleLock lock(m_critSection);
   return (m_iEpgID > 0 && /* valid EPG ID */
-      m_tags.size() > 0 && /* contains at least 1 tag */
-      m_tags.rbegin()->second->EndAsUTC() >= CDateTime::GetCurrentDateTime().GetAsUTCDateTime()); /* the last end time hasn't passed yet */
+      !tags->empty() && /* contains at least 1 tag */
+      tags->back()->EndAsUTC() >= CDateTime::GetCurrentDateTime().GetAsUTCDateTime()); /* the last end time hasn't passed yet */
 }
 
 void CEpg::Clear(void)
 {
   CSingleLock lock(m_critSection);
   m_tags.clear();
+  m_searchIndex.Clear();
+  InvalidateTags();
+
+  CSingleLock snapshotLock(m_snapshotSection);
+  m_nowActive.reset();
 }
 
 void CEpg::Cleanup(void)
@@ -168,51 +186,56 @@ void CEpg::Cleanup(const CDateTime &Time)
   {
     if (it->second->EndAsUTC() < Time)
     {
-      if (m_nowActiveStart == it->first)
-        m_nowActiveStart.SetValid(false);
+      {
+        CSingleLock snapshotLock(m_snapshotSection);
+        if (m_nowActive == it->second)
+          m_nowActive.reset();
+      }
 
       it->second->ClearTimer();
+      m_searchIndex.Remove(it->second.get());
       m_tags.erase(it++);
+      InvalidateTags();
     }
   }
 }
 
 bool CEpg::InfoTagNow(CEpgInfoTag &tag, bool bUpdateIfNeeded /* = true */)
 {
-  CSingleLock lock(m_critSection);
-  if (m_nowActiveStart.IsValid())
   {
-    map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.find(m_nowActiveStart);
-    if (it != m_tags.end() && it->second->IsActive())
+    CSingleLock lock(m_snapshotSection);
+    if (m_nowActive && m_nowActive->IsActive())
     {
-      tag = *it->second;
+      tag = *m_nowActive;
       return true;
     }
   }
 
   if (bUpdateIfNeeded)
   {
-    CDateTime lastActiveTag;
-
-    /* one of the first items will always match if the list is sorted */
-    for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
+    EpgTagsPtr tags = GetTags();
+    EpgTags::const_iterator it = FindTagAround(*tags, CDateTime::GetUTCDateTime());
+    if (it != tags->end())
     {
-      if (it->second->IsActive())
+      /* the next event may have been moved to start earlier by FixOverlappingEvents() */
+      EpgTags::const_iterator next = it + 1;
+      if (!(*it)->IsActive() && next != tags->end() && (*next)->IsActive())
+        it = next;
+
+      if ((*it)->IsActive())
       {
-        m_nowActiveStart = it->first;
-        tag = *it->second;
+        CSingleLock lock(m_snapshotSection);
+        m_nowActive = *it;
+        tag = **it;
         return true;
       }
-      else if (it->second->WasActive())
-        lastActiveTag = it->first;
-    }
 
-    /* there might be a gap between the last and next event. just return the last if found */
-    map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.find(lastActiveTag);
-    if (it != m_tags.end())
-    {
-      tag = *it->second;
-      return true;
+      /* there might be a gap between the last and next event. just return the last if found */
+      if ((*it)->WasActive())
+      {
+        tag = **it;
+        return true;
+      }
     }
   }
 
@@ -224,22 +247,25 @@ bool CEpg::InfoTagNext(CEpgInfoTag &tag)
   CEpgInfoTag nowTag;
   if (InfoTagNow(nowTag))
   {
-    CSingleLock lock(m_critSection);
-    map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.find(nowTag.StartAsUTC());
-    if (it != m_tags.end() && ++it != m_tags.end())
+    EpgTagsPtr tags = GetTags();
+    EpgTags::const_iterator it = FindTagAround(*tags, nowTag.StartAsUTC());
+    if (it != tags->end() && ++it != tags->end())
     {
-      tag = *it->second;
+      tag = **it;
       return true;
     }
   }
-  else if (Size() > 0)
+  else
   {
     /* return the first event that is in the future */
-    for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
+    EpgTagsPtr tags = GetTags();
+    EpgTags::const_iterator it = FindTagAround(*tags, CDateTime::GetUTCDateTime());
+    it = (it == tags->end()) ? tags->begin() : it + 1;
+    for (; it != tags->end(); ++it)
     {
-      if (it->second->InTheFuture())
+      if ((*it)->InTheFuture())
       {
-        tag = *it->second;
+        tag = **it;
         return true;
       }
     }
@@ -281,11 +307,14 @@ CEpgInfoTagPtr CEpg::GetTag(const CDateTime &StartTime) const
 
 CEpgInfoTagPtr CEpg::GetTagBetween(const CDateTime &beginTime, const CDateTime &endTime) const
 {
-  CSingleLock lock(m_critSection);
-  for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
+  EpgTagsPtr tags = GetTags();
+
+  /* tags that start after endTime can't end before it */
+  EpgTags::const_iterator it = FindTagAround(*tags, beginTime);
+  for (it = (it == tags->end()) ? tags->begin() : it; it != tags->end() && (*it)->StartAsUTC() <= endTime; ++it)
   {
-    if (it->second->StartAsUTC() >= beginTime && it->second->EndAsUTC() <= endTime)
-      return it->second;
+    if ((*it)->StartAsUTC() >= beginTime && (*it)->EndAsUTC() <= endTime)
+      return *it;
   }
 
   CEpgInfoTagPtr retVal;
@@ -294,15 +323,87 @@ CEpgInfoTagPtr CEpg::GetTagBetween(const CDateTime &beginTime, const CDateTime &
 
 CEpgInfoTagPtr CEpg::GetTagAround(const CDateTime &time) const
 {
+  int iMaxDuration(0);
+  EpgTagsPtr tags = GetTags(&iMaxDuration);
+  CEpgInfoTagPtr retVal;
+
+  /* the first tag that is running at the given time. tags overlap until they're fixed,
+     so look back at every tag that started less than the longest tag lasts before it */
+  CDateTime earliest = time - CDateTimeSpan(0, 0, 0, iMaxDuration);
+  for (EpgTags::const_iterator it = FindTagAround(*tags, time); it != tags->end(); --it)
+  {
+    if ((*it)->EndAsUTC() >= time)
+      retVal = *it;
+    if (it == tags->begin() || (*it)->StartAsUTC() < earliest)
+      break;
+  }
+
+  return retVal;
+}
+
+EpgTagsPtr CEpg::GetTags(int *iMaxDuration /* = NULL */) const
+{
+  {
+    CSingleLock lock(m_snapshotSection);
+    if (m_snapshot && !m_bSnapshotStale)
+    {
+      if (iMaxDuration)
+        *iMaxDuration = m_iSnapshotMaxDuration;
+      return m_snapshot;
+    }
+  }
+
+  /* don't wait for an update that's in progress if we've got something to show */
+  CSingleTryLock tryLock((CCriticalSection &)m_critSection);
+  if (!tryLock.IsOwner())
+  {
+    CSingleLock lock(m_snapshotSection);
+    if (m_snapshot)
+    {
+      if (iMaxDuration)
+        *iMaxDuration = m_iSnapshotMaxDuration;
+      return m_snapshot;
+    }
+  }
+
   CSingleLock lock(m_critSection);
+  EpgTags *tags = new EpgTags;
+  int iLongest(0);
+  tags->reserve(m_tags.size());
   for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
   {
-    if ((it->second->StartAsUTC() <= time) && (it->second->EndAsUTC() >= time))
-      return it->second;
+    tags->push_back(it->second);
+    iLongest = max(iLongest, it->second->GetDuration());
   }
 
-  CEpgInfoTagPtr retVal;
-  return retVal;
+  CSingleLock snapshotLock(m_snapshotSection);
+  m_snapshot = EpgTagsPtr(tags);
+  m_iSnapshotMaxDuration = iLongest;
+  m_bSnapshotStale = false;
+  if (iMaxDuration)
+    *iMaxDuration = m_iSnapshotMaxDuration;
+  return m_snapshot;
+}
+
+void CEpg::InvalidateTags(void)
+{
+  CSingleLock lock(m_snapshotSection);
+  m_bSnapshotStale = true;
+}
+
+/*! Orders a time before the tags that start after it */
+struct TagStartsAfter
+{
+  bool operator()(const CDateTime &time, const CEpgInfoTagPtr &tag) const
+  {
+    return tag->StartAsUTC() > time;
+  }
+};
+
+EpgTags::const_iterator CEpg::FindTagAround(const EpgTags &tags, const CDateTime &time)
+{
+  EpgTags::const_iterator it = upper_bound(tags.begin(), tags.end(), time, TagStartsAfter());
+  return it == tags.begin() ? tags.end() : it - 1;
 }
 
 void CEpg::AddEntry(const CEpgInfoTag &tag)
@@ -320,10 +421,13 @@ void CEpg::AddEntry(const CEpgInfoTag &tag)
 
   if (newTag)
   {
+    /* the end time may change as well */
+    InvalidateTags();
     newTag->Update(tag);
     newTag->SetPVRChannel(m_pvrChannel);
     newTag->m_epg          = this;
     newTag->m_bChanged     = false;
+    m_searchIndex.Add(newTag);
   }
 }
 
@@ -348,9 +452,12 @@ bool CEpg::UpdateEntry(const CEpgInfoTag &tag, bool bUpdateDatabase /* = false *
       bNewTag = true;
     }
 
+    /* the end time may change as well */
+    InvalidateTags();
     infoTag->Update(tag, bNewTag);
     infoTag->m_epg          = this;
     infoTag->m_pvrChannel   = m_pvrChannel;
+    m_searchIndex.Add(infoTag);
   }
 
   if (bUpdateDatabase)
@@ -396,59 +503,36 @@ bool CEpg::Load(void)
 bool CEpg::UpdateEntries(const CEpg &epg, bool bStoreInDb /* = true */)
 {
   bool bReturn(false);
-  CEpgDatabase *database = g_EpgContainer.GetDatabase();
 
   if (epg.m_tags.size() > 0)
   {
-    if (bStoreInDb)
-    {
-      if (!database || !database->IsOpen())
-      {
-        CLog::Log(LOGERROR, "EPG -%s - could not open the database", __FUNCTION__);
-        return bReturn;
-      }
-      database->BeginTransaction();
-    }
-
-    {
-      CSingleLock lock(m_critSection);
+    CSingleLock lock(m_critSection);
 #if EPG_DEBUGGING
-      CLog::Log(LOGDEBUG, "EPG - %s - %zu entries in memory before merging", __FUNCTION__, m_tags.size());
+    CLog::Log(LOGDEBUG, "EPG - %s - %zu entries in memory before merging", __FUNCTION__, m_tags.size());
 #endif
-      /* copy over tags */
-      for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = epg.m_tags.begin(); it != epg.m_tags.end(); it++)
-        UpdateEntry(*it->second, bStoreInDb, false);
+    /* copy over tags */
+    for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = epg.m_tags.begin(); it != epg.m_tags.end(); it++)
+      UpdateEntry(*it->second, false, false);
 
 #if EPG_DEBUGGING
-      CLog::Log(LOGDEBUG, "EPG - %s - %zu entries in memory after merging and before fixing", __FUNCTION__, m_tags.size());
+    CLog::Log(LOGDEBUG, "EPG - %s - %zu entries in memory after merging and before fixing", __FUNCTION__, m_tags.size());
 #endif
-      FixOverlappingEvents(bStoreInDb);
+    FixOverlappingEvents(bStoreInDb);
 
 #if EPG_DEBUGGING
-      CLog::Log(LOGDEBUG, "EPG - %s - %zu entries in memory after fixing", __FUNCTION__, m_tags.size());
+    CLog::Log(LOGDEBUG, "EPG - %s - %zu entries in memory after fixing", __FUNCTION__, m_tags.size());
 #endif
-      /* update the last scan time of this table */
-      m_lastScanTime = CDateTime::GetCurrentDateTime().GetAsUTCDateTime();
+    /* update the last scan time of this table */
+    m_lastScanTime = CDateTime::GetCurrentDateTime().GetAsUTCDateTime();
 
-      SetChanged();
-    }
-    /* persist changes */
-    if (bStoreInDb)
-    {
-      bReturn = database->CommitTransaction();
-      if (bReturn)
-        Persist(true);
-    }
-    else
-      bReturn = true;
+    SetChanged();
   }
+
+  /* persist changes */
+  if (bStoreInDb)
+    bReturn = Persist(true);
   else
-  {
-    if (bStoreInDb)
-      bReturn = Persist(true);
-    else
-      bReturn = true;
-  }
+    bReturn = true;
 
   NotifyObservers(ObservableMessageEpg);
 
@@ -486,9 +570,19 @@ CDateTime CEpg::GetLastScanTime(void)
 
 bool CEpg::Update(const time_t start, const time_t end, int iUpdateTime, bool bForceUpdate /* = false */)
 {
-  bool bGrabSuccess(true);
-  bool bUpdate(false);
+  CEpg *fetched(NULL);
+  bool bFetch = PrepareUpdate(iUpdateTime, bForceUpdate);
+  if (bFetch)
+    fetched = FetchFromClients(start, end);
+
+  bool bReturn = FinishUpdate(fetched, bFetch);
+  delete fetched;
+
+  return bReturn;
+}
 
+bool CEpg::PrepareUpdate(int iUpdateTime, bool bForceUpdate /* = false */)
+{
   /* load the entries from the db first */
   if (!m_bLoaded && !g_EpgContainer.IgnoreDB())
     Load();
@@ -497,27 +591,50 @@ bool CEpg::Update(const time_t start, const time_t end, int iUpdateTime, bool bF
   if (m_bLoaded)
     Cleanup();
 
+  if (bForceUpdate)
+    return true;
+
   /* get the last update time from the database */
   CDateTime lastScanTime = GetLastScanTime();
 
   /* force an update for TV channels when we don't have any data every 60 seconds */
-  if (m_tags.empty() && !bUpdate && ChannelID() > 0 && !Channel()->IsRadio())
+  if (m_tags.empty() && ChannelID() > 0 && !Channel()->IsRadio())
     iUpdateTime = 60;
 
-  if (!bForceUpdate)
+  /* check if we have to update */
+  time_t iNow = 0;
+  time_t iLastUpdate = 0;
+  CDateTime::GetCurrentDateTime().GetAsUTCDateTime().GetAsTime(iNow);
+  lastScanTime.GetAsTime(iLastUpdate);
+  return (iNow > iLastUpdate + iUpdateTime);
+}
+
+CEpg *CEpg::FetchFromClients(time_t start, time_t end) const
+{
+  CEpg *fetched(NULL);
+  CPVRChannelPtr channel = Channel();
+  if (channel)
+    fetched = new CEpg(channel);
+  else
   {
-    /* check if we have to update */
-    time_t iNow = 0;
-    time_t iLastUpdate = 0;
-    CDateTime::GetCurrentDateTime().GetAsUTCDateTime().GetAsTime(iNow);
-    lastScanTime.GetAsTime(iLastUpdate);
-    bUpdate = (iNow > iLastUpdate + iUpdateTime);
+    CSingleLock lock(m_critSection);
+    fetched = new CEpg(m_iEpgID, m_strName, m_strScraperName);
   }
-  else
-    bUpdate = true;
 
-  if (bUpdate)
-    bGrabSuccess = LoadFromClients(start, end);
+  if (!fetched->UpdateFromScraper(start, end))
+  {
+    delete fetched;
+    fetched = NULL;
+  }
+
+  return fetched;
+}
+
+bool CEpg::FinishUpdate(const CEpg *fetched, bool bFetched)
+{
+  bool bGrabSuccess(true);
+  if (bFetched)
+    bGrabSuccess = fetched && UpdateEntries(*fetched, !g_guiSettings.GetBool("epg.ignoredbforclient"));
 
   if (bGrabSuccess)
   {
@@ -540,10 +657,9 @@ int CEpg::Get(CFileItemList &results) const
 {
   int iInitialSize = results.Size();
 
-  CSingleLock lock(m_critSection);
-
-  for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
-    results.Add(CFileItemPtr(new CFileItem(*it->second)));
+  EpgTagsPtr tags = GetTags();
+  for (EpgTags::const_iterator it = tags->begin(); it != tags->end(); ++it)
+    results.Add(CFileItemPtr(new CFileItem(**it)));
 
   return results.Size() - iInitialSize;
 }
@@ -555,12 +671,33 @@ int CEpg::Get(CFileItemList &results, const EpgSearchFilter &filter) const
   if (!HasValidEntries())
     return -1;
 
-  CSingleLock lock(m_critSection);
+  /* only check the tags that the index can't rule out */
+  EpgTags candidates;
+  EpgTagsPtr tags;
+  if (m_searchIndex.Find(filter, candidates))
+    tags = EpgTagsPtr(new EpgTags(candidates));
+  else
+    tags = GetTags();
 
-  for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
+  for (EpgTags::const_iterator it = tags->begin(); it != tags->end(); ++it)
   {
-    if (filter.FilterEntry(*it->second))
-      results.Add(CFileItemPtr(new CFileItem(*it->second)));
+    if (filter.FilterEntry(**it))
+      results.Add(CFileItemPtr(new CFileItem(**it)));
+  }
+
+  return results.Size() - iInitialSize;
+}
+
+int CEpg::Get(CFileItemList &results, const CDateTime &start, const CDateTime &end) const
+{
+  int iInitialSize = results.Size();
+
+  EpgTagsPtr tags = GetTags();
+  EpgTags::const_iterator it = FindTagAround(*tags, start);
+  for (it = (it == tags->end()) ? tags->begin() : it; it != tags->end() && (*it)->StartAsUTC() < end; ++it)
+  {
+    if ((*it)->EndAsUTC() > start)
+      results.Add(CFileItemPtr(new CFileItem(**it)));
   }
 
   return results.Size() - iInitialSize;
@@ -579,37 +716,55 @@ bool CEpg::Persist(bool bUpdateLastScanTime /* = false */)
     return false;
   }
 
-  CEpg epgCopy;
+  bool bChanged(false);
+  vector<int> deletedTags;
+  vector<CEpgInfoTagPtr> changedTags;
   {
     CSingleLock lock(m_critSection);
-    epgCopy = *this;
+    bChanged = m_iEpgID <= 0 || m_bChanged;
+    deletedTags.swap(m_deletedTags);
+    for (map<CDateTime, CEpgInfoTagPtr>::const_iterator it = m_tags.begin(); it != m_tags.end(); it++)
+    {
+      if (it->second->m_bChanged)
+        changedTags.push_back(it->second);
+    }
     m_bChanged     = false;
     m_bTagsChanged = false;
   }
 
+  bool bReturn(true);
   database->BeginTransaction();
 
-  if (epgCopy.m_iEpgID <= 0 || epgCopy.m_bChanged)
+  if (bChanged)
   {
-    int iId = database->Persist(epgCopy);
+    int iId = database->Persist(*this);
     if (iId > 0)
     {
-      epgCopy.m_iEpgID   = iId;
-      epgCopy.m_bChanged = false;
-      if (m_iEpgID != epgCopy.m_iEpgID)
-      {
-        CSingleLock lock(m_critSection);
-        m_iEpgID = epgCopy.m_iEpgID;
-      }
+      CSingleLock lock(m_critSection);
+      m_iEpgID = iId;
     }
+    else
+      bReturn = false;
   }
 
-  bool bReturn(true);
+  if (bReturn && (!deletedTags.empty() || !changedTags.empty()))
+    bReturn = database->PersistChanges(m_iEpgID, deletedTags, changedTags);
 
-  if (bUpdateLastScanTime)
-    bReturn = database->PersistLastEpgScanTime(epgCopy.m_iEpgID);
+  if (bReturn && bUpdateLastScanTime)
+    bReturn = database->PersistLastEpgScanTime(m_iEpgID);
 
-  database->CommitTransaction();
+  if (bReturn)
+    bReturn = database->CommitTransaction();
+  else
+    database->RollbackTransaction();
+
+  if (!bReturn)
+  {
+    /* try again next time */
+    CSingleLock lock(m_critSection);
+    m_bChanged = m_bChanged || bChanged;
+    m_deletedTags.insert(m_deletedTags.end(), deletedTags.begin(), deletedTags.end());
+  }
 
   return bReturn;
 }
@@ -618,9 +773,9 @@ CDateTime CEpg::GetFirstDate(void) const
 {
   CDateTime first;
 
-  CSingleLock lock(m_critSection);
-  if (m_tags.size() > 0)
-    first = m_tags.begin()->second->StartAsUTC();
+  EpgTagsPtr tags = GetTags();
+  if (!tags->empty())
+    first = tags->front()->StartAsUTC();
 
   return first;
 }
@@ -629,9 +784,9 @@ CDateTime CEpg::GetLastDate(void) const
 {
   CDateTime last;
 
-  CSingleLock lock(m_critSection);
-  if (m_tags.size() > 0)
-    last = m_tags.rbegin()->second->StartAsUTC();
+  EpgTagsPtr tags = GetTags();
+  if (!tags->empty())
+    last = tags->back()->StartAsUTC();
 
   return last;
 }
@@ -666,16 +821,6 @@ bool CEpg::FixOverlappingEvents(bool bUpdateDb /* = false */)
 {
   bool bReturn(true);
   CEpgInfoTagPtr previousTag, currentTag;
-  CEpgDatabase *database(NULL);
-  if (bUpdateDb)
-  {
-    database = g_EpgContainer.GetDatabase();
-    if (!database || !database->IsOpen())
-    {
-      CLog::Log(LOGERROR, "EPG - %s - could not open the database", __FUNCTION__);
-      return false;
-    }
-  }
 
   for (map<CDateTime, CEpgInfoTagPtr>::iterator it = m_tags.begin(); it != m_tags.end(); it != m_tags.end() ? it++ : it)
   {
@@ -689,20 +834,24 @@ bool CEpg::FixOverlappingEvents(bool bUpdateDb /* = false */)
     if (previousTag->EndAsUTC() >= currentTag->EndAsUTC())
     {
       // delete the current tag. it's completely overlapped
-      if (bUpdateDb)
-        bReturn &= database->Delete(*currentTag);
+      if (bUpdateDb && currentTag->BroadcastId() > 0)
+        m_deletedTags.push_back(currentTag->BroadcastId());
 
-      if (m_nowActiveStart == it->first)
-        m_nowActiveStart.SetValid(false);
+      {
+        CSingleLock snapshotLock(m_snapshotSection);
+        if (m_nowActive == it->second)
+          m_nowActive.reset();
+      }
 
       it->second->ClearTimer();
+      m_searchIndex.Remove(it->second.get());
       m_tags.erase(it++);
+      InvalidateTags();
     }
     else if (previousTag->EndAsUTC() > currentTag->StartAsUTC())
     {
       currentTag->SetStartFromUTC(previousTag->EndAsUTC());
-      if (bUpdateDb)
-        bReturn &= currentTag->Persist();
+      InvalidateTags();
 
       previousTag = it->second;
     }
@@ -716,15 +865,7 @@ bool CEpg::FixOverlappingEvents(bool bUpdateDb /* = false */)
 
       currentTag->SetStartFromUTC(newTime);
       previousTag->SetEndFromUTC(newTime);
-
-      if (m_nowActiveStart == it->first)
-        m_nowActiveStart = currentTag->StartAsUTC();
-
-      if (bUpdateDb)
-      {
-        bReturn &= currentTag->Persist();
-        bReturn &= previousTag->Persist();
-      }
+      InvalidateTags();
 
       previousTag = it->second;
     }
@@ -897,18 +1038,11 @@ bool CEpg::IsRemovableTag(const CEpgInfoTag &tag) const
 bool CEpg::LoadFromClients(time_t start, time_t end)
 {
   bool bReturn(false);
-  CPVRChannelPtr channel = Channel();
-  if (channel)
-  {
-    CEpg tmpEpg(channel);
-    if (tmpEpg.UpdateFromScraper(start, end))
-      bReturn = UpdateEntries(tmpEpg, !g_guiSettings.GetBool("epg.ignoredbforclient"));
-  }
-  else
+  CEpg *fetched = FetchFromClients(start, end);
+  if (fetched)
   {
-    CEpg tmpEpg(m_iEpgID, m_strName, m_strScraperName);
-    if (tmpEpg.UpdateFromScraper(start, end))
-      bReturn = UpdateEntries(tmpEpg, !g_guiSettings.GetBool("epg.ignoredbforclient"));
+    bReturn = UpdateEntries(*fetched, !g_guiSettings.GetBool("epg.ignoredbforclient"));
+    delete fetched;
   }
 
   return bReturn;
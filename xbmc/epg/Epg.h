@@ -26,6 +26,7 @@
 
 #include "EpgInfoTag.h"
 #include "EpgSearchFilter.h"
+#include "EpgSearchIndex.h"
 #include "utils/Observer.h"
 #include "pvr/channels/PVRChannel.h"
 
@@ -37,6 +38,9 @@ namespace PVR
 /** EPG container for CEpgInfoTag instances */
 namespace EPG
 {
+  typedef std::vector<CEpgInfoTagPtr> EpgTags;               /*!< tags sorted by start time */
+  typedef boost::shared_ptr<const EpgTags> EpgTagsPtr;
+
   class CEpg : public Observable
   {
     friend class CEpgDatabase;
@@ -229,6 +233,31 @@ namespace EPG
      */
     bool Update(const time_t start, const time_t end, int iUpdateTime, bool bForceUpdate = false);
 
+    /*!
+     * @brief First stage of Update(): load and clean up this table and check whether it has to be fetched.
+     * @param iUpdateTime Update the table after the given amount of time has passed.
+     * @param bForceUpdate Force update from client even if it's not the time to
+     * @return True if the entries have to be fetched, false otherwise.
+     */
+    bool PrepareUpdate(int iUpdateTime, bool bForceUpdate = false);
+
+    /*!
+     * @brief Second stage of Update(): fetch the entries from the clients into a new temporary table.
+     * Doesn't change this table or touch the database, so it can be called from any thread.
+     * @param start Only get entries after this start time.
+     * @param end Only get entries before this end time.
+     * @return The temporary table, which has to be deleted by the caller, or NULL if the entries couldn't be fetched.
+     */
+    CEpg *FetchFromClients(time_t start, time_t end) const;
+
+    /*!
+     * @brief Last stage of Update(): merge the fetched entries into this table and store them in the database.
+     * @param fetched The entries returned by FetchFromClients() or NULL if nothing had to be or could be fetched.
+     * @param bFetched True if entries had to be fetched.
+     * @return True if the update was successful, false otherwise.
+     */
+    bool FinishUpdate(const CEpg *fetched, bool bFetched);
+
     /*!
      * @brief Get all EPG entries.
      * @param results The file list to store the results in.
@@ -244,8 +273,33 @@ namespace EPG
      */
     int Get(CFileItemList &results, const EpgSearchFilter &filter) const;
 
+    /*!
+     * @brief Get all EPG entries that overlap with the given period.
+     * @param results The file list to store the results in.
+     * @param start The start of the period in UTC.
+     * @param end The end of the period in UTC.
+     * @return The amount of entries that were added.
+     */
+    int Get(CFileItemList &results, const CDateTime &start, const CDateTime &end) const;
+
+    /*!
+     * @brief Get a snapshot of all entries in this table, sorted by start time.
+     *
+     * The snapshot is never changed, later changes to the table create a new one. It can be
+     * used without holding any lock, and getting one doesn't wait for an update of this table
+     * that's in progress; the previous snapshot is returned instead.
+     *
+     * The tags in the snapshot are shared with the table, so they have to be read through their
+     * accessors or copied, which lock them.
+     *
+     * @param iMaxDuration Set to the duration of the longest tag in the snapshot in seconds, if given.
+     * @return The snapshot.
+     */
+    EpgTagsPtr GetTags(int *iMaxDuration = NULL) const;
+
     /*!
      * @brief Persist this table in the database.
+     * Only the tags that were added or changed and the ids of the tags that were removed since the last call are written.
      * @param bUpdateLastScanTime True to update the last scan time in the db, false otherwise.
      * @return True if the table was persisted, false otherwise.
      */
@@ -318,7 +372,7 @@ namespace EPG
 
     /*!
      * @brief Fix overlapping events from the tables.
-     * @param bUpdateDb If set to yes, any changes to tags during fixing will be persisted to database
+     * @param bUpdateDb If set to yes, tags that are removed during fixing will be deleted from the database by the next call to Persist()
      * @return True if anything changed, false otherwise.
      */
     bool FixOverlappingEvents(bool bUpdateDb = false);
@@ -347,7 +401,21 @@ namespace EPG
 
     bool IsRemovableTag(const EPG::CEpgInfoTag &tag) const;
 
+    /*!
+     * @brief Mark the snapshot returned by GetTags() as outdated. Must be called after changing m_tags.
+     */
+    void InvalidateTags(void);
+
+    /*!
+     * @brief Find the tag that starts last at or before the given time.
+     * @param tags The tags to search.
+     * @param time The time in UTC.
+     * @return The tag or tags.end() if all tags start after the given time.
+     */
+    static EpgTags::const_iterator FindTagAround(const EpgTags &tags, const CDateTime &time);
+
     std::map<CDateTime, CEpgInfoTagPtr> m_tags;
+    std::vector<int>                    m_deletedTags;     /*!< database ids of removed tags that still have to be deleted from the database */
     bool                                m_bChanged;        /*!< true if anything changed that needs to be persisted, false otherwise */
     bool                                m_bTagsChanged;    /*!< true when any tags are changed and not persisted, false otherwise */
     bool                                m_bLoaded;         /*!< true when the initial entries have been loaded */
@@ -355,12 +423,19 @@ namespace EPG
     int                                 m_iEpgID;          /*!< the database ID of this table */
     CStdString                          m_strName;         /*!< the name of this table */
     CStdString                          m_strScraperName;  /*!< the name of the scraper to use */
-    CDateTime                           m_nowActiveStart;  /*!< the start time of the tag that is currently active */
+    CEpgInfoTagPtr                      m_nowActive;       /*!< the tag that is currently active */
 
     CDateTime                           m_lastScanTime;    /*!< the last time the EPG has been updated */
 
     PVR::CPVRChannelPtr                 m_pvrChannel;      /*!< the channel this EPG belongs to */
 
     CCriticalSection                    m_critSection;     /*!< critical section for changes in this table */
+
+    mutable EpgTagsPtr                  m_snapshot;        /*!< the tags when they were last changed */
+    mutable bool                        m_bSnapshotStale;  /*!< true when m_tags changed after m_snapshot was taken */
+    mutable int                         m_iSnapshotMaxDuration; /*!< the duration of the longest tag in m_snapshot in seconds */
+    mutable CCriticalSection            m_snapshotSection; /*!< critical section for m_snapshot and m_nowActive */
+
+    CEpgSearchIndex                     m_searchIndex;     /*!< index of the texts and genres of the tags, used by searches */
   };
 }
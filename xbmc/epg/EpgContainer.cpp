@@ -26,7 +26,10 @@
 #include "dialogs/GUIDialogProgress.h"
 #include "guilib/GUIWindowManager.h"
 #include "guilib/LocalizeStrings.h"
+#include "settings/Settings.h"
 #include "utils/log.h"
+#include "utils/URIUtils.h"
+#include "utils/JobManager.h"
 #include "pvr/PVRManager.h"
 #include "pvr/channels/PVRChannelGroupsContainer.h"
 #include "pvr/timers/PVRTimers.h"
@@ -36,12 +39,58 @@
 #include "EpgInfoTag.h"
 #include "EpgSearchFilter.h"
 
+#include <algorithm>
+
 using namespace std;
 using namespace EPG;
 using namespace PVR;
 
 typedef std::map<int, CEpg*>::iterator EPGITR;
 
+#define EPG_UPDATE_BATCH_SIZE 50 /* tables to merge before the database writes are committed */
+
+namespace EPG
+{
+  /*!
+   * @brief Fetches one table from its client for CEpgContainer::UpdateEPG().
+   * One job per table, so the low priority workers are given back between tables.
+   */
+  class CEpgUpdateJob : public CJob
+  {
+  public:
+    CEpgUpdateJob(CEpgContainer *container, int iClientId, CEpg *epg, time_t start, time_t end) :
+      m_container(container),
+      m_iClientId(iClientId),
+      m_epg(epg),
+      m_start(start),
+      m_end(end) {}
+
+    /* the job manager deletes jobs whether they ran or were cancelled, so count the jobs down here */
+    virtual ~CEpgUpdateJob()
+    {
+      CSingleLock lock(m_container->m_fetchSection);
+      m_container->m_clientJobs[m_iClientId]--;
+      m_container->m_iFetchJobs--;
+      m_container->m_fetchEvent.Set();
+    }
+
+    virtual const char *GetType() const { return "epgupdate"; }
+
+    virtual bool DoWork()
+    {
+      m_container->AddFetched(m_epg, m_epg->FetchFromClients(m_start, m_end));
+      return true;
+    }
+
+  private:
+    CEpgContainer *m_container;
+    int            m_iClientId;
+    CEpg          *m_epg;
+    time_t         m_start;
+    time_t         m_end;
+  };
+}
+
 CEpgContainer::CEpgContainer(void) :
     CThread("EPG updater")
 {
@@ -54,6 +103,7 @@ CEpgContainer::CEpgContainer(void) :
   m_updateEvent.Reset();
   m_bLoaded = false;
   m_bHasPendingUpdates = false;
+  m_iFetchJobs = 0;
 }
 
 CEpgContainer::~CEpgContainer(void)
@@ -171,10 +221,13 @@ void CEpgContainer::LoadFromDB(void)
   {
     ShowProgressDialog(false);
 
-    m_database.DeleteOldEpgEntries();
     m_database.Get(*this);
 
-    for (map<unsigned int, CEpg *>::iterator it = m_epgs.begin(); it != m_epgs.end(); it++)
+    /* the snapshot is only valid until the database is changed, so it has to be read before the old entries are deleted */
+    bool bSnapshotLoaded = m_database.LoadSnapshot(*this, GetSnapshotFile());
+    m_database.DeleteOldEpgEntries();
+
+    for (map<unsigned int, CEpg *>::iterator it = m_epgs.begin(); !bSnapshotLoaded && it != m_epgs.end(); it++)
     {
       UpdateProgressDialog(++iCounter, m_epgs.size(), it->second->Name());
       it->second->Load();
@@ -187,6 +240,11 @@ void CEpgContainer::LoadFromDB(void)
   m_bLoaded = bLoaded;
 }
 
+CStdString CEpgContainer::GetSnapshotFile(void)
+{
+  return URIUtils::AddFileToFolder(g_settings.GetDatabaseFolder(), "EpgSnapshot.dat");
+}
+
 bool CEpgContainer::PersistTables(void)
 {
   return m_database.Persist(*this);
@@ -256,6 +314,10 @@ void CEpgContainer::Process(void)
     Sleep(1000);
   }
 
+  /* write a snapshot of the tables, so the next start doesn't have to read them back from the database */
+  if (m_bLoaded && !m_bIgnoreDbForClient && m_database.IsOpen())
+    m_database.PersistSnapshot(*this, GetSnapshotFile());
+
   g_guiSettings.UnregisterObserver(this);
 }
 
@@ -478,9 +540,17 @@ bool CEpgContainer::UpdateEPG(bool bOnlyPending /* = false */)
     return false;
   }
 
-  /* load or update all EPG tables */
+  /* load or update all EPG tables. tables are loaded, merged and persisted on this thread,
+     while update jobs fetch the entries from the clients in parallel */
   CEpg *epg;
   unsigned int iCounter(0);
+  {
+    CSingleLock lock(m_fetchSection);
+    m_fetchQueues.clear();
+    m_fetched.clear();
+    m_clientJobs.clear();
+  }
+
   for (map<unsigned int, CEpg *>::iterator it = m_epgs.begin(); it != m_epgs.end(); it++)
   {
     if (InterruptUpdate())
@@ -490,16 +560,94 @@ bool CEpgContainer::UpdateEPG(bool bOnlyPending /* = false */)
     }
 
     epg = it->second;
-    if (!epg)
+    if (!epg || (bOnlyPending && !epg->UpdatePending()))
       continue;
 
+    if (epg->PrepareUpdate(m_iUpdateTime, bOnlyPending))
+    {
+      CPVRChannelPtr channel = epg->Channel();
+      CSingleLock lock(m_fetchSection);
+      m_fetchQueues[channel ? channel->ClientID() : -1].push_back(epg);
+      continue;
+    }
+
     if (bShowProgress && !bOnlyPending)
       UpdateProgressDialog(++iCounter, m_epgs.size(), epg->Name());
 
-    if ((!bOnlyPending || epg->UpdatePending()) && epg->Update(start, end, m_iUpdateTime, bOnlyPending))
+    if (epg->FinishUpdate(NULL, false))
       ++iUpdatedTables;
   }
 
+  {
+    CSingleLock lock(m_fetchSection);
+    if (bInterrupted)
+      m_fetchQueues.clear();
+
+    /* the tables are taken from the back, so reverse to fetch them in order */
+    for (map<int, vector<CEpg *> >::iterator it = m_fetchQueues.begin(); it != m_fetchQueues.end(); it++)
+      reverse(it->second.begin(), it->second.end());
+  }
+
+  /* merge and persist the tables as they come in, committing the database writes in batches,
+     and start the next job for a client whenever one of its jobs is done */
+  vector<unsigned int> jobs;
+  bool bCancelled(false);
+  bool bBulkImport(false);
+  unsigned int iMerged(0);
+  while (true)
+  {
+    bool bFinished = !StartFetchJobs(start, end, jobs);
+
+    vector<pair<CEpg *, CEpg *> > fetched;
+    {
+      CSingleLock lock(m_fetchSection);
+      fetched.swap(m_fetched);
+    }
+
+    if (!bInterrupted && InterruptUpdate())
+      bInterrupted = true;
+
+    if (bInterrupted && !bCancelled)
+    {
+      /* let the running jobs finish the tables they're fetching and drop the rest */
+      {
+        CSingleLock lock(m_fetchSection);
+        m_fetchQueues.clear();
+      }
+      for (vector<unsigned int>::const_iterator it = jobs.begin(); it != jobs.end(); it++)
+        CJobManager::GetInstance().CancelJob(*it);
+      bCancelled = true;
+    }
+
+    for (vector<pair<CEpg *, CEpg *> >::iterator it = fetched.begin(); it != fetched.end(); it++)
+    {
+      if (!bInterrupted)
+      {
+        if (!bBulkImport && !m_bIgnoreDbForClient)
+          bBulkImport = m_database.BeginBulkImport();
+
+        if (bShowProgress && !bOnlyPending)
+          UpdateProgressDialog(++iCounter, m_epgs.size(), it->first->Name());
+
+        if (it->first->FinishUpdate(it->second, true))
+          ++iUpdatedTables;
+
+        if (bBulkImport && ++iMerged % EPG_UPDATE_BATCH_SIZE == 0)
+          m_database.FlushBulkImport();
+      }
+
+      delete it->second;
+    }
+
+    if (bFinished)
+      break;
+
+    m_fetchEvent.WaitMSec(100);
+  }
+
+  if (bBulkImport)
+    m_database.EndBulkImport();
+
   if (bInterrupted)
   {
     /* the update has been interrupted. try again later */
@@ -531,6 +679,40 @@ bool CEpgContainer::UpdateEPG(bool bOnlyPending /* = false */)
   return !bInterrupted;
 }
 
+bool CEpgContainer::StartFetchJobs(time_t start, time_t end, vector<unsigned int> &jobs)
+{
+  vector<pair<int, CEpg *> > next;
+  bool bFetching;
+  {
+    CSingleLock lock(m_fetchSection);
+    for (map<int, vector<CEpg *> >::iterator it = m_fetchQueues.begin(); it != m_fetchQueues.end(); it++)
+    {
+      unsigned int &iClientJobs = m_clientJobs[it->first];
+      while (!it->second.empty() && iClientJobs < (unsigned int)g_advancedSettings.m_iEpgClientUpdateJobs)
+      {
+        next.push_back(make_pair(it->first, it->second.back()));
+        it->second.pop_back();
+        ++iClientJobs;
+        ++m_iFetchJobs;
+      }
+    }
+    bFetching = m_iFetchJobs > 0;
+  }
+
+  /* the job manager's lock is taken while jobs are destroyed, so jobs must be added without holding ours */
+  for (vector<pair<int, CEpg *> >::const_iterator it = next.begin(); it != next.end(); it++)
+    jobs.push_back(CJobManager::GetInstance().AddJob(new CEpgUpdateJob(this, it->first, it->second, start, end), NULL));
+
+  return bFetching;
+}
+
+void CEpgContainer::AddFetched(CEpg *epg, CEpg *fetched)
+{
+  CSingleLock lock(m_fetchSection);
+  m_fetched.push_back(make_pair(epg, fetched));
+  m_fetchEvent.Set();
+}
+
 int CEpgContainer::GetEPGAll(CFileItemList &results)
 {
   int iInitialSize = results.Size();
@@ -29,6 +29,7 @@
 #include "EpgDatabase.h"
 
 #include <map>
+#include <vector>
 
 class CFileItemList;
 class CGUIDialogProgressBarHandle;
@@ -37,11 +38,14 @@ namespace EPG
 {
   #define g_EpgContainer CEpgContainer::Get()
 
+  class CEpgUpdateJob;
+
   class CEpgContainer : public Observer,
     public Observable,
     private CThread
   {
     friend class CEpgDatabase;
+    friend class CEpgUpdateJob;
 
   public:
     /*!
@@ -252,8 +256,29 @@ namespace EPG
      */
     void LoadFromDB(void);
 
+    /*!
+     * @return The file that the tables are written to when the update thread stops.
+     */
+    static CStdString GetSnapshotFile(void);
+
     void InsertFromDatabase(int iEpgID, const CStdString &strName, const CStdString &strScraperName);
 
+    /*!
+     * @brief Start a CEpgUpdateJob for each queued table, as long as a client has less than <epg><clientupdatejobs> jobs running.
+     * @param start The start of the period to fetch.
+     * @param end The end of the period to fetch.
+     * @param jobs The ids of the started jobs are added to this.
+     * @return False once all tables were fetched and all jobs are done.
+     */
+    bool StartFetchJobs(time_t start, time_t end, std::vector<unsigned int> &jobs);
+
+    /*!
+     * @brief Hand a fetched table back to the update thread, which merges and persists it.
+     * @param epg The table that was fetched.
+     * @param fetched The fetched entries or NULL if they couldn't be fetched.
+     */
+    void AddFetched(CEpg *epg, CEpg *fetched);
+
     CEpgDatabase m_database;           /*!< the EPG database */
 
     /** @name Configuration */
@@ -280,5 +305,15 @@ namespace EPG
     CGUIDialogProgressBarHandle *  m_progressHandle; /*!< the progress dialog that is visible when updating the first time */
     CCriticalSection               m_critSection;    /*!< a critical section for changes to this container */
     CEvent                         m_updateEvent;    /*!< trigger when an update finishes */
+
+    /** @name Update pipeline */
+    //@{
+    CCriticalSection                             m_fetchSection; /*!< a critical section for the queues below */
+    CEvent                                       m_fetchEvent;   /*!< trigger when a table was fetched or a job finished */
+    std::map<int, std::vector<CEpg *> >          m_fetchQueues;  /*!< client id -> tables waiting to be fetched */
+    std::vector<std::pair<CEpg *, CEpg *> >      m_fetched;      /*!< tables waiting to be merged and their fetched entries */
+    std::map<int, unsigned int>                  m_clientJobs;   /*!< client id -> the number of update jobs queued or running */
+    unsigned int                                 m_iFetchJobs;   /*!< the number of update jobs queued or running */
+    //@}
   };
 }
@@ -19,17 +19,45 @@
  */
 
 #include "dbwrappers/dataset.h"
+#include "filesystem/File.h"
 #include "settings/AdvancedSettings.h"
 #include "settings/VideoSettings.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/Archive.h"
 #include "utils/log.h"
 #include "addons/include/xbmc_pvr_types.h"
 
 #include "EpgDatabase.h"
 #include "EpgContainer.h"
 
+#define EPG_DELETE_BATCH_SIZE 500 /* tags deleted per query */
+#define EPG_SNAPSHOT_VERSION  1
+#define EPG_SNAPSHOT_END      0x45504721 /* marks the end of a complete snapshot */
+
 using namespace std;
 using namespace dbiplus;
 using namespace EPG;
+using namespace XFILE;
+
+/* any change to the tables invalidates the snapshot that was written when XBMC was last stopped */
+static const char *SnapshotTriggers[] = {
+  "CREATE TRIGGER epg_insert_snapshot AFTER INSERT ON epg FOR EACH ROW BEGIN DELETE FROM epgsnapshot; END",
+  "CREATE TRIGGER epg_update_snapshot AFTER UPDATE ON epg FOR EACH ROW BEGIN DELETE FROM epgsnapshot; END",
+  "CREATE TRIGGER epg_delete_snapshot AFTER DELETE ON epg FOR EACH ROW BEGIN DELETE FROM epgsnapshot; END",
+  "CREATE TRIGGER epgtags_insert_snapshot AFTER INSERT ON epgtags FOR EACH ROW BEGIN DELETE FROM epgsnapshot; END",
+  "CREATE TRIGGER epgtags_update_snapshot AFTER UPDATE ON epgtags FOR EACH ROW BEGIN DELETE FROM epgsnapshot; END",
+  "CREATE TRIGGER epgtags_delete_snapshot AFTER DELETE ON epgtags FOR EACH ROW BEGIN DELETE FROM epgsnapshot; END"
+};
+
+/* a table that is read from a snapshot */
+typedef struct
+{
+  int                 iEpgId;
+  vector<int>         deletedTags;
+  vector<CEpgInfoTag> tags;
+  vector<bool>        changed;      /* whether a tag has changes that weren't persisted yet */
+} SnapshotTable;
 
 bool CEpgDatabase::Open(void)
 {
@@ -91,6 +119,11 @@ bool CEpgDatabase::CreateTables(void)
         ")"
     );
 
+    CLog::Log(LOGDEBUG, "EpgDB - %s - creating table 'epgsnapshot'", __FUNCTION__);
+    m_pDS->exec("CREATE TABLE epgsnapshot (sToken varchar(32))");
+    for (unsigned int iPtr = 0; iPtr < sizeof(SnapshotTriggers) / sizeof(SnapshotTriggers[0]); iPtr++)
+      m_pDS->exec(SnapshotTriggers[iPtr]);
+
     CommitTransaction();
 
     bReturn = true;
@@ -133,6 +166,12 @@ bool CEpgDatabase::UpdateOldVersion(int iVersion)
     {
       m_pDS->exec("CREATE INDEX idx_epg_iEndTime on epgtags(iEndTime);");
     }
+    if (iVersion < 8)
+    {
+      m_pDS->exec("CREATE TABLE epgsnapshot (sToken varchar(32))");
+      for (unsigned int iPtr = 0; iPtr < sizeof(SnapshotTriggers) / sizeof(SnapshotTriggers[0]); iPtr++)
+        m_pDS->exec(SnapshotTriggers[iPtr]);
+    }
   }
   catch (...)
   {
@@ -381,9 +420,12 @@ int CEpgDatabase::Persist(const CEpgInfoTag &tag, bool bSingleUpdate /* = true *
   /* Only store the genre string when needed */
   CStdString strGenre = (tag.GenreType() == EPG_GENRE_USE_STRING) ? StringUtils::Join(tag.Genre(), g_advancedSettings.m_videoItemSeparator) : "";
 
+  /* REPLACE rather than INSERT for new tags: only the changes are persisted, so a row that
+     used to start at this time may still be in the table (it's moved by its own REPLACE,
+     which can come later) and would violate idx_epg_idEpg_iStartTime */
   if (iBroadcastId < 0)
   {
-    strQuery = FormatSQL("INSERT INTO epgtags (idEpg, iStartTime, "
+    strQuery = FormatSQL("REPLACE INTO epgtags (idEpg, iStartTime, "
         "iEndTime, sTitle, sPlotOutline, sPlot, iGenreType, iGenreSubType, sGenre, "
         "iFirstAired, iParentalRating, iStarRating, bNotify, iSeriesId, "
         "iEpisodeId, iEpisodePart, sEpisodeName, iBroadcastUid) "
@@ -421,3 +463,229 @@ int CEpgDatabase::Persist(const CEpgInfoTag &tag, bool bSingleUpdate /* = true *
 
   return iReturn;
 }
+
+bool CEpgDatabase::PersistChanges(int iEpgId, const vector<int> &deletedTags, const vector<CEpgInfoTagPtr> &changedTags)
+{
+  if (iEpgId <= 0)
+  {
+    CLog::Log(LOGERROR, "EpgDB - %s - invalid table id: %d", __FUNCTION__, iEpgId);
+    return false;
+  }
+
+  bool bReturn(true);
+
+  /* delete the removed tags */
+  for (unsigned int iPtr = 0; bReturn && iPtr < deletedTags.size(); iPtr += EPG_DELETE_BATCH_SIZE)
+  {
+    CStdString strIds;
+    for (unsigned int iTagPtr = iPtr; iTagPtr < deletedTags.size() && iTagPtr < iPtr + EPG_DELETE_BATCH_SIZE; iTagPtr++)
+      strIds.AppendFormat(iTagPtr > iPtr ? ",%d" : "%d", deletedTags[iTagPtr]);
+
+    bReturn = DeleteValues("epgtags", FormatSQL("idBroadcast IN (%s)", strIds.c_str()));
+  }
+
+  /* write the new and changed tags directly: CommitInsertQueries() would commit the transaction we're in */
+  vector<int> newIds(changedTags.size(), -1);
+  for (unsigned int iPtr = 0; bReturn && iPtr < changedTags.size(); iPtr++)
+  {
+    newIds[iPtr] = Persist(*changedTags[iPtr], true);
+    bReturn = newIds[iPtr] >= 0;
+  }
+
+  if (!bReturn)
+  {
+    CLog::Log(LOGERROR, "EpgDB - %s - failed to persist the changes to table %d", __FUNCTION__, iEpgId);
+    return false;
+  }
+
+  for (unsigned int iPtr = 0; iPtr < changedTags.size(); iPtr++)
+  {
+    CEpgInfoTag &tag = *changedTags[iPtr];
+    CSingleLock lock(tag.m_critSection);
+    if (tag.m_iBroadcastId <= 0)
+      tag.m_iBroadcastId = newIds[iPtr];
+    tag.m_bChanged = false;
+  }
+
+  return true;
+}
+
+bool CEpgDatabase::PersistSnapshot(const CEpgContainer &container, const CStdString &strFile)
+{
+  CStdString strToken;
+  strToken.Format("%u-%u", (unsigned int) time(NULL), XbmcThreads::SystemClockMillis());
+
+  /* write the token first, so the database stays locked for other writers until the snapshot is
+     complete. The triggers created in CreateTables() remove it as soon as the database is changed */
+  BeginTransaction();
+  if (!ExecuteQuery("DELETE FROM epgsnapshot;") ||
+      !ExecuteQuery(FormatSQL("INSERT INTO epgsnapshot (sToken) VALUES ('%s');", strToken.c_str())))
+  {
+    RollbackTransaction();
+    return false;
+  }
+
+  CFile file;
+  if (!file.OpenForWrite(strFile, true))
+  {
+    CLog::Log(LOGERROR, "EpgDB - %s - unable to write %s", __FUNCTION__, strFile.c_str());
+    RollbackTransaction();
+    return false;
+  }
+
+  unsigned int iTags(0);
+  CArchive ar(&file, CArchive::store);
+  ar << (int) EPG_SNAPSHOT_VERSION;
+  ar << strToken;
+  ar << (int) container.m_epgs.size();
+  for (map<unsigned int, CEpg *>::const_iterator it = container.m_epgs.begin(); it != container.m_epgs.end(); it++)
+  {
+    CEpg &epg = *it->second;
+    CSingleLock lock(epg.m_critSection);
+    ar << epg.m_iEpgID;
+    ar << epg.m_deletedTags;
+    ar << (int) epg.m_tags.size();
+    for (map<CDateTime, CEpgInfoTagPtr>::const_iterator tagIt = epg.m_tags.begin(); tagIt != epg.m_tags.end(); tagIt++)
+    {
+      CEpgInfoTag &tag = *tagIt->second;
+      CSingleLock tagLock(tag.m_critSection);
+
+      time_t iStartTime, iEndTime, iFirstAired;
+      tag.m_startTime.GetAsTime(iStartTime);
+      tag.m_endTime.GetAsTime(iEndTime);
+      tag.m_firstAired.GetAsTime(iFirstAired);
+
+      ar << tag.m_iBroadcastId;
+      ar << tag.m_iUniqueBroadcastID;
+      ar << (int64_t) iStartTime;
+      ar << (int64_t) iEndTime;
+      ar << (int64_t) iFirstAired;
+      ar << tag.m_strTitle;
+      ar << tag.m_strPlotOutline;
+      ar << tag.m_strPlot;
+      ar << tag.m_iGenreType;
+      ar << tag.m_iGenreSubType;
+      ar << tag.m_genre;
+      ar << tag.m_iParentalRating;
+      ar << tag.m_iStarRating;
+      ar << tag.m_bNotify;
+      ar << tag.m_iSeriesNumber;
+      ar << tag.m_iEpisodeNumber;
+      ar << tag.m_iEpisodePart;
+      ar << tag.m_strEpisodeName;
+      ar << tag.m_bChanged;
+    }
+    iTags += epg.m_tags.size();
+  }
+  ar << (int) EPG_SNAPSHOT_END;
+  ar.Close();
+  file.Close();
+
+  bool bReturn = CommitTransaction();
+  if (bReturn)
+    CLog::Log(LOGDEBUG, "EpgDB - %s - wrote %u tags of %u tables to %s", __FUNCTION__, iTags, (unsigned int) container.m_epgs.size(), strFile.c_str());
+  else
+    CFile::Delete(strFile);
+
+  return bReturn;
+}
+
+bool CEpgDatabase::LoadSnapshot(CEpgContainer &container, const CStdString &strFile)
+{
+  CFile file;
+  if (!file.Open(strFile))
+    return false;
+
+  vector<SnapshotTable> tables;
+  bool bReturn(false);
+  CArchive ar(&file, CArchive::load);
+  int iVersion(0), iTables(0), iEnd(0);
+  CStdString strToken;
+  ar >> iVersion;
+  if (iVersion == EPG_SNAPSHOT_VERSION)
+    ar >> strToken;
+
+  if (strToken.IsEmpty() || GetSingleValue("epgsnapshot", "sToken") != strToken)
+  {
+    CLog::Log(LOGDEBUG, "EpgDB - %s - %s doesn't match the database", __FUNCTION__, strFile.c_str());
+  }
+  else
+  {
+    ar >> iTables;
+    tables.resize(iTables > 0 ? iTables : 0);
+    for (vector<SnapshotTable>::iterator it = tables.begin(); it != tables.end(); it++)
+    {
+      int iTags(0);
+      ar >> it->iEpgId;
+      ar >> it->deletedTags;
+      ar >> iTags;
+      it->tags.resize(iTags > 0 ? iTags : 0);
+      it->changed.resize(it->tags.size());
+      for (unsigned int iPtr = 0; iPtr < it->tags.size(); iPtr++)
+      {
+        CEpgInfoTag &tag = it->tags[iPtr];
+        int64_t iStartTime, iEndTime, iFirstAired;
+        bool bChanged;
+
+        ar >> tag.m_iBroadcastId;
+        ar >> tag.m_iUniqueBroadcastID;
+        ar >> iStartTime;
+        ar >> iEndTime;
+        ar >> iFirstAired;
+        ar >> tag.m_strTitle;
+        ar >> tag.m_strPlotOutline;
+        ar >> tag.m_strPlot;
+        ar >> tag.m_iGenreType;
+        ar >> tag.m_iGenreSubType;
+        ar >> tag.m_genre;
+        ar >> tag.m_iParentalRating;
+        ar >> tag.m_iStarRating;
+        ar >> tag.m_bNotify;
+        ar >> tag.m_iSeriesNumber;
+        ar >> tag.m_iEpisodeNumber;
+        ar >> tag.m_iEpisodePart;
+        ar >> tag.m_strEpisodeName;
+        ar >> bChanged;
+
+        tag.m_startTime  = CDateTime((time_t) iStartTime);
+        tag.m_endTime    = CDateTime((time_t) iEndTime);
+        tag.m_firstAired = CDateTime((time_t) iFirstAired);
+        it->changed[iPtr] = bChanged;
+      }
+    }
+    ar >> iEnd;
+    bReturn = iEnd == EPG_SNAPSHOT_END;
+    if (!bReturn)
+      CLog::Log(LOGERROR, "EpgDB - %s - %s is incomplete", __FUNCTION__, strFile.c_str());
+  }
+  ar.Close();
+  file.Close();
+
+  if (!bReturn)
+    return false;
+
+  unsigned int iTags(0);
+  for (vector<SnapshotTable>::const_iterator it = tables.begin(); it != tables.end(); it++)
+  {
+    CEpg *epg = container.GetById(it->iEpgId);
+    if (!epg)
+      continue;
+
+    CSingleLock lock(epg->m_critSection);
+    for (unsigned int iPtr = 0; iPtr < it->tags.size(); iPtr++)
+    {
+      epg->AddEntry(it->tags[iPtr]);
+
+      /* changes that weren't persisted yet are persisted with the next update */
+      map<CDateTime, CEpgInfoTagPtr>::iterator tag = epg->m_tags.find(it->tags[iPtr].m_startTime);
+      if (it->changed[iPtr] && tag != epg->m_tags.end())
+        tag->second->m_bChanged = true;
+    }
+    epg->m_deletedTags.insert(epg->m_deletedTags.end(), it->deletedTags.begin(), it->deletedTags.end());
+    epg->m_bLoaded = true;
+    iTags += it->tags.size();
+  }
+
+  CLog::Log(LOGDEBUG, "EpgDB - %s - loaded %u tags of %u tables from %s", __FUNCTION__, iTags, (unsigned int) tables.size(), strFile.c_str());
+  return true;
+}
@@ -22,6 +22,10 @@
 #include "dbwrappers/Database.h"
 #include "XBDateTime.h"
 
+#include "EpgInfoTag.h"
+
+#include <vector>
+
 namespace EPG
 {
   class CEpg;
@@ -53,7 +57,7 @@ namespace EPG
      * @brief Get the minimal database version that is required to operate correctly.
      * @return The minimal database version.
      */
-    virtual int GetMinVersion(void) const { return 7; };
+    virtual int GetMinVersion(void) const { return 8; };
 
     /*!
      * @brief Get the default sqlite database filename.
@@ -140,6 +144,41 @@ namespace EPG
      */
     virtual int Persist(const CEpgInfoTag &tag, bool bSingleUpdate = true);
 
+    /*!
+     * @brief Persist the changes made to the entries of a table since it was last persisted.
+     * Meant to be called inside a transaction, which is left to the caller to commit or roll back.
+     * The deletions are done in batches, the other entries are written with a statement each.
+     * Entries that were added get their database ID and all entries are marked as persisted.
+     * @param iEpgId The table.
+     * @param deletedTags The database IDs of the entries that were removed.
+     * @param changedTags The entries that were added or changed.
+     * @return True if the changes were persisted, false otherwise.
+     */
+    virtual bool PersistChanges(int iEpgId, const std::vector<int> &deletedTags, const std::vector<CEpgInfoTagPtr> &changedTags);
+
+    //@}
+
+    /*! @name Snapshot methods */
+    //@{
+
+    /*!
+     * @brief Write the entries of all tables to a compact snapshot file, so the next start doesn't have to read them back from the database.
+     * The snapshot is only valid until the next change to the database. Its token is written in a
+     * transaction that spans writing the file, so no change can slip in between the two.
+     * @param container The tables to write.
+     * @param strFile The file to write the snapshot to.
+     * @return True if the snapshot was written, false otherwise.
+     */
+    virtual bool PersistSnapshot(const CEpgContainer &container, const CStdString &strFile);
+
+    /*!
+     * @brief Load the entries of the tables in a container from a snapshot file.
+     * @param container The container with the tables to load. Tables that aren't in the snapshot are left alone.
+     * @param strFile The file to read the snapshot from.
+     * @return True if the snapshot matches the database and was loaded, false otherwise.
+     */
+    virtual bool LoadSnapshot(CEpgContainer &container, const CStdString &strFile);
+
     //@}
 
   protected:
@@ -101,31 +101,10 @@ CEpgInfoTag::CEpgInfoTag(const EPG_TAG &data) :
 }
 
 CEpgInfoTag::CEpgInfoTag(const CEpgInfoTag &tag) :
-    m_bNotify(tag.m_bNotify),
-    m_bChanged(tag.m_bChanged),
-    m_iBroadcastId(tag.m_iBroadcastId),
-    m_iGenreType(tag.m_iGenreType),
-    m_iGenreSubType(tag.m_iGenreSubType),
-    m_iParentalRating(tag.m_iParentalRating),
-    m_iStarRating(tag.m_iStarRating),
-    m_iSeriesNumber(tag.m_iSeriesNumber),
-    m_iEpisodeNumber(tag.m_iEpisodeNumber),
-    m_iEpisodePart(tag.m_iEpisodePart),
-    m_iUniqueBroadcastID(tag.m_iUniqueBroadcastID),
-    m_strTitle(tag.m_strTitle),
-    m_strPlotOutline(tag.m_strPlotOutline),
-    m_strPlot(tag.m_strPlot),
-    m_genre(tag.m_genre),
-    m_strEpisodeName(tag.m_strEpisodeName),
-    m_strIconPath(tag.m_strIconPath),
-    m_strFileNameAndPath(tag.m_strFileNameAndPath),
-    m_startTime(tag.m_startTime),
-    m_endTime(tag.m_endTime),
-    m_firstAired(tag.m_firstAired),
-    m_timer(tag.m_timer),
-    m_epg(tag.m_epg),
-    m_pvrChannel(tag.m_pvrChannel)
+    m_epg(NULL)
 {
+  /* copied under the tag's lock, the update thread may be changing it */
+  *this = tag;
 }
 
 CEpgInfoTag::~CEpgInfoTag()
@@ -24,6 +24,8 @@
 #include "FileItem.h"
 #include "../addons/include/xbmc_pvr_types.h"
 
+#include <set>
+
 #include "EpgSearchFilter.h"
 #include "EpgContainer.h"
 
@@ -120,30 +122,27 @@ bool EpgSearchFilter::FilterEntry(const CEpgInfoTag &tag) const
 
 int EpgSearchFilter::RemoveDuplicates(CFileItemList &results)
 {
-  unsigned int iSize = results.Size();
+  /* keep the first of each set of entries with the same title, plot and plot outline */
+  set<CStdString> entries;
+  vector<CFileItemPtr> unique;
+  unique.reserve(results.Size());
 
-  for (unsigned int iResultPtr = 0; iResultPtr < iSize; iResultPtr++)
+  for (int iResultPtr = 0; iResultPtr < results.Size(); iResultPtr++)
   {
-    const CEpgInfoTag *epgentry_1 = results.Get(iResultPtr)->GetEPGInfoTag();
-    for (unsigned int iTagPtr = 0; iTagPtr < iSize; iTagPtr++)
-    {
-      const CEpgInfoTag *epgentry_2 = results.Get(iTagPtr)->GetEPGInfoTag();
-      if (iResultPtr == iTagPtr)
-        continue;
-
-      if (epgentry_1->Title()       != epgentry_2->Title() ||
-          epgentry_1->Plot()        != epgentry_2->Plot() ||
-          epgentry_1->PlotOutline() != epgentry_2->PlotOutline())
-        continue;
+    const CEpgInfoTag *epgentry = results.Get(iResultPtr)->GetEPGInfoTag();
+    CStdString strKey = epgentry->Title() + '\n' + epgentry->Plot() + '\n' + epgentry->PlotOutline();
+    if (entries.insert(strKey).second)
+      unique.push_back(results.Get(iResultPtr));
+  }
 
-      results.Remove(iTagPtr);
-      iResultPtr--;
-      iTagPtr--;
-      iSize--;
-    }
+  if (unique.size() != (size_t)results.Size())
+  {
+    results.ClearItems();
+    for (vector<CFileItemPtr>::const_iterator it = unique.begin(); it != unique.end(); ++it)
+      results.Add(*it);
   }
 
-  return iSize;
+  return results.Size();
 }
 
 
@@ -0,0 +1,226 @@
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "threads/SingleLock.h"
+#include "utils/TextSearch.h"
+
+#include "EpgSearchIndex.h"
+#include "EpgSearchFilter.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+using namespace EPG;
+
+static inline bool IsWordChar(unsigned char c)
+{
+  /* bytes of multibyte characters are treated as part of a word */
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static bool SortByStartTime(const CEpgInfoTagPtr &left, const CEpgInfoTagPtr &right)
+{
+  return left->StartAsUTC() < right->StartAsUTC();
+}
+
+void CEpgSearchIndex::Add(const CEpgInfoTagPtr &tag)
+{
+  set<string> tokens;
+  Tokenise(tag->Title(), tokens);
+  Tokenise(tag->PlotOutline(), tokens);
+  int iGenreType = tag->GenreType();
+
+  CSingleLock lock(m_critSection);
+  Remove(tag.get());
+
+  Entry &entry = m_entries[tag.get()];
+  entry.tag        = tag;
+  entry.iGenreType = iGenreType;
+  entry.tokens.assign(tokens.begin(), tokens.end());
+
+  for (vector<string>::const_iterator it = entry.tokens.begin(); it != entry.tokens.end(); ++it)
+    m_tokens[*it].insert(tag.get());
+  m_genres[iGenreType].insert(tag.get());
+}
+
+void CEpgSearchIndex::Remove(const CEpgInfoTag *tag)
+{
+  CSingleLock lock(m_critSection);
+  map<const CEpgInfoTag *, Entry>::iterator entry = m_entries.find(tag);
+  if (entry == m_entries.end())
+    return;
+
+  for (vector<string>::const_iterator it = entry->second.tokens.begin(); it != entry->second.tokens.end(); ++it)
+  {
+    map<string, Postings>::iterator token = m_tokens.find(*it);
+    if (token == m_tokens.end())
+      continue;
+
+    token->second.erase(tag);
+    if (token->second.empty())
+      m_tokens.erase(token);
+  }
+
+  map<int, Postings>::iterator genre = m_genres.find(entry->second.iGenreType);
+  if (genre != m_genres.end())
+  {
+    genre->second.erase(tag);
+    if (genre->second.empty())
+      m_genres.erase(genre);
+  }
+
+  m_entries.erase(entry);
+}
+
+void CEpgSearchIndex::Clear(void)
+{
+  CSingleLock lock(m_critSection);
+  m_entries.clear();
+  m_tokens.clear();
+  m_genres.clear();
+}
+
+bool CEpgSearchIndex::Find(const EpgSearchFilter &filter, vector<CEpgInfoTagPtr> &candidates) const
+{
+  bool bNarrowed(false);
+  Postings postings;
+
+  CSingleLock lock(m_critSection);
+
+  if (!filter.m_strSearchTerm.IsEmpty())
+  {
+    /* the same search that EpgSearchFilter::MatchSearchTerm() does */
+    CTextSearch search(filter.m_strSearchTerm, filter.m_bIsCaseSensitive, SEARCH_DEFAULT_OR);
+    vector<CStdString> terms;
+    bool bAll = search.GetRequiredTerms(terms);
+
+    vector<string> words;
+    for (vector<CStdString>::const_iterator it = terms.begin(); it != terms.end(); ++it)
+    {
+      string strWord = GetLongestWord(*it);
+      if (!strWord.empty())
+        words.push_back(strWord);
+      else if (!bAll)
+      {
+        /* any tag could match this term */
+        words.clear();
+        break;
+      }
+    }
+
+    for (vector<string>::const_iterator it = words.begin(); it != words.end(); ++it)
+    {
+      Postings found;
+      FindWord(*it, found);
+
+      if (!bNarrowed)
+        postings.swap(found);
+      else if (bAll)
+        Intersect(postings, found);
+      else
+        postings.insert(found.begin(), found.end());
+      bNarrowed = true;
+    }
+  }
+
+  if (filter.m_iGenreType != EPG_SEARCH_UNSET && !filter.m_bIncludeUnknownGenres)
+  {
+    map<int, Postings>::const_iterator genre = m_genres.find(filter.m_iGenreType);
+    if (genre != m_genres.end())
+    {
+      if (bNarrowed)
+        Intersect(postings, genre->second);
+      else
+        postings = genre->second;
+    }
+    else
+      postings.clear();
+    bNarrowed = true;
+  }
+
+  if (!bNarrowed)
+    return false;
+
+  candidates.reserve(candidates.size() + postings.size());
+  for (Postings::const_iterator it = postings.begin(); it != postings.end(); ++it)
+  {
+    map<const CEpgInfoTag *, Entry>::const_iterator entry = m_entries.find(*it);
+    if (entry != m_entries.end())
+      candidates.push_back(entry->second.tag);
+  }
+  lock.Leave();
+
+  sort(candidates.begin(), candidates.end(), SortByStartTime);
+  return true;
+}
+
+void CEpgSearchIndex::Tokenise(const CStdString &strText, set<string> &tokens)
+{
+  CStdString strLower(strText);
+  strLower.ToLower();
+
+  size_t iStart(string::npos);
+  for (size_t iPtr = 0; iPtr <= strLower.size(); iPtr++)
+  {
+    if (iPtr < strLower.size() && IsWordChar(strLower[iPtr]))
+    {
+      if (iStart == string::npos)
+        iStart = iPtr;
+    }
+    else if (iStart != string::npos)
+    {
+      tokens.insert(strLower.substr(iStart, iPtr - iStart));
+      iStart = string::npos;
+    }
+  }
+}
+
+string CEpgSearchIndex::GetLongestWord(const CStdString &strTerm)
+{
+  set<string> words;
+  Tokenise(strTerm, words);
+
+  string strLongest;
+  for (set<string>::const_iterator it = words.begin(); it != words.end(); ++it)
+  {
+    if (it->size() > strLongest.size())
+      strLongest = *it;
+  }
+
+  return strLongest;
+}
+
+void CEpgSearchIndex::FindWord(const string &strWord, Postings &postings) const
+{
+  /* search terms match anywhere in the text, so a word can be part of a longer token */
+  for (map<string, Postings>::const_iterator it = m_tokens.begin(); it != m_tokens.end(); ++it)
+  {
+    if (it->first.size() >= strWord.size() && it->first.find(strWord) != string::npos)
+      postings.insert(it->second.begin(), it->second.end());
+  }
+}
+
+void CEpgSearchIndex::Intersect(Postings &postings, const Postings &other)
+{
+  Postings result;
+  set_intersection(postings.begin(), postings.end(), other.begin(), other.end(), inserter(result, result.begin()));
+  postings.swap(result);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "threads/CriticalSection.h"
+#include "utils/StdString.h"
+
+#include "EpgInfoTag.h"
+
+namespace EPG
+{
+  struct EpgSearchFilter;
+
+  /** Inverted index over the tags of an EPG table, used to narrow down searches */
+
+  class CEpgSearchIndex
+  {
+  public:
+    /*!
+     * @brief (Re)index a tag. Must be called again every time the title, plot outline or genre of the tag changed.
+     * @param tag The tag to index.
+     */
+    void Add(const CEpgInfoTagPtr &tag);
+
+    /*!
+     * @brief Remove a tag from the index.
+     * @param tag The tag to remove.
+     */
+    void Remove(const CEpgInfoTag *tag);
+
+    /*!
+     * @brief Remove all tags from the index.
+     */
+    void Clear(void);
+
+    /*!
+     * @brief Get the tags that might match a search filter.
+     *
+     * Every tag that matches the filter is returned, but not every tag that's returned
+     * has to match it, so candidates still have to be checked with EpgSearchFilter::FilterEntry().
+     *
+     * @param filter The filter.
+     * @param candidates The candidates, sorted by start time.
+     * @return True if the candidates were found, false if the filter can't be narrowed down by the index and all tags have to be checked.
+     */
+    bool Find(const EpgSearchFilter &filter, std::vector<CEpgInfoTagPtr> &candidates) const;
+
+  private:
+    typedef std::set<const CEpgInfoTag *> Postings;
+
+    typedef struct
+    {
+      CEpgInfoTagPtr           tag;
+      std::vector<std::string> tokens;
+      int                      iGenreType;
+    } Entry;
+
+    /*!
+     * @brief Split a text into lower case words.
+     * @param strText The text.
+     * @param tokens The words found in it.
+     */
+    static void Tokenise(const CStdString &strText, std::set<std::string> &tokens);
+
+    /*!
+     * @brief Get the longest word in a search term. Every text that contains the term contains a token that contains this word.
+     * @param strTerm The search term.
+     * @return The word or an empty string if the term contains no word.
+     */
+    static std::string GetLongestWord(const CStdString &strTerm);
+
+    /*!
+     * @brief Get all tags with a token that contains a word.
+     * @param strWord The word.
+     * @param postings The tags found.
+     */
+    void FindWord(const std::string &strWord, Postings &postings) const;
+
+    static void Intersect(Postings &postings, const Postings &other);
+
+    std::map<const CEpgInfoTag *, Entry>   m_entries;     /*!< the indexed tags */
+    std::map<std::string, Postings>        m_tokens;      /*!< token -> tags with this token in their title or plot outline */
+    std::map<int, Postings>                m_genres;      /*!< genre type -> tags with this genre type */
+    mutable CCriticalSection               m_critSection;
+  };
+}
@@ -28,6 +28,8 @@
 #include "utils/log.h"
 #include "utils/Variant.h"
 #include "threads/SystemClock.h"
+
+#include <algorithm>
 #include "GUIInfoManager.h"
 
 #include "epg/Epg.h"
@@ -64,6 +66,8 @@ CGUIEPGGridContainer::CGUIEPGGridContainer(int parentID, int controlID, float po
   m_scrollTime            = scrollTime ? scrollTime : 1;
   m_renderTime            = 0;
   m_item                  = NULL;
+  m_emptyGridItem.width   = 0;
+  m_emptyGridItem.height  = 0;
   m_lastItem              = NULL;
   m_lastChannel           = NULL;
   m_orientation           = orientation;
@@ -89,7 +93,6 @@ CGUIEPGGridContainer::CGUIEPGGridContainer(int parentID, int controlID, float po
   m_cacheChannelItems     = preloadItems;
   m_cacheRulerItems       = preloadItems;
   m_cacheProgrammeItems   = preloadItems;
-  m_gridIndex             = NULL;
 }
 
 CGUIEPGGridContainer::~CGUIEPGGridContainer(void)
@@ -289,6 +292,9 @@ void CGUIEPGGridContainer::Render()
   if ((int)m_programmeItems.size() > m_ProgrammesPerPage + cacheBeforeProgramme + cacheAfterProgramme)
     FreeProgrammeMemory(CorrectOffset(blockOffset - cacheBeforeProgramme, 0), CorrectOffset(blockOffset + m_ProgrammesPerPage + 1 + cacheAfterProgramme, 0));
 
+  // keep the rows of one page before and after the visible channels laid out
+  FreeGridMemory(chanOffset - m_channelsPerPage - cacheBeforeChannel, chanOffset + 2 * m_channelsPerPage + cacheAfterChannel);
+
   g_graphicsContext.SetClipRegion(m_gridPosX, m_gridPosY, m_gridWidth, m_gridHeight);
   CPoint originProgramme = CPoint(m_gridPosX, m_gridPosY) + m_renderOffset;
   float posA = (m_orientation != VERTICAL) ? originProgramme.y : originProgramme.x;
@@ -316,12 +322,12 @@ void CGUIEPGGridContainer::Render()
     int block = blockOffset;
     float posA2 = posA;
 
-    CGUIListItemPtr item = m_gridIndex[channel][block].item;
-    if (blockOffset > 0 && item == m_gridIndex[channel][blockOffset-1].item)
+    CGUIListItemPtr item = GetGridItem(channel, block)->item;
+    if (blockOffset > 0 && item == GetGridItem(channel, blockOffset-1)->item)
     {
       /* first program starts before current view */
       int startBlock = blockOffset - 1;
-      while (m_gridIndex[channel][startBlock].item == item)
+      while (GetGridItem(channel, startBlock)->item == item)
         startBlock--;
 
       block = startBlock + 1;
@@ -331,11 +337,11 @@ void CGUIEPGGridContainer::Render()
 
     while (posA2 < endA && m_programmeItems.size())   // FOR EACH ITEM ///////////////
     {
-      item = m_gridIndex[channel][block].item;
+      item = GetGridItem(channel, block)->item;
       if (!item || !item.get()->IsFileItem())
         break;
 
-      bool focused = (channel == m_channelOffset + m_channelCursor) && (item == m_gridIndex[m_channelOffset + m_channelCursor][m_blockOffset + m_blockCursor].item);
+      bool focused = (channel == m_channelOffset + m_channelCursor) && (item == GetGridItem(m_channelOffset + m_channelCursor, m_blockOffset + m_blockCursor)->item);
 
       // render our item
       if (focused)
@@ -351,27 +357,27 @@ void CGUIEPGGridContainer::Render()
           focusedPosY = posA2;
         }
         focusedItem = item;
-        focusedwidth = m_gridIndex[channel][block].width;
-        focusedheight = m_gridIndex[channel][block].height;
+        focusedwidth = GetGridItem(channel, block)->width;
+        focusedheight = GetGridItem(channel, block)->height;
       }
       else
       {
         if (m_orientation == VERTICAL)
-          RenderProgrammeItem(posA2, posB, m_gridIndex[channel][block].width, m_gridIndex[channel][block].height, item.get(), focused);
+          RenderProgrammeItem(posA2, posB, GetGridItem(channel, block)->width, GetGridItem(channel, block)->height, item.get(), focused);
         else
-          RenderProgrammeItem(posB, posA2, m_gridIndex[channel][block].width, m_gridIndex[channel][block].height, item.get(), focused);
+          RenderProgrammeItem(posB, posA2, GetGridItem(channel, block)->width, GetGridItem(channel, block)->height, item.get(), focused);
       }
 
       // increment our X position
       if (m_orientation == VERTICAL)
       {
-        posA2 += m_gridIndex[channel][block].width; // assumes focused & unfocused layouts have equal length
-        block += (int)(m_gridIndex[channel][block].width / m_blockSize);
+        posA2 += GetGridItem(channel, block)->width; // assumes focused & unfocused layouts have equal length
+        block += (int)(GetGridItem(channel, block)->width / m_blockSize);
       }
       else
       {
-        posA2 += m_gridIndex[channel][block].height; // assumes focused & unfocused layouts have equal length
-        block += (int)(m_gridIndex[channel][block].height / m_blockSize);
+        posA2 += GetGridItem(channel, block)->height; // assumes focused & unfocused layouts have equal length
+        block += (int)(GetGridItem(channel, block)->height / m_blockSize);
       }
     }
 
@@ -708,16 +714,6 @@ bool CGUIEPGGridContainer::OnMessage(CGUIMessage& message)
       for (int i = 0; i < items->Size(); i++)
         m_programmeItems.push_back(items->Get(i));
 
-      ClearGridIndex();
-      m_gridIndex = (struct GridItemsPtr **) calloc(1,m_channelItems.size()*sizeof(struct GridItemsPtr*));
-      if (m_gridIndex != NULL)
-      {
-        for (unsigned int i = 0; i < m_channelItems.size(); i++)
-        {
-          m_gridIndex[i] = (struct GridItemsPtr*) calloc(1,MAXBLOCKS*sizeof(struct GridItemsPtr));
-        }
-      }
-
       UpdateLayout(true); // true to refresh all items
 
       /* Create Ruler items */
@@ -755,7 +751,7 @@ bool CGUIEPGGridContainer::OnMessage(CGUIMessage& message)
 
 void CGUIEPGGridContainer::UpdateItems()
 {
-  CDateTimeSpan blockDuration, gridDuration;
+  CDateTimeSpan gridDuration;
 
   /* check for invalid start and end time */
   if (m_gridStart >= m_gridEnd)
@@ -781,99 +777,13 @@ void CGUIEPGGridContainer::UpdateItems()
     return;
   }
 
-  blockDuration.SetDateTimeSpan(0, 0, MINSPERBLOCK, 0);
-
-  long tick(XbmcThreads::SystemClockMillis());
-
-  for (unsigned int row = 0; row < m_channelItems.size(); ++row)
-  {
-    CDateTime gridCursor  = m_gridStart; //reset cursor for new channel
-    unsigned long progIdx = m_epgItemsPtr[row].start;
-    unsigned long lastIdx = m_epgItemsPtr[row].stop;
-    int iEpgId            = ((CFileItem *)m_programmeItems[progIdx].get())->GetEPGInfoTag()->EpgID();
-
-    /** FOR EACH BLOCK **********************************************************************/
-
-    for (int block = 0; block < m_blocks; block++)
-    {
-      while (progIdx <= lastIdx)
-      {
-        CGUIListItemPtr item = m_programmeItems[progIdx];
-        const CEpgInfoTag* tag = ((CFileItem *)item.get())->GetEPGInfoTag();
-        if (tag == NULL)
-          progIdx++;
-
-        if (tag->EpgID() != iEpgId)
-          break;
-
-        if (m_gridEnd <= tag->StartAsUTC())
-        {
-          break;
-        }
-        else if (gridCursor >= tag->EndAsUTC())
-        {
-          progIdx++;
-        }
-        else if (gridCursor < tag->EndAsUTC())
-        {
-          m_gridIndex[row][block].item = item;
-          break;
-        }
-        else
-        {
-          progIdx++;
-        }
-      }
-
-      gridCursor += blockDuration;
-    }
-
-    /** FOR EACH BLOCK **********************************************************************/
-    int itemSize = 1; // size of the programme in blocks
-    int savedBlock = 0;
-
-    for (int block = 0; block < m_blocks; block++)
-    {
-      if (m_gridIndex[row][block].item != m_gridIndex[row][block+1].item)
-      {
-        if (!m_gridIndex[row][block].item)
-        {
-          CEpgInfoTag broadcast;
-          CFileItemPtr unknown(new CFileItem(broadcast));
-          for (int i = block ; i > block - itemSize; i--)
-          {
-            m_gridIndex[row][i].item = unknown;
-          }
-        }
-
-        CGUIListItemPtr item = m_gridIndex[row][block].item;
-        CFileItem *fileItem = (CFileItem *)item.get();
-
-        m_gridIndex[row][savedBlock].item->SetProperty("GenreType", fileItem->GetEPGInfoTag()->GenreType());
-        if (m_orientation == VERTICAL)
-        {
-          m_gridIndex[row][savedBlock].width   = itemSize*m_blockSize;
-          m_gridIndex[row][savedBlock].height  = m_channelHeight;
-        }
-        else
-        {
-          m_gridIndex[row][savedBlock].width   = m_channelWidth;
-          m_gridIndex[row][savedBlock].height  = itemSize*m_blockSize;
-        }
-
-        itemSize = 1;
-        savedBlock = block+1;
-      }
-      else
-      {
-        itemSize++;
-      }
-    }
-  }
-
-  /******************************************* END ******************************************/
-
-  CLog::Log(LOGDEBUG, "%s completed successfully in %u ms", __FUNCTION__, (unsigned int)(XbmcThreads::SystemClockMillis()-tick));
+  /* rows are laid out when they're first needed, see GetGridItem(). They
+     aren't carried over from the last bind: the window binds new items each
+     time, so telling whether a row changed means walking its programmes,
+     which is all laying it out again costs, and only the rows near the
+     screen were laid out in the first place. */
+  ClearGridIndex();
+  m_gridRows.resize(m_channelItems.size());
 
   m_channels = (int)m_epgItemsPtr.size();
   m_item = GetItem(m_channelCursor);
@@ -966,7 +876,7 @@ bool CGUIEPGGridContainer::MoveChannel(bool direction, bool wrapAround)
 
 bool CGUIEPGGridContainer::MoveProgrammes(bool direction)
 {
-  if (!m_gridIndex || !m_item)
+  if (m_gridRows.empty() || !m_item)
     return false;
 
   if (direction)
@@ -974,7 +884,7 @@ bool CGUIEPGGridContainer::MoveProgrammes(bool direction)
     if (m_channelCursor + m_channelOffset < 0 || m_blockOffset < 0)
       return false;
 
-    if (m_item->item != m_gridIndex[m_channelCursor + m_channelOffset][m_blockOffset].item)
+    if (m_item->item != GetGridItem(m_channelCursor + m_channelOffset, m_blockOffset)->item)
     {
       // this is not first item on page
       m_item = GetPrevItem(m_channelCursor);
@@ -1023,7 +933,7 @@ bool CGUIEPGGridContainer::MoveProgrammes(bool direction)
   }
   else
   {
-    if (m_item->item != m_gridIndex[m_channelCursor + m_channelOffset][m_blocksPerPage + m_blockOffset - 1].item)
+    if (m_item->item != GetGridItem(m_channelCursor + m_channelOffset, m_blocksPerPage + m_blockOffset - 1)->item)
     {
       // this is not last item on page
       m_item = GetNextItem(m_channelCursor);
@@ -1313,13 +1223,13 @@ bool CGUIEPGGridContainer::OnMouseWheel(char wheel, const CPoint &point)
 
 int CGUIEPGGridContainer::GetSelectedItem() const
 {
-  if (!m_gridIndex ||
+  if (m_gridRows.empty() ||
       !m_epgItemsPtr.size() ||
       m_channelCursor + m_channelOffset >= (int)m_channelItems.size() ||
       m_blockCursor + m_blockOffset >= (int)m_programmeItems.size())
     return 0;
 
-  CGUIListItemPtr currentItem = m_gridIndex[m_channelCursor + m_channelOffset][m_blockCursor + m_blockOffset].item;
+  CGUIListItemPtr currentItem = GetGridItem(m_channelCursor + m_channelOffset, m_blockCursor + m_blockOffset)->item;
   if (!currentItem)
     return 0;
 
@@ -1333,7 +1243,7 @@ int CGUIEPGGridContainer::GetSelectedItem() const
 
 CGUIListItemPtr CGUIEPGGridContainer::GetListItem(int offset) const
 {
-  if (!m_epgItemsPtr.size())
+  if (!m_epgItemsPtr.size() || !m_item)
     return CGUIListItemPtr();
 
   return m_item->item;
@@ -1368,9 +1278,9 @@ GridItemsPtr *CGUIEPGGridContainer::GetClosestItem(const int &channel)
   }
 
   if (right <= SHORTGAP && right <= left && m_blockCursor + right < m_blocksPerPage)
-    return &m_gridIndex[channel + m_channelOffset][m_blockCursor + right + m_blockOffset];
+    return GetGridItem(channel + m_channelOffset, m_blockCursor + right + m_blockOffset);
 
-  return &m_gridIndex[channel + m_channelOffset][m_blockCursor - left  + m_blockOffset];
+  return GetGridItem(channel + m_channelOffset, m_blockCursor - left  + m_blockOffset);
 }
 
 int CGUIEPGGridContainer::GetItemSize(GridItemsPtr *item)
@@ -1393,7 +1303,7 @@ int CGUIEPGGridContainer::GetRealBlock(const CGUIListItemPtr &item, const int &c
 {
   int block = 0;
 
-  while (m_gridIndex[channel + m_channelOffset][block].item != item && block < m_blocks)
+  while (GetGridItem(channel + m_channelOffset, block)->item != item && block < m_blocks)
     block++;
 
   return block;
@@ -1403,28 +1313,28 @@ GridItemsPtr *CGUIEPGGridContainer::GetNextItem(const int &channel)
 {
   int i = m_blockCursor;
 
-  while (m_gridIndex[channel + m_channelOffset][i + m_blockOffset].item == m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset].item && i < m_blocksPerPage)
+  while (GetGridItem(channel + m_channelOffset, i + m_blockOffset)->item == GetGridItem(channel + m_channelOffset, m_blockCursor + m_blockOffset)->item && i < m_blocksPerPage)
     i++;
 
-  return &m_gridIndex[channel + m_channelOffset][i + m_blockOffset];
+  return GetGridItem(channel + m_channelOffset, i + m_blockOffset);
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetPrevItem(const int &channel)
 {
   int i = m_blockCursor;
 
-  while (m_gridIndex[channel + m_channelOffset][i + m_blockOffset].item == m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset].item && i > 0)
+  while (GetGridItem(channel + m_channelOffset, i + m_blockOffset)->item == GetGridItem(channel + m_channelOffset, m_blockCursor + m_blockOffset)->item && i > 0)
     i--;
 
-  return &m_gridIndex[channel + m_channelOffset][i + m_blockOffset];
+  return GetGridItem(channel + m_channelOffset, i + m_blockOffset);
 
-//  return &m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset - 1];
+//  return GetGridItem(channel + m_channelOffset, m_blockCursor + m_blockOffset - 1);
 }
 
 GridItemsPtr *CGUIEPGGridContainer::GetItem(const int &channel)
 {
   if ( (channel >= 0) && (channel < m_channels) )
-    return &m_gridIndex[channel + m_channelOffset][m_blockCursor + m_blockOffset];
+    return GetGridItem(channel + m_channelOffset, m_blockCursor + m_blockOffset);
   else
     return NULL;
 }
@@ -1602,19 +1512,132 @@ CStdString CGUIEPGGridContainer::GetDescription() const
 
 void CGUIEPGGridContainer::ClearGridIndex(void)
 {
-  if (m_gridIndex)
+  while (!m_laidOutRows.empty())
+    FreeGridRow(*m_laidOutRows.begin());
+  m_gridRows.clear();
+}
+
+GridItemsPtr *CGUIEPGGridContainer::GetGridItem(int channel, int block) const
+{
+  if (channel < 0 || channel >= (int)m_gridRows.size() || block < 0 || block >= m_blocks)
+    return &m_emptyGridItem;
+
+  GridRow &row = m_gridRows[channel];
+  if (!row.laidOut)
+    LayoutGridRow(channel);
+
+  if (block >= row.end)
+    return &m_emptyGridItem;
+
+  /* the programme that starts last at or before this block */
+  vector<int>::const_iterator run = upper_bound(row.starts.begin(), row.starts.end(), block);
+  if (run == row.starts.begin())
+    return &m_emptyGridItem;
+
+  return &row.items[run - row.starts.begin() - 1];
+}
+
+void CGUIEPGGridContainer::LayoutGridRow(int channel) const
+{
+  GridRow &row = m_gridRows[channel];
+  row.starts.clear();
+  row.items.clear();
+  row.end     = 0;
+  row.laidOut = true;
+  m_laidOutRows.insert(channel);
+
+  if (channel >= (int)m_epgItemsPtr.size())
+    return;
+
+  /* every block belongs to the first programme that hasn't ended when the block starts */
+  int block = 0;
+  int iEpgId = -1;
+  for (long progIdx = m_epgItemsPtr[channel].start; progIdx <= m_epgItemsPtr[channel].stop && block < m_blocks; progIdx++)
   {
-    for (unsigned int i = 0; i < m_channelItems.size(); i++)
+    CGUIListItemPtr item = m_programmeItems[progIdx];
+    const CEpgInfoTag* tag = ((CFileItem *)item.get())->GetEPGInfoTag();
+    if (tag == NULL)
+      continue;
+
+    if (iEpgId == -1)
+      iEpgId = tag->EpgID();
+    else if (tag->EpgID() != iEpgId)
+      break;
+
+    if (m_gridEnd <= tag->StartAsUTC())
+      break;
+
+    int endBlock = GetBlocksBefore(tag->EndAsUTC());
+    if (endBlock <= block)
+      continue;
+    if (endBlock > m_blocks)
+      endBlock = m_blocks;
+
+    GridItemsPtr gridItem;
+    gridItem.item = item;
+    if (m_orientation == VERTICAL)
     {
-      for (int block = 0; block < m_blocks; block++)
-      {
-        if (m_gridIndex[i][block].item)
-          m_gridIndex[i][block].item.get()->ClearProperties();
-      }
-      free(m_gridIndex[i]);
+      gridItem.width  = (endBlock - block) * m_blockSize;
+      gridItem.height = m_channelHeight;
+    }
+    else
+    {
+      gridItem.width  = m_channelWidth;
+      gridItem.height = (endBlock - block) * m_blockSize;
     }
-    free(m_gridIndex);
+    item->SetProperty("GenreType", tag->GenreType());
+
+    row.starts.push_back(block);
+    row.items.push_back(gridItem);
+    block = endBlock;
   }
+
+  if (block < m_blocks)
+  {
+    /* fill the rest of the row with an unknown broadcast */
+    CEpgInfoTag broadcast;
+    GridItemsPtr gridItem;
+    gridItem.item = CFileItemPtr(new CFileItem(broadcast));
+    if (m_orientation == VERTICAL)
+    {
+      gridItem.width  = (m_blocks - block) * m_blockSize;
+      gridItem.height = m_channelHeight;
+    }
+    else
+    {
+      gridItem.width  = m_channelWidth;
+      gridItem.height = (m_blocks - block) * m_blockSize;
+    }
+    gridItem.item->SetProperty("GenreType", broadcast.GenreType());
+
+    row.starts.push_back(block);
+    row.items.push_back(gridItem);
+  }
+
+  row.end = m_blocks;
+}
+
+void CGUIEPGGridContainer::FreeGridRow(int channel)
+{
+  GridRow &row = m_gridRows[channel];
+  for (vector<GridItemsPtr>::iterator it = row.items.begin(); it != row.items.end(); ++it)
+    it->item->ClearProperties();
+
+  vector<int>().swap(row.starts);
+  vector<GridItemsPtr>().swap(row.items);
+  row.end     = 0;
+  row.laidOut = false;
+  m_laidOutRows.erase(channel);
+}
+
+int CGUIEPGGridContainer::GetBlocksBefore(const CDateTime &time) const
+{
+  if (time <= m_gridStart)
+    return 0;
+
+  CDateTimeSpan span = time - m_gridStart;
+  int iSeconds = ((span.GetDays() * 24 + span.GetHours()) * 60 + span.GetMinutes()) * 60 + span.GetSeconds();
+  return (iSeconds + MINSPERBLOCK * 60 - 1) / (MINSPERBLOCK * 60);
 }
 
 void CGUIEPGGridContainer::Reset()
@@ -1627,9 +1650,9 @@ void CGUIEPGGridContainer::Reset()
   m_rulerItems.clear();
   m_epgItemsPtr.clear();
 
+  m_item        = NULL;
   m_lastItem    = NULL;
   m_lastChannel = NULL;
-  m_gridIndex   = NULL;
 }
 
 void CGUIEPGGridContainer::GoToBegin()
@@ -1645,10 +1668,10 @@ void CGUIEPGGridContainer::GoToEnd()
   int blockOffset = 0; // the block offset to scroll to
   for (int blockIndex = m_blocks; blockIndex >= 0 && (!blocksEnd || !blocksStart); blockIndex--)
   {
-    if (!blocksEnd && m_gridIndex[m_channelCursor + m_channelOffset][blockIndex].item != NULL)
+    if (!blocksEnd && GetGridItem(m_channelCursor + m_channelOffset, blockIndex)->item != NULL)
       blocksEnd = blockIndex;
-    if (blocksEnd && m_gridIndex[m_channelCursor + m_channelOffset][blocksEnd].item != 
-                     m_gridIndex[m_channelCursor + m_channelOffset][blockIndex].item)
+    if (blocksEnd && GetGridItem(m_channelCursor + m_channelOffset, blocksEnd)->item != 
+                     GetGridItem(m_channelCursor + m_channelOffset, blockIndex)->item)
       blocksStart = blockIndex + 1;
   }
   if (blocksEnd - blocksStart > m_blocksPerPage)
@@ -1884,6 +1907,25 @@ void CGUIEPGGridContainer::FreeRulerMemory(int keepStart, int keepEnd)
   }
 }
 
+void CGUIEPGGridContainer::FreeGridMemory(int keepStart, int keepEnd)
+{
+  int selectedChannel = m_channelOffset + m_channelCursor;
+  set<int>::iterator it = m_laidOutRows.begin();
+  while (it != m_laidOutRows.end())
+  {
+    int channel = *it++; // FreeGridRow() drops the row from the set
+    if ((channel >= keepStart && channel <= keepEnd) || channel == selectedChannel)
+      continue;
+
+    /* m_item points into the row of the selected programme */
+    const vector<GridItemsPtr> &items = m_gridRows[channel].items;
+    if (m_item && !items.empty() && m_item >= &items[0] && m_item < &items[0] + items.size())
+      continue;
+
+    FreeGridRow(channel);
+  }
+}
+
 void CGUIEPGGridContainer::GetChannelCacheOffsets(int &cacheBefore, int &cacheAfter)
 {
   if (m_channelScrollSpeed > 0)
@@ -25,6 +25,8 @@
 #include "guilib/GUIControl.h"
 #include "guilib/GUIListItemLayout.h"
 
+#include <set>
+
 namespace PVR
 {
   class CGUIWindowPVRGuide;
@@ -111,6 +113,21 @@ namespace EPG
     void Reset();
     void ClearGridIndex(void);
 
+    /*! \brief Get the programme shown in a block of a channel, laying out the channel's row if needed
+     \param channel the channel
+     \param block the block
+     \return the programme and its size. Its item is empty if there's no programme in the block
+     */
+    GridItemsPtr *GetGridItem(int channel, int block) const;
+    void LayoutGridRow(int channel) const;
+    void FreeGridRow(int channel);
+
+    /*! \brief Get the number of blocks that start before a time
+     \param time the time in UTC
+     \return the number of blocks
+     */
+    int GetBlocksBefore(const CDateTime &time) const;
+
     GridItemsPtr *GetItem(const int &channel);
     GridItemsPtr *GetNextItem(const int &channel);
     GridItemsPtr *GetPrevItem(const int &channel);
@@ -167,6 +184,7 @@ namespace EPG
     void FreeChannelMemory(int keepStart, int keepEnd);
     void FreeProgrammeMemory(int keepStart, int keepEnd);
     void FreeRulerMemory(int keepStart, int keepEnd);
+    void FreeGridMemory(int keepStart, int keepEnd);
 
     void GetChannelCacheOffsets(int &cacheBefore, int &cacheAfter);
     void GetProgrammeCacheOffsets(int &cacheBefore, int &cacheAfter);
@@ -205,7 +223,20 @@ namespace EPG
     CDateTime m_gridStart;
     CDateTime m_gridEnd;
 
-    struct GridItemsPtr **m_gridIndex;
+    /*! \brief The programmes of a channel as consecutive runs of blocks
+     Only the rows of channels that are on (or near) the screen are laid out.
+     */
+    struct GridRow
+    {
+      GridRow() : end(0), laidOut(false) {}
+      std::vector<int>          starts;  //! first block of each programme
+      std::vector<GridItemsPtr> items;   //! the programmes
+      int                       end;     //! the block after the last programme
+      bool                      laidOut;
+    };
+    mutable std::vector<GridRow> m_gridRows;
+    mutable std::set<int> m_laidOutRows; //! the rows that are laid out, so only they are looked at when freeing rows
+    mutable GridItemsPtr m_emptyGridItem;
     GridItemsPtr *m_item;
     CGUIListItem *m_lastItem;
     CGUIListItem *m_lastChannel;
@@ -19,20 +19,112 @@
  */
 
 #include "DirectoryCache.h"
+#include "DirectoryFactory.h"
+#include "File.h"
 #include "settings/Settings.h"
 #include "FileItem.h"
+#include "GUIUserMessages.h"
+#include "guilib/GUIWindowManager.h"
+#include "threads/Atomics.h"
 #include "threads/SingleLock.h"
+#include "utils/Archive.h"
+#include "utils/DirectoryFingerprints.h"
+#include "utils/Job.h"
+#include "utils/JobManager.h"
 #include "utils/log.h"
 #include "utils/URIUtils.h"
 #include "climits"
 
+#include <ctime>
+
+#define PERSISTED_DIRS_FILE    "special://temp/DirectoryCache.dat"
+#define PERSISTED_DIRS_VERSION 2
+#define MAX_PERSISTED_DIRS     500
+
 using namespace std;
 using namespace XFILE;
 
+/*! \brief Lists a directory that was served from disk without being validated and caches the fresh listing */
+class CDirectoryRefreshJob : public CJob
+{
+public:
+  CDirectoryRefreshJob(CDirectoryCache *cache, const CStdString &path, const boost::shared_ptr<CFileItemList> &served)
+    : m_cache(cache), m_path(path), m_served(served) {}
+
+  virtual const char *GetType() const { return "directoryrefresh"; }
+
+  virtual bool DoWork()
+  {
+    boost::shared_ptr<IDirectory> directory(CDirectoryFactory::Create(m_path));
+    if (!directory.get())
+      return false;
+
+    CFileItemList items;
+    if (!CDirectory::GetDirectory(m_path, items, "", DIR_FLAG_BYPASS_CACHE | DIR_FLAG_NO_FILE_DIRS | DIR_FLAG_GET_HIDDEN))
+    {
+      // the listing we served can't be trusted anymore
+      m_cache->ClearDirectory(m_path);
+      return false;
+    }
+
+    m_cache->SetDirectory(m_path, items, directory->GetCacheType(m_path));
+
+    // windows showing the listing we served have to list the directory again
+    if (!IsSameListing(*m_served, items))
+    {
+      CStdString path(m_path);
+      URIUtils::AddSlashAtEnd(path);
+      CGUIMessage message(GUI_MSG_NOTIFY_ALL, 0, 0, GUI_MSG_UPDATE_PATH);
+      message.SetStringParam(path);
+      g_windowManager.SendThreadMessage(message);
+    }
+    return true;
+  }
+
+private:
+  static bool IsSameListing(const CFileItemList &served, const CFileItemList &listed)
+  {
+    if (served.Size() != listed.Size())
+      return false;
+    for (int i = 0; i < served.Size(); i++)
+    {
+      if (served[i]->GetPath() != listed[i]->GetPath() ||
+          served[i]->m_dwSize != listed[i]->m_dwSize ||
+          served[i]->m_dateTime != listed[i]->m_dateTime)
+        return false;
+    }
+    return true;
+  }
+
+  CDirectoryCache *m_cache;
+  CStdString m_path;
+  boost::shared_ptr<CFileItemList> m_served;
+};
+
+/*! \brief Stats a directory that was served from the cache and keeps its listing between sessions */
+class CDirectoryPersistJob : public CJob
+{
+public:
+  CDirectoryPersistJob(CDirectoryCache *cache, const CStdString &path) : m_cache(cache), m_path(path) {}
+
+  virtual const char *GetType() const { return "directorypersist"; }
+
+  virtual bool DoWork()
+  {
+    m_cache->PersistDirectory(m_path);
+    return true;
+  }
+
+private:
+  CDirectoryCache *m_cache;
+  CStdString m_path;
+};
+
 CDirectoryCache::CDir::CDir(DIR_CACHE_TYPE cacheType)
 {
   m_cacheType = cacheType;
   m_lastAccess = 0;
+  m_persistRequests = 0;
   m_Items = new CFileItemList;
   m_Items->SetFastLookup(true);
 }
@@ -42,14 +134,23 @@ CDirectoryCache::CDir::~CDir()
   delete m_Items;
 }
 
-void CDirectoryCache::CDir::SetLastAccess(unsigned int &accessCounter)
+void CDirectoryCache::CDir::SetLastAccess(volatile long &accessCounter)
+{
+  // called with a shared lock, so several threads may be accessing the cache
+  m_lastAccess = (unsigned int)AtomicIncrement(&accessCounter);
+}
+
+bool CDirectoryCache::CDir::RequestPersist()
 {
-  m_lastAccess = accessCounter++;
+  // also called with a shared lock
+  return AtomicIncrement(&m_persistRequests) == 1;
 }
 
 CDirectoryCache::CDirectoryCache(void)
 {
   m_accessCounter = 0;
+  m_persistedLoaded = false;
+  m_persistedFile = PERSISTED_DIRS_FILE;
 #ifdef _DEBUG
   m_cacheHits = 0;
   m_cacheMisses = 0;
@@ -62,27 +163,40 @@ CDirectoryCache::~CDirectoryCache(void)
 
 bool CDirectoryCache::GetDirectory(const CStdString& strPath, CFileItemList &items, bool retrieveAll)
 {
-  CSingleLock lock (m_cs);
-
   CStdString storedPath = URIUtils::SubstitutePath(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
 
-  ciCache i = m_cache.find(storedPath);
-  if (i != m_cache.end())
+  bool found = false, persist = false;
   {
-    CDir* dir = i->second;
-    if (dir->m_cacheType == XFILE::DIR_CACHE_ALWAYS ||
-       (dir->m_cacheType == XFILE::DIR_CACHE_ONCE && retrieveAll))
+    CSharedLock lock (m_cs);
+
+    ciCache i = m_cache.find(storedPath);
+    if (i != m_cache.end())
     {
-      items.Copy(*dir->m_Items);
-      dir->SetLastAccess(m_accessCounter);
+      CDir* dir = i->second;
+      if (dir->m_cacheType == XFILE::DIR_CACHE_ALWAYS ||
+         (dir->m_cacheType == XFILE::DIR_CACHE_ONCE && retrieveAll))
+      {
+        items.Copy(*dir->m_Items);
+        dir->SetLastAccess(m_accessCounter);
 #ifdef _DEBUG
-      m_cacheHits+=items.Size();
+        AtomicAdd(&m_cacheHits, items.Size());
 #endif
-      return true;
+        found = true;
+        persist = IsPersistable(storedPath) && dir->RequestPersist();
+      }
     }
   }
-  return false;
+
+  if (persist)
+    PersistLater(storedPath);
+  if (found)
+    return true;
+
+  if (!IsPersistable(storedPath))
+    return false;
+
+  return GetPersistedDirectory(storedPath, items);
 }
 
 void CDirectoryCache::SetDirectory(const CStdString& strPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType)
@@ -90,6 +204,46 @@ void CDirectoryCache::SetDirectory(const CStdString& strPath, const CFileItemLis
   if (cacheType == DIR_CACHE_NEVER)
     return; // nothing to do
 
+  CStdString storedPath = URIUtils::SubstitutePath(strPath);
+  URIUtils::RemoveSlashAtEnd(storedPath);
+
+  CacheDirectory(storedPath, items, cacheType);
+}
+
+void CDirectoryCache::PersistDirectory(const CStdString& storedPath)
+{
+  CStdString fingerprint = GetFingerprint(storedPath); // stats the directory, so not under the lock
+  Load();
+
+  CExclusiveLock lock (m_cs);
+  ciCache i = m_cache.find(storedPath);
+  if (i == m_cache.end())
+    return; // dropped from the cache in the meantime
+
+  CPersistedDir dir;
+  dir.fingerprint = fingerprint;
+  dir.cacheType = i->second->m_cacheType;
+  dir.listed = (int)time(NULL);
+  dir.served = true; // this session has the fresh listing
+  dir.items.reset(new CFileItemList);
+  dir.items->Copy(*i->second->m_Items);
+
+  if (m_persisted.find(storedPath) == m_persisted.end() && m_persisted.size() >= MAX_PERSISTED_DIRS)
+  {
+    // make room by dropping the listing that is the oldest
+    map<CStdString, CPersistedDir>::iterator oldest = m_persisted.begin();
+    for (map<CStdString, CPersistedDir>::iterator i = m_persisted.begin(); i != m_persisted.end(); ++i)
+    {
+      if (i->second.listed < oldest->second.listed)
+        oldest = i;
+    }
+    m_persisted.erase(oldest);
+  }
+  m_persisted[storedPath] = dir;
+}
+
+void CDirectoryCache::CacheDirectory(const CStdString& storedPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType, bool persisted)
+{
   // caches the given directory using a copy of the items, rather than the items
   // themselves.  The reason we do this is because there is often some further
   // processing on the items (stacking, transparent rars/zips for instance) that
@@ -101,10 +255,7 @@ void CDirectoryCache::SetDirectory(const CStdString& strPath, const CFileItemLis
   // IDEALLY, any further processing on the item would actually create a new item
   // instead of altering it, but we can't really enforce that in an easy way, so
   // this is the best solution for now.
-  CSingleLock lock (m_cs);
-
-  CStdString storedPath = URIUtils::SubstitutePath(strPath);
-  URIUtils::RemoveSlashAtEnd(storedPath);
+  CExclusiveLock lock (m_cs);
 
   ClearDirectory(storedPath);
 
@@ -113,9 +264,58 @@ void CDirectoryCache::SetDirectory(const CStdString& strPath, const CFileItemLis
   CDir* dir = new CDir(cacheType);
   dir->m_Items->Copy(items);
   dir->SetLastAccess(m_accessCounter);
+  if (persisted)
+    dir->RequestPersist(); // already on disk
   m_cache.insert(pair<CStdString, CDir*>(storedPath, dir));
 }
 
+bool CDirectoryCache::GetPersistedDirectory(const CStdString& storedPath, CFileItemList &items)
+{
+  Load();
+
+  CPersistedDir dir;
+  {
+    CExclusiveLock lock (m_cs);
+
+    map<CStdString, CPersistedDir>::iterator i = m_persisted.find(storedPath);
+    if (i == m_persisted.end() || i->second.served)
+      return false;
+
+    // the listing stands in for the first listing of the session, so it's served whatever its
+    // cache type. after that it's cached under its type and the directory is listed as usual
+    i->second.served = true;
+    dir = i->second;
+  }
+
+  // validate the listing against the directory as it is now
+  CStdString fingerprint = GetFingerprint(storedPath);
+  if (!fingerprint.IsEmpty() && fingerprint != dir.fingerprint)
+  {
+    CExclusiveLock lock (m_cs);
+    m_persisted.erase(storedPath);
+    return false;
+  }
+
+  items.Copy(*dir.items);
+  CacheDirectory(storedPath, items, dir.cacheType, true);
+
+  // no way to tell whether it's still current, so serve it while it's refreshed
+  if (fingerprint.IsEmpty())
+    CJobManager::GetInstance().AddJob(new CDirectoryRefreshJob(this, storedPath, dir.items), NULL);
+
+  return true;
+}
+
+void CDirectoryCache::PersistLater(const CStdString& storedPath)
+{
+  CJobManager::GetInstance().AddJob(new CDirectoryPersistJob(this, storedPath), NULL, CJob::PRIORITY_LOW);
+}
+
+CStdString CDirectoryCache::GetFingerprint(const CStdString& storedPath) const
+{
+  return CDirectoryFingerprints::GetFingerprint(storedPath);
+}
+
 void CDirectoryCache::ClearFile(const CStdString& strFile)
 {
   CStdString strPath;
@@ -125,19 +325,24 @@ void CDirectoryCache::ClearFile(const CStdString& strFile)
 
 void CDirectoryCache::ClearDirectory(const CStdString& strPath)
 {
-  CSingleLock lock (m_cs);
+  // most files written aren't in a cached directory, so only
+  // lock out the readers once we know there is something to clear
+  CUpgradableLock lock (m_cs);
 
   CStdString storedPath = URIUtils::SubstitutePath(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
 
   iCache i = m_cache.find(storedPath);
   if (i != m_cache.end())
+  {
+    lock.Upgrade();
     Delete(i);
+  }
 }
 
 void CDirectoryCache::ClearSubPaths(const CStdString& strPath)
 {
-  CSingleLock lock (m_cs);
+  CExclusiveLock lock (m_cs);
 
   CStdString storedPath = URIUtils::SubstitutePath(strPath);
   URIUtils::RemoveSlashAtEnd(storedPath);
@@ -155,15 +360,15 @@ void CDirectoryCache::ClearSubPaths(const CStdString& strPath)
 
 void CDirectoryCache::AddFile(const CStdString& strFile)
 {
-  CSingleLock lock (m_cs);
-
   CStdString strPath;
   URIUtils::GetDirectory(strFile, strPath);
   URIUtils::RemoveSlashAtEnd(strPath);
 
+  CUpgradableLock lock (m_cs);
   ciCache i = m_cache.find(strPath);
   if (i != m_cache.end())
   {
+    lock.Upgrade();
     CDir *dir = i->second;
     CFileItemPtr item(new CFileItem(strFile, false));
     dir->m_Items->Add(item);
@@ -173,7 +378,7 @@ void CDirectoryCache::AddFile(const CStdString& strFile)
 
 bool CDirectoryCache::FileExists(const CStdString& strFile, bool& bInCache)
 {
-  CSingleLock lock (m_cs);
+  CSharedLock lock (m_cs);
   bInCache = false;
 
   CStdString strPath;
@@ -187,12 +392,27 @@ bool CDirectoryCache::FileExists(const CStdString& strFile, bool& bInCache)
     CDir *dir = i->second;
     dir->SetLastAccess(m_accessCounter);
 #ifdef _DEBUG
-    m_cacheHits++;
+    AtomicIncrement(&m_cacheHits);
 #endif
-    return dir->m_Items->Contains(strFile);
+    bool exists = dir->m_Items->Contains(strFile);
+    bool persist = IsPersistable(strPath) && dir->RequestPersist();
+    lock.Leave();
+
+    if (persist)
+      PersistLater(strPath);
+    return exists;
+  }
+  lock.Leave();
+
+  // the first lookup in a remote share this session may be answered by its persisted listing
+  CFileItemList items;
+  if (IsPersistable(strPath) && GetPersistedDirectory(strPath, items))
+  {
+    bInCache = true;
+    return items.Contains(strFile);
   }
 #ifdef _DEBUG
-  m_cacheMisses++;
+  AtomicIncrement(&m_cacheMisses);
 #endif
   return false;
 }
@@ -200,7 +420,7 @@ bool CDirectoryCache::FileExists(const CStdString& strFile, bool& bInCache)
 void CDirectoryCache::Clear()
 {
   // this routine clears everything
-  CSingleLock lock (m_cs);
+  CExclusiveLock lock (m_cs);
 
   iCache i = m_cache.begin();
   while (i != m_cache.end() )
@@ -233,7 +453,7 @@ void CDirectoryCache::ClearCache(set<CStdString>& dirs)
 
 void CDirectoryCache::CheckIfFull()
 {
-  CSingleLock lock (m_cs);
+  CExclusiveLock lock (m_cs);
   static const unsigned int max_cached_dirs = 10;
 
   // find the last accessed folder, and remove if the number of cached folders is too many
@@ -260,11 +480,100 @@ void CDirectoryCache::Delete(iCache it)
   m_cache.erase(it);
 }
 
+bool CDirectoryCache::IsPersistable(const CStdString& strPath)
+{
+  // listings of remote shares are worth keeping between sessions
+  return URIUtils::IsSmb(strPath) || URIUtils::IsNfs(strPath) ||
+         URIUtils::IsAfp(strPath) || URIUtils::IsFTP(strPath);
+}
+
+void CDirectoryCache::Load()
+{
+  // reading the file takes a while, so lookups carry on until the listings are merged in
+  CSingleLock loadLock (m_loadSection);
+  if (m_persistedLoaded)
+    return;
+
+  map<CStdString, CPersistedDir> persisted;
+  CFile file;
+  if (file.Open(m_persistedFile))
+  {
+    CArchive ar(&file, CArchive::load);
+    int version = 0, count;
+    ar >> version;
+    if (version == PERSISTED_DIRS_VERSION)
+    {
+      ar.EnableStringTable();
+      ar >> count;
+      for (int i = 0; i < count; i++)
+      {
+        CStdString path;
+        CPersistedDir dir;
+        int cacheType;
+        ar >> path;
+        ar >> dir.fingerprint;
+        ar >> cacheType;
+        ar >> dir.listed;
+        dir.cacheType = (DIR_CACHE_TYPE)cacheType;
+        dir.served = false;
+        dir.items.reset(new CFileItemList);
+        ar >> *dir.items;
+        persisted[path] = dir;
+      }
+    }
+    ar.Close();
+    file.Close();
+    CLog::Log(LOGDEBUG, "%s - loaded %u directory listings from %s", __FUNCTION__, (unsigned int)persisted.size(), m_persistedFile.c_str());
+  }
+
+  CExclusiveLock lock (m_cs);
+  // listings persisted before the file was read are more recent
+  for (map<CStdString, CPersistedDir>::iterator i = persisted.begin(); i != persisted.end(); ++i)
+    m_persisted.insert(*i);
+  m_persistedLoaded = true;
+}
+
+void CDirectoryCache::Save()
+{
+  map<CStdString, CPersistedDir> persisted;
+  {
+    CSingleLock loadLock (m_loadSection);
+    CSharedLock lock (m_cs);
+
+    // if no remote share was listed the file is still current
+    if (!m_persistedLoaded)
+      return;
+    persisted = m_persisted; // the items are shared, not copied
+  }
+
+  CFile file;
+  if (!file.OpenForWrite(m_persistedFile, true)) // overwrite always
+  {
+    CLog::Log(LOGERROR, "%s - unable to write %s", __FUNCTION__, m_persistedFile.c_str());
+    return;
+  }
+
+  CArchive ar(&file, CArchive::store);
+  ar << (int)PERSISTED_DIRS_VERSION;
+  ar.EnableStringTable();
+  ar << (int)persisted.size();
+  for (map<CStdString, CPersistedDir>::iterator i = persisted.begin(); i != persisted.end(); ++i)
+  {
+    ar << i->first;
+    ar << i->second.fingerprint;
+    ar << (int)i->second.cacheType;
+    ar << i->second.listed;
+    ar << *i->second.items;
+  }
+  ar.Close();
+  file.Close();
+}
+
 #ifdef _DEBUG
 void CDirectoryCache::PrintStats() const
 {
-  CSingleLock lock (m_cs);
-  CLog::Log(LOGDEBUG, "%s - total of %u cache hits, and %u cache misses", __FUNCTION__, m_cacheHits, m_cacheMisses);
+  CSharedLock lock (m_cs);
+  CLog::Log(LOGDEBUG, "%s - total of %u cache hits, and %u cache misses", __FUNCTION__, (unsigned int)m_cacheHits, (unsigned int)m_cacheMisses);
   // run through and find the oldest and the number of items cached
   unsigned int oldest = UINT_MAX;
   unsigned int numItems = 0;
@@ -276,6 +585,10 @@ void CDirectoryCache::PrintStats() const
     numItems += dir->m_Items->Size();
     numDirs++;
   }
-  CLog::Log(LOGDEBUG, "%s - %u folders cached, with %u items total.  Oldest is %u, current is %u", __FUNCTION__, numDirs, numItems, oldest, m_accessCounter);
+  CLog::Log(LOGDEBUG, "%s - %u folders cached, with %u items total.  Oldest is %u, current is %u", __FUNCTION__, numDirs, numItems, oldest, (unsigned int)m_accessCounter);
+  const XbmcThreads::LockContention &cache = m_cs.get_contention();
+  const XbmcThreads::LockContention &load = m_loadSection.get_contention();
+  CLog::Log(LOGDEBUG, "%s - waited %u times for the cache (%u ms, longest %u ms) and %u times for loading (%u ms, longest %u ms)", __FUNCTION__,
+            cache.waits, cache.waitedMs, cache.maxWaitMs, load.waits, load.waitedMs, load.maxWaitMs);
 }
 #endif
@@ -22,9 +22,11 @@
 #include "IDirectory.h"
 #include "Directory.h"
 #include "threads/CriticalSection.h"
+#include "threads/SharedSection.h"
 
 #include <map>
 #include <set>
+#include <boost/shared_ptr.hpp>
 
 class CFileItem;
 
@@ -38,14 +40,30 @@ namespace XFILE
       CDir(DIR_CACHE_TYPE cacheType);
       virtual ~CDir();
 
-      void SetLastAccess(unsigned int &accessCounter);
+      void SetLastAccess(volatile long &accessCounter);
       unsigned int GetLastAccess() const { return m_lastAccess; };
 
+      /*! \brief Called when the listing is served from the cache
+       \return true the first time, when the listing should be kept between sessions
+       */
+      bool RequestPersist();
+
       CFileItemList* m_Items;
       DIR_CACHE_TYPE m_cacheType;
+      volatile long m_persistRequests;
     private:
-      unsigned int m_lastAccess;
+      volatile unsigned int m_lastAccess;
     };
+
+    /*! \brief A listing of a remote share kept on disk between sessions */
+    typedef struct
+    {
+      CStdString fingerprint;                   ///< modification time of the directory when it was listed
+      DIR_CACHE_TYPE cacheType;
+      int listed;                               ///< time it was listed, the most recent listings are kept
+      bool served;                              ///< already served this session
+      boost::shared_ptr<CFileItemList> items;
+    } CPersistedDir;
   public:
     CDirectoryCache(void);
     virtual ~CDirectoryCache(void);
@@ -57,6 +75,19 @@ namespace XFILE
     void Clear();
     void AddFile(const CStdString& strFile);
     bool FileExists(const CStdString& strPath, bool& bInCache);
+
+    /*! \brief Write the listings of remote shares to disk
+     Only listings that were served from the cache at least once this session are kept. The first
+     lookup of each of these directories in the next session, a listing or a FileExists() check, is
+     served from disk if the modification time of the directory is unchanged. If the
+     directory can't be stat'ed the listing is served as is and refreshed by a background job.
+     */
+    void Save();
+
+    /*! \brief Keep the cached listing of a remote share between sessions
+     Stats the directory, so it's called from a background job rather than on lookups.
+     */
+    void PersistDirectory(const CStdString& storedPath);
 #ifdef _DEBUG
     void PrintStats() const;
 #endif
@@ -65,18 +96,35 @@ namespace XFILE
     void ClearCache(std::set<CStdString>& dirs);
     void CheckIfFull();
 
+    void Load();
+    /*! \brief Serve the persisted listing of a directory, the first time it's looked up this session
+     Whatever the cache type of the listing, provided the directory is unchanged since it was listed.
+     */
+    bool GetPersistedDirectory(const CStdString& storedPath, CFileItemList &items);
+    void CacheDirectory(const CStdString& storedPath, const CFileItemList &items, DIR_CACHE_TYPE cacheType, bool persisted = false);
+    static bool IsPersistable(const CStdString& strPath);
+
+    /*! \brief Queue a job that calls PersistDirectory() */
+    virtual void PersistLater(const CStdString& storedPath);
+    virtual CStdString GetFingerprint(const CStdString& storedPath) const;
+
     std::map<CStdString, CDir*> m_cache;
     typedef std::map<CStdString, CDir*>::iterator iCache;
     typedef std::map<CStdString, CDir*>::const_iterator ciCache;
     void Delete(iCache i);
 
-    CCriticalSection m_cs;
+    CSharedSection m_cs; ///< lookups only take a shared lock
+
+    volatile long m_accessCounter;
 
-    unsigned int m_accessCounter;
+    std::map<CStdString, CPersistedDir> m_persisted;
+    bool m_persistedLoaded;
+    CStdString m_persistedFile;
+    CCriticalSection m_loadSection; ///< held while the persisted listings are read, without holding m_cs
 
 #ifdef _DEBUG
-    unsigned int m_cacheHits;
-    unsigned int m_cacheMisses;
+    volatile long m_cacheHits;
+    volatile long m_cacheMisses;
 #endif
   };
 }
@@ -30,13 +30,18 @@
 #include "utils/log.h"
 #include "utils/URIUtils.h"
 #include "network/DNSNameCache.h"
+#include "settings/AdvancedSettings.h"
 #include "threads/SystemClock.h"
 
+#include <algorithm>
 #include <nfsc/libnfs-raw-mount.h>
 
 #ifdef TARGET_WINDOWS
 #include <fcntl.h>
 #include <sys\stat.h>
+#define poll WSAPoll
+#else
+#include <poll.h>
 #endif
 
 //KEEP_ALIVE_TIMEOUT is decremented every half a second
@@ -445,8 +450,122 @@ void CNfsConnection::AddIdleConnection()
 
 CNfsConnection gNfsConnection;
 
+struct NfsRequestBatch;
+
+//a READ or WRITE request of a file
+struct NfsRequest
+{
+  char *buffer;//data to write or where the data read goes
+  uint64_t count;//number of bytes requested
+  int status;//number of bytes transferred or error
+  NfsRequestBatch *batch;//the requests issued together with this one
+};
+
+//the requests in flight - owned by the context once the caller gave up on them,
+//their callbacks still fire when the context is serviced or destroyed later
+struct NfsRequestBatch
+{
+  std::vector<NfsRequest> requests;
+  unsigned int pending;//number of requests in flight
+  bool bWrite;
+  bool abandoned;//the caller returned - nothing may be copied to its buffers anymore
+};
+
+static void NfsRequestDone(int status, struct nfs_context *nfs, void *data, void *private_data)
+{
+  NfsRequest *request = (NfsRequest *)private_data;
+  NfsRequestBatch *batch = request->batch;
+  request->status = status;
+  //for reads data holds the bytes read - replies can arrive in any order
+  //but every request knows where its data goes
+  if (!batch->bWrite && !batch->abandoned && status > 0 && data && request->count)
+    memcpy(request->buffer, data, std::min((uint64_t)status, request->count));
+  if (--batch->pending == 0 && batch->abandoned)
+    delete batch;
+}
+
+//issues the requests back to back at offset, keeping up to <nfs><requests> of them
+//in flight, and returns when all of them are done - call with the connection locked.
+//if the context fails while requests are in flight they are left to the context,
+//which still calls them back, and count as failed
+static bool RunNfsRequests(struct nfs_context *nfs, struct nfsfh *fh, uint64_t offset, std::vector<NfsRequest> &requests, bool bWrite)
+{
+  DllLibNfs *lib = gNfsConnection.GetImpl();
+  unsigned int window = (unsigned int)g_advancedSettings.m_nfsrequests;
+  size_t next = 0;
+  bool bReturn = true;
+
+  NfsRequestBatch *batch = new NfsRequestBatch;
+  batch->requests = requests;
+  batch->pending = 0;
+  batch->bWrite = bWrite;
+  batch->abandoned = false;
+
+  while (next < batch->requests.size() || batch->pending > 0)
+  {
+    while (bReturn && next < batch->requests.size() && batch->pending < window)
+    {
+      NfsRequest &request = batch->requests[next++];
+      request.batch = batch;
+      request.status = -1;//until it is called back
+      int ret = bWrite ?
+        lib->nfs_pwrite_async(nfs, fh, offset, request.count, request.buffer, NfsRequestDone, &request) :
+        lib->nfs_pread_async(nfs, fh, offset, request.count, NfsRequestDone, &request);
+      if (ret != 0)
+      {
+        CLog::Log(LOGERROR, "NFS: Failed to queue request (%s)", lib->nfs_get_error(nfs));
+        request.status = -1;
+        bReturn = false;
+        break;
+      }
+      batch->pending++;
+      offset += request.count;
+    }
+
+    if (!bReturn)
+    {
+      //requests that weren't issued count as failed
+      for (; next < batch->requests.size(); next++)
+        batch->requests[next].status = -1;
+    }
+
+    if (batch->pending == 0)
+      continue;
+
+    struct pollfd pfd;
+    pfd.fd = lib->nfs_get_fd(nfs);
+    pfd.events = lib->nfs_which_events(nfs);
+    pfd.revents = 0;
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+    {
+      CLog::Log(LOGERROR, "NFS: poll failed (%s)", strerror(errno));
+      bReturn = false;
+      break;
+    }
+    if (lib->nfs_service(nfs, pfd.revents) < 0)
+    {
+      CLog::Log(LOGERROR, "NFS: nfs_service failed (%s)", lib->nfs_get_error(nfs));
+      bReturn = false;
+      break;
+    }
+  }
+
+  //requests still in flight keep their failed status
+  for (size_t i = 0; i < requests.size(); i++)
+    requests[i].status = batch->requests[i].status;
+
+  if (batch->pending > 0)
+    batch->abandoned = true;
+  else
+    delete batch;
+
+  return bReturn;
+}
+
 CNFSFile::CNFSFile()
 : m_fileSize(0)
+, m_offset(0)
+, m_readBufferOffset(0)
 , m_pFileHandle(NULL)
 , m_pNfsContext(NULL)
 {
@@ -461,19 +580,11 @@ CNFSFile::~CNFSFile()
 
 int64_t CNFSFile::GetPosition()
 {
-  int ret = 0;
-  uint64_t offset = 0;
   CSingleLock lock(gNfsConnection);
   
   if (gNfsConnection.GetNfsContext() == NULL || m_pFileHandle == NULL) return 0;
   
-  ret = (int)gNfsConnection.GetImpl()->nfs_lseek(gNfsConnection.GetNfsContext(), m_pFileHandle, 0, SEEK_CUR, &offset);
-  
-  if (ret < 0) 
-  {
-    CLog::Log(LOGERROR, "NFS: Failed to lseek(%s)",gNfsConnection.GetImpl()->nfs_get_error(gNfsConnection.GetNfsContext()));
-  }
-  return offset;
+  return m_offset;
 }
 
 int64_t CNFSFile::GetLength()
@@ -524,6 +635,8 @@ bool CNFSFile::Open(const CURL& url)
   }
   
   m_fileSize = tmpBuffer.st_size;//cache the size of this file
+  m_offset = 0;
+  m_readBuffer.clear();
   // We've successfully opened the file!
   return true;
 }
@@ -581,26 +694,73 @@ int CNFSFile::Stat(const CURL& url, struct __stat64* buffer)
   return ret;
 }
 
+bool CNFSFile::ReadAhead(int64_t iSize)
+{
+  uint64_t chunkSize = gNfsConnection.GetMaxReadChunkSize();
+  if (chunkSize == 0)
+    chunkSize = 32768;
+
+  std::vector<NfsRequest> requests((size_t)((iSize + chunkSize - 1) / chunkSize));
+  m_readBuffer.resize(requests.size() * chunkSize);
+  m_readBufferOffset = m_offset;
+  for (size_t i = 0; i < requests.size(); i++)
+  {
+    requests[i].buffer = &m_readBuffer[i * chunkSize];
+    requests[i].count = chunkSize;
+    requests[i].status = -1;
+  }
+
+  bool bReturn = RunNfsRequests(m_pNfsContext, m_pFileHandle, m_offset, requests, false);
+
+  //the data is only usable up to the first failed or short read (eof)
+  size_t validBytes = 0;
+  for (size_t i = 0; i < requests.size() && requests[i].status >= 0; i++)
+  {
+    validBytes += requests[i].status;
+    if ((uint64_t)requests[i].status < requests[i].count)
+      break;
+  }
+  m_readBuffer.resize(validBytes);
+
+  return bReturn || validBytes > 0;
+}
+
 unsigned int CNFSFile::Read(void *lpBuf, int64_t uiBufSize)
 {
-  int numberOfBytesRead = 0;
   CSingleLock lock(gNfsConnection);
   
   if (m_pFileHandle == NULL || m_pNfsContext == NULL ) return 0;
 
-  numberOfBytesRead = gNfsConnection.GetImpl()->nfs_read(m_pNfsContext, m_pFileHandle, uiBufSize, (char *)lpBuf);  
+  int64_t bufferEnd = m_readBufferOffset + m_readBuffer.size();
+  if (m_offset < m_readBufferOffset || m_offset >= bufferEnd)
+  {
+    //read ahead a whole window when reading on sequentially, otherwise only what was asked for
+    int64_t readSize = uiBufSize;
+    if (m_offset == bufferEnd && !m_readBuffer.empty())
+      readSize = std::max(readSize, (int64_t)(g_advancedSettings.m_nfsrequests * gNfsConnection.GetMaxReadChunkSize()));
+
+    if (!ReadAhead(readSize))
+    {
+      //something went wrong ...
+      CLog::Log(LOGERROR, "%s - Error( %s )", __FUNCTION__, gNfsConnection.GetImpl()->nfs_get_error(m_pNfsContext));
+      m_readBuffer.clear();
+      return 0;
+    }
+  }
+
+  unsigned int numberOfBytesRead = 0;
+  if (m_offset >= m_readBufferOffset && m_offset < m_readBufferOffset + (int64_t)m_readBuffer.size())
+  {
+    numberOfBytesRead = (unsigned int)std::min(uiBufSize, m_readBufferOffset + (int64_t)m_readBuffer.size() - m_offset);
+    memcpy(lpBuf, &m_readBuffer[(size_t)(m_offset - m_readBufferOffset)], numberOfBytesRead);
+    m_offset += numberOfBytesRead;
+  }
 
   lock.Leave();//no need to keep the connection lock after that
   
   gNfsConnection.resetKeepAlive(m_pFileHandle);//triggers keep alive timer reset for this filehandle
   
-  //something went wrong ...
-  if (numberOfBytesRead < 0) 
-  {
-    CLog::Log(LOGERROR, "%s - Error( %d, %s )", __FUNCTION__, numberOfBytesRead, gNfsConnection.GetImpl()->nfs_get_error(m_pNfsContext));
-    return 0;
-  }
-  return (unsigned int)numberOfBytesRead;
+  return numberOfBytesRead;
 }
 
 int64_t CNFSFile::Seek(int64_t iFilePosition, int iWhence)
@@ -611,6 +771,12 @@ int64_t CNFSFile::Seek(int64_t iFilePosition, int iWhence)
   CSingleLock lock(gNfsConnection);  
   if (m_pFileHandle == NULL || m_pNfsContext == NULL) return -1;
   
+  //reads and writes don't move the position of the handle
+  if (iWhence == SEEK_CUR)
+  {
+    iFilePosition += m_offset;
+    iWhence = SEEK_SET;
+  }
  
   ret = (int)gNfsConnection.GetImpl()->nfs_lseek(m_pNfsContext, m_pFileHandle, iFilePosition, iWhence, &offset);
   if (ret < 0) 
@@ -618,7 +784,8 @@ int64_t CNFSFile::Seek(int64_t iFilePosition, int iWhence)
     CLog::Log(LOGERROR, "%s - Error( seekpos: %"PRId64", whence: %i, fsize: %"PRId64", %s)", __FUNCTION__, iFilePosition, iWhence, m_fileSize, gNfsConnection.GetImpl()->nfs_get_error(m_pNfsContext));
     return -1;
   }
-  return (int64_t)offset;
+  m_offset = (int64_t)offset;
+  return m_offset;
 }
 
 int CNFSFile::Truncate(int64_t iSize)
@@ -629,6 +796,7 @@ int CNFSFile::Truncate(int64_t iSize)
   if (m_pFileHandle == NULL || m_pNfsContext == NULL) return -1;
   
   
+  m_readBuffer.clear();
   ret = (int)gNfsConnection.GetImpl()->nfs_ftruncate(m_pNfsContext, m_pFileHandle, iSize);
   if (ret < 0) 
   {
@@ -656,49 +824,57 @@ void CNFSFile::Close()
     m_pFileHandle = NULL;
     m_pNfsContext = NULL;    
     m_fileSize = 0;
+    m_offset = 0;
+    m_readBuffer.clear();
   }
 }
 
 //this was a bitch!
 //for nfs write to work we have to write chunked
 //otherwise this could crash on big files
+//the chunks are sent as a window of requests in flight
 int CNFSFile::Write(const void* lpBuf, int64_t uiBufSize)
 {
   int numberOfBytesWritten = 0;
-  int writtenBytes = 0;
-  int64_t leftBytes = uiBufSize;
   //clamp max write chunksize to 32kb - fixme - this might be superfluious with future libnfs versions
   int64_t chunkSize = gNfsConnection.GetMaxWriteChunkSize() > 32768 ? 32768 : gNfsConnection.GetMaxWriteChunkSize();
+  if (chunkSize <= 0)
+    chunkSize = 32768;
   
   CSingleLock lock(gNfsConnection);
   
   if (m_pFileHandle == NULL || m_pNfsContext == NULL) return -1;
-  
-  //write as long as some bytes are left to be written
-  while( leftBytes )
+
+  m_readBuffer.clear();
+
+  std::vector<NfsRequest> requests((size_t)((uiBufSize + chunkSize - 1) / chunkSize));
+  for (size_t i = 0; i < requests.size(); i++)
+  {
+    //the last chunk could be smaller than chunksize
+    requests[i].buffer = (char *)lpBuf + i * chunkSize;
+    requests[i].count = std::min(chunkSize, uiBufSize - (int64_t)(i * chunkSize));
+    requests[i].status = -1;
+  }
+
+  RunNfsRequests(m_pNfsContext, m_pFileHandle, m_offset, requests, true);
+
+  //only count what was written without a gap
+  for (size_t i = 0; i < requests.size(); i++)
   {
-    //the last chunk could be smalle than chunksize
-    if(leftBytes < chunkSize)
-    {
-      chunkSize = leftBytes;//write last chunk with correct size
-    }
-    //write chunk
-    writtenBytes = gNfsConnection.GetImpl()->nfs_write(m_pNfsContext,
-                                  m_pFileHandle, 
-                                  chunkSize, 
-                                  (char *)lpBuf + numberOfBytesWritten);
-    //decrease left bytes
-    leftBytes-= writtenBytes;
-    //increase overall written bytes
-    numberOfBytesWritten += writtenBytes;
-        
     //danger - something went wrong
-    if (writtenBytes < 0) 
+    if (requests[i].status < 0) 
     {
       CLog::Log(LOGERROR, "Failed to pwrite(%s) %s\n", m_url.GetFileName().c_str(), gNfsConnection.GetImpl()->nfs_get_error(m_pNfsContext));        
+      if (i == 0)
+        return -1;
       break;
     }     
+    numberOfBytesWritten += requests[i].status;
+    if ((uint64_t)requests[i].status < requests[i].count)
+      break;
   }
+  m_offset += numberOfBytesWritten;
+
   //return total number of written bytes
   return numberOfBytesWritten;
 }
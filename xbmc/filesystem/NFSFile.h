@@ -28,6 +28,7 @@
 #include <list>
 #include "SectionLoader.h"
 #include <map>
+#include <vector>
 
 #ifdef TARGET_WINDOWS
 #define S_IRGRP 0
@@ -146,7 +147,13 @@ namespace XFILE
   protected:
     CURL m_url;
     bool IsValidFile(const CStdString& strFileName);
+    //fills the read buffer with at least iSize bytes from the current position
+    //using a window of requests in flight - call with the connection locked
+    bool ReadAhead(int64_t iSize);
     int64_t m_fileSize;
+    int64_t m_offset;//current position - reads and writes are done at this offset
+    std::vector<char> m_readBuffer;//data read ahead
+    int64_t m_readBufferOffset;//file offset of the first byte in m_readBuffer
     struct nfsfh  *m_pFileHandle;
     struct nfs_context *m_pNfsContext;//current nfs context    
   };
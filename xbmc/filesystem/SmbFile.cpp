@@ -28,6 +28,7 @@
 #include "SMBDirectory.h"
 #include "Util.h"
 #include <libsmbclient.h>
+#include <algorithm>
 #include "settings/AdvancedSettings.h"
 #include "settings/GUISettings.h"
 #include "threads/SingleLock.h"
@@ -35,6 +36,28 @@
 #include "utils/TimeUtils.h"
 #include "commons/Exception.h"
 
+/* requests are clamped to this size, see CSmbFile::Read() */
+#define SMB_MAX_READ_SIZE (64*1024-2)
+
+/* functions of a context, for files that don't use the global one */
+#ifdef DEPRECATED_SMBC_INTERFACE
+#define SMBC_OPEN(ctx)  smbc_getFunctionOpen(ctx)
+#define SMBC_CREAT(ctx) smbc_getFunctionCreat(ctx)
+#define SMBC_READ(ctx)  smbc_getFunctionRead(ctx)
+#define SMBC_WRITE(ctx) smbc_getFunctionWrite(ctx)
+#define SMBC_LSEEK(ctx) smbc_getFunctionLseek(ctx)
+#define SMBC_FSTAT(ctx) smbc_getFunctionFstat(ctx)
+#define SMBC_CLOSE(ctx) smbc_getFunctionClose(ctx)
+#else
+#define SMBC_OPEN(ctx)  (ctx)->open
+#define SMBC_CREAT(ctx) (ctx)->creat
+#define SMBC_READ(ctx)  (ctx)->read
+#define SMBC_WRITE(ctx) (ctx)->write
+#define SMBC_LSEEK(ctx) (ctx)->lseek
+#define SMBC_FSTAT(ctx) (ctx)->fstat
+#define SMBC_CLOSE(ctx) (ctx)->close_fn
+#endif
+
 using namespace XFILE;
 
 void xb_smbc_log(const char* msg)
@@ -61,6 +84,7 @@ CSMB::CSMB()
   m_IdleTimeout = 0;
 #endif
   m_context = NULL;
+  m_contextUsers = 0;
 }
 
 CSMB::~CSMB()
@@ -75,10 +99,23 @@ void CSMB::Deinit()
   /* samba goes loco if deinited while it has some files opened */
   if (m_context)
   {
+    /* files still hold their contexts, they are freed once they're all returned */
+    if (m_contextUsers > 0)
+    {
+      CLog::Log(LOGDEBUG, "%s - not deinitialising, %d file contexts still in use", __FUNCTION__, m_contextUsers);
+      return;
+    }
+
     try
     {
       smbc_set_context(NULL);
       smbc_free_context(m_context, 1);
+
+      for (std::vector<FileContext>::iterator it = m_fileContexts.begin(); it != m_fileContexts.end(); ++it)
+      {
+        smbc_free_context(it->context, 1);
+        delete it->section;
+      }
     }
     XBMCCOMMONS_HANDLE_UNCHECKED
     catch(...)
@@ -86,6 +123,7 @@ void CSMB::Deinit()
       CLog::Log(LOGERROR,"exception on CSMB::Deinit. errno: %d", errno);
     }
     m_context = NULL;
+    m_fileContexts.clear();
   }
 }
 
@@ -143,6 +181,17 @@ void CSMB::Init()
     }
 #endif
 
+#ifdef HAVE_SMBC_THREAD_POSIX
+    // libsmbclient keeps global state, files on their own contexts call it from several threads.
+    // this MUST be before any other call to libsmbclient.
+    static bool threadsInitialized = false;
+    if (!threadsInitialized)
+    {
+      smbc_thread_posix();
+      threadsInitialized = true;
+    }
+#endif
+
     // reads smb.conf so this MUST be after we create smb.conf
     // multiple smbc_init calls are ignored by libsmbclient.
     smbc_init(xb_smbc_auth, 0);
@@ -153,29 +202,8 @@ void CSMB::Init()
 #endif
 
     // setup our context
-    m_context = smbc_new_context();
-#ifdef DEPRECATED_SMBC_INTERFACE
-    smbc_setDebug(m_context, g_advancedSettings.m_logLevel == LOG_LEVEL_DEBUG_SAMBA ? 10 : 0);
-    smbc_setFunctionAuthData(m_context, xb_smbc_auth);
-    orig_cache = smbc_getFunctionGetCachedServer(m_context);
-    smbc_setFunctionGetCachedServer(m_context, xb_smbc_cache);
-    smbc_setOptionOneSharePerServer(m_context, false);
-    smbc_setOptionBrowseMaxLmbCount(m_context, 0);
-    smbc_setTimeout(m_context, g_advancedSettings.m_sambaclienttimeout * 1000);
-    smbc_setUser(m_context, strdup("guest"));
-#else
-    m_context->debug = g_advancedSettings.m_logLevel == LOG_LEVEL_DEBUG_SAMBA ? 10 : 0;
-    m_context->callbacks.auth_fn = xb_smbc_auth;
-    orig_cache = m_context->callbacks.get_cached_srv_fn;
-    m_context->callbacks.get_cached_srv_fn = xb_smbc_cache;
-    m_context->options.one_share_per_server = false;
-    m_context->options.browse_max_lmb_count = 0;
-    m_context->timeout = g_advancedSettings.m_sambaclienttimeout * 1000;
-    m_context->user = strdup("guest");
-#endif
-
-    // initialize samba and do some hacking into the settings
-    if (smbc_init_context(m_context))
+    m_context = CreateContext();
+    if (m_context)
     {
       /* setup old interface to use this context */
       smbc_set_context(m_context);
@@ -196,17 +224,101 @@ void CSMB::Init()
         lp_do_parameter( -1, "dos charset", "CP850");
 #endif
     }
-    else
-    {
-      smbc_free_context(m_context, 1);
-      m_context = NULL;
-    }
   }
 #ifdef TARGET_POSIX
   m_IdleTimeout = 180;
 #endif
 }
 
+SMBCCTX *CSMB::CreateContext()
+{
+  SMBCCTX *context = smbc_new_context();
+#ifdef DEPRECATED_SMBC_INTERFACE
+  smbc_setDebug(context, g_advancedSettings.m_logLevel == LOG_LEVEL_DEBUG_SAMBA ? 10 : 0);
+  smbc_setFunctionAuthData(context, xb_smbc_auth);
+  orig_cache = smbc_getFunctionGetCachedServer(context);
+  smbc_setFunctionGetCachedServer(context, xb_smbc_cache);
+  smbc_setOptionOneSharePerServer(context, false);
+  smbc_setOptionBrowseMaxLmbCount(context, 0);
+  smbc_setTimeout(context, g_advancedSettings.m_sambaclienttimeout * 1000);
+  smbc_setUser(context, strdup("guest"));
+#else
+  context->debug = g_advancedSettings.m_logLevel == LOG_LEVEL_DEBUG_SAMBA ? 10 : 0;
+  context->callbacks.auth_fn = xb_smbc_auth;
+  orig_cache = context->callbacks.get_cached_srv_fn;
+  context->callbacks.get_cached_srv_fn = xb_smbc_cache;
+  context->options.one_share_per_server = false;
+  context->options.browse_max_lmb_count = 0;
+  context->timeout = g_advancedSettings.m_sambaclienttimeout * 1000;
+  context->user = strdup("guest");
+#endif
+
+  // initialize samba
+  if (!smbc_init_context(context))
+  {
+    smbc_free_context(context, 1);
+    return NULL;
+  }
+
+  return context;
+}
+
+SMBCCTX *CSMB::AcquireFileContext(CCriticalSection *&section)
+{
+  CSingleLock lock(*this);
+  Init();
+  section = this;
+  if (!m_context)
+    return NULL;
+
+  m_contextUsers++;
+
+#ifndef HAVE_SMBC_THREAD_POSIX
+  /* without thread support libsmbclient may only be called under our lock */
+  return m_context;
+#endif
+
+  for (std::vector<FileContext>::iterator it = m_fileContexts.begin(); it != m_fileContexts.end(); ++it)
+  {
+    if (!it->inUse)
+    {
+      it->inUse = true;
+      section = it->section;
+      return it->context;
+    }
+  }
+
+  if ((int)m_fileContexts.size() < g_advancedSettings.m_sambafilecontexts)
+  {
+    FileContext fileContext = { CreateContext(), NULL, true };
+    if (fileContext.context)
+    {
+      fileContext.section = new CCriticalSection;
+      m_fileContexts.push_back(fileContext);
+      section = fileContext.section;
+      return fileContext.context;
+    }
+  }
+
+  /* all contexts are busy, share the global one */
+  return m_context;
+}
+
+void CSMB::ReleaseFileContext(SMBCCTX *context)
+{
+  CSingleLock lock(*this);
+  if (m_contextUsers > 0)
+    m_contextUsers--;
+  for (std::vector<FileContext>::iterator it = m_fileContexts.begin(); it != m_fileContexts.end(); ++it)
+  {
+    if (it->context == context)
+    {
+      it->inUse = false;
+      break;
+    }
+  }
+}
+
 void CSMB::Purge()
 {
 #ifdef TARGET_WINDOWS
@@ -349,7 +461,9 @@ CSMB smb;
 CSmbFile::CSmbFile()
 {
   smb.Init();
-  m_fd = -1;
+  m_file = NULL;
+  m_context = NULL;
+  m_section = &smb;
 #ifdef TARGET_POSIX
   smb.AddActiveConnection();
 #endif
@@ -365,10 +479,9 @@ CSmbFile::~CSmbFile()
 
 int64_t CSmbFile::GetPosition()
 {
-  if (m_fd == -1) return 0;
-  smb.Init();
-  CSingleLock lock(smb);
-  int64_t pos = smbc_lseek(m_fd, 0, SEEK_CUR);
+  if (!m_file) return 0;
+  CSingleLock lock(*m_section);
+  int64_t pos = SMBC_LSEEK(m_context)(m_context, m_file, 0, SEEK_CUR);
   if ( pos < 0 )
     return 0;
   return pos;
@@ -376,7 +489,7 @@ int64_t CSmbFile::GetPosition()
 
 int64_t CSmbFile::GetLength()
 {
-  if (m_fd == -1) return 0;
+  if (!m_file) return 0;
   return m_fileSize;
 }
 
@@ -398,10 +511,10 @@ bool CSmbFile::Open(const CURL& url)
   // listed, which will create lot's of open sessions.
 
   CStdString strFileName;
-  m_fd = OpenFile(url, strFileName);
+  m_file = OpenFile(url, strFileName);
 
-  CLog::Log(LOGDEBUG,"CSmbFile::Open - opened %s, fd=%d",url.GetFileName().c_str(), m_fd);
-  if (m_fd == -1)
+  CLog::Log(LOGDEBUG,"CSmbFile::Open - opened %s, file=%p",url.GetFileName().c_str(), (void *)m_file);
+  if (!m_file)
   {
     // write error to logfile
 #ifdef TARGET_WINDOWS
@@ -413,26 +526,26 @@ bool CSmbFile::Open(const CURL& url)
     return false;
   }
 
-  CSingleLock lock(smb);
+  CSingleLock lock(*m_section);
 #ifdef TARGET_WINDOWS
   struct __stat64 tmpBuffer = {0};
 #else
   struct stat tmpBuffer;
 #endif
-  if (smbc_stat(strFileName, &tmpBuffer) < 0)
+  if (SMBC_FSTAT(m_context)(m_context, m_file, &tmpBuffer) < 0)
   {
-    smbc_close(m_fd);
-    m_fd = -1;
+    lock.Leave();
+    Close();
     return false;
   }
 
   m_fileSize = tmpBuffer.st_size;
 
-  int64_t ret = smbc_lseek(m_fd, 0, SEEK_SET);
+  int64_t ret = SMBC_LSEEK(m_context)(m_context, m_file, 0, SEEK_SET);
   if ( ret < 0 )
   {
-    smbc_close(m_fd);
-    m_fd = -1;
+    lock.Leave();
+    Close();
     return false;
   }
   // We've successfully opened the file!
@@ -465,23 +578,30 @@ int CSmbFile::OpenFile(CStdString& strAuth)
 }
 */
 
-int CSmbFile::OpenFile(const CURL &url, CStdString& strAuth)
+SMBCFILE *CSmbFile::OpenFile(const CURL &url, CStdString& strAuth)
 {
-  int fd = -1;
-  smb.Init();
+  SMBCFILE *file = NULL;
+  m_context = smb.AcquireFileContext(m_section);
+  if (!m_context)
+    return NULL;
 
   strAuth = GetAuthenticatedPath(url);
-  CStdString strPath = strAuth;
 
   {
-    CSingleLock lock(smb);
-    fd = smbc_open(strPath.c_str(), O_RDONLY, 0);
+    CSingleLock lock(*m_section);
+    file = SMBC_OPEN(m_context)(m_context, strAuth.c_str(), O_RDONLY, 0);
   }
 
-  if (fd >= 0)
-    strAuth = strPath;
+  if (!file)
+  {
+    int error = errno;
+    smb.ReleaseFileContext(m_context);
+    m_context = NULL;
+    m_section = &smb;
+    errno = error;
+  }
 
-  return fd;
+  return file;
 }
 
 bool CSmbFile::Exists(const CURL& url)
@@ -508,7 +628,7 @@ bool CSmbFile::Exists(const CURL& url)
 
 int CSmbFile::Stat(struct __stat64* buffer)
 {
-  if (m_fd == -1)
+  if (!m_file)
     return -1;
 
 #ifdef TARGET_WINDOWS
@@ -517,8 +637,8 @@ int CSmbFile::Stat(struct __stat64* buffer)
   struct stat tmpBuffer = {0};
 #endif
 
-  CSingleLock lock(smb);
-  int iResult = smbc_fstat(m_fd, &tmpBuffer);
+  CSingleLock lock(*m_section);
+  int iResult = SMBC_FSTAT(m_context)(m_context, m_file, &tmpBuffer);
 
   memset(buffer, 0, sizeof(struct __stat64));
   buffer->st_dev = tmpBuffer.st_dev;
@@ -567,7 +687,7 @@ int CSmbFile::Stat(const CURL& url, struct __stat64* buffer)
 
 int CSmbFile::Truncate(int64_t size)
 {
-  if (m_fd == -1) return 0;
+  if (!m_file) return 0;
 /* 
  * This would force us to be dependant on SMBv3.2 which is GPLv3
  * This is only used by the TagLib writers, which are not currently in use
@@ -586,8 +706,8 @@ int CSmbFile::Truncate(int64_t size)
 
 unsigned int CSmbFile::Read(void *lpBuf, int64_t uiBufSize)
 {
-  if (m_fd == -1) return 0;
-  CSingleLock lock(smb); // Init not called since it has to be "inited" by now
+  if (!m_file) return 0;
+  CSingleLock lock(*m_section);
 #ifdef TARGET_POSIX
   smb.SetActivityTime();
 #endif
@@ -598,39 +718,52 @@ unsigned int CSmbFile::Read(void *lpBuf, int64_t uiBufSize)
   /* also worse, a request of exactly 64k will return */
   /* as if eof, client has a workaround for windows */
   /* thou it seems other servers are affected too */
-  if( uiBufSize >= 64*1024-2 )
-    uiBufSize = 64*1024-2;
+  /* so no request may be larger than SMB_MAX_READ_SIZE, but as */
+  /* long as full requests are returned we keep on reading */
+  unsigned int totalRead = 0;
+  while (totalRead < uiBufSize)
+  {
+    int requestSize = (int)std::min(uiBufSize - totalRead, (int64_t)SMB_MAX_READ_SIZE);
+    char *buffer = (char *)lpBuf + totalRead;
 
-  int bytesRead = smbc_read(m_fd, lpBuf, (int)uiBufSize);
+    int bytesRead = SMBC_READ(m_context)(m_context, m_file, buffer, requestSize);
 
-  if ( bytesRead < 0 && errno == EINVAL )
-  {
-    CLog::Log(LOGERROR, "%s - Error( %d, %d, %s ) - Retrying", __FUNCTION__, bytesRead, errno, strerror(errno));
-    bytesRead = smbc_read(m_fd, lpBuf, (int)uiBufSize);
-  }
+    if ( bytesRead < 0 && errno == EINVAL )
+    {
+      CLog::Log(LOGERROR, "%s - Error( %d, %d, %s ) - Retrying", __FUNCTION__, bytesRead, errno, strerror(errno));
+      bytesRead = SMBC_READ(m_context)(m_context, m_file, buffer, requestSize);
+    }
 
-  if ( bytesRead < 0 )
-  {
+    if ( bytesRead < 0 )
+    {
 #ifdef TARGET_WINDOWS
-    CLog::Log(LOGERROR, "%s - Error( %s )", __FUNCTION__, get_friendly_nt_error_msg(smb.ConvertUnixToNT(errno)));
+      CLog::Log(LOGERROR, "%s - Error( %s )", __FUNCTION__, get_friendly_nt_error_msg(smb.ConvertUnixToNT(errno)));
 #else
-    CLog::Log(LOGERROR, "%s - Error( %d, %d, %s )", __FUNCTION__, bytesRead, errno, strerror(errno));
+      CLog::Log(LOGERROR, "%s - Error( %d, %d, %s )", __FUNCTION__, bytesRead, errno, strerror(errno));
 #endif
-    return 0;
+      break;
+    }
+
+    totalRead += bytesRead;
+
+    /* end of file or a short read. files sharing the global context */
+    /* also shouldn't hold it for longer than a single request */
+    if (bytesRead < requestSize || m_section == &smb)
+      break;
   }
 
-  return (unsigned int)bytesRead;
+  return totalRead;
 }
 
 int64_t CSmbFile::Seek(int64_t iFilePosition, int iWhence)
 {
-  if (m_fd == -1) return -1;
+  if (!m_file) return -1;
 
-  CSingleLock lock(smb); // Init not called since it has to be "inited" by now
+  CSingleLock lock(*m_section);
 #ifdef TARGET_POSIX
   smb.SetActivityTime();
 #endif
-  int64_t pos = smbc_lseek(m_fd, iFilePosition, iWhence);
+  int64_t pos = SMBC_LSEEK(m_context)(m_context, m_file, iFilePosition, iWhence);
 
   if ( pos < 0 )
   {
@@ -647,24 +780,28 @@ int64_t CSmbFile::Seek(int64_t iFilePosition, int iWhence)
 
 void CSmbFile::Close()
 {
-  if (m_fd != -1)
+  if (m_file)
   {
-    CLog::Log(LOGDEBUG,"CSmbFile::Close closing fd %d", m_fd);
-    CSingleLock lock(smb);
-    smbc_close(m_fd);
+    CLog::Log(LOGDEBUG,"CSmbFile::Close closing file %p", (void *)m_file);
+    {
+      CSingleLock lock(*m_section);
+      SMBC_CLOSE(m_context)(m_context, m_file);
+    }
+    smb.ReleaseFileContext(m_context);
   }
-  m_fd = -1;
+  m_file = NULL;
+  m_context = NULL;
+  m_section = &smb;
 }
 
 int CSmbFile::Write(const void* lpBuf, int64_t uiBufSize)
 {
-  if (m_fd == -1) return -1;
+  if (!m_file) return -1;
   DWORD dwNumberOfBytesWritten = 0;
 
   // lpBuf can be safely casted to void* since xmbc_write will only read from it.
-  smb.Init();
-  CSingleLock lock(smb);
-  dwNumberOfBytesWritten = smbc_write(m_fd, (void*)lpBuf, (DWORD)uiBufSize);
+  CSingleLock lock(*m_section);
+  dwNumberOfBytesWritten = SMBC_WRITE(m_context)(m_context, m_file, (void*)lpBuf, (size_t)uiBufSize);
 
   return (int)dwNumberOfBytesWritten;
 }
@@ -717,20 +854,24 @@ bool CSmbFile::OpenForWrite(const CURL& url, bool bOverWrite)
   // if a file matches the if below return false, it can't exist on a samba share.
   if (!IsValidFile(url.GetFileName())) return false;
 
+  m_context = smb.AcquireFileContext(m_section);
+  if (!m_context)
+    return false;
+
   CStdString strFileName = GetAuthenticatedPath(url);
-  CSingleLock lock(smb);
+  CSingleLock lock(*m_section);
 
   if (bOverWrite)
   {
     CLog::Log(LOGWARNING, "FileSmb::OpenForWrite() called with overwriting enabled! - %s", strFileName.c_str());
-    m_fd = smbc_creat(strFileName.c_str(), 0);
+    m_file = SMBC_CREAT(m_context)(m_context, strFileName.c_str(), 0);
   }
   else
   {
-    m_fd = smbc_open(strFileName.c_str(), O_RDWR, 0);
+    m_file = SMBC_OPEN(m_context)(m_context, strFileName.c_str(), O_RDWR, 0);
   }
 
-  if (m_fd == -1)
+  if (!m_file)
   {
     // write error to logfile
 #ifdef TARGET_WINDOWS
@@ -739,6 +880,10 @@ bool CSmbFile::OpenForWrite(const CURL& url, bool bOverWrite)
 #else
     CLog::Log(LOGERROR, "FileSmb->Open: Unable to open file : '%s'\nunix_err:'%x' error : '%s'", strFileName.c_str(), errno, strerror(errno));
 #endif
+    lock.Leave();
+    smb.ReleaseFileContext(m_context);
+    m_context = NULL;
+    m_section = &smb;
     return false;
   }
 
@@ -41,6 +41,8 @@
 #include "URL.h"
 #include "threads/CriticalSection.h"
 
+#include <vector>
+
 #define NT_STATUS_CONNECTION_REFUSED long(0xC0000000 | 0x0236)
 #define NT_STATUS_INVALID_HANDLE long(0xC0000000 | 0x0008)
 #define NT_STATUS_ACCESS_DENIED long(0xC0000000 | 0x0022)
@@ -51,6 +53,8 @@
 
 struct _SMBCCTX;
 typedef _SMBCCTX SMBCCTX;
+struct _SMBCFILE;
+typedef _SMBCFILE SMBCFILE;
 
 class CSMB : public CCriticalSection
 {
@@ -58,6 +62,9 @@ public:
   CSMB();
   ~CSMB();
   void Init();
+  /*! \brief Free the global context and the file contexts.
+   Does nothing while files still hold a context from AcquireFileContext(), the idle check tries again later.
+   */
   void Deinit();
   void Purge();
   void PurgeEx(const CURL& url);
@@ -70,9 +77,33 @@ public:
   CStdString URLEncode(const CStdString &value);
   CStdString URLEncode(const CURL &url);
 
+  /*! \brief Get a context for a file, so that it doesn't have to share the connection of the global context.
+   Contexts are kept in a pool and reused by the next file when they are released. When all
+   <samba><filecontexts> contexts are in use the global context is returned.
+   \param section [out] the lock that has to be held while the context is used
+   \return the context, NULL if samba couldn't be initialised
+   */
+  SMBCCTX *AcquireFileContext(CCriticalSection *&section);
+
+  /*! \brief Return a context obtained by AcquireFileContext() to the pool
+   \param context the context
+   */
+  void ReleaseFileContext(SMBCCTX *context);
+
   DWORD ConvertUnixToNT(int error);
 private:
+  SMBCCTX *CreateContext();
+
+  typedef struct
+  {
+    SMBCCTX          *context;
+    CCriticalSection *section;
+    bool              inUse;
+  } FileContext;
+
   SMBCCTX *m_context;
+  std::vector<FileContext> m_fileContexts;
+  int m_contextUsers; ///< number of contexts handed out by AcquireFileContext(), Deinit() waits for them
   CStdString m_strLastHost;
   CStdString m_strLastShare;
 #ifdef _LINUX
@@ -89,7 +120,7 @@ class CSmbFile : public IFile
 {
 public:
   CSmbFile();
-  int OpenFile(const CURL &url, CStdString& strAuth);
+  SMBCFILE *OpenFile(const CURL &url, CStdString& strAuth);
   virtual ~CSmbFile();
   virtual void Close();
   virtual int64_t Seek(int64_t iFilePosition, int iWhence = SEEK_SET);
@@ -113,7 +144,9 @@ protected:
   bool IsValidFile(const CStdString& strFileName);
   CStdString GetAuthenticatedPath(const CURL &url);
   int64_t m_fileSize;
-  int m_fd;
+  SMBCFILE *m_file;
+  SMBCCTX *m_context;
+  CCriticalSection *m_section;
 };
 }
 
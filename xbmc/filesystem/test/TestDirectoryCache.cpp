@@ -0,0 +1,160 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "filesystem/DirectoryCache.h"
+#include "filesystem/File.h"
+#include "FileItem.h"
+#include "test/TestUtils.h"
+
+#include "gtest/gtest.h"
+
+#define SHARE "smb://server/share/"
+
+/* a directory cache with its own file, that persists listings right away and
+   sees the given modification time for every directory */
+class TestDirectoryCache : public XFILE::CDirectoryCache
+{
+public:
+  TestDirectoryCache(const CStdString &file, const CStdString &fingerprint)
+  {
+    m_persistedFile = file;
+    m_fingerprint = fingerprint;
+  }
+
+protected:
+  virtual void PersistLater(const CStdString &storedPath) { PersistDirectory(storedPath); }
+  virtual CStdString GetFingerprint(const CStdString &storedPath) const { return m_fingerprint; }
+
+private:
+  CStdString m_fingerprint;
+};
+
+static void MakeListing(const CStdString &dir, int count, CFileItemList &items)
+{
+  for (int i = 0; i < count; i++)
+  {
+    CStdString path;
+    path.Format("%s%s/file%i.avi", SHARE, dir.c_str(), i);
+    items.Add(CFileItemPtr(new CFileItem(path, false)));
+  }
+}
+
+TEST(TestDirectoryCache, CacheOnce)
+{
+  XFILE::CFile *file = XBMC_CREATETEMPFILE(".dat");
+  ASSERT_TRUE(file);
+  file->Close();
+
+  TestDirectoryCache cache(XBMC_TEMPFILEPATH(file), "1");
+  CFileItemList items, cached;
+  MakeListing("dir", 3, items);
+  cache.SetDirectory(SHARE "dir/", items, XFILE::DIR_CACHE_ONCE);
+
+  EXPECT_FALSE(cache.GetDirectory(SHARE "dir/", cached));
+  EXPECT_TRUE(cache.GetDirectory(SHARE "dir/", cached, true));
+  EXPECT_EQ(3, cached.Size());
+
+  cache.ClearDirectory(SHARE "dir/");
+  cached.Clear();
+  EXPECT_FALSE(cache.GetDirectory(SHARE "dir/", cached, true));
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
+
+TEST(TestDirectoryCache, PersistServedListings)
+{
+  XFILE::CFile *file = XBMC_CREATETEMPFILE(".dat");
+  ASSERT_TRUE(file);
+  file->Close();
+  CStdString path = XBMC_TEMPFILEPATH(file);
+
+  {
+    TestDirectoryCache cache(path, "1");
+    CFileItemList items, other, cached;
+    MakeListing("dir", 3, items);
+    MakeListing("other", 2, other);
+    cache.SetDirectory(SHARE "dir/", items, XFILE::DIR_CACHE_ONCE);
+    cache.SetDirectory(SHARE "other/", other, XFILE::DIR_CACHE_ONCE);
+    EXPECT_TRUE(cache.GetDirectory(SHARE "dir/", cached, true));
+    cache.Save();
+  }
+
+  TestDirectoryCache cache(path, "1");
+  CFileItemList cached;
+  /* only the listing that was served from the cache is kept */
+  EXPECT_FALSE(cache.GetDirectory(SHARE "other/", cached, true));
+  /* it's served on the first listing of the session */
+  EXPECT_TRUE(cache.GetDirectory(SHARE "dir/", cached));
+  EXPECT_EQ(3, cached.Size());
+  /* after that it follows the rules of its cache type */
+  cached.Clear();
+  EXPECT_FALSE(cache.GetDirectory(SHARE "dir/", cached));
+  EXPECT_TRUE(cache.GetDirectory(SHARE "dir/", cached, true));
+  EXPECT_EQ(3, cached.Size());
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
+
+TEST(TestDirectoryCache, PersistedFileExists)
+{
+  XFILE::CFile *file = XBMC_CREATETEMPFILE(".dat");
+  ASSERT_TRUE(file);
+  file->Close();
+  CStdString path = XBMC_TEMPFILEPATH(file);
+
+  {
+    TestDirectoryCache cache(path, "1");
+    CFileItemList items, cached;
+    MakeListing("dir", 3, items);
+    cache.SetDirectory(SHARE "dir/", items, XFILE::DIR_CACHE_ONCE);
+    EXPECT_TRUE(cache.GetDirectory(SHARE "dir/", cached, true));
+    cache.Save();
+  }
+
+  TestDirectoryCache cache(path, "1");
+  bool inCache = false;
+  EXPECT_TRUE(cache.FileExists(SHARE "dir/file1.avi", inCache));
+  EXPECT_TRUE(inCache);
+  EXPECT_FALSE(cache.FileExists(SHARE "dir/file3.avi", inCache));
+  EXPECT_TRUE(inCache);
+  EXPECT_FALSE(cache.FileExists(SHARE "other/file0.avi", inCache));
+  EXPECT_FALSE(inCache);
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
+
+TEST(TestDirectoryCache, ChangedDirectory)
+{
+  XFILE::CFile *file = XBMC_CREATETEMPFILE(".dat");
+  ASSERT_TRUE(file);
+  file->Close();
+  CStdString path = XBMC_TEMPFILEPATH(file);
+
+  {
+    TestDirectoryCache cache(path, "1");
+    CFileItemList items, cached;
+    MakeListing("dir", 3, items);
+    cache.SetDirectory(SHARE "dir/", items, XFILE::DIR_CACHE_ALWAYS);
+    EXPECT_TRUE(cache.GetDirectory(SHARE "dir/", cached));
+    cache.Save();
+  }
+
+  TestDirectoryCache cache(path, "2");
+  CFileItemList cached;
+  EXPECT_FALSE(cache.GetDirectory(SHARE "dir/", cached, true));
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
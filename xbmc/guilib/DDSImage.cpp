@@ -31,23 +31,51 @@ using namespace XFILE;
 #include "SimpleFS.h"
 #endif
 
+#if defined(_LINUX) && !defined(NO_XBMC_FILESYSTEM)
+#define HAS_DDS_MMAP
+#include "filesystem/SpecialProtocol.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 CDDSImage::CDDSImage()
 {
   m_data = NULL;
+  m_mapped = NULL;
+  m_mappedSize = 0;
   memset(&m_desc, 0, sizeof(m_desc));
 }
 
 CDDSImage::CDDSImage(unsigned int width, unsigned int height, unsigned int format)
 {
   m_data = NULL;
+  m_mapped = NULL;
+  m_mappedSize = 0;
   Allocate(width, height, format);
 }
 
 CDDSImage::~CDDSImage()
 {
+  Free();
+}
+
+void CDDSImage::Free()
+{
+#ifdef HAS_DDS_MMAP
+  if (m_mapped)
+  {
+    munmap(m_mapped, m_mappedSize);
+    m_mapped = NULL;
+    m_mappedSize = 0;
+    m_data = NULL;
+  }
+#endif
   delete[] m_data;
+  m_data = NULL;
 }
 
 unsigned int CDDSImage::GetWidth() const
@@ -90,6 +118,10 @@ unsigned char *CDDSImage::GetData() const
 
 bool CDDSImage::ReadFile(const std::string &inputFile)
 {
+  Free();
+  if (MapFile(inputFile))
+    return true;
+
   // open the file
   CFile file;
   if (!file.Open(inputFile))
@@ -117,6 +149,41 @@ bool CDDSImage::ReadFile(const std::string &inputFile)
   return true;
 }
 
+bool CDDSImage::MapFile(const std::string &inputFile)
+{
+#ifdef HAS_DDS_MMAP
+  CStdString path = CSpecialProtocol::TranslatePath(inputFile);
+  if (path.empty() || path[0] != '/')
+    return false; // not a local file
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  void *mapped = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size > 4 + sizeof(m_desc))
+    mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping holds its own reference to the file
+  if (mapped == MAP_FAILED)
+    return false;
+
+  m_mapped = mapped;
+  m_mappedSize = st.st_size;
+  memcpy(&m_desc, (unsigned char *)m_mapped + 4, sizeof(m_desc));
+  if (memcmp(m_mapped, "DDS ", 4) != 0 || !GetFormat() ||
+      4 + sizeof(m_desc) + m_desc.linearSize > m_mappedSize)
+  {
+    Free();
+    return false;
+  }
+  m_data = (unsigned char *)m_mapped + 4 + sizeof(m_desc);
+  return true;
+#else
+  return false;
+#endif
+}
+
 bool CDDSImage::Create(const std::string &outputFile, unsigned int width, unsigned int height, unsigned int pitch, unsigned char const *brga, double maxMSE)
 {
   if (!Compress(width, height, pitch, brga, maxMSE))
@@ -244,7 +311,7 @@ void CDDSImage::Allocate(unsigned int width, unsigned int height, unsigned int f
   m_desc.pixelFormat.flags = ddpf_fourcc;
   memcpy(&m_desc.pixelFormat.fourcc, GetFourCC(format), 4);
   m_desc.caps.flags1 = ddscaps_texture;
-  delete[] m_data;
+  Free();
   m_data = new unsigned char[m_desc.linearSize];
 }
 
@@ -36,6 +36,12 @@ public:
   unsigned int GetSize() const;
   unsigned char *GetData() const;
 
+  /*! \brief Read a DDS image from file
+   Local files are memory mapped rather than read into a buffer, so GetData() points straight
+   at the mapped pixel data until the image is destroyed.
+   \param file name of the file to read
+   \return true on success, false otherwise
+   */
   bool ReadFile(const std::string &file);
 
   /*! \brief Create a DDS image file from the given an ARGB buffer
@@ -63,6 +69,8 @@ public:
 
 private:
   void Allocate(unsigned int width, unsigned int height, unsigned int format);
+  void Free();
+  bool MapFile(const std::string &file);
   const char *GetFourCC(unsigned int format) const;
   bool WriteFile(const std::string &file) const;
 
@@ -145,4 +153,6 @@ private:
 
   ddsurfacedesc2 m_desc;
   unsigned char *m_data;
+  void          *m_mapped;     ///< base of the memory mapped file, NULL if m_data is allocated
+  size_t         m_mappedSize;
 };
@@ -19,6 +19,7 @@
  */
 
 #include "GUIControlProfiler.h"
+#include "GUITextLayout.h"
 #include "utils/XBMCTinyXML.h"
 #include "utils/TimeUtils.h"
 
@@ -261,6 +262,7 @@ void CGUIControlProfiler::Start(void)
   m_bIsRunning = true;
   m_pLastItem = NULL;
   m_ItemHead.Reset(this);
+  CGUITextLayoutCache::Get().ResetCounters();
 }
 
 void CGUIControlProfiler::BeginVisibility(CGUIControl *pControl)
@@ -351,5 +353,24 @@ bool CGUIControlProfiler::SaveResults(void)
   doc.LinkEndChild(root);
 
   m_ItemHead.SaveToXML(root);
+
+  const CGUITextLayoutCache &layoutCache = CGUITextLayoutCache::Get();
+  TiXmlElement *xmlLayoutCache = new TiXmlElement("textlayoutcache");
+  str.Format("%u", layoutCache.GetHits());
+  xmlLayoutCache->SetAttribute("hits", str.c_str());
+  str.Format("%u", layoutCache.GetMisses());
+  xmlLayoutCache->SetAttribute("misses", str.c_str());
+  str.Format("%u", layoutCache.GetEvictions());
+  xmlLayoutCache->SetAttribute("evictions", str.c_str());
+  str.Format("%u", layoutCache.GetSize());
+  xmlLayoutCache->SetAttribute("size", str.c_str());
+  unsigned int lookups = layoutCache.GetHits() + layoutCache.GetMisses();
+  if (lookups)
+  {
+    str.Format("%.0f", 100.0f * layoutCache.GetHits() / lookups);
+    xmlLayoutCache->SetAttribute("hitpercent", str.c_str());
+  }
+  root->LinkEndChild(xmlLayoutCache);
+
   return doc.SaveFile(m_strOutputFile);
 }
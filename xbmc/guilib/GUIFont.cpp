@@ -21,6 +21,7 @@
 #include "GUIFont.h"
 #include "GUIFontTTF.h"
 #include "GraphicContext.h"
+#include "GUITextLayout.h"
 
 #include "threads/SingleLock.h"
 #include "utils/TimeUtils.h"
@@ -74,6 +75,8 @@ CGUIFont::CGUIFont(const CStdString& strFontName, uint32_t style, color_t textCo
 
 CGUIFont::~CGUIFont()
 {
+  // cached layouts are keyed on our address, so make sure they can't be picked up by a new font
+  CGUITextLayoutCache::Get().Clear();
   if (m_font)
     m_font->RemoveReference();
 }
@@ -301,6 +304,8 @@ void CGUIFont::SetFont(CGUIFontTTFBase *font)
 {
   if (m_font == font)
     return; // no need to update the font if we already have it
+  // metrics may have changed, so any cached layouts are no longer valid
+  CGUITextLayoutCache::Get().Clear();
   if (m_font)
     m_font->RemoveReference();
   m_font = font;
@@ -24,11 +24,15 @@
 #include "GUIColorManager.h"
 #include "utils/CharsetConverter.h"
 #include "utils/StringUtils.h"
+#include "threads/SingleLock.h"
 
 using namespace std;
 
 #define WORK_AROUND_NEEDED_FOR_LINE_BREAKS
 
+// maximum number of layouts we keep around.  Roughly a couple of screens worth of list items
+#define TEXT_LAYOUT_CACHE_SIZE 1024
+
 CGUIString::CGUIString(iString start, iString end, bool carriageReturn)
 {
   m_text.assign(start, end);
@@ -43,6 +47,83 @@ CStdString CGUIString::GetAsString() const
   return text;
 }
 
+bool CGUITextLayoutCache::Key::operator<(const Key &right) const
+{
+  if (font != right.font)
+    return font < right.font;
+  if (maxWidth != right.maxWidth)
+    return maxWidth < right.maxWidth;
+  if (maxHeight != right.maxHeight)
+    return maxHeight < right.maxHeight;
+  if (wrap != right.wrap)
+    return wrap < right.wrap;
+  if (forceLTR != right.forceLTR)
+    return forceLTR < right.forceLTR;
+  return text.compare(right.text) < 0;
+}
+
+CGUITextLayoutCache::CGUITextLayoutCache()
+{
+  ResetCounters();
+}
+
+CGUITextLayoutCache &CGUITextLayoutCache::Get()
+{
+  static CGUITextLayoutCache cache;
+  return cache;
+}
+
+bool CGUITextLayoutCache::Lookup(const Key &key, Layout &layout)
+{
+  CSingleLock lock(m_critSection);
+  LayoutIndex::iterator i = m_index.find(key);
+  if (i == m_index.end())
+  {
+    m_misses++;
+    return false;
+  }
+  // move to the front of our list
+  m_layouts.splice(m_layouts.begin(), m_layouts, i->second);
+  layout = i->second->second;
+  m_hits++;
+  return true;
+}
+
+void CGUITextLayoutCache::Store(const Key &key, const Layout &layout)
+{
+  CSingleLock lock(m_critSection);
+  LayoutIndex::iterator i = m_index.find(key);
+  if (i != m_index.end())
+  { // already there (another layout got in first) - just refresh it
+    i->second->second = layout;
+    m_layouts.splice(m_layouts.begin(), m_layouts, i->second);
+    return;
+  }
+  m_layouts.push_front(make_pair(key, layout));
+  m_index.insert(make_pair(key, m_layouts.begin()));
+
+  while (m_layouts.size() > TEXT_LAYOUT_CACHE_SIZE)
+  {
+    m_index.erase(m_layouts.back().first);
+    m_layouts.pop_back();
+    m_evictions++;
+  }
+}
+
+void CGUITextLayoutCache::Clear()
+{
+  CSingleLock lock(m_critSection);
+  m_index.clear();
+  m_layouts.clear();
+}
+
+void CGUITextLayoutCache::ResetCounters()
+{
+  m_hits = 0;
+  m_misses = 0;
+  m_evictions = 0;
+}
+
 CGUITextLayout::CGUITextLayout(CGUIFont *font, bool wrap, float fHeight, CGUIFont *borderFont)
 {
   m_font = font;
@@ -208,6 +289,26 @@ bool CGUITextLayout::UpdateW(const CStdStringW &text, float maxWidth /*= 0*/, bo
   if (text.Equals(m_lastText) && !forceUpdate)
     return false;
 
+  // see whether some other control has already laid out this text the same way
+  CGUITextLayoutCache::Key key;
+  key.font = m_font;
+  key.maxWidth = (m_wrap && maxWidth > 0) ? maxWidth : 0;
+  key.maxHeight = m_maxHeight;
+  key.wrap = m_wrap;
+  key.forceLTR = forceLTRReadingOrder;
+  key.text = text;
+
+  CGUITextLayoutCache::Layout layout;
+  if (m_font && CGUITextLayoutCache::Get().Lookup(key, layout))
+  {
+    m_lines.swap(layout.lines);
+    m_colors.swap(layout.colors);
+    m_textWidth = layout.textWidth;
+    m_textHeight = layout.textHeight;
+    m_lastText = text;
+    return true;
+  }
+
   vecText parsedText;
 
   // empty out our previous string
@@ -236,6 +337,15 @@ bool CGUITextLayout::UpdateW(const CStdStringW &text, float maxWidth /*= 0*/, bo
   // and cache the width and height for later reading
   CalcTextExtent();
 
+  if (m_font)
+  {
+    layout.lines = m_lines;
+    layout.colors = m_colors;
+    layout.textWidth = m_textWidth;
+    layout.textHeight = m_textHeight;
+    CGUITextLayoutCache::Get().Store(key, layout);
+  }
+
   m_lastText = text;
   return true;
 }
@@ -21,7 +21,10 @@
  */
 
 #include "utils/StdString.h"
+#include "threads/CriticalSection.h"
 
+#include <list>
+#include <map>
 #include <vector>
 
 #ifdef __GNUC__
@@ -61,6 +64,71 @@ public:
   bool m_carriageReturn; // true if we have a carriage return here
 };
 
+/*!
+ \brief Shared LRU cache of parsed, wrapped and bidi-flipped text layouts.
+
+ Laying out a label involves parsing the formatting tags, wrapping, and a charset round trip per
+ line for the bidi transform.  List containers lay out the same strings over and over as items
+ scroll in and out of view, so the results are shared between all CGUITextLayout instances and
+ keyed on everything that affects them.  Entries are dropped whenever a font is changed or destroyed.
+ */
+class CGUITextLayoutCache
+{
+public:
+  struct Key
+  {
+    const CGUIFont *font;
+    float maxWidth;      // only relevant when wrapping, 0 otherwise
+    float maxHeight;
+    bool  wrap;
+    bool  forceLTR;
+    CStdStringW text;
+
+    bool operator<(const Key &right) const;
+  };
+
+  struct Layout
+  {
+    std::vector<CGUIString> lines;
+    vecColors colors;
+    float textWidth;
+    float textHeight;
+  };
+
+  static CGUITextLayoutCache &Get();
+
+  /*! \brief Retrieve a previously cached layout, marking it as most recently used.
+   \param key the layout parameters to look for
+   \param layout [out] the cached layout if found
+   \return true if the layout was found, false otherwise
+   */
+  bool Lookup(const Key &key, Layout &layout);
+  void Store(const Key &key, const Layout &layout);
+  void Clear();
+
+  unsigned int GetHits() const { return m_hits; };
+  unsigned int GetMisses() const { return m_misses; };
+  unsigned int GetEvictions() const { return m_evictions; };
+  unsigned int GetSize() const { return m_index.size(); };
+  void ResetCounters();
+
+private:
+  CGUITextLayoutCache();
+  CGUITextLayoutCache(const CGUITextLayoutCache &);
+  CGUITextLayoutCache const& operator=(CGUITextLayoutCache const&);
+
+  typedef std::list< std::pair<Key, Layout> > LayoutList;
+  typedef std::map<Key, LayoutList::iterator> LayoutIndex;
+
+  LayoutList  m_layouts;   // most recently used at the front
+  LayoutIndex m_index;
+  CCriticalSection m_critSection;
+
+  unsigned int m_hits;
+  unsigned int m_misses;
+  unsigned int m_evictions;
+};
+
 class CGUITextLayout
 {
 public:
@@ -82,6 +82,7 @@ CGUITextureBase::CGUITextureBase(float posX, float posY, float width, float heig
 
   m_allocateDynamically = false;
   m_isAllocated = NO;
+  m_largeReloading = false;
   m_invalid = true;
 }
 
@@ -118,6 +119,7 @@ CGUITextureBase::CGUITextureBase(const CGUITextureBase &right)
   m_currentLoop = 0;
 
   m_isAllocated = NO;
+  m_largeReloading = false;
   m_invalid = true;
 }
 
@@ -129,7 +131,7 @@ bool CGUITextureBase::AllocateOnDemand()
 {
   if (m_visible)
   { // visible, so make sure we're allocated
-    if (!IsAllocated() || (m_isAllocated == LARGE && !m_texture.size()))
+    if (!IsAllocated() || (m_isAllocated == LARGE && (!m_texture.size() || m_largeReloading)))
       return AllocResources();
   }
   else
@@ -288,7 +290,21 @@ bool CGUITextureBase::AllocResources()
     return false;
 
   if (m_texture.size())
-    return false; // already have our texture
+  { // already have our texture, but a larger version of it may be on its way
+    if (!m_largeReloading)
+      return false;
+
+    CTextureArray texture;
+    g_largeTextureManager.GetImage(m_info.filename, texture, false, 0, 0, &m_largeReloading);
+    if (!texture.size() || texture.m_textures == m_texture.m_textures)
+      return false;
+
+    m_texture = texture;
+    m_frameWidth = (float)m_texture.m_width;
+    m_frameHeight = (float)m_texture.m_height;
+    CalculateSize();
+    return true;
+  }
 
   // reset our animstate
   m_frameCounter = 0;
@@ -312,7 +328,10 @@ bool CGUITextureBase::AllocResources()
     if (m_isAllocated != NORMAL)
     { // use our large image background loader
       CTextureArray texture;
-      if (g_largeTextureManager.GetImage(m_info.filename, texture, !IsAllocated()))
+      // hint at the size we're displayed at so the loader can decode large images at lower resolution.
+      // use the larger dimension for both, as the image may be rotated or cropped to fit.
+      unsigned int size = (unsigned int)std::max(m_width * g_graphicsContext.GetGUIScaleX(), m_height * g_graphicsContext.GetGUIScaleY());
+      if (g_largeTextureManager.GetImage(m_info.filename, texture, !IsAllocated(), size, size, &m_largeReloading))
       {
         m_isAllocated = LARGE;
 
@@ -465,6 +484,7 @@ void CGUITextureBase::FreeResources(bool immediately /* = false */)
   m_diffuse.Reset();
 
   m_texture.Reset();
+  m_largeReloading = false;
 
   m_currentFrame = 0;
   m_currentLoop = 0;
@@ -162,6 +162,7 @@ protected:
   bool m_allocateDynamically;
   enum ALLOCATE_TYPE { NO = 0, NORMAL, LARGE, NORMAL_FAILED, LARGE_FAILED };
   ALLOCATE_TYPE m_isAllocated;
+  bool m_largeReloading;                  // a larger version of our large texture is being decoded
 
   CTextureInfo m_info;
   CAspectRatio m_aspect;
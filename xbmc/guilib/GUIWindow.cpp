@@ -165,6 +165,12 @@ bool CGUIWindow::Load(TiXmlElement* pRootElement)
 
   // Resolve any includes that may be present and save conditions used to do it
   g_SkinInfo->ResolveIncludes(pRootElement, &m_xmlIncludeConditions);
+
+  // start decompressing our bundled textures while we create our controls
+  std::vector<CStdString> textures;
+  GetTextures(pRootElement, textures);
+  g_TextureManager.PrefetchTextures(textures);
+
   // now load in the skin file
   SetDefaults();
 
@@ -947,6 +953,22 @@ bool CGUIWindow::OnMove(int fromControl, int moveAction)
   return true;
 }
 
+void CGUIWindow::GetTextures(const TiXmlElement *node, std::vector<CStdString> &textures)
+{
+  for (const TiXmlElement *child = node->FirstChildElement(); child; child = child->NextSiblingElement())
+  {
+    CStdString tag(child->ValueStr());
+    if (tag.ToLower().Find("texture") >= 0)
+    { // skip info labels, as we don't know what they'll be yet
+      const TiXmlNode *value = child->FirstChild();
+      if (value && value->Type() == TiXmlNode::TINYXML_TEXT && value->ValueStr() != "-" && value->Value()[0] != '$')
+        textures.push_back(value->ValueStr());
+    }
+    else
+      GetTextures(child, textures);
+  }
+}
+
 void CGUIWindow::SetDefaults()
 {
   m_renderOrder = 0;
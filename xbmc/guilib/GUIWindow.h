@@ -200,6 +200,12 @@ protected:
   bool NeedXMLReload();
   virtual void LoadAdditionalTags(TiXmlElement *root) {}; ///< Load additional information from the XML document
 
+  /*! \brief Collect the textures used by the controls in a window's XML
+   \param node the XML node to search
+   \param textures [out] the texture filenames found
+   */
+  static void GetTextures(const TiXmlElement *node, std::vector<CStdString> &textures);
+
   virtual void SetDefaults();
   virtual void OnWindowUnload() {}
   virtual void OnWindowLoaded();
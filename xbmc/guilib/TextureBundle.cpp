@@ -103,6 +103,14 @@ int CTextureBundle::LoadAnim(const CStdString& Filename, CBaseTexture*** ppTextu
   }
 }
 
+void CTextureBundle::Prefetch(const std::vector<CStdString> &filenames)
+{
+  if (m_useXBT)
+  {
+    m_tbXBT.Prefetch(filenames);
+  }
+}
+
 void CTextureBundle::Cleanup()
 {
   m_tbXBT.Cleanup();
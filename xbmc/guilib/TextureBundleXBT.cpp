@@ -30,16 +30,64 @@
 #include "utils/EndianSwap.h"
 #include "utils/URIUtils.h"
 #include "XBTF.h"
+#include "threads/Atomics.h"
+#include "threads/SingleLock.h"
+#include "utils/JobManager.h"
 #include <lzo/lzo1x.h>
+#include <algorithm>
 
 #ifdef _WIN32
 #pragma comment(lib,"liblzo2.lib")
 #endif
 
+// number of jobs to split a prefetch over
+#define PREFETCH_JOBS 4
+
+/*!
+ \ingroup textures,jobs
+ \brief Job that decompresses a set of bundled textures ready for them to be loaded
+ */
+class CTexturePrefetchJob : public CJob
+{
+public:
+  CTexturePrefetchJob(CTextureBundleXBT *bundle) : m_bundle(bundle)
+  {
+    AtomicIncrement(&m_bundle->m_prefetchRunning);
+  }
+  virtual ~CTexturePrefetchJob()
+  {
+    // jobs are deleted whether they ran or were cancelled
+    if (AtomicDecrement(&m_bundle->m_prefetchRunning) == 0)
+      m_bundle->m_prefetchDone.Set();
+  }
+
+  virtual const char* GetType() const { return "textureprefetch"; };
+
+  virtual bool DoWork()
+  {
+    for (unsigned int i = 0; i < m_frames.size(); i++)
+    {
+      if (ShouldCancel(i, m_frames.size()))
+        return false;
+      // LoadTexture() may have got there first
+      if (!m_bundle->BeginPrefetch(m_frames[i].first))
+        continue;
+      CBaseTexture *texture = NULL;
+      m_bundle->ConvertFrameToTexture(m_frames[i].first, m_frames[i].second, &texture, true);
+      m_bundle->EndPrefetch(m_frames[i].first, texture);
+    }
+    return true;
+  }
+
+  CTextureBundleXBT *m_bundle;
+  std::vector< std::pair<CStdString, CXBTFFrame> > m_frames;
+};
+
 CTextureBundleXBT::CTextureBundleXBT(void)
 {
   m_themeBundle = false;
   m_TimeStamp = 0;
+  m_prefetchRunning = 0;
 }
 
 CTextureBundleXBT::~CTextureBundleXBT(void)
@@ -145,7 +193,28 @@ bool CTextureBundleXBT::LoadTexture(const CStdString& Filename, CBaseTexture** p
     return false;
 
   CXBTFFrame& frame = file->GetFrames().at(0);
-  if (!ConvertFrameToTexture(Filename, frame, ppTexture))
+
+  { // use the prefetched texture if we have it
+    CSingleLock lock(m_prefetchSection);
+    // the window is usually loaded right after its textures were queued, so wait for
+    // a texture a job is working on and take over those it hasn't got to yet
+    std::map<CStdString, bool>::iterator pending;
+    while ((pending = m_prefetchPending.find(name)) != m_prefetchPending.end() && pending->second)
+      m_prefetchCond.wait(lock);
+    if (pending != m_prefetchPending.end())
+      m_prefetchPending.erase(pending);
+
+    std::map<CStdString, CBaseTexture*>::iterator i = m_prefetched.find(name);
+    if (i != m_prefetched.end())
+    {
+      *ppTexture = i->second;
+      m_prefetched.erase(i);
+    }
+    else
+      *ppTexture = NULL;
+  }
+
+  if (!*ppTexture && !ConvertFrameToTexture(Filename, frame, ppTexture))
   {
     return false;
   }
@@ -191,22 +260,31 @@ int CTextureBundleXBT::LoadAnim(const CStdString& Filename, CBaseTexture*** ppTe
   return nTextures;
 }
 
-bool CTextureBundleXBT::ConvertFrameToTexture(const CStdString& name, CXBTFFrame& frame, CBaseTexture** ppTexture)
+bool CTextureBundleXBT::ConvertFrameToTexture(const CStdString& name, const CXBTFFrame& frame, CBaseTexture** ppTexture, bool mappedOnly)
 {
-  // found texture - allocate the necessary buffers
-  squish::u8 *buffer = new squish::u8[(size_t)frame.GetPackedSize()];
-  if (buffer == NULL)
-  {
-    CLog::Log(LOGERROR, "Out of memory loading texture: %s (need %"PRIu64" bytes)", name.c_str(), frame.GetPackedSize());
+  // if the bundle is mapped we can work straight from the mapped data, else read it in
+  const squish::u8 *packed = m_XBTFReader.GetFrameData(frame);
+  squish::u8 *buffer = NULL;
+  if (!packed && mappedOnly)
     return false;
-  }
-
-  // load the compressed texture
-  if (!m_XBTFReader.Load(frame, buffer))
+  if (!packed)
   {
-    CLog::Log(LOGERROR, "Error loading texture: %s", name.c_str());
-    delete[] buffer;
-    return false;
+    // found texture - allocate the necessary buffers
+    buffer = new squish::u8[(size_t)frame.GetPackedSize()];
+    if (buffer == NULL)
+    {
+      CLog::Log(LOGERROR, "Out of memory loading texture: %s (need %"PRIu64" bytes)", name.c_str(), frame.GetPackedSize());
+      return false;
+    }
+
+    // load the compressed texture
+    if (!m_XBTFReader.Load(frame, buffer))
+    {
+      CLog::Log(LOGERROR, "Error loading texture: %s", name.c_str());
+      delete[] buffer;
+      return false;
+    }
+    packed = buffer;
   }
 
   // check if it's packed with lzo
@@ -220,7 +298,7 @@ bool CTextureBundleXBT::ConvertFrameToTexture(const CStdString& name, CXBTFFrame
       return false;
     }
     lzo_uint s = (lzo_uint)frame.GetUnpackedSize();
-    if (lzo1x_decompress(buffer, (lzo_uint)frame.GetPackedSize(), unpacked, &s, NULL) != LZO_E_OK ||
+    if (lzo1x_decompress(packed, (lzo_uint)frame.GetPackedSize(), unpacked, &s, NULL) != LZO_E_OK ||
         s != frame.GetUnpackedSize())
     {
       CLog::Log(LOGERROR, "Error loading texture: %s: Decompression error", name.c_str());
@@ -230,19 +308,102 @@ bool CTextureBundleXBT::ConvertFrameToTexture(const CStdString& name, CXBTFFrame
     }
     delete[] buffer;
     buffer = unpacked;
+    packed = buffer;
   }
 
   // create an xbmc texture
   *ppTexture = new CTexture();
-  (*ppTexture)->LoadFromMemory(frame.GetWidth(), frame.GetHeight(), 0, frame.GetFormat(), frame.HasAlpha(), buffer);
+  (*ppTexture)->LoadFromMemory(frame.GetWidth(), frame.GetHeight(), 0, frame.GetFormat(), frame.HasAlpha(), (unsigned char *)packed);
 
   delete[] buffer;
 
   return true;
 }
 
+void CTextureBundleXBT::Prefetch(const std::vector<CStdString> &filenames)
+{
+  if (!m_XBTFReader.IsOpen())
+    return;
+
+  CancelPrefetch();
+
+  CSingleLock lock(m_prefetchSection);
+  std::vector<CTexturePrefetchJob *> jobs;
+  unsigned int count = 0;
+  for (std::vector<CStdString>::const_iterator i = filenames.begin(); i != filenames.end(); ++i)
+  {
+    CStdString name = Normalize(*i);
+    CXBTFFile* file = m_XBTFReader.Find(name);
+    // animations are rare enough to leave to LoadAnim(), and if the bundle isn't mapped
+    // we can't read from more than one thread at once
+    if (!file || file->GetFrames().size() != 1 || !m_XBTFReader.GetFrameData(file->GetFrames()[0]))
+      continue;
+
+    // a texture listed more than once only needs decompressing once
+    if (!m_prefetchPending.insert(make_pair(name, false)).second)
+      continue;
+
+    // fill the jobs round robin, so they finish at roughly the same time
+    if (count < PREFETCH_JOBS)
+      jobs.push_back(new CTexturePrefetchJob(this));
+    jobs[count++ % PREFETCH_JOBS]->m_frames.push_back(make_pair(name, file->GetFrames()[0]));
+  }
+
+  for (std::vector<CTexturePrefetchJob *>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+    m_prefetchJobs.push_back(CJobManager::GetInstance().AddJob(*i, this, CJob::PRIORITY_HIGH));
+}
+
+bool CTextureBundleXBT::BeginPrefetch(const CStdString &name)
+{
+  CSingleLock lock(m_prefetchSection);
+  std::map<CStdString, bool>::iterator i = m_prefetchPending.find(name);
+  if (i == m_prefetchPending.end())
+    return false;
+  i->second = true;
+  return true;
+}
+
+void CTextureBundleXBT::EndPrefetch(const CStdString &name, CBaseTexture *texture)
+{
+  CSingleLock lock(m_prefetchSection);
+  // if the prefetch was cancelled in the meantime there's no one to hand it to
+  if (m_prefetchPending.erase(name) && texture)
+    m_prefetched[name] = texture;
+  else
+    delete texture;
+  m_prefetchCond.notifyAll();
+}
+
+void CTextureBundleXBT::OnJobComplete(unsigned int jobID, bool success, CJob *job)
+{
+  CSingleLock lock(m_prefetchSection);
+  std::vector<unsigned int>::iterator i = find(m_prefetchJobs.begin(), m_prefetchJobs.end(), jobID);
+  if (i != m_prefetchJobs.end())
+    m_prefetchJobs.erase(i);
+}
+
+void CTextureBundleXBT::CancelPrefetch()
+{
+  CSingleLock lock(m_prefetchSection);
+  for (std::vector<unsigned int>::iterator i = m_prefetchJobs.begin(); i != m_prefetchJobs.end(); ++i)
+    CJobManager::GetInstance().CancelJob(*i);
+  m_prefetchJobs.clear();
+  m_prefetchPending.clear();
+
+  for (std::map<CStdString, CBaseTexture*>::iterator i = m_prefetched.begin(); i != m_prefetched.end(); ++i)
+    delete i->second;
+  m_prefetched.clear();
+  lock.Leave();
+
+  // jobs already running are reading from our mapped bundle, so wait for them to finish
+  while (m_prefetchRunning > 0)
+    m_prefetchDone.Wait();
+}
+
 void CTextureBundleXBT::Cleanup()
 {
+  CancelPrefetch();
+
   if (m_XBTFReader.IsOpen())
   {
     m_XBTFReader.Close();
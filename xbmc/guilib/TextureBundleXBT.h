@@ -23,10 +23,14 @@
 #include "utils/StdString.h"
 #include <map>
 #include "XBTFReader.h"
+#include "threads/Condition.h"
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
+#include "utils/Job.h"
 
 class CBaseTexture;
 
-class CTextureBundleXBT
+class CTextureBundleXBT : public IJobCallback
 {
 public:
   CTextureBundleXBT(void);
@@ -44,14 +48,52 @@ public:
   int LoadAnim(const CStdString& Filename, CBaseTexture*** ppTextures,
                 int &width, int &height, int& nLoops, int** ppDelays);
 
+  /*! \brief Decompress the given textures in the background, ready for a later LoadTexture().
+   The work is split over several jobs.  LoadTexture() waits for a texture a job is working on,
+   and decompresses those no job has started on itself.  Textures prefetched by an earlier call
+   that haven't been loaded yet are freed.
+   \param filenames the textures to prefetch.  Textures not in this bundle are ignored.
+   */
+  void Prefetch(const std::vector<CStdString> &filenames);
+
+  virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job);
+
 private:
+  friend class CTexturePrefetchJob;
+
   bool OpenBundle();
-  bool ConvertFrameToTexture(const CStdString& name, CXBTFFrame& frame, CBaseTexture** ppTexture);
+  /*! \brief Decompress a frame of the bundle into a texture
+   \param mappedOnly only use the mapped bundle, failing if it isn't available.  Reading the bundle
+   in isn't thread safe, so this is set when called from a job.
+   */
+  bool ConvertFrameToTexture(const CStdString& name, const CXBTFFrame& frame, CBaseTexture** ppTexture, bool mappedOnly = false);
+
+  /*! \brief Cancel any outstanding prefetch jobs, waiting for those in progress, and free unused prefetched textures
+   */
+  void CancelPrefetch();
+
+  /*! \brief Called by a prefetch job before it decompresses a texture
+   \return false if the texture was taken over by LoadTexture() or the prefetch was cancelled
+   */
+  bool BeginPrefetch(const CStdString &name);
+
+  /*! \brief Called by a prefetch job once it has decompressed a texture
+   \param texture the decompressed texture, NULL if that failed.  Ownership passes to the bundle.
+   */
+  void EndPrefetch(const CStdString &name, CBaseTexture *texture);
 
   time_t m_TimeStamp;
 
   bool m_themeBundle;
   CXBTFReader m_XBTFReader;
+
+  CCriticalSection m_prefetchSection;
+  std::vector<unsigned int> m_prefetchJobs;
+  std::map<CStdString, bool> m_prefetchPending; ///< textures queued for a job, true once the job started on them
+  XbmcThreads::ConditionVariable m_prefetchCond; ///< notified when a job finishes a texture
+  std::map<CStdString, CBaseTexture*> m_prefetched;
+  volatile long m_prefetchRunning; ///< prefetch jobs of this bundle that haven't been deleted yet
+  CEvent m_prefetchDone;           ///< set when the last of them is deleted
 };
 
 
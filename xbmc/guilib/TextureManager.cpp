@@ -291,6 +291,26 @@ bool CGUITextureManager::HasTexture(const CStdString &textureName, CStdString *p
   return !fullPath.IsEmpty();
 }
 
+void CGUITextureManager::PrefetchTextures(const std::vector<CStdString> &textures)
+{
+  // sort the textures we don't have yet into the bundle they'll be loaded from
+  std::vector<CStdString> bundled[2];
+  for (std::vector<CStdString>::const_iterator i = textures.begin(); i != textures.end(); ++i)
+  {
+    int bundle = -1;
+    int size = 0;
+    if (i->Right(4).ToLower() == ".gif" || !HasTexture(*i, NULL, &bundle, &size))
+      continue;
+    if (!size && bundle >= 0)
+      bundled[bundle].push_back(*i);
+  }
+  for (int i = 0; i < 2; i++)
+  {
+    if (!bundled[i].empty())
+      m_TexBundle[i].Prefetch(bundled[i]);
+  }
+}
+
 int CGUITextureManager::Load(const CStdString& strTextureName, bool checkBundleOnly /*= false */)
 {
   CStdString strPath;
@@ -109,6 +109,11 @@ public:
   bool HasTexture(const CStdString &textureName, CStdString *path = NULL, int *bundle = NULL, int *size = NULL);
   bool CanLoad(const CStdString &texturePath) const; ///< Returns true if the texture manager can load this texture
   int Load(const CStdString& strTextureName, bool checkBundleOnly = false);
+
+  /*! \brief Start decompressing bundled textures in the background ahead of them being loaded
+   \param textures names of the textures that are about to be loaded
+   */
+  void PrefetchTextures(const std::vector<CStdString> &textures);
   const CTextureArray& GetTexture(const CStdString& strTextureName);
   void ReleaseTexture(const CStdString& strTextureName);
   void Cleanup();
@@ -24,6 +24,9 @@
 #include "utils/CharsetConverter.h"
 #ifdef _WIN32
 #include "FileSystem/SpecialProtocol.h"
+#else
+#include <sys/types.h>
+#include <sys/mman.h>
 #endif
 
 #include <string.h>
@@ -46,6 +49,9 @@
 CXBTFReader::CXBTFReader()
 {
   m_file = NULL;
+  m_mapped = NULL;
+  m_mappedSize = 0;
+  m_mappedTime = 0;
 }
 
 bool CXBTFReader::IsOpen() const
@@ -135,11 +141,37 @@ bool CXBTFReader::Open(const CStdString& fileName)
     return false;
   }
 
+#ifndef _WIN32
+  // map the frame data so textures can be decompressed straight from the page cache.
+  // if this fails we fall back to reading into the caller's buffer in Load().
+  // the bundle may be rewritten while we have it open (skin development), so the
+  // mapping is private and only used while the file is the one we mapped
+  struct stat fileStat;
+  if (fstat(fileno(m_file), &fileStat) == 0 && fileStat.st_size > 0)
+  {
+    void *mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fileno(m_file), 0);
+    if (mapped != MAP_FAILED)
+    {
+      m_mapped = (unsigned char *)mapped;
+      m_mappedSize = fileStat.st_size;
+      m_mappedTime = fileStat.st_mtime;
+    }
+  }
+#endif
+
   return true;
 }
 
 void CXBTFReader::Close()
 {
+#ifndef _WIN32
+  if (m_mapped)
+    munmap(m_mapped, (size_t)m_mappedSize);
+#endif
+  m_mapped = NULL;
+  m_mappedSize = 0;
+  m_mappedTime = 0;
+
   if (m_file)
   {
     fclose(m_file);
@@ -182,12 +214,38 @@ CXBTFFile* CXBTFReader::Find(const CStdString& name)
   return &(iter->second);
 }
 
+const unsigned char* CXBTFReader::GetFrameData(const CXBTFFrame& frame) const
+{
+  if (!m_mapped || frame.GetOffset() + frame.GetPackedSize() > m_mappedSize)
+  {
+    return NULL;
+  }
+
+  // pages of a file that was truncated or rewritten in place can't be read (SIGBUS),
+  // so once it has changed leave it to Load() until the bundle is reopened
+  struct stat fileStat;
+  if (fstat(fileno(m_file), &fileStat) == -1 ||
+      (uint64_t)fileStat.st_size != m_mappedSize || fileStat.st_mtime != m_mappedTime)
+  {
+    return NULL;
+  }
+
+  return m_mapped + frame.GetOffset();
+}
+
 bool CXBTFReader::Load(const CXBTFFrame& frame, unsigned char* buffer)
 {
   if (!m_file)
   {
     return false;
   }
+
+  const unsigned char* data = GetFrameData(frame);
+  if (data)
+  {
+    memcpy(buffer, data, (size_t)frame.GetPackedSize());
+    return true;
+  }
 #if defined(TARGET_DARWIN) || defined(__FreeBSD__) || defined(__ANDROID__)
     if (fseeko(m_file, (off_t)frame.GetOffset(), SEEK_SET) == -1)
 #else
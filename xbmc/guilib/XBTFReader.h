@@ -37,12 +37,24 @@ public:
   bool Exists(const CStdString& name);
   CXBTFFile* Find(const CStdString& name);
   bool Load(const CXBTFFrame& frame, unsigned char* buffer);
+
+  /*! \brief Get a pointer to the packed data of a frame in the memory mapped bundle.
+   Pages are only read in from disk as they are accessed.  Unlike Load() this may be used
+   from several threads at once.
+   \param frame the frame to retrieve
+   \return pointer to the packed frame data, NULL if the bundle isn't mapped, has changed on disk
+   since it was mapped or the frame is invalid
+   */
+  const unsigned char* GetFrameData(const CXBTFFrame& frame) const;
   std::vector<CXBTFFile>&  GetFiles();
 
 private:
   CXBTF      m_xbtf;
   CStdString m_fileName;
   FILE*      m_file;
+  unsigned char* m_mapped;
+  uint64_t   m_mappedSize;
+  time_t     m_mappedTime; ///< modification time of the file when it was mapped
   std::map<CStdString, CXBTFFile> m_filesMap;
 };
 
@@ -0,0 +1,87 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guilib/DDSImage.h"
+#include "guilib/XBTF.h"
+#include "filesystem/File.h"
+#include "test/TestUtils.h"
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+
+static const unsigned int width = 64;
+static const unsigned int height = 32;
+
+static void CreateGradient(unsigned char *pixels)
+{
+  for (unsigned int y = 0; y < height; y++)
+  {
+    for (unsigned int x = 0; x < width; x++)
+    {
+      unsigned char *pixel = pixels + (y * width + x) * 4;
+      pixel[0] = x * 4;          // blue
+      pixel[1] = y * 8;          // green
+      pixel[2] = (x + y) * 2;    // red
+      pixel[3] = 0xff;           // alpha
+    }
+  }
+}
+
+TEST(TestDDSImage, CreateAndRead)
+{
+  unsigned char pixels[width * height * 4];
+  CreateGradient(pixels);
+
+  XFILE::CFile *file;
+  ASSERT_TRUE((file = XBMC_CREATETEMPFILE(".dds")) != NULL);
+  file->Close();
+
+  CDDSImage out;
+  EXPECT_TRUE(out.Create(XBMC_TEMPFILEPATH(file), width, height, width * 4, pixels, 40));
+
+  CDDSImage in;
+  ASSERT_TRUE(in.ReadFile(XBMC_TEMPFILEPATH(file)));
+  EXPECT_EQ(width, in.GetWidth());
+  EXPECT_EQ(height, in.GetHeight());
+  EXPECT_EQ((unsigned int)XB_FMT_DXT1, in.GetFormat());
+  EXPECT_EQ(width * height / 2, in.GetSize());
+
+  // a smooth gradient should survive DXT1 compression without much loss
+  unsigned char decompressed[width * height * 4];
+  EXPECT_TRUE(CDDSImage::Decompress(decompressed, width, height, width * 4, in.GetData(), in.GetFormat()));
+  for (unsigned int i = 0; i < width * height * 4; i++)
+    EXPECT_GE(16, abs(decompressed[i] - pixels[i]));
+
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
+
+TEST(TestDDSImage, ReadInvalid)
+{
+  XFILE::CFile *file;
+  ASSERT_TRUE((file = XBMC_CREATETEMPFILE(".dds")) != NULL);
+  file->Write("not a dds file", 14);
+  file->Close();
+
+  CDDSImage in;
+  EXPECT_FALSE(in.ReadFile(XBMC_TEMPFILEPATH(file)));
+
+  EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+}
@@ -230,6 +230,8 @@ void CFileItemHandler::HandleFileItemList(const char *ID, bool allowFile, const
     CVariant object;
     CFileItemPtr item = items.Get(i);
     HandleFileItem(ID, allowFile, resultname, item, parameterObject, fields, result, true, thumbLoader);
+    // record backed items don't need to stay filled in once they're serialized
+    item->UnloadRecord();
   }
 
   delete thumbLoader;
@@ -254,6 +256,8 @@ void CFileItemHandler::HandleFileItem(const char *ID, bool allowFile, const char
 
   if (item.get())
   {
+    item->LoadRecord();
+
     std::set<std::string>::const_iterator fileField = fields.find("file");
     if (fileField != fields.end())
     {
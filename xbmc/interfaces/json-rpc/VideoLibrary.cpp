@@ -76,6 +76,7 @@ JSONRPC_STATUS CVideoLibrary::GetMovies(const CStdString &method, ITransportLaye
     setID = 0;
 
   CFileItemList items;
+  items.SetRecordBacked(true);
   if (!videodatabase.GetMoviesNav(videoUrl.ToString(), items, genreID, year, -1, -1, -1, -1, setID, -1, sorting))
     return InvalidParams;
 
@@ -791,6 +792,8 @@ JSONRPC_STATUS CVideoLibrary::GetAdditionalMovieDetails(const CVariant &paramete
         videodatabase.GetMovieInfo("", *(items[index]->GetVideoInfoTag()), items[index]->GetVideoInfoTag()->m_iDbId);
       if (streamdetails)
         videodatabase.GetStreamDetails(*(items[index]->GetVideoInfoTag()));
+      // these details aren't in the record, so the item must not be filled in from it again
+      items[index]->SetRecord(CFileItemRecordsPtr(), 0);
     }
   }
 
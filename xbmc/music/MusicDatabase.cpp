@@ -60,6 +60,7 @@
 #include "utils/AutoPtrHandle.h"
 #include "interfaces/AnnouncementManager.h"
 #include "dbwrappers/dataset.h"
+#include "dbwrappers/DatabaseRecords.h"
 #include "utils/XMLUtils.h"
 #include "URL.h"
 #include "playlists/SmartPlayList.h"
@@ -181,7 +182,7 @@ bool CMusicDatabase::CreateTables()
     m_pDS->exec("CREATE INDEX idxAlbumInfo on albuminfo(idAlbum)");
 
     CLog::Log(LOGINFO, "create karaokedata index");
-    m_pDS->exec("CREATE INDEX idxKaraNumber on karaokedata(iKaraNumber)");
+    m_pDS->exec("CREATE INDEX idxKaraNumber ON karaokedata(iKaraNumber)");
     m_pDS->exec("CREATE INDEX idxKarSong on karaokedata(idSong)");
 
     // Trigger
@@ -905,7 +906,7 @@ void CMusicDatabase::GetFileItemFromDataset(const dbiplus::sql_record* const rec
   CStdString strRealPath;
   URIUtils::AddFileToFolder(record->at(song_strPath).get_asString(), record->at(song_strFileName).get_asString(), strRealPath);
   item->GetMusicInfoTag()->SetURL(strRealPath);
-  item->GetMusicInfoTag()->SetCompilation(m_pDS->fv(song_bCompilation).get_asInt() == 1);
+  item->GetMusicInfoTag()->SetCompilation(record->at(song_bCompilation).get_asInt() == 1);
   item->GetMusicInfoTag()->SetLoaded(true);
   // Get filename with full path
   if (strMusicDBbasePath.IsEmpty())
@@ -3239,6 +3240,9 @@ bool CMusicDatabase::GetSongsByWhere(const CStdString &baseDir, const Filter &fi
     // get data from returned rows
     items.Reserve(results.size());
     const dbiplus::query_data &data = m_pDS->get_result_set().records;
+    boost::shared_ptr<CDatabaseRecords> records;
+    if (items.GetRecordBacked())
+      records.reset(new CDatabaseRecords(&CMusicDatabase::GetFileItemFromDataset, musicUrl.ToString()));
     int count = 0;
     for (DatabaseResults::const_iterator it = results.begin(); it != results.end(); it++)
     {
@@ -3248,7 +3252,10 @@ bool CMusicDatabase::GetSongsByWhere(const CStdString &baseDir, const Filter &fi
       try
       {
         CFileItemPtr item(new CFileItem);
-        GetFileItemFromDataset(record, item.get(), musicUrl.ToString());
+        if (records)
+          item->SetRecord(records, records->Add(m_pDS.get(), targetRow));
+        else
+          GetFileItemFromDataset(record, item.get(), musicUrl.ToString());
         // HACK for sorting by database returned order
         item->m_iprogramCount = ++count;
         items.Add(item);
@@ -4270,14 +4277,35 @@ int CMusicDatabase::GetSongIDFromPath(const CStdString &filePath)
   return -1;
 }
 
+void CMusicDatabase::GetBulkImportIndexes(std::vector<std::string> &indexes) const
+{
+  // indexes for browsing - adding songs only looks things up by name, path, album
+  // and the first direction of the link tables
+  static const char *browsing[] = {
+    "CREATE INDEX idxAlbum_1 ON album(bCompilation)",
+    "CREATE UNIQUE INDEX idxAlbumArtist_2 ON album_artist ( idArtist, idAlbum )",
+    "CREATE INDEX idxAlbumArtist_3 ON album_artist ( boolFeatured )",
+    "CREATE UNIQUE INDEX idxAlbumGenre_2 ON album_genre ( idGenre, idAlbum )",
+    "CREATE INDEX idxSong1 ON song(iTimesPlayed)",
+    "CREATE INDEX idxSong2 ON song(lastplayed)",
+    "CREATE UNIQUE INDEX idxSongArtist_2 ON song_artist ( idArtist, idSong )",
+    "CREATE INDEX idxSongArtist_3 ON song_artist ( boolFeatured )",
+    "CREATE UNIQUE INDEX idxSongGenre_2 ON song_genre ( idGenre, idSong )",
+    "CREATE INDEX idxKaraNumber ON karaokedata(iKaraNumber)" };
+  indexes.insert(indexes.end(), browsing, browsing + sizeof(browsing) / sizeof(browsing[0]));
+}
+
 bool CMusicDatabase::CommitTransaction()
 {
-  if (CDatabase::CommitTransaction())
+  if (!CDatabase::CommitTransaction())
+    return false;
+
+  // during a bulk import this only released a savepoint, EndBulkImport() commits again
+  if (!InBulkImport())
   { // number of items in the db has likely changed, so reset the infomanager cache
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MUSIC, GetSongsCount() > 0);
-    return true;
   }
-  return false;
+  return true;
 }
 
 bool CMusicDatabase::SetScraperForPath(const CStdString& strPath, const ADDON::ScraperPtr& scraper)
@@ -51,6 +51,9 @@
 #include "music/MusicThumbLoader.h"
 #include "interfaces/AnnouncementManager.h"
 #include "GUIUserMessages.h"
+#include "threads/SingleLock.h"
+#include "utils/JobManager.h"
+#include "utils/DirectoryFingerprints.h"
 
 #include <algorithm>
 
@@ -59,6 +62,47 @@ using namespace MUSIC_INFO;
 using namespace XFILE;
 using namespace MUSIC_GRABBER;
 
+#define MAX_TAG_READERS  4    // number of jobs reading tags in parallel
+#define SCAN_BATCH_SIZE  1000 // songs to add before an offline scan commits
+#define SCAN_BATCH_TIME  5000 // ms to hold a transaction open before an offline scan commits
+
+namespace MUSIC_INFO
+{
+/*! \brief Reads tags for the scanner until its queue runs dry
+ */
+class CMusicTagReaderJob : public CJob
+{
+public:
+  CMusicTagReaderJob(CMusicInfoScanner *scanner) : m_scanner(scanner) {}
+
+  // the job manager deletes jobs whether they ran or were cancelled, so count the readers down here
+  virtual ~CMusicTagReaderJob()
+  {
+    CSingleLock lock(m_scanner->m_tagSection);
+    m_scanner->m_tagReaders--;
+    m_scanner->m_tagEvent.Set();
+  }
+
+  virtual const char *GetType() const { return "musictagreader"; }
+  virtual bool DoWork()
+  {
+    CFileItemPtr item;
+    while (m_scanner->GetNextTagRead(item))
+    {
+      auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(item->GetPath()));
+      if (NULL != pLoader.get())
+        pLoader->Load(item->GetPath(), *item->GetMusicInfoTag());
+
+      CSingleLock lock(m_scanner->m_tagSection);
+      m_scanner->m_tagsRead++;
+    }
+    return true;
+  }
+private:
+  CMusicInfoScanner *m_scanner;
+};
+}
+
 CMusicInfoScanner::CMusicInfoScanner() : CThread("CMusicInfoScanner")
 {
   m_bRunning = false;
@@ -68,6 +112,11 @@ CMusicInfoScanner::CMusicInfoScanner() : CThread("CMusicInfoScanner")
   m_currentItem=0;
   m_itemCount=0;
   m_flags = 0;
+  m_tagsRead = 0;
+  m_tagReaders = 0;
+  m_batched = false;
+  m_batchSongs = 0;
+  m_batchStart = 0;
 }
 
 CMusicInfoScanner::~CMusicInfoScanner()
@@ -115,6 +164,21 @@ void CMusicInfoScanner::Process()
       m_bCanInterrupt = false;
       m_needsCleanup = false;
 
+      // online lookups can take a while, so only batch database writes if we're offline
+      m_batched = !(m_flags & SCAN_ONLINE);
+      if (m_batched)
+      {
+        // a first or full scan adds everything anew, so import it in one go
+        if ((m_flags & SCAN_RESCAN) || m_musicDatabase.GetSongsCount() == 0)
+          m_musicDatabase.BeginBulkImport();
+        else
+          m_musicDatabase.BeginTransaction();
+        m_batchSongs = 0;
+        m_batchStart = XbmcThreads::SystemClockMillis();
+      }
+
+      LoadFingerprints();
+
       bool commit = false;
       bool cancelled = false;
       while (!cancelled && m_pathsToScan.size())
@@ -131,6 +195,18 @@ void CMusicInfoScanner::Process()
         commit = !cancelled;
       }
 
+      // a cancelled directory is rolled back, along with the removal of its old songs, and
+      // isn't marked as scanned, so whatever is left in the batch is consistent
+      if (m_batched)
+      {
+        if (m_musicDatabase.InBulkImport())
+          m_musicDatabase.EndBulkImport();
+        else
+          m_musicDatabase.CommitTransaction();
+        m_batched = false;
+      }
+      m_fingerprints.Save();
+
       if (commit)
       {
         g_infoManager.ResetLibraryBools();
@@ -395,8 +471,32 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   if (CUtil::ExcludeFileOrFolder(strDirectory, regexps))
     return true;
 
-  // load subfolder
+  // skip listing the folder if it hasn't changed since we last scanned it
   CFileItemList items;
+  vector<CStdString> subdirs;
+  int files = 0;
+  CStdString dbHash;
+  if (!(m_flags & SCAN_RESCAN) && m_fingerprints.IsUnchanged(strDirectory, subdirs, files) &&
+      m_musicDatabase.GetPathHash(strDirectory, dbHash))
+  {
+    CLog::Log(LOGDEBUG, "%s Skipping dir '%s' due to unchanged fingerprint", __FUNCTION__, strDirectory.c_str());
+    m_currentItem += files;
+
+    if (m_handle)
+    {
+      if (m_itemCount>0)
+        m_handle->SetPercentage(m_currentItem/(float)m_itemCount*100);
+      OnDirectoryScanned(strDirectory);
+    }
+
+    for (vector<CStdString>::const_iterator i = subdirs.begin(); i != subdirs.end(); ++i)
+      items.Add(CFileItemPtr(new CFileItem(*i, true)));
+
+    return ScanSubFolders(items);
+  }
+
+  // load subfolder
+  m_fingerprints.BeginScan(strDirectory);
   CDirectory::GetDirectory(strDirectory, items, g_settings.m_musicExtensions + "|.jpg|.tbn|.lrc|.cdg");
 
   // sort and get the path hash.  Note that we don't filter .cue sheet items here as we want
@@ -407,7 +507,6 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   GetPathHash(items, hash);
 
   // check whether we need to rescan or not
-  CStdString dbHash;
   if ((m_flags & SCAN_RESCAN) || !m_musicDatabase.GetPathHash(strDirectory, dbHash) || dbHash != hash)
   { // path has changed - rescan
     if (dbHash.IsEmpty())
@@ -426,8 +525,9 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
         OnDirectoryScanned(strDirectory);
     }
 
-    // save information about this folder
-    m_musicDatabase.SetPathHash(strDirectory, hash);
+    // save information about this folder, unless it was rolled back to be scanned again next time
+    if (!m_bStop)
+      m_musicDatabase.SetPathHash(strDirectory, hash);
   }
   else
   { // path is the same - no need to rescan
@@ -443,7 +543,23 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
     }
   }
 
-  // now scan the subfolders
+  if (!m_bStop)
+  {
+    subdirs.clear();
+    for (int i = 0; i < items.Size(); ++i)
+    {
+      CFileItemPtr pItem = items[i];
+      if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList())
+        subdirs.push_back(pItem->GetPath());
+    }
+    m_fingerprints.SetScanned(strDirectory, subdirs, CountFiles(items, false));
+  }
+
+  return ScanSubFolders(items);
+}
+
+bool CMusicInfoScanner::ScanSubFolders(const CFileItemList &items)
+{
   for (int i = 0; i < items.Size(); ++i)
   {
     CFileItemPtr pItem = items[i];
@@ -468,6 +584,9 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
 {
   CSongMap songsMap;
 
+  // the old songs are removed in the same transaction the new ones are added in
+  BeginDirectory();
+
   // get all information for all files in current directory from database, and remove them
   if (m_musicDatabase.RemoveSongsFromPath(strDirectory, songsMap))
     m_needsCleanup = true;
@@ -477,14 +596,16 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
   CStdStringArray regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
 
   // for every file found, but skip folder
+  vector<CFileItemPtr> songItems;
   for (int i = 0; i < items.Size(); ++i)
   {
     CFileItemPtr pItem = items[i];
-    CStdString strExtension;
-    URIUtils::GetExtension(pItem->GetPath(), strExtension);
 
     if (m_bStop)
+    {
+      RollbackDirectory();
       return 0;
+    }
 
     // Discard all excluded files defined by m_musicExcludeRegExps
     if (CUtil::ExcludeFileOrFolder(pItem->GetPath(), regexps))
@@ -492,64 +613,59 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
 
     // dont try reading id3tags for folders, playlists or shoutcast streams
     if (!pItem->m_bIsFolder && !pItem->IsPlayList() && !pItem->IsPicture() && !pItem->IsLyrics() )
-    {
-      m_currentItem++;
-//      CLog::Log(LOGDEBUG, "%s - Reading tag for: %s", __FUNCTION__, pItem->GetPath().c_str());
-
-      // grab info from the song
-      CSong *dbSong = songsMap.Find(pItem->GetPath());
-
-      CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
-      if (!tag.Loaded() )
-      { // read the tag from a file
-        auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(pItem->GetPath()));
-        if (NULL != pLoader.get())
-          pLoader->Load(pItem->GetPath(), tag);
-      }
+      songItems.push_back(pItem);
+  }
 
-      // if we have the itemcount, update our
-      // dialog with the progress we made
-      if (m_handle && m_itemCount>0)
-        m_handle->SetPercentage(m_currentItem/(float)m_itemCount*100);
+  // grab info from the songs
+  if (!ReadTags(songItems))
+  {
+    RollbackDirectory();
+    return 0;
+  }
+
+  for (vector<CFileItemPtr>::iterator i = songItems.begin(); i != songItems.end(); ++i)
+  {
+    CFileItemPtr pItem = *i;
+    CSong *dbSong = songsMap.Find(pItem->GetPath());
+
+    CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
+    if (tag.Loaded())
+    {
+      CSong song(tag);
 
-      if (tag.Loaded())
+      // ensure our song has a valid filename or else it will assert in AddSong()
+      if (song.strFileName.IsEmpty())
       {
-        CSong song(tag);
+        // copy filename from path in case UPnP or other tag loaders didn't specify one (FIXME?)
+        song.strFileName = pItem->GetPath();
 
-        // ensure our song has a valid filename or else it will assert in AddSong()
+        // if we still don't have a valid filename, skip the song
         if (song.strFileName.IsEmpty())
         {
-          // copy filename from path in case UPnP or other tag loaders didn't specify one (FIXME?)
-          song.strFileName = pItem->GetPath();
-
-          // if we still don't have a valid filename, skip the song
-          if (song.strFileName.IsEmpty())
-          {
-            // this shouldn't ideally happen!
-            CLog::Log(LOGERROR, "Skipping song since it doesn't seem to have a filename");
-            continue;
-          }
+          // this shouldn't ideally happen!
+          CLog::Log(LOGERROR, "Skipping song since it doesn't seem to have a filename");
+          continue;
         }
+      }
 
-        song.iStartOffset = pItem->m_lStartOffset;
-        song.iEndOffset = pItem->m_lEndOffset;
-        song.strThumb = pItem->GetUserMusicThumb(true);
-        if (dbSong)
-        { // keep the db-only fields intact on rescan...
-          song.iTimesPlayed = dbSong->iTimesPlayed;
-          song.lastPlayed = dbSong->lastPlayed;
-          song.iKaraokeNumber = dbSong->iKaraokeNumber;
-
-          if (song.rating == '0') song.rating = dbSong->rating;
-          if (song.strThumb.empty())
-            song.strThumb = dbSong->strThumb;
-        }
-        songsToAdd.push_back(song);
-//        CLog::Log(LOGDEBUG, "%s - Tag loaded for: %s", __FUNCTION__, pItem->GetPath().c_str());
+      song.iStartOffset = pItem->m_lStartOffset;
+      song.iEndOffset = pItem->m_lEndOffset;
+      song.strThumb = pItem->GetUserMusicThumb(true);
+      if (dbSong)
+      { // keep the db-only fields intact on rescan...
+        song.iTimesPlayed = dbSong->iTimesPlayed;
+        song.lastPlayed = dbSong->lastPlayed;
+        song.iKaraokeNumber = dbSong->iKaraokeNumber;
+
+        if (song.rating == '0') song.rating = dbSong->rating;
+        if (song.strThumb.empty())
+          song.strThumb = dbSong->strThumb;
       }
-      else
-        CLog::Log(LOGDEBUG, "%s - No tag found for: %s", __FUNCTION__, pItem->GetPath().c_str());
+      songsToAdd.push_back(song);
+//        CLog::Log(LOGDEBUG, "%s - Tag loaded for: %s", __FUNCTION__, pItem->GetPath().c_str());
     }
+    else
+      CLog::Log(LOGDEBUG, "%s - No tag found for: %s", __FUNCTION__, pItem->GetPath().c_str());
   }
 
   VECALBUMS albums;
@@ -557,7 +673,6 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
   FindArtForAlbums(albums, items.GetPath());
 
   // finally, add these to the database
-  m_musicDatabase.BeginTransaction();
   int numAdded = 0;
   set<long> albumsToScan;
   set<long> artistsToScan;
@@ -568,7 +683,7 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
     numAdded += i->songs.size();
     if (m_bStop)
     {
-      m_musicDatabase.RollbackTransaction();
+      RollbackDirectory();
       return numAdded;
     }
 
@@ -584,7 +699,7 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
     m_musicDatabase.GetArtistsByAlbum(idAlbum, false, albumArtists);
     artistsToScan.insert(albumArtists.begin(), albumArtists.end());
   }
-  m_musicDatabase.CommitTransaction();
+  CommitBatch(numAdded);
 
   // Download info & artwork
   bool bCanceled;
@@ -638,6 +753,147 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
   return songsToAdd.size();
 }
 
+bool CMusicInfoScanner::ReadTags(const vector<CFileItemPtr> &items)
+{
+  vector<CFileItemPtr> serial;
+  unsigned int readers;
+  {
+    CSingleLock lock(m_tagSection);
+    m_tagQueue.clear();
+    m_tagsRead = 0;
+    for (vector<CFileItemPtr>::const_iterator i = items.begin(); i != items.end(); ++i)
+    {
+      // creates the tag on this thread so the readers only fill it in
+      if ((*i)->GetMusicInfoTag()->Loaded())
+        m_tagsRead++;
+      else if (CMusicInfoTagLoaderFactory::IsTagLibFile((*i)->GetPath()))
+        m_tagQueue.push_back(*i);
+      else
+        serial.push_back(*i);
+    }
+    // the readers pop from the back, so reverse to read in directory order
+    reverse(m_tagQueue.begin(), m_tagQueue.end());
+
+    // not worth the overhead of a job for a single song
+    if (m_tagQueue.size() == 1)
+    {
+      serial.push_back(m_tagQueue.back());
+      m_tagQueue.clear();
+    }
+    readers = m_tagReaders = min(m_tagQueue.size(), (size_t)MAX_TAG_READERS);
+  }
+
+  // the job manager's lock is taken while jobs are destroyed, so jobs must be added without holding ours
+  vector<unsigned int> jobs;
+  for (unsigned int i = 0; i < readers; i++)
+    jobs.push_back(CJobManager::GetInstance().AddJob(new CMusicTagReaderJob(this), NULL));
+
+  // the remaining loaders may not be thread safe, so read them here while the jobs run
+  for (vector<CFileItemPtr>::iterator i = serial.begin(); i != serial.end() && !m_bStop; ++i)
+  {
+    auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader((*i)->GetPath()));
+    if (NULL != pLoader.get())
+      pLoader->Load((*i)->GetPath(), *(*i)->GetMusicInfoTag());
+
+    CSingleLock lock(m_tagSection);
+    m_tagsRead++;
+  }
+
+  // wait for the readers to finish, updating our progress as we go
+  bool cancelled = false;
+  while (true)
+  {
+    {
+      CSingleLock lock(m_tagSection);
+      if (m_bStop)
+        m_tagQueue.clear();
+      m_currentItem += m_tagsRead;
+      m_tagsRead = 0;
+      if (!m_tagReaders)
+        break;
+    }
+    if (m_bStop && !cancelled)
+    { // drop any readers that haven't started yet
+      for (vector<unsigned int>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+        CJobManager::GetInstance().CancelJob(*i);
+      cancelled = true;
+    }
+    // if we have the itemcount, update our
+    // dialog with the progress we made
+    if (m_handle && m_itemCount>0)
+      m_handle->SetPercentage(m_currentItem/(float)m_itemCount*100);
+    m_tagEvent.WaitMSec(100);
+  }
+  if (m_handle && m_itemCount>0)
+    m_handle->SetPercentage(m_currentItem/(float)m_itemCount*100);
+
+  return !m_bStop;
+}
+
+bool CMusicInfoScanner::GetNextTagRead(CFileItemPtr &item)
+{
+  CSingleLock lock(m_tagSection);
+  if (m_tagQueue.empty())
+    return false;
+  item = m_tagQueue.back();
+  m_tagQueue.pop_back();
+  return true;
+}
+
+void CMusicInfoScanner::BeginDirectory()
+{
+  // within a bulk import the transaction is a savepoint
+  if (!m_batched || m_musicDatabase.InBulkImport())
+    m_musicDatabase.BeginTransaction();
+}
+
+void CMusicInfoScanner::RollbackDirectory()
+{
+  if (!m_batched || m_musicDatabase.InBulkImport())
+  {
+    m_musicDatabase.RollbackTransaction();
+    return;
+  }
+
+  // the directory can only go with the whole batch, including the path hashes of the
+  // directories before it, so those are scanned again next time too
+  m_musicDatabase.RollbackTransaction();
+  m_batched = false;
+
+  // their fingerprints would have them skipped, so go back to the ones saved by the last scan
+  m_fingerprints.Clear();
+  LoadFingerprints();
+}
+
+void CMusicInfoScanner::CommitBatch(int songsAdded)
+{
+  if (!m_batched || m_musicDatabase.InBulkImport())
+    m_musicDatabase.CommitTransaction();
+  if (!m_batched)
+    return;
+
+  m_batchSongs += songsAdded;
+  if (m_batchSongs >= SCAN_BATCH_SIZE || XbmcThreads::SystemClockMillis() - m_batchStart >= SCAN_BATCH_TIME)
+  {
+    if (m_musicDatabase.InBulkImport())
+      m_musicDatabase.FlushBulkImport();
+    else
+    {
+      m_musicDatabase.CommitTransaction();
+      m_musicDatabase.BeginTransaction();
+    }
+    m_batchSongs = 0;
+    m_batchStart = XbmcThreads::SystemClockMillis();
+  }
+}
+
+void CMusicInfoScanner::LoadFingerprints()
+{
+  m_fingerprints.Load(URIUtils::AddFileToFolder(g_settings.GetDatabaseFolder(), "MusicFingerprints.dat"),
+                      g_advancedSettings.m_bMusicLibraryFastUpdate ? CDirectoryFingerprints::TRUST_ALL
+                                                                   : CDirectoryFingerprints::TRUST_NONE);
+}
+
 static bool SortSongsByTrack(CSong *song, CSong *song2)
 {
   return song->iTrack < song2->iTrack;
@@ -19,7 +19,11 @@
  *
  */
 #include "threads/Thread.h"
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
 #include "music/MusicDatabase.h"
+#include "FileItem.h"
+#include "utils/DirectoryFingerprints.h"
 #include "MusicAlbumInfo.h"
 
 class CAlbum;
@@ -95,12 +99,55 @@ public:
 
   std::map<std::string, std::string> GetArtistArtwork(long id, const CArtist *artist = NULL);
 protected:
+  friend class CMusicTagReaderJob;
+
   virtual void Process();
   int RetrieveMusicInfo(CFileItemList& items, const CStdString& strDirectory);
+
+  /*! \brief Read the tags of the given songs
+   Files read by TagLib are handed to a bounded set of CMusicTagReaderJobs so that
+   the per-file latency of network shares overlaps, other loaders run on the scanner thread.
+   Progress is reported as tags come in.
+   \param items [in/out] songs to read tags for.
+   \return false if the scan was stopped while reading.
+   */
+  bool ReadTags(const std::vector<CFileItemPtr> &items);
+
+  /*! \brief Fetch the next song a tag reader should load
+   \param item [out] the song to load the tag of.
+   \return false once there is nothing left to read.
+   */
+  bool GetNextTagRead(CFileItemPtr &item);
+
+  /*! \brief Begin the database transaction a directory is added in
+   Batches outside a bulk import have no transaction per directory, the directory is
+   added to the batch as it goes.
+   \sa RollbackDirectory, CommitBatch
+   */
+  void BeginDirectory();
+
+  /*! \brief Undo what was written for a directory, when the scan is stopped part way through it
+   Batches outside a bulk import can only be rolled back as a whole, which also drops the
+   fingerprints taken since the last scan was saved.
+   */
+  void RollbackDirectory();
+
+  /*! \brief Commit the database transaction once enough songs have been added
+   Offline scans keep a transaction open across directories, and only commit every
+   SCAN_BATCH_SIZE songs (or SCAN_BATCH_TIME ms), rather than once per directory.
+   \param songsAdded number of songs added since the last call.
+   */
+  void CommitBatch(int songsAdded);
+
+  /*! \brief Load the fingerprints saved by the last scan, unless they're still in memory
+   */
+  void LoadFingerprints();
+
   int GetPathHash(const CFileItemList &items, CStdString &hash);
   void GetAlbumArtwork(long id, const CAlbum &artist);
 
   bool DoScan(const CStdString& strDirectory);
+  bool ScanSubFolders(const CFileItemList &items);
 
   virtual void Run();
   int CountFiles(const CFileItemList& items, bool recursive);
@@ -124,5 +171,17 @@ protected:
   std::vector<long> m_artistsScanned;
   std::vector<long> m_albumsScanned;
   int m_flags;
+
+  CCriticalSection m_tagSection;
+  CEvent m_tagEvent;
+  std::vector<CFileItemPtr> m_tagQueue;  ///< songs waiting for a tag reader
+  unsigned int m_tagsRead;               ///< tags read since progress was last updated
+  unsigned int m_tagReaders;             ///< number of tag reader jobs still running
+
+  bool m_batched;                        ///< whether database writes are batched across directories
+  int m_batchSongs;
+  unsigned int m_batchStart;
+
+  CDirectoryFingerprints m_fingerprints; ///< directories known to be unchanged since the last scan
 };
 }
@@ -30,6 +30,13 @@ namespace MUSIC_INFO
       virtual ~CMusicInfoTagLoaderFactory();
 
       static IMusicInfoTagLoader* CreateLoader(const CStdString& strFileName);
+
+      /*! \brief Check whether the tags of a file are read by TagLib.
+       TagLib loaders share no state, so these files may be loaded from several threads at once.
+       \param strFileName the file to check
+       \return true if CreateLoader() returns a TagLib loader for this file
+       */
+      static bool IsTagLibFile(const CStdString& strFileName);
   };
 }
 
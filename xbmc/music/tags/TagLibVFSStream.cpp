@@ -24,6 +24,7 @@
 #include "utils/StdString.h"
 #include "utils/log.h"
 #include <taglib/tiostream.h>
+#include <algorithm>
 
 using namespace XFILE;
 using namespace TagLib;
@@ -34,6 +35,11 @@ using namespace std;
 #pragma comment(lib, "tag.lib")
 #endif
 
+#define BLOCK_SIZE  (32 * 1024) // granularity of the read cache
+#define HEAD_BLOCKS 4           // blocks fetched from the start of the file when opened
+#define TAIL_BLOCKS 1           // blocks fetched from the end of the file when opened
+#define MAX_BLOCKS  64          // blocks cached before we start over
+
 /*!
  * Construct a File object and opens the \a file.  \a file should be a
  * be an XBMC Vfile.
@@ -41,6 +47,16 @@ using namespace std;
 TagLibVFSStream::TagLibVFSStream(const string& strFileName, bool readOnly)
 {
   m_bIsOpen = true;
+  m_bIsReadOnly = readOnly;
+  m_position = 0;
+  m_length = 0;
+  m_pictureLimit = 0;
+  m_pictureOffset = -1;
+  m_pictureLength = 0;
+  m_readCalls = 0;
+  m_seekCalls = 0;
+  m_fileReads = 0;
+  m_bytesRead = 0;
   if (readOnly)
   {
     if (!m_file.Open(strFileName))
@@ -52,6 +68,21 @@ TagLibVFSStream::TagLibVFSStream(const string& strFileName, bool readOnly)
       m_bIsOpen = false;
   }
   m_strFileName = strFileName;
+
+  if (m_bIsOpen && m_bIsReadOnly)
+  {
+    m_length = m_file.GetLength();
+    // tags live at the start and the end of the file, so grab both up front
+    if (m_length > 0)
+    {
+      int64_t blocks = (m_length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      int64_t head = min(blocks, (int64_t)HEAD_BLOCKS);
+      fetchBlocks(0, head - 1);
+      int64_t tail = max(head, blocks - TAIL_BLOCKS);
+      if (tail < blocks)
+        fetchBlocks(tail, blocks - 1);
+    }
+  }
 }
 
 /*!
@@ -59,6 +90,9 @@ TagLibVFSStream::TagLibVFSStream(const string& strFileName, bool readOnly)
  */
 TagLibVFSStream::~TagLibVFSStream()
 {
+  if (m_bIsReadOnly && m_bIsOpen)
+    CLog::Log(LOGDEBUG, "TagLibVFSStream: %u reads and %u seeks took %u file reads (%"PRId64" of %"PRId64" bytes) for %s",
+              m_readCalls, m_seekCalls, m_fileReads, m_bytesRead, m_length, m_strFileName.c_str());
   m_file.Close();
 }
 
@@ -75,11 +109,121 @@ FileName TagLibVFSStream::name() const
  */
 ByteVector TagLibVFSStream::readBlock(TagLib::ulong length)
 {
+  if (!m_bIsReadOnly || m_length <= 0)
+  {
+    ByteVector byteVector(static_cast<TagLib::uint>(length));
+    byteVector.resize(m_file.Read(byteVector.data(), length));
+    return byteVector;
+  }
+
+  m_readCalls++;
+  if (m_position < 0 || m_position >= m_length)
+    return ByteVector();
+
+  // the payload of a FLAC PICTURE block, announced by the block header read just before, is left zeroed
+  // beyond the limit. any other read, even of another metadata block, is read in full.
+  bool picture = m_pictureLimit && m_position == m_pictureOffset && length == m_pictureLength;
+  m_pictureOffset = -1;
+
+  if ((int64_t)length > m_length - m_position)
+    length = (TagLib::ulong)(m_length - m_position);
+
+  TagLib::ulong wanted = length;
+  if (picture && wanted > m_pictureLimit)
+    wanted = m_pictureLimit;
+
   ByteVector byteVector(static_cast<TagLib::uint>(length));
-  byteVector.resize(m_file.Read(byteVector.data(), length));
+  TagLib::ulong read = readCached(byteVector.data(), m_position, wanted);
+  if (read < wanted)
+    byteVector.resize(read);
+  m_position += byteVector.size();
+
+  // a FLAC metadata block header: 1 byte type (6 is PICTURE), 3 bytes big endian block length
+  const unsigned char *header = (const unsigned char *)byteVector.data();
+  if (m_pictureLimit && byteVector.size() == 4 && (header[0] & 0x7F) == 6)
+  {
+    m_pictureOffset = m_position;
+    m_pictureLength = (header[1] << 16) | (header[2] << 8) | header[3];
+  }
   return byteVector;
 }
 
+TagLib::ulong TagLibVFSStream::readCached(char *buffer, int64_t offset, TagLib::ulong length)
+{
+  if (length == 0)
+    return 0;
+
+  int64_t first = offset / BLOCK_SIZE;
+  int64_t last = (offset + length - 1) / BLOCK_SIZE;
+
+  // big reads (embedded art) would push everything else out of the cache, so read them straight through
+  if (last - first >= MAX_BLOCKS / 2)
+  {
+    m_file.Seek(offset, SEEK_SET);
+    unsigned int read = m_file.Read(buffer, length);
+    m_fileReads++;
+    if (read == (unsigned int)-1)
+      return 0;
+    m_bytesRead += read;
+    return read;
+  }
+
+  if (m_blocks.size() + (last - first + 1) > MAX_BLOCKS)
+    m_blocks.clear();
+
+  // fetch what we're missing, merging runs of neighbouring blocks into a single read
+  for (int64_t block = first; block <= last; block++)
+  {
+    if (m_blocks.find(block) != m_blocks.end())
+      continue;
+    int64_t end = block;
+    while (end < last && m_blocks.find(end + 1) == m_blocks.end())
+      end++;
+    fetchBlocks(block, end);
+    block = end;
+  }
+
+  TagLib::ulong copied = 0;
+  while (copied < length)
+  {
+    int64_t position = offset + copied;
+    map<int64_t, ByteVector>::const_iterator it = m_blocks.find(position / BLOCK_SIZE);
+    if (it == m_blocks.end())
+      break;
+    TagLib::ulong start = (TagLib::ulong)(position % BLOCK_SIZE);
+    if (start >= it->second.size())
+      break;
+    TagLib::ulong count = min(length - copied, (TagLib::ulong)(it->second.size() - start));
+    memcpy(buffer + copied, it->second.data() + start, count);
+    copied += count;
+  }
+  return copied;
+}
+
+void TagLibVFSStream::fetchBlocks(int64_t first, int64_t last)
+{
+  int64_t offset = first * BLOCK_SIZE;
+  int64_t size = min((last + 1) * BLOCK_SIZE, m_length) - offset;
+  if (size <= 0)
+    return;
+
+  ByteVector data(static_cast<TagLib::uint>(size));
+  m_file.Seek(offset, SEEK_SET);
+  unsigned int read = m_file.Read(data.data(), size);
+  m_fileReads++;
+  if (read == (unsigned int)-1)
+    return;
+  m_bytesRead += read;
+
+  for (int64_t block = first; block <= last; block++)
+  {
+    unsigned int start = (unsigned int)((block - first) * BLOCK_SIZE);
+    if (start >= read)
+      break;
+    m_blocks[block] = data.mid(start, min((unsigned int)BLOCK_SIZE, read - start));
+  }
+}
+
 /*!
  * Attempts to write the block \a data at the current get pointer.  If the
  * file is currently only opened read only -- i.e. readOnly() returns true --
@@ -240,6 +384,24 @@ bool TagLibVFSStream::isOpen() const
  */
 void TagLibVFSStream::seek(long offset, Position p)
 {
+  if (m_bIsReadOnly && m_length > 0)
+  {
+    m_seekCalls++;
+    switch(p)
+    {
+      case Beginning:
+        m_position = offset;
+        break;
+      case Current:
+        m_position += offset;
+        break;
+      case End:
+        m_position = m_length + offset;
+        break;
+    }
+    return;
+  }
+
   switch(p)
   {
     case Beginning:
@@ -266,7 +428,7 @@ void TagLibVFSStream::clear()
  */
 long TagLibVFSStream::tell() const
 {
-  int64_t pos = m_file.GetPosition();
+  int64_t pos = (m_bIsReadOnly && m_length > 0) ? m_position : m_file.GetPosition();
   if(pos > LONG_MAX)
     return -1;
   else
@@ -278,6 +440,8 @@ long TagLibVFSStream::tell() const
  */
 long TagLibVFSStream::length()
 {
+  if (m_bIsReadOnly && m_length > 0)
+    return (long)m_length;
   return (long)m_file.GetLength();
 }
 
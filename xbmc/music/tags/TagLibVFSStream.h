@@ -22,6 +22,7 @@
 #include "filesystem/File.h"
 #include "utils/StdString.h"
 #include <taglib/tiostream.h>
+#include <map>
 
 using namespace XFILE;
 using namespace TagLib;
@@ -120,6 +121,14 @@ namespace MUSIC_INFO
      */
     void truncate(long length);
 
+    /*!
+     * Only read the first \a limit bytes of a FLAC PICTURE metadata block,
+     * returning zeros for the remainder.  The block is recognised by the block
+     * header TagLib reads right before it.  Used to skip the payload of embedded
+     * pictures when only their size is needed.  0 disables this.
+     */
+    void setFlacPictureReadLimit(TagLib::ulong limit) { m_pictureLimit = limit; };
+
   protected:
     /*!
      * Returns the buffer size that is used for internal buffering.
@@ -127,11 +136,36 @@ namespace MUSIC_INFO
     static TagLib::uint bufferSize() { return 1024; };
 
   private:
+    /*!
+     * Copies \a length bytes at \a offset into \a buffer, fetching any blocks
+     * that aren't cached with as few reads as possible.
+     */
+    TagLib::ulong readCached(char *buffer, int64_t offset, TagLib::ulong length);
+
+    /*!
+     * Reads the blocks \a first to \a last from the file in a single request.
+     */
+    void fetchBlocks(int64_t first, int64_t last);
+
     std::string m_strFileName;
     CFile       m_file;
     bool        m_bIsReadOnly;
     bool        m_bIsOpen;
     int         m_bufferSize;
+
+    /* Read only streams never touch m_file's position, but serve reads from
+       block aligned chunks of the file.  The head and tail, where the tags live,
+       are fetched up front and neighbouring missing blocks are read together. */
+    std::map<int64_t, ByteVector> m_blocks;
+    int64_t       m_position;
+    int64_t       m_length;
+    TagLib::ulong m_pictureLimit;
+    int64_t       m_pictureOffset; ///< where the PICTURE block whose header was just read starts, -1 if none
+    TagLib::ulong m_pictureLength; ///< length of that PICTURE block
+    unsigned int  m_readCalls;   ///< number of reads made by TagLib
+    unsigned int  m_seekCalls;   ///< number of seeks made by TagLib
+    unsigned int  m_fileReads;   ///< number of reads issued to the file
+    int64_t       m_bytesRead;   ///< bytes read from the file
   };
 }
 
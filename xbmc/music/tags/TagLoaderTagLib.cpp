@@ -50,6 +50,8 @@ using namespace std;
 using namespace TagLib;
 using namespace MUSIC_INFO;
 
+#define FLAC_PICTURE_READ_LIMIT (64 * 1024) // bytes of a FLAC picture block read when skipping embedded art
+
 CTagLoaderTagLib::CTagLoaderTagLib()
 {
 }
@@ -105,7 +107,13 @@ bool CTagLoaderTagLib::Load(const string& strFileName, CMusicInfoTag& tag, Embed
   else if (strExtension == "asf" || strExtension == "wmv" || strExtension == "wma")
     file = asfFile = new ASF::File(stream);
   else if (strExtension == "flac")
+  {
+    // FLAC pictures sit in their own metadata block, read in one go, with the payload at the end.
+    // If we don't want the art only its header is read, so we still know the size and type.
+    if (!art && g_advancedSettings.m_bMusicLibrarySkipEmbeddedArt)
+      stream->setFlacPictureReadLimit(FLAC_PICTURE_READ_LIMIT);
     file = flacFile = new FLAC::File(stream, ID3v2::FrameFactory::instance());
+  }
   else if (strExtension == "it")
     file = itFile = new IT::File(stream);
   else if (strExtension == "mod" || strExtension == "module" || strExtension == "nst" || strExtension == "wow")
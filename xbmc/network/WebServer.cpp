@@ -25,9 +25,17 @@
 #include "utils/URIUtils.h"
 #include "utils/Variant.h"
 #include "utils/Base64.h"
+#include "utils/StringUtils.h"
 #include "threads/SingleLock.h"
 #include "XBDateTime.h"
 #include "URL.h"
+#include "TextureCacheJob.h"
+#include "filesystem/SpecialProtocol.h"
+
+#ifdef _LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #ifdef _WIN32
 #pragma comment(lib, "libmicrohttpd.dll.lib")
@@ -358,105 +366,271 @@ int CWebServer::CreateFileDownloadResponse(struct MHD_Connection *connection, co
 {
   CFile *file = new CFile();
 
-  if (file->Open(strURL, READ_NO_CACHE))
+  if (!file->Open(strURL, READ_NO_CACHE))
+  {
+    delete file;
+    CLog::Log(LOGERROR, "WebServer: Failed to open %s", strURL.c_str());
+    return SendErrorResponse(connection, MHD_HTTP_NOT_FOUND, GET); /* GET Assumed Temporarily */
+  }
+
+  int64_t fileLength = file->GetLength();
+  uint64_t length = fileLength > 0 ? (uint64_t)fileLength : 0;
+
+  CDateTime lastModified;
+  bool hasLastModified = false;
+  struct __stat64 statBuffer;
+  if (file->Stat(&statBuffer) == 0)
+  {
+    struct tm *time = localtime((time_t *)&statBuffer.st_mtime);
+    if (time != NULL)
+    {
+      lastModified = *time;
+      hasLastModified = true;
+    }
+  }
+
+  // the size/mtime hash the texture cache uses to detect changed images doubles as a strong validator
+  string etag;
+  CStdString hash = CTextureCacheJob::GetImageHash(strURL);
+  if (!hash.IsEmpty())
+    etag = "\"" + hash + "\"";
+
+  // If-None-Match takes precedence over If-Modified-Since
+  bool notModified = false;
+  if (methodType == GET || methodType == HEAD)
+  {
+    string ifNoneMatch = GetRequestHeaderValue(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH);
+    if (!ifNoneMatch.empty())
+      notModified = MatchesETag(ifNoneMatch, etag);
+    else if (hasLastModified)
+    {
+      string ifModifiedSince = GetRequestHeaderValue(connection, MHD_HEADER_KIND, "If-Modified-Since");
+      if (!ifModifiedSince.empty())
+      {
+        CDateTime ifModifiedSinceDate;
+        ifModifiedSinceDate.SetFromRFC1123DateTime(ifModifiedSince);
+        notModified = lastModified.GetAsUTCDateTime() <= ifModifiedSinceDate;
+      }
+    }
+  }
+
+  uint64_t first = 0;
+  uint64_t last = length > 0 ? length - 1 : 0;
+  bool ranged = false;
+  if (methodType == GET && !notModified && length > 0)
   {
-    bool getData = true;
-    if (methodType != HEAD)
+    string range = GetRequestHeaderValue(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_RANGE);
+    if (!range.empty())
     {
-      if (methodType == GET)
+      // If-Range only lets the range through if the file is unchanged, otherwise the whole file is sent
+      bool unchanged = true;
+      string ifRange = GetRequestHeaderValue(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_RANGE);
+      if (!ifRange.empty())
+      {
+        if (ifRange[0] == '"')
+          unchanged = !etag.empty() && ifRange == etag;
+        else
+          unchanged = hasLastModified && ifRange == lastModified.GetAsRFC1123DateTime();
+      }
+
+      if (unchanged)
       {
-        string ifModifiedSince = GetRequestHeaderValue(connection, MHD_HEADER_KIND, "If-Modified-Since");
-        if (!ifModifiedSince.empty())
+        int ret = ParseRangeHeader(range, length, first, last);
+        if (ret < 0)
         {
-          CDateTime ifModifiedSinceDate;
-          ifModifiedSinceDate.SetFromRFC1123DateTime(ifModifiedSince);
+          file->Close();
+          delete file;
 
-          struct __stat64 statBuffer;
-          if (file->Stat(&statBuffer) == 0)
-          {
-            struct tm *time = localtime((time_t *)&statBuffer.st_mtime);
-            if (time != NULL)
-            {
-              CDateTime lastModified = *time;
-              if (lastModified.GetAsUTCDateTime() <= ifModifiedSinceDate)
-              {
-                getData = false;
-                response = MHD_create_response_from_data (0, NULL, MHD_NO, MHD_NO);
-                responseCode = MHD_HTTP_NOT_MODIFIED;
-              }
-            }
-          }
+          response = MHD_create_response_from_data (0, NULL, MHD_NO, MHD_NO);
+          if (response == NULL)
+            return MHD_NO;
+
+          CStdString contentRange;
+          contentRange.Format("bytes */%"PRIu64, length);
+          MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_RANGE, contentRange);
+          responseCode = MHD_HTTP_REQUESTED_RANGE_NOT_SATISFIABLE;
+          return MHD_YES;
         }
+        ranged = ret > 0;
       }
-
-      if (getData)
-        response = MHD_create_response_from_callback(file->GetLength(),
-                                                     2048,
-                                                     &CWebServer::ContentReaderCallback, file,
-                                                     &CWebServer::ContentReaderFreeCallback);
-      if (response == NULL)
-        return MHD_NO;
     }
-    else
+  }
+
+  response = NULL;
+  if (notModified)
+  {
+    response = MHD_create_response_from_data (0, NULL, MHD_NO, MHD_NO);
+    if (response == NULL)
     {
-      getData = false;
+      file->Close();
+      delete file;
+      return MHD_NO;
+    }
+    responseCode = MHD_HTTP_NOT_MODIFIED;
+  }
+  else if (methodType != HEAD)
+  {
+    uint64_t size = ranged ? last - first + 1 : length;
 
-      CStdString contentLength;
-      contentLength.Format("%I64d", file->GetLength());
+#if defined(_LINUX) && (MHD_VERSION >= 0x00091400)
+    // local files are handed to libmicrohttpd as a file descriptor so it can sendfile() them
+    CStdString localPath = CSpecialProtocol::TranslatePath(strURL);
+    if (CURL(localPath).GetProtocol().IsEmpty() && size == (size_t)size)
+    {
+      int fd = open(localPath.c_str(), O_RDONLY);
+      if (fd >= 0)
+      {
+        response = MHD_create_response_from_fd_at_offset((size_t)size, fd, (off_t)first);
+        if (response == NULL)
+          close(fd);
+      }
+    }
+#endif
 
-      response = MHD_create_response_from_data (0, NULL, MHD_NO, MHD_NO);
+    if (response == NULL)
+    {
+      HttpFileDownloadContext *context = new HttpFileDownloadContext;
+      context->file = file;
+      context->rangeStart = first;
+
+      response = MHD_create_response_from_callback(size,
+                                                   2048,
+                                                   &CWebServer::ContentReaderCallback, context,
+                                                   &CWebServer::ContentReaderFreeCallback);
       if (response == NULL)
       {
+        delete context;
         file->Close();
         delete file;
         return MHD_NO;
       }
-      MHD_add_response_header(response, "Content-Length", contentLength);
+      // libmicrohttpd owns the CFile instance from now on
+      file = NULL;
     }
 
-    // set the Content-Type header
-    CStdString ext = URIUtils::GetExtension(strURL);
-    ext = ext.ToLower();
-    const char *mime = CreateMimeTypeFromExtension(ext.c_str());
-    if (mime)
-      MHD_add_response_header(response, "Content-Type", mime);
-
-    // set the Last-Modified header
-    struct __stat64 statBuffer;
-    if (file->Stat(&statBuffer) == 0)
+    if (ranged)
     {
-      struct tm *time = localtime((time_t *)&statBuffer.st_mtime);
-      if (time != NULL)
-      {
-        CDateTime lastModified = *time;
-        MHD_add_response_header(response, "Last-Modified", lastModified.GetAsRFC1123DateTime());
-      }
+      CStdString contentRange;
+      contentRange.Format("bytes %"PRIu64"-%"PRIu64"/%"PRIu64, first, last, length);
+      MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_RANGE, contentRange);
+      responseCode = MHD_HTTP_PARTIAL_CONTENT;
     }
+  }
+  else
+  {
+    CStdString contentLength;
+    contentLength.Format("%"PRIu64, length);
 
-    // set the Expires header
-    CDateTime expiryTime = CDateTime::GetCurrentDateTime();
-    if (mime && strncmp(mime, "text/html", 9) == 0)
-      expiryTime += CDateTimeSpan(1, 0, 0, 0);
-    else
-      expiryTime += CDateTimeSpan(365, 0, 0, 0);
-    MHD_add_response_header(response, "Expires", expiryTime.GetAsRFC1123DateTime());
-
-    // only close the CFile instance if libmicrohttpd doesn't have to grab the data of the file
-    if (!getData)
+    response = MHD_create_response_from_data (0, NULL, MHD_NO, MHD_NO);
+    if (response == NULL)
     {
       file->Close();
       delete file;
+      return MHD_NO;
     }
+    MHD_add_response_header(response, "Content-Length", contentLength);
   }
+
+  MHD_add_response_header(response, MHD_HTTP_HEADER_ACCEPT_RANGES, "bytes");
+  if (!etag.empty())
+    MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, etag.c_str());
+
+  // set the Content-Type header
+  CStdString ext = URIUtils::GetExtension(strURL);
+  ext = ext.ToLower();
+  const char *mime = CreateMimeTypeFromExtension(ext.c_str());
+  if (mime)
+    MHD_add_response_header(response, "Content-Type", mime);
+
+  // set the Last-Modified header
+  if (hasLastModified)
+    MHD_add_response_header(response, "Last-Modified", lastModified.GetAsRFC1123DateTime());
+
+  // set the Expires header
+  CDateTime expiryTime = CDateTime::GetCurrentDateTime();
+  if (mime && strncmp(mime, "text/html", 9) == 0)
+    expiryTime += CDateTimeSpan(1, 0, 0, 0);
   else
+    expiryTime += CDateTimeSpan(365, 0, 0, 0);
+  MHD_add_response_header(response, "Expires", expiryTime.GetAsRFC1123DateTime());
+
+  // only close the CFile instance if libmicrohttpd doesn't have to grab the data of the file
+  if (file != NULL)
   {
+    file->Close();
     delete file;
-    CLog::Log(LOGERROR, "WebServer: Failed to open %s", strURL.c_str());
-    return SendErrorResponse(connection, MHD_HTTP_NOT_FOUND, GET); /* GET Assumed Temporarily */
   }
   return MHD_YES;
 }
 
+/* Parses a single "bytes=first-last" range (RFC 7233 section 2.1).
+   Returns 1 for a satisfiable range, -1 for an unsatisfiable one and 0 if the
+   header has to be ignored (other units, syntax errors or multiple ranges) in
+   which case the whole file is sent. */
+int CWebServer::ParseRangeHeader(const string &range, uint64_t length, uint64_t &first, uint64_t &last)
+{
+  if (range.compare(0, 6, "bytes=") != 0 || range.find(',') != string::npos)
+    return 0;
+
+  CStdString spec = range.substr(6);
+  size_t dash = spec.find('-');
+  if (dash == string::npos)
+    return 0;
+
+  CStdString start = spec.Left(dash);
+  CStdString end = spec.Mid(dash + 1);
+  start.Trim();
+  end.Trim();
+  if (start.find_first_not_of("0123456789") != string::npos ||
+      end.find_first_not_of("0123456789") != string::npos)
+    return 0;
+
+  if (start.IsEmpty())
+  {
+    // suffix range, the last n bytes of the file
+    if (end.IsEmpty())
+      return 0;
+    uint64_t suffix = _atoi64(end.c_str());
+    if (suffix == 0)
+      return -1;
+    first = suffix < length ? length - suffix : 0;
+    last = length - 1;
+    return 1;
+  }
+
+  first = _atoi64(start.c_str());
+  last = end.IsEmpty() ? length - 1 : _atoi64(end.c_str());
+  if (last < first)
+    return 0;
+  if (first >= length)
+    return -1;
+  if (last >= length)
+    last = length - 1;
+  return 1;
+}
+
+bool CWebServer::MatchesETag(const string &header, const string &etag)
+{
+  if (etag.empty())
+    return false;
+
+  // If-None-Match uses the weak comparison, so W/ prefixes are ignored
+  CStdStringArray tags;
+  StringUtils::SplitString(header, ",", tags);
+  for (unsigned int i = 0; i < tags.size(); i++)
+  {
+    CStdString tag = tags[i];
+    tag.Trim();
+    if (tag == "*")
+      return true;
+    if (tag.Left(2) == "W/")
+      tag = tag.Mid(2);
+    if (tag == etag)
+      return true;
+  }
+  return false;
+}
+
 int CWebServer::CreateErrorResponse(struct MHD_Connection *connection, int responseType, HTTPMethod method, struct MHD_Response *&response)
 {
   size_t payloadSize = 0;
@@ -518,9 +692,11 @@ int CWebServer::ContentReaderCallback(void *cls, uint64_t pos, char *buf, int ma
 int CWebServer::ContentReaderCallback(void *cls, size_t pos, char *buf, int max)
 #endif
 {
-  CFile *file = (CFile *)cls;
-  if((unsigned int)pos != file->GetPosition())
-    file->Seek(pos);
+  HttpFileDownloadContext *context = (HttpFileDownloadContext *)cls;
+  CFile *file = context->file;
+  int64_t position = context->rangeStart + pos;
+  if (position != file->GetPosition())
+    file->Seek(position);
   unsigned res = file->Read(buf, max);
   if(res == 0)
     return -1;
@@ -529,10 +705,11 @@ int CWebServer::ContentReaderCallback(void *cls, size_t pos, char *buf, int max)
 
 void CWebServer::ContentReaderFreeCallback(void *cls)
 {
-  CFile *file = (CFile *)cls;
-  file->Close();
+  HttpFileDownloadContext *context = (HttpFileDownloadContext *)cls;
+  context->file->Close();
 
-  delete file;
+  delete context->file;
+  delete context;
 }
 
 struct MHD_Daemon* CWebServer::StartMHD(unsigned int flags, int port)
@@ -33,6 +33,11 @@
 #include "threads/CriticalSection.h"
 #include "httprequesthandler/IHTTPRequestHandler.h"
 
+namespace XFILE
+{
+  class CFile;
+}
+
 class CWebServer : public JSONRPC::ITransportLayer
 {
 public:
@@ -92,6 +97,8 @@ private:
   static void ContentReaderFreeCallback (void *cls);
   static int CreateRedirect(struct MHD_Connection *connection, const std::string &strURL, struct MHD_Response *&response);
   static int CreateFileDownloadResponse(struct MHD_Connection *connection, const std::string &strURL, HTTPMethod methodType, struct MHD_Response *&response, int &responseCode);
+  static int ParseRangeHeader(const std::string &range, uint64_t length, uint64_t &first, uint64_t &last);
+  static bool MatchesETag(const std::string &header, const std::string &etag);
   static int CreateErrorResponse(struct MHD_Connection *connection, int responseType, HTTPMethod method, struct MHD_Response *&response);
   static int CreateMemoryDownloadResponse(struct MHD_Connection *connection, void *data, size_t size, bool free, bool copy, struct MHD_Response *&response);
 
@@ -114,5 +121,11 @@ private:
     IHTTPRequestHandler *requestHandler;
     struct MHD_PostProcessor *postprocessor;
   } ConnectionHandler;
+
+  typedef struct HttpFileDownloadContext
+  {
+    XFILE::CFile *file;
+    uint64_t rangeStart;
+  } HttpFileDownloadContext;
 };
 #endif
@@ -34,6 +34,7 @@
 #include "DllSwScale.h"
 #include "guilib/JpegIO.h"
 #include "guilib/Texture.h"
+#include "guilib/DDSImage.h"
 #if defined(HAS_OMXPLAYER)
 #include "cores/omxplayer/OMXImage.h"
 #endif
@@ -87,13 +88,13 @@ bool CThumbnailWriter::DoWork()
   return success;
 }
 
-bool CPicture::CacheTexture(CBaseTexture *texture, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest)
+bool CPicture::CacheTexture(CBaseTexture *texture, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest, bool createDDS)
 {
   return CacheTexture(texture->GetPixels(), texture->GetWidth(), texture->GetHeight(), texture->GetPitch(),
-                      texture->GetOrientation(), dest_width, dest_height, dest);
+                      texture->GetOrientation(), dest_width, dest_height, dest, createDDS);
 }
 
-bool CPicture::CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, int orientation, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest)
+bool CPicture::CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, int orientation, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest, bool createDDS)
 {
   // if no max width or height is specified, don't resize
   if (dest_width == 0)
@@ -132,6 +133,8 @@ bool CPicture::CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, ui
         if (!orientation || OrientateImage(buffer, dest_width, dest_height, orientation))
         {
           success = CreateThumbnailFromSurface((unsigned char*)buffer, dest_width, dest_height, dest_width * 4, dest);
+          if (success && createDDS)
+            CreateDDSFromSurface((unsigned char*)buffer, dest_width, dest_height, dest_width * 4, URIUtils::ReplaceExtension(dest, ".dds"));
         }
       }
       delete[] buffer;
@@ -142,11 +145,22 @@ bool CPicture::CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, ui
   { // no orientation needed
     dest_width = width;
     dest_height = height;
-    return CreateThumbnailFromSurface(pixels, width, height, pitch, dest);
+    if (!CreateThumbnailFromSurface(pixels, width, height, pitch, dest))
+      return false;
+    if (createDDS)
+      CreateDDSFromSurface(pixels, width, height, pitch, URIUtils::ReplaceExtension(dest, ".dds"));
+    return true;
   }
   return false;
 }
 
+bool CPicture::CreateDDSFromSurface(const unsigned char* buffer, int width, int height, int stride, const CStdString &ddsFile)
+{
+  CDDSImage dds;
+  CLog::Log(LOGDEBUG, "%s - creating %s", __FUNCTION__, ddsFile.c_str());
+  return dds.Create(ddsFile, width, height, stride, buffer, 40);
+}
+
 bool CPicture::CreateTiledThumb(const std::vector<std::string> &files, const std::string &thumb)
 {
   if (!files.size())
@@ -39,10 +39,22 @@ public:
    \param dest_width [in/out] maximum width in pixels of cached version - replaced with actual cached width
    \param dest_height [in/out] maximum height in pixels of cached version - replaced with actual cached height
    \param dest the output cache file
+   \param createDDS whether to also save a GPU ready .dds version alongside the cache file
    \return true if successful, false otherwise
    */
-  static bool CacheTexture(CBaseTexture *texture, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest);
-  static bool CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, int orientation, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest);
+  static bool CacheTexture(CBaseTexture *texture, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest, bool createDDS = false);
+  static bool CacheTexture(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, int orientation, uint32_t &dest_width, uint32_t &dest_height, const std::string &dest, bool createDDS = false);
+
+  /*! \brief Save an ARGB buffer as a DXT compressed .dds file, for loading straight to the GPU
+   Compression is done on the CPU, falling back to uncompressed ARGB if DXT is too lossy.
+   \param buffer the ARGB pixels
+   \param width width of the buffer
+   \param height height of the buffer
+   \param stride pitch of the buffer
+   \param ddsFile the filename of the .dds to create
+   \return true if successful, false otherwise
+   */
+  static bool CreateDDSFromSurface(const unsigned char* buffer, int width, int height, int stride, const CStdString &ddsFile);
 
 private:
   static void GetScale(unsigned int width, unsigned int height, unsigned int &out_width, unsigned int &out_height);
@@ -376,6 +376,7 @@ int CPVRDatabase::Get(CPVRChannelGroupInternal &results)
 #endif
         PVRChannelGroupMember newMember = { channel, (unsigned int)m_pDS->fv("iChannelNumber").get_asInt() };
         results.m_members.push_back(newMember);
+        results.IndexMember(channel);
 
         m_pDS->next();
         ++iReturn;
@@ -720,6 +721,7 @@ int CPVRDatabase::Get(CPVRChannelGroup &group)
 #endif
           PVRChannelGroupMember newMember = { channel, (unsigned int)iChannelNumber };
           group.m_members.push_back(newMember);
+          group.IndexMember(channel);
           iReturn++;
         }
         else
@@ -946,7 +948,10 @@ bool CPVRDatabase::Persist(CPVRChannel &channel, bool bQueueWrite /* = false */)
   {
     CSingleLock lock(channel.m_critSection);
     if (channel.m_iChannelId <= 0)
+    {
       channel.m_iChannelId = (int)m_pDS->lastinsertid();
+      channel.IdsChanged();
+    }
     bReturn = true;
   }
 
@@ -144,6 +144,9 @@ CPVRChannel &CPVRChannel::operator=(const CPVRChannel &channel)
 
   UpdateEncryptionName();
 
+  /* the groups indexing this channel stay, but its ids may be different now */
+  IdsChanged();
+
   return *this;
 }
 
@@ -251,6 +254,7 @@ bool CPVRChannel::SetChannelID(int iChannelId)
   {
     /* update the id */
     m_iChannelId = iChannelId;
+    IdsChanged();
     SetChanged();
     m_bChanged = true;
 
@@ -398,6 +402,7 @@ bool CPVRChannel::SetUniqueID(int iUniqueId)
   {
     /* update the unique ID */
     m_iUniqueId = iUniqueId;
+    IdsChanged();
     SetChanged();
     m_bChanged = true;
 
@@ -415,6 +420,7 @@ bool CPVRChannel::SetClientID(int iClientId)
   {
     /* update the client ID */
     m_iClientId = iClientId;
+    IdsChanged();
     SetChanged();
     m_bChanged = true;
 
@@ -851,10 +857,36 @@ int CPVRChannel::EpgID(void) const
   return m_iEpgId;
 }
 
+void CPVRChannel::IdsChanged(void)
+{
+  CSingleLock lock(m_critSection);
+  for (std::vector<CPVRChannelGroup *>::const_iterator it = m_indexingGroups.begin(); it != m_indexingGroups.end(); ++it)
+    (*it)->ChannelIdsChanged(this);
+}
+
+void CPVRChannel::AddIndexingGroup(CPVRChannelGroup *group)
+{
+  CSingleLock lock(m_critSection);
+  if (std::find(m_indexingGroups.begin(), m_indexingGroups.end(), group) == m_indexingGroups.end())
+    m_indexingGroups.push_back(group);
+}
+
+void CPVRChannel::RemoveIndexingGroup(CPVRChannelGroup *group)
+{
+  CSingleLock lock(m_critSection);
+  std::vector<CPVRChannelGroup *>::iterator it = std::find(m_indexingGroups.begin(), m_indexingGroups.end(), group);
+  if (it != m_indexingGroups.end())
+    m_indexingGroups.erase(it);
+}
+
 void CPVRChannel::SetEpgID(int iEpgId)
 {
   CSingleLock lock(m_critSection);
-  m_iEpgId = iEpgId;
+  if (m_iEpgId != iEpgId)
+  {
+    m_iEpgId = iEpgId;
+    IdsChanged();
+  }
   SetChanged();
 }
 
@@ -28,6 +28,7 @@
 #include "utils/ISerializable.h"
 
 #include <boost/shared_ptr.hpp>
+#include <vector>
 
 namespace EPG
 {
@@ -37,6 +38,7 @@ namespace EPG
 namespace PVR
 {
   class CPVRDatabase;
+  class CPVRChannelGroup;
   class CPVRChannelGroupInternal;
 
   class CPVRChannel;
@@ -46,6 +48,7 @@ namespace PVR
   class CPVRChannel : public Observable, public ISerializable
   {
     friend class CPVRDatabase;
+    friend class CPVRChannelGroup;
     friend class CPVRChannelGroupInternal;
 
   public:
@@ -454,12 +457,30 @@ namespace PVR
 
     bool CanRecord(void) const;
     //@}
+
   private:
     /*!
      * @brief Update the encryption name after SetEncryptionSystem() has been called.
      */
     void UpdateEncryptionName(void);
 
+    /*!
+     * @brief Tell the groups that index this channel that its channel id, unique id, client id or EPG id changed.
+     */
+    void IdsChanged(void);
+
+    /*!
+     * @brief Register a group that indexes this channel by its ids.
+     * @param group The group.
+     */
+    void AddIndexingGroup(CPVRChannelGroup *group);
+
+    /*!
+     * @brief Unregister a group that no longer indexes this channel.
+     * @param group The group.
+     */
+    void RemoveIndexingGroup(CPVRChannelGroup *group);
+
     /*! @name XBMC related channel data
      */
     //@{
@@ -499,6 +520,8 @@ namespace PVR
     CStdString       m_strClientEncryptionName; /*!< the name of the encryption system used by this channel */
     //@}
 
+    std::vector<CPVRChannelGroup *> m_indexingGroups; /*!< the groups that index this channel by its ids */
+
     CCriticalSection m_critSection;
   };
 }
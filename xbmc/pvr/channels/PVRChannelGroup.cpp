@@ -40,6 +40,7 @@
 
 using namespace PVR;
 using namespace EPG;
+using namespace std;
 
 CPVRChannelGroup::CPVRChannelGroup(void) :
     m_bRadio(false),
@@ -47,7 +48,8 @@ CPVRChannelGroup::CPVRChannelGroup(void) :
     m_iGroupId(-1),
     m_bLoaded(false),
     m_bChanged(false),
-    m_bUsingBackendChannelOrder(false)
+    m_bUsingBackendChannelOrder(false),
+    m_bIndexesBuilt(false)
 {
 }
 
@@ -58,7 +60,8 @@ CPVRChannelGroup::CPVRChannelGroup(bool bRadio, unsigned int iGroupId, const CSt
     m_strGroupName(strGroupName),
     m_bLoaded(false),
     m_bChanged(false),
-    m_bUsingBackendChannelOrder(false)
+    m_bUsingBackendChannelOrder(false),
+    m_bIndexesBuilt(false)
 {
 }
 
@@ -69,7 +72,8 @@ CPVRChannelGroup::CPVRChannelGroup(const PVR_CHANNEL_GROUP &group) :
     m_strGroupName(group.strGroupName),
     m_bLoaded(false),
     m_bChanged(false),
-    m_bUsingBackendChannelOrder(false)
+    m_bUsingBackendChannelOrder(false),
+    m_bIndexesBuilt(false)
 {
 }
 
@@ -102,6 +106,8 @@ CPVRChannelGroup::CPVRChannelGroup(const CPVRChannelGroup &group)
   m_bUsingBackendChannelOrder   = group.m_bUsingBackendChannelOrder;
   m_bUsingBackendChannelNumbers = group.m_bUsingBackendChannelNumbers;
 
+  m_bIndexesBuilt               = false;
+
   for (int iPtr = 0; iPtr < group.Size(); iPtr++)
     m_members.push_back(group.m_members.at(iPtr));
 }
@@ -137,6 +143,7 @@ void CPVRChannelGroup::Unload(void)
 {
   CSingleLock lock(m_critSection);
   g_guiSettings.UnregisterObserver(this);
+  ClearIndexes();
   m_members.clear();
 }
 
@@ -322,14 +329,11 @@ void CPVRChannelGroup::SortByChannelNumber(void)
 CPVRChannelPtr CPVRChannelGroup::GetByClient(int iUniqueChannelId, int iClientID) const
 {
   CSingleLock lock(m_critSection);
+  UpdateIndexes();
 
-  for (unsigned int ptr = 0; ptr < m_members.size(); ptr++)
-  {
-    PVRChannelGroupMember groupMember = m_members.at(ptr);
-    if (groupMember.channel->UniqueID() == iUniqueChannelId &&
-        groupMember.channel->ClientID() == iClientID)
-      return groupMember.channel;
-  }
+  multimap<pair<int, int>, CPVRChannelPtr>::const_iterator it = m_clientChannels.find(make_pair(iUniqueChannelId, iClientID));
+  if (it != m_clientChannels.end())
+    return it->second;
 
   CPVRChannelPtr empty;
   return empty;
@@ -338,13 +342,11 @@ CPVRChannelPtr CPVRChannelGroup::GetByClient(int iUniqueChannelId, int iClientID
 CPVRChannelPtr CPVRChannelGroup::GetByChannelID(int iChannelID) const
 {
   CSingleLock lock(m_critSection);
+  UpdateIndexes();
 
-  for (unsigned int ptr = 0; ptr < m_members.size(); ptr++)
-  {
-    PVRChannelGroupMember groupMember = m_members.at(ptr);
-    if (groupMember.channel->ChannelID() == iChannelID)
-      return groupMember.channel;
-  }
+  multimap<int, CPVRChannelPtr>::const_iterator it = m_channelIds.find(iChannelID);
+  if (it != m_channelIds.end())
+    return it->second;
 
   CPVRChannelPtr empty;
   return empty;
@@ -353,13 +355,11 @@ CPVRChannelPtr CPVRChannelGroup::GetByChannelID(int iChannelID) const
 CPVRChannelPtr CPVRChannelGroup::GetByChannelEpgID(int iEpgID) const
 {
   CSingleLock lock(m_critSection);
+  UpdateIndexes();
 
-  for (unsigned int ptr = 0; ptr < m_members.size(); ptr++)
-  {
-    PVRChannelGroupMember groupMember = m_members.at(ptr);
-    if (groupMember.channel->EpgID() == iEpgID)
-      return groupMember.channel;
-  }
+  multimap<int, CPVRChannelPtr>::const_iterator it = m_epgIds.find(iEpgID);
+  if (it != m_epgIds.end())
+    return it->second;
 
   CPVRChannelPtr empty;
   return empty;
@@ -368,13 +368,11 @@ CPVRChannelPtr CPVRChannelGroup::GetByChannelEpgID(int iEpgID) const
 CPVRChannelPtr CPVRChannelGroup::GetByUniqueID(int iUniqueID) const
 {
   CSingleLock lock(m_critSection);
+  UpdateIndexes();
 
-  for (unsigned int ptr = 0; ptr < m_members.size(); ptr++)
-  {
-    PVRChannelGroupMember groupMember = m_members.at(ptr);
-    if (groupMember.channel->UniqueID() == iUniqueID)
-      return groupMember.channel;
-  }
+  multimap<int, CPVRChannelPtr>::const_iterator it = m_uniqueIds.find(iUniqueID);
+  if (it != m_uniqueIds.end())
+    return it->second;
 
   CPVRChannelPtr empty;
   return empty;
@@ -639,6 +637,7 @@ bool CPVRChannelGroup::RemoveDeletedChannels(const CPVRChannelGroup &channels)
         channel->Delete();
       }
 
+      UnindexMember(channel.get());
       m_members.erase(m_members.begin() + iChannelPtr);
       m_bChanged = true;
       bReturn = true;
@@ -721,6 +720,7 @@ void CPVRChannelGroup::RemoveInvalidChannels(void)
       }
       else
       {
+        UnindexMember(channel.get());
         m_members.erase(m_members.begin() + ptr);
       }
       m_bChanged = true;
@@ -738,6 +738,7 @@ bool CPVRChannelGroup::RemoveFromGroup(const CPVRChannel &channel)
     if (channel == *m_members.at(iChannelPtr).channel)
     {
       // TODO notify observers
+      UnindexMember(m_members.at(iChannelPtr).channel.get());
       m_members.erase(m_members.begin() + iChannelPtr);
       bReturn = true;
       m_bChanged = true;
@@ -769,6 +770,7 @@ bool CPVRChannelGroup::AddToGroup(CPVRChannel &channel, int iChannelNumber /* =
     {
       PVRChannelGroupMember newMember = { realChannel, (unsigned int)iChannelNumber };
       m_members.push_back(newMember);
+      IndexMember(realChannel);
       m_bChanged = true;
 
       if (bSortAndRenumber)
@@ -784,36 +786,119 @@ bool CPVRChannelGroup::AddToGroup(CPVRChannel &channel, int iChannelNumber /* =
 
 bool CPVRChannelGroup::IsGroupMember(const CPVRChannel &channel) const
 {
-  bool bReturn(false);
-  CSingleLock lock(m_critSection);
+  CPVRChannelPtr member = GetByClient(channel.UniqueID(), channel.ClientID());
+  return member && *member == channel;
+}
 
-  for (unsigned int iChannelPtr = 0; iChannelPtr < m_members.size(); iChannelPtr++)
+bool CPVRChannelGroup::IsGroupMember(int iChannelId) const
+{
+  return GetByChannelID(iChannelId) != NULL;
+}
+
+/* erase the entry of the given channel under the given key, leaving other channels with the same key */
+template<class K>
+static void EraseIndexEntry(multimap<K, CPVRChannelPtr> &index, const K &key, const CPVRChannel *channel)
+{
+  pair<typename multimap<K, CPVRChannelPtr>::iterator, typename multimap<K, CPVRChannelPtr>::iterator> range = index.equal_range(key);
+  for (typename multimap<K, CPVRChannelPtr>::iterator it = range.first; it != range.second; ++it)
   {
-    if (channel == *m_members.at(iChannelPtr).channel)
+    if (it->second.get() == channel)
     {
-      bReturn = true;
-      break;
+      index.erase(it);
+      return;
     }
   }
+}
 
-  return bReturn;
+void CPVRChannelGroup::IndexMember(const CPVRChannelPtr &channel) const
+{
+  CSingleLock lock(m_critSection);
+  /* not built yet, the member is picked up when they are */
+  if (!m_bIndexesBuilt || !channel || m_indexed.find(channel.get()) != m_indexed.end())
+    return;
+
+  PVRChannelGroupIndexEntry entry;
+  entry.channel    = channel;
+  entry.iChannelId = channel->ChannelID();
+  entry.iUniqueId  = channel->UniqueID();
+  entry.iClientId  = channel->ClientID();
+  entry.iEpgId     = channel->EpgID();
+  m_indexed.insert(make_pair(channel.get(), entry));
+
+  m_channelIds.insert(make_pair(entry.iChannelId, channel));
+  m_uniqueIds.insert(make_pair(entry.iUniqueId, channel));
+  m_clientChannels.insert(make_pair(make_pair(entry.iUniqueId, entry.iClientId), channel));
+  m_epgIds.insert(make_pair(entry.iEpgId, channel));
+
+  channel->AddIndexingGroup(const_cast<CPVRChannelGroup *>(this));
 }
 
-bool CPVRChannelGroup::IsGroupMember(int iChannelId) const
+void CPVRChannelGroup::UnindexMember(const CPVRChannel *channel) const
 {
-  bool bReturn(false);
   CSingleLock lock(m_critSection);
+  map<const CPVRChannel *, PVRChannelGroupIndexEntry>::iterator it = m_indexed.find(channel);
+  if (it == m_indexed.end())
+    return;
 
-  for (unsigned int iChannelPtr = 0; iChannelPtr < m_members.size(); iChannelPtr++)
+  const PVRChannelGroupIndexEntry &entry = it->second;
+  EraseIndexEntry(m_channelIds, entry.iChannelId, channel);
+  EraseIndexEntry(m_uniqueIds, entry.iUniqueId, channel);
+  EraseIndexEntry(m_clientChannels, make_pair(entry.iUniqueId, entry.iClientId), channel);
+  EraseIndexEntry(m_epgIds, entry.iEpgId, channel);
+
+  entry.channel->RemoveIndexingGroup(const_cast<CPVRChannelGroup *>(this));
+  m_indexed.erase(it);
+}
+
+void CPVRChannelGroup::UpdateIndexes(void) const
+{
+  CSingleLock lock(m_critSection);
+  if (!m_bIndexesBuilt)
   {
-    if (iChannelId == m_members.at(iChannelPtr).channel->ChannelID())
-    {
-      bReturn = true;
-      break;
-    }
+    m_bIndexesBuilt = true;
+    for (vector<PVRChannelGroupMember>::const_iterator it = m_members.begin(); it != m_members.end(); ++it)
+      IndexMember(it->channel);
   }
 
-  return bReturn;
+  vector<const CPVRChannel *> changedIds;
+  {
+    CSingleLock changedLock(m_changedIdsSection);
+    changedIds.swap(m_changedIds);
+  }
+
+  /* index the channels again under their new ids */
+  for (vector<const CPVRChannel *>::const_iterator it = changedIds.begin(); it != changedIds.end(); ++it)
+  {
+    map<const CPVRChannel *, PVRChannelGroupIndexEntry>::const_iterator entry = m_indexed.find(*it);
+    if (entry == m_indexed.end())
+      continue;
+    CPVRChannelPtr channel = entry->second.channel;
+    UnindexMember(channel.get());
+    IndexMember(channel);
+  }
+}
+
+void CPVRChannelGroup::ClearIndexes(void)
+{
+  CSingleLock lock(m_critSection);
+  for (map<const CPVRChannel *, PVRChannelGroupIndexEntry>::iterator it = m_indexed.begin(); it != m_indexed.end(); ++it)
+    it->second.channel->RemoveIndexingGroup(this);
+
+  m_indexed.clear();
+  m_channelIds.clear();
+  m_uniqueIds.clear();
+  m_clientChannels.clear();
+  m_epgIds.clear();
+  m_bIndexesBuilt = false;
+
+  CSingleLock changedLock(m_changedIdsSection);
+  m_changedIds.clear();
+}
+
+void CPVRChannelGroup::ChannelIdsChanged(const CPVRChannel *channel)
+{
+  CSingleLock lock(m_changedIdsSection);
+  m_changedIds.push_back(channel);
 }
 
 bool CPVRChannelGroup::SetGroupName(const CStdString &strGroupName, bool bSaveInDb /* = false */)
@@ -25,6 +25,7 @@
 #include "utils/JobManager.h"
 
 #include <boost/shared_ptr.hpp>
+#include <map>
 
 namespace EPG
 {
@@ -63,6 +64,7 @@ namespace PVR
     friend class CPVRChannelGroupInternal;
     friend class CPVRChannelGroupsContainer;
     friend class CPVRDatabase;
+    friend class CPVRChannel;
 
   public:
     CPVRChannelGroup(void);
@@ -464,6 +466,37 @@ namespace PVR
      */
     CPVRChannelPtr GetByChannelID(int iChannelID) const;
 
+    /*!
+     * @brief Add a member to the lookup indexes. Must be called after adding a member.
+     * @param channel The channel of the member.
+     */
+    void IndexMember(const CPVRChannelPtr &channel) const;
+
+    /*!
+     * @brief Remove a member from the lookup indexes. Must be called before removing a member.
+     * @param channel The channel of the member.
+     */
+    void UnindexMember(const CPVRChannel *channel) const;
+
+    /*!
+     * @brief Build the lookup indexes if they haven't been built yet, and re-index the members whose ids changed since the last lookup.
+     */
+    void UpdateIndexes(void) const;
+
+    /*!
+     * @brief Drop the lookup indexes. They're built again on the next lookup.
+     */
+    void ClearIndexes(void);
+
+    /*!
+     * @brief Called by an indexed channel when its channel id, unique id, client id or EPG id changed.
+     *
+     * Only queues the channel to be re-indexed on the next lookup, so it can be called with the lock of the channel held.
+     *
+     * @param channel The channel.
+     */
+    void ChannelIdsChanged(const CPVRChannel *channel);
+
     bool             m_bRadio;                      /*!< true if this container holds radio channels, false if it holds TV channels */
     int              m_iGroupType;                  /*!< The type of this group */
     int              m_iGroupId;                    /*!< The ID of this group in the database */
@@ -475,6 +508,25 @@ namespace PVR
     bool             m_bSelectedGroup;              /*!< true when this is the selected group, false otherwise */
     std::vector<PVRChannelGroupMember> m_members;
     CCriticalSection m_critSection;
+
+    /* lookup indexes over m_members, built on the first lookup and then kept up to date member by member */
+    typedef struct
+    {
+      CPVRChannelPtr channel;
+      int            iChannelId;
+      int            iUniqueId;
+      int            iClientId;
+      int            iEpgId;
+    } PVRChannelGroupIndexEntry; /*!< a member and the ids it is indexed by */
+
+    mutable bool                                                  m_bIndexesBuilt;  /*!< false until the indexes are built */
+    mutable std::map<const CPVRChannel *, PVRChannelGroupIndexEntry> m_indexed;     /*!< the indexed members */
+    mutable std::multimap<int, CPVRChannelPtr>                    m_channelIds;     /*!< channel id -> channel */
+    mutable std::multimap<int, CPVRChannelPtr>                    m_uniqueIds;      /*!< unique id -> channel */
+    mutable std::multimap<std::pair<int, int>, CPVRChannelPtr>    m_clientChannels; /*!< (unique id, client id) -> channel */
+    mutable std::multimap<int, CPVRChannelPtr>                    m_epgIds;         /*!< EPG id -> channel */
+    mutable std::vector<const CPVRChannel *>                      m_changedIds;     /*!< indexed channels whose ids changed since the last lookup */
+    mutable CCriticalSection                                      m_changedIdsSection; /*!< protects m_changedIds only, no other lock is taken while holding it */
   };
 
   class CPVRPersistGroupJob : public CJob
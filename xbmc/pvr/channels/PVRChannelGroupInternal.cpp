@@ -96,6 +96,7 @@ void CPVRChannelGroupInternal::UpdateFromClient(const CPVRChannel &channel, unsi
   {
     PVRChannelGroupMember newMember = { CPVRChannelPtr(new CPVRChannel(channel)), iChannelNumber > 0l ? iChannelNumber : (int)m_members.size() + 1 };
     m_members.push_back(newMember);
+    IndexMember(newMember.channel);
     m_bChanged = true;
 
     SortAndRenumber();
@@ -281,6 +282,7 @@ bool CPVRChannelGroupInternal::UpdateChannel(const CPVRChannel &channel)
     updateChannel = CPVRChannelPtr(new CPVRChannel(channel.IsRadio()));
     PVRChannelGroupMember newMember = { updateChannel, 0 };
     m_members.push_back(newMember);
+    IndexMember(updateChannel);
     updateChannel->SetUniqueID(channel.UniqueID());
   }
   updateChannel->UpdateFromClient(channel);
@@ -356,6 +358,7 @@ void CPVRChannelGroupInternal::CreateChannelEpg(CPVRChannelPtr channel, bool bFo
       {
         channel->m_iEpgId = epg->EpgID();
         channel->m_bChanged = true;
+        channel->IdsChanged();
       }
     }
   }
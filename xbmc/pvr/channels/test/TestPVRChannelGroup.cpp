@@ -0,0 +1,153 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "pvr/channels/PVRChannelGroup.h"
+#include "threads/SystemClock.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+#define BENCHMARK_CHANNELS 5000
+#define BENCHMARK_LOOKUPS  1000000
+
+using namespace PVR;
+
+class TestChannelGroup : public CPVRChannelGroup
+{
+public:
+  TestChannelGroup() : CPVRChannelGroup(false, 100, "test") {}
+
+  CPVRChannelPtr AddChannel(int iChannelId, int iUniqueId, int iClientId, int iEpgId)
+  {
+    CPVRChannelPtr channel(new CPVRChannel(false));
+    channel->SetChannelID(iChannelId);
+    channel->SetUniqueID(iUniqueId);
+    channel->SetClientID(iClientId);
+    channel->SetEpgID(iEpgId);
+
+    PVRChannelGroupMember member = { channel, (unsigned int)m_members.size() + 1 };
+    m_members.push_back(member);
+    IndexMember(channel);
+    return channel;
+  }
+
+  void RemoveChannel(unsigned int iIndex)
+  {
+    UnindexMember(m_members.at(iIndex).channel.get());
+    m_members.erase(m_members.begin() + iIndex);
+  }
+
+  using CPVRChannelGroup::GetByChannelID;
+  using CPVRChannelGroup::GetByUniqueID;
+};
+
+TEST(TestPVRChannelGroup, Lookups)
+{
+  TestChannelGroup group;
+  CPVRChannelPtr first = group.AddChannel(1, 1001, 1, 11);
+  CPVRChannelPtr second = group.AddChannel(2, 1002, 1, 12);
+  CPVRChannelPtr third = group.AddChannel(3, 1001, 2, 13);
+
+  EXPECT_EQ(second, group.GetByChannelID(2));
+  EXPECT_EQ(third, group.GetByClient(1001, 2));
+  EXPECT_EQ(second, group.GetByChannelEpgID(12));
+  EXPECT_EQ(first, group.GetByUniqueID(1001));
+  EXPECT_TRUE(group.IsGroupMember(*third));
+  EXPECT_TRUE(group.IsGroupMember(3));
+
+  EXPECT_FALSE(group.GetByChannelID(4));
+  EXPECT_FALSE(group.GetByClient(1002, 2));
+  EXPECT_FALSE(group.GetByChannelEpgID(14));
+  EXPECT_FALSE(group.IsGroupMember(4));
+}
+
+TEST(TestPVRChannelGroup, IdChanges)
+{
+  TestChannelGroup group;
+  CPVRChannelPtr channel = group.AddChannel(-1, 1001, 1, -1);
+  EXPECT_EQ(channel, group.GetByChannelID(-1));
+
+  /* ids are assigned when channels are persisted or get an EPG */
+  channel->SetChannelID(5);
+  channel->SetEpgID(15);
+  EXPECT_EQ(channel, group.GetByChannelID(5));
+  EXPECT_EQ(channel, group.GetByChannelEpgID(15));
+  EXPECT_FALSE(group.GetByChannelID(-1));
+}
+
+TEST(TestPVRChannelGroup, RemovedMembers)
+{
+  TestChannelGroup group;
+  group.AddChannel(1, 1001, 1, 11);
+  CPVRChannelPtr channel = group.AddChannel(2, 1002, 1, 12);
+
+  group.RemoveChannel(1);
+  EXPECT_FALSE(group.GetByChannelID(2));
+  EXPECT_FALSE(group.GetByClient(1002, 1));
+  EXPECT_FALSE(group.IsGroupMember(*channel));
+}
+
+TEST(TestPVRChannelGroup, LookupBenchmark)
+{
+  TestChannelGroup group;
+  for (int iChannel = 1; iChannel <= BENCHMARK_CHANNELS; iChannel++)
+    group.AddChannel(iChannel, 1000 + iChannel, 1 + iChannel % 3, 10000 + iChannel);
+
+  unsigned int iFound(0);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int iLookup = 0; iLookup < BENCHMARK_LOOKUPS; iLookup++)
+  {
+    int iChannel = 1 + (iLookup * 7919) % BENCHMARK_CHANNELS;
+    if (group.GetByChannelID(iChannel) &&
+        group.GetByClient(1000 + iChannel, 1 + iChannel % 3) &&
+        group.GetByChannelEpgID(10000 + iChannel))
+      iFound++;
+  }
+  unsigned int iElapsed = XbmcThreads::SystemClockMillis() - iStart;
+
+  EXPECT_EQ((unsigned int)BENCHMARK_LOOKUPS, iFound);
+  std::cout << 3 * BENCHMARK_LOOKUPS << " lookups in " << BENCHMARK_CHANNELS <<
+    " channels took " << iElapsed << " ms" << std::endl;
+}
+
+TEST(TestPVRChannelGroup, ImportBenchmark)
+{
+  TestChannelGroup group;
+  group.GetByChannelID(0);
+
+  /* like a channel import: look up every channel before adding it, then persist it and create its EPG */
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int iChannel = 1; iChannel <= BENCHMARK_CHANNELS; iChannel++)
+  {
+    if (group.GetByClient(1000 + iChannel, 1 + iChannel % 3))
+      continue;
+    CPVRChannelPtr channel = group.AddChannel(-1, 1000 + iChannel, 1 + iChannel % 3, -1);
+    channel->SetChannelID(iChannel);
+    channel->SetEpgID(10000 + iChannel);
+  }
+  unsigned int iElapsed = XbmcThreads::SystemClockMillis() - iStart;
+
+  EXPECT_EQ(BENCHMARK_CHANNELS, group.Size());
+  EXPECT_TRUE(group.GetByChannelID(BENCHMARK_CHANNELS));
+  EXPECT_TRUE(group.GetByChannelEpgID(10000 + BENCHMARK_CHANNELS));
+  EXPECT_FALSE(group.GetByChannelID(-1));
+  std::cout << "importing " << BENCHMARK_CHANNELS << " channels took " << iElapsed << " ms" << std::endl;
+}
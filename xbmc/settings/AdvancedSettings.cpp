@@ -189,6 +189,9 @@ void CAdvancedSettings::Initialize()
   m_sambaclienttimeout = 10;
   m_sambadoscodepage = "";
   m_sambastatfiles = true;
+  m_sambafilecontexts = 4;
+
+  m_nfsrequests = 8;
 
   m_bHTTPDirectoryStatFilesize = false;
 
@@ -204,6 +207,8 @@ void CAdvancedSettings::Initialize()
   m_strMusicLibraryAlbumFormat = "";
   m_strMusicLibraryAlbumFormatRight = "";
   m_prioritiseAPEv2tags = false;
+  m_bMusicLibrarySkipEmbeddedArt = false;
+  m_bMusicLibraryFastUpdate = false;
   m_musicItemSeparator = " / ";
   m_videoItemSeparator = " / ";
 
@@ -239,6 +244,7 @@ void CAdvancedSettings::Initialize()
   m_iEpgRetryInterruptedUpdateInterval = 30; /* retry an interrupted epg update after 30 seconds */
   m_bEpgDisplayUpdatePopup = true; /* display a progress popup while updating EPG data from clients */
   m_bEpgDisplayIncrementalUpdatePopup = false; /* also display a progress popup while doing incremental EPG updates */
+  m_iEpgClientUpdateJobs = 2;      /* fetch the EPG of 2 channels of the same client at once */
 
   m_bEdlMergeShortCommBreaks = false;      // Off by default
   m_iEdlMaxCommBreakLength = 8 * 30 + 10;  // Just over 8 * 30 second commercial break.
@@ -630,6 +636,8 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetBoolean(pElement, "hideallitems", m_bMusicLibraryHideAllItems);
     XMLUtils::GetInt(pElement, "recentlyaddeditems", m_iMusicLibraryRecentlyAddedItems, 1, INT_MAX);
     XMLUtils::GetBoolean(pElement, "prioritiseapetags", m_prioritiseAPEv2tags);
+    XMLUtils::GetBoolean(pElement, "skipembeddedart", m_bMusicLibrarySkipEmbeddedArt);
+    XMLUtils::GetBoolean(pElement, "fastupdate", m_bMusicLibraryFastUpdate);
     XMLUtils::GetBoolean(pElement, "allitemsonbottom", m_bMusicLibraryAllItemsOnBottom);
     XMLUtils::GetBoolean(pElement, "albumssortbyartistthenyear", m_bMusicLibraryAlbumsSortByArtistThenYear);
     XMLUtils::GetString(pElement, "albumformat", m_strMusicLibraryAlbumFormat);
@@ -703,8 +711,13 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetString(pElement,  "doscodepage",   m_sambadoscodepage);
     XMLUtils::GetInt(pElement, "clienttimeout", m_sambaclienttimeout, 5, 100);
     XMLUtils::GetBoolean(pElement, "statfiles", m_sambastatfiles);
+    XMLUtils::GetInt(pElement, "filecontexts", m_sambafilecontexts, 0, 16);
   }
 
+  pElement = pRootElement->FirstChildElement("nfs");
+  if (pElement)
+    XMLUtils::GetInt(pElement, "requests", m_nfsrequests, 1, 64);
+
   pElement = pRootElement->FirstChildElement("httpdirectory");
   if (pElement)
     XMLUtils::GetBoolean(pElement, "statfilesize", m_bHTTPDirectoryStatFilesize);
@@ -798,6 +811,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetInt(pElement, "retryinterruptedupdateinterval", m_iEpgRetryInterruptedUpdateInterval);
     XMLUtils::GetBoolean(pElement, "displayupdatepopup", m_bEpgDisplayUpdatePopup);
     XMLUtils::GetBoolean(pElement, "displayincrementalupdatepopup", m_bEpgDisplayIncrementalUpdatePopup);
+    XMLUtils::GetInt(pElement, "clientupdatejobs", m_iEpgClientUpdateJobs, 1, 8);
   }
 
   // EDL commercial break handling
@@ -224,6 +224,9 @@ class CAdvancedSettings
     int m_sambaclienttimeout;
     CStdString m_sambadoscodepage;
     bool m_sambastatfiles;
+    int m_sambafilecontexts;
+
+    int m_nfsrequests; ///< number of READ or WRITE requests kept in flight per file
 
     bool m_bHTTPDirectoryStatFilesize;
 
@@ -239,6 +242,8 @@ class CAdvancedSettings
     CStdString m_strMusicLibraryAlbumFormat;
     CStdString m_strMusicLibraryAlbumFormatRight;
     bool m_prioritiseAPEv2tags;
+    bool m_bMusicLibrarySkipEmbeddedArt; ///< \brief only read the size of embedded art in FLAC files when the art isn't wanted
+    bool m_bMusicLibraryFastUpdate; ///< \brief skip folders whose modification time is unchanged when updating the library
     CStdString m_musicItemSeparator;
     CStdString m_videoItemSeparator;
     std::vector<CStdString> m_musicTagsFromFileFilters;
@@ -278,6 +283,7 @@ class CAdvancedSettings
     int m_iEpgRetryInterruptedUpdateInterval; // seconds
     bool m_bEpgDisplayUpdatePopup;
     bool m_bEpgDisplayIncrementalUpdatePopup;
+    int m_iEpgClientUpdateJobs;     // tables fetched from the same client at once
 
     // EDL Commercial Break
     bool m_bEdlMergeShortCommBreaks;
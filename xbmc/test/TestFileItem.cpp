@@ -21,6 +21,7 @@
 #include "FileItem.h"
 #include "URL.h"
 #include "settings/AdvancedSettings.h"
+#include "music/tags/MusicInfoTag.h"
 
 #include "gtest/gtest.h"
 
@@ -112,3 +113,55 @@ TEST(TestFileItem, GetBaseMoviePath)
     EXPECT_EQ(path, compare);
   }
 }
+
+class TestRecords : public IFileItemRecords
+{
+public:
+  TestRecords() : loads(0) {}
+
+  virtual void LoadRecord(unsigned int row, CFileItem &item) const
+  {
+    CStdString path;
+    path.Format("musicdb://4/%u.mp3", row);
+    item.SetPath(path);
+    item.SetLabel(path);
+    item.GetMusicInfoTag()->SetDatabaseId(row, "song");
+    item.SetProperty("row", (int)row);
+    loads++;
+  }
+
+  mutable int loads;
+};
+
+TEST(TestFileItem, RecordBacked)
+{
+  boost::shared_ptr<TestRecords> records(new TestRecords);
+  CFileItem item;
+  item.SetRecord(records, 7);
+  EXPECT_TRUE(item.IsRecordBacked());
+  EXPECT_EQ(0, records->loads);
+
+  // the label isn't filled in until something else loads the record
+  EXPECT_TRUE(item.GetLabel().IsEmpty());
+  EXPECT_EQ(0, records->loads);
+
+  EXPECT_TRUE(item.HasMusicInfoTag());
+  EXPECT_STREQ("musicdb://4/7.mp3", item.GetLabel().c_str());
+  EXPECT_EQ(7, item.GetMusicInfoTag()->GetDatabaseId());
+  EXPECT_STREQ("musicdb://4/7.mp3", item.GetPath().c_str());
+  EXPECT_EQ(7, item.GetProperty("row").asInteger());
+  EXPECT_EQ(1, records->loads);
+
+  // copies are filled in and no longer record backed
+  CFileItem copy(item);
+  EXPECT_FALSE(copy.IsRecordBacked());
+  EXPECT_EQ(7, copy.GetMusicInfoTag()->GetDatabaseId());
+  EXPECT_EQ(1, records->loads);
+
+  item.UnloadRecord();
+  EXPECT_FALSE(item.HasProperty("row"));
+  EXPECT_EQ(1, records->loads);
+  EXPECT_TRUE(item.HasMusicInfoTag());
+  EXPECT_EQ(7, item.GetProperty("row").asInteger());
+  EXPECT_EQ(2, records->loads);
+}
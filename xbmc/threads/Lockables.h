@@ -21,9 +21,49 @@
 #pragma once
 
 #include "threads/Helpers.h"
+#ifdef _DEBUG
+#include "threads/SystemClock.h"
+#endif
 
 namespace XbmcThreads
 {
+  /**
+   * How often and how long threads had to wait for a lock. Only kept in
+   *  debug builds, where it helps finding the locks that threads queue up on.
+   *  The numbers are updated by the thread that just got the lock, so they
+   *  are only exact when read while holding it.
+   */
+  struct LockContention
+  {
+    unsigned int waits;       // number of times the lock was busy
+    unsigned int waitedMs;    // total time spent waiting for it
+    unsigned int maxWaitMs;   // longest single wait
+
+    inline LockContention() : waits(0), waitedMs(0), maxWaitMs(0) {}
+  };
+
+  /**
+   * Take a lock, recording the wait if it's busy. Without profiling this is
+   *  simply mutex.lock(), an uncontended native lock doesn't leave user space
+   *  so there is nothing to gain from trying first.
+   */
+  template<class L> inline void lockProfiled(L& mutex, LockContention& contention)
+  {
+#ifdef _DEBUG
+    if (!mutex.try_lock())
+    {
+      unsigned int start = SystemClockMillis();
+      mutex.lock();
+      unsigned int waited = SystemClockMillis() - start;
+      contention.waits++;
+      contention.waitedMs += waited;
+      if (waited > contention.maxWaitMs)
+        contention.maxWaitMs = waited;
+    }
+#else
+    mutex.lock();
+#endif
+  }
 
   /**
    * This template will take any implementation of the "Lockable" concept
@@ -51,12 +91,13 @@ namespace XbmcThreads
   protected:
     L mutex;
     unsigned int count;
+    LockContention contention;
 
   public:
     inline CountingLockable() : count(0) {}
 
     // boost::thread Lockable concept
-    inline void lock() { mutex.lock(); count++; }
+    inline void lock() { lockProfiled(mutex, contention); count++; }
     inline bool try_lock() { return mutex.try_lock() ? count++, true : false; }
     inline void unlock() { count--; mutex.unlock(); }
 
@@ -101,6 +142,30 @@ namespace XbmcThreads
      *  to call this method.
      */
     inline L& get_underlying() { return mutex; }
+
+    /**
+     * Waits for this lock so far, only counted in debug builds.
+     */
+    inline const LockContention& get_contention() const { return contention; }
+  };
+
+  /**
+   * This template will take any implementation of the "Lockable" concept
+   * and profile it like a CountingLockable, without the recursion support.
+   * Use it for non-recursive mutexes.
+   */
+  template<class L> class ProfiledLockable : public NonCopyable
+  {
+  protected:
+    L mutex;
+    LockContention contention;
+
+  public:
+    inline void lock() { lockProfiled(mutex, contention); }
+    inline bool try_lock() { return mutex.try_lock(); }
+    inline void unlock() { mutex.unlock(); }
+
+    inline const LockContention& get_contention() const { return contention; }
   };
 
 
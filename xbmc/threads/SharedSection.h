@@ -26,25 +26,53 @@
 
 /**
  * A CSharedSection is a mutex that satisfies the Shared Lockable concept (see Lockables.h).
+ *
+ * It is also "upgradable": one thread at a time can hold it shared with the
+ *  right to upgrade to exclusive (see CUpgradableLock), so structures that are
+ *  mostly looked up and only sometimes changed don't need to lock out all
+ *  readers just to find out whether they have to change anything.
  */
 class CSharedSection
 {
   CCriticalSection sec;
+  CCriticalSection upgradeSec; // held by the upgradable and the exclusive owner
   XbmcThreads::ConditionVariable actualCv;
   XbmcThreads::TightConditionVariable<XbmcThreads::InversePredicate<unsigned int&> > cond;
 
   unsigned int sharedCount;
 
+  inline void waitForReaders(CSingleLock& l) { if (sharedCount) cond.wait(l); sec.lock(); }
+
 public:
   inline CSharedSection() : cond(actualCv,XbmcThreads::InversePredicate<unsigned int&>(sharedCount)), sharedCount(0)  {}
 
-  inline void lock() { CSingleLock l(sec); if (sharedCount) cond.wait(l); sec.lock(); }
-  inline bool try_lock() { return (sec.try_lock() ? ((sharedCount == 0) ? true : (sec.unlock(), false)) : false); }
-  inline void unlock() { sec.unlock(); }
+  inline void lock() { upgradeSec.lock(); CSingleLock l(sec); waitForReaders(l); }
+  inline bool try_lock() { return upgradeSec.try_lock() ? (sec.try_lock() ? ((sharedCount == 0) ? true : (sec.unlock(), upgradeSec.unlock(), false)) : (upgradeSec.unlock(), false)) : false; }
+  inline void unlock() { sec.unlock(); upgradeSec.unlock(); }
 
   inline void lock_shared() { CSingleLock l(sec); sharedCount++; }
   inline bool try_lock_shared() { return (sec.try_lock() ? sharedCount++, sec.unlock(), true : false); }
   inline void unlock_shared() { CSingleLock l(sec); sharedCount--; if (!sharedCount) { cond.notifyAll(); } }
+
+  /**
+   * Upgradable ownership is shared ownership that excludes other upgradable
+   *  and exclusive owners, so that it can be turned into exclusive ownership
+   *  without anybody else changing things in between.
+   */
+  inline void lock_upgrade() { upgradeSec.lock(); lock_shared(); }
+  inline void unlock_upgrade() { unlock_shared(); upgradeSec.unlock(); }
+
+  /**
+   * Turn upgradable ownership into exclusive ownership, waiting for the other
+   *  readers to leave. unlock() releases it, or downgrade() goes back to upgradable.
+   */
+  inline void upgrade() { CSingleLock l(sec); sharedCount--; waitForReaders(l); }
+  inline void downgrade() { { CSingleLock l(sec); sharedCount++; } sec.unlock(); }
+
+  /**
+   * Waits for the section while it was held exclusive, only counted in debug builds.
+   */
+  inline const XbmcThreads::LockContention& get_contention() const { return sec.get_contention(); }
 };
 
 class CSharedLock : public XbmcThreads::SharedLock<CSharedSection>
@@ -69,3 +97,35 @@ public:
   inline void Enter() { lock(); }
 };
 
+/**
+ * Guard holding a CSharedSection upgradable, see CSharedSection::lock_upgrade().
+ *
+ * Like a CExclusiveLock it must not be taken by a thread that already holds
+ *  the section shared.
+ */
+class CUpgradableLock : public XbmcThreads::NonCopyable
+{
+  CSharedSection& sec;
+  bool owns;
+  bool upgraded;
+public:
+  inline CUpgradableLock(CSharedSection& cs) : sec(cs), owns(true), upgraded(false) { sec.lock_upgrade(); }
+  inline CUpgradableLock(const CSharedSection& cs) : sec((CSharedSection&)cs), owns(true), upgraded(false) { sec.lock_upgrade(); }
+  inline ~CUpgradableLock() { Leave(); }
+
+  inline bool IsOwner() const { return owns; }
+  inline bool IsUpgraded() const { return upgraded; }
+
+  inline void Upgrade() { if (owns && !upgraded) { sec.upgrade(); upgraded = true; } }
+  inline void Downgrade() { if (upgraded) { sec.downgrade(); upgraded = false; } }
+
+  inline void Enter() { if (!owns) { sec.lock_upgrade(); owns = true; } }
+  inline void Leave()
+  {
+    if (upgraded)
+      sec.unlock();
+    else if (owns)
+      sec.unlock_upgrade();
+    owns = upgraded = false;
+  }
+};
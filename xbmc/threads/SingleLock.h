@@ -43,6 +43,20 @@ protected:
   inline CSingleLock(CCriticalSection& cs, bool dicrim) : XbmcThreads::UniqueLock<CCriticalSection>(cs,true) {}
 };
 
+/**
+ * This implements a "guard" pattern for a CMutex. Unlike a CSingleLock it
+ *  can't be nested on the same mutex.
+ */
+class CMutexLock : public XbmcThreads::UniqueLock<CMutex>
+{
+public:
+  inline CMutexLock(CMutex& m) : XbmcThreads::UniqueLock<CMutex>(m) {}
+  inline CMutexLock(const CMutex& m) : XbmcThreads::UniqueLock<CMutex> ((CMutex&)m) {}
+
+  inline void Leave() { unlock(); }
+  inline void Enter() { lock(); }
+};
+
 /**
  * This implements a "guard" pattern for a CCriticalSection that
  *  works like a CSingleLock but only "try"s the lock and so
@@ -52,6 +52,26 @@ namespace XbmcThreads
         
       inline bool try_lock() { return (pthread_mutex_trylock(&mutex) == 0); }
     };
+
+    /**
+     * A plain, non-recursive mutex. Where available it spins briefly before
+     *  sleeping, which suits the short critical sections it's meant for.
+     */
+    class Mutex
+    {
+      pthread_mutexattr_t* getFastAttr();
+      pthread_mutex_t mutex;
+    public:
+      inline Mutex() { pthread_mutex_init(&mutex,getFastAttr()); }
+
+      inline ~Mutex() { pthread_mutex_destroy(&mutex); }
+
+      inline void lock() { pthread_mutex_lock(&mutex); }
+
+      inline void unlock() { pthread_mutex_unlock(&mutex); }
+
+      inline bool try_lock() { return (pthread_mutex_trylock(&mutex) == 0); }
+    };
   }
 }
 
@@ -65,3 +85,8 @@ namespace XbmcThreads
  */
 class CCriticalSection : public XbmcThreads::CountingLockable<XbmcThreads::pthreads::RecursiveMutex> {};
 
+/**
+ * A CMutex is a non-recursive native mutex for hot paths, see CMutexLock.
+ *  Taking it again from the thread holding it deadlocks.
+ */
+class CMutex : public XbmcThreads::ProfiledLockable<XbmcThreads::pthreads::Mutex> {};
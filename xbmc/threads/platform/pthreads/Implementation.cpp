@@ -51,6 +51,31 @@ namespace XbmcThreads
         recursiveAttrSet = setRecursiveAttr();
       return &recursiveAttr;
     }
+
+    static pthread_mutexattr_t fastAttr;
+
+    static bool setFastAttr()
+    {
+      static bool alreadyCalled = false;
+      if (!alreadyCalled)
+      {
+        pthread_mutexattr_init(&fastAttr);
+#ifdef PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP
+        pthread_mutexattr_settype(&fastAttr,PTHREAD_MUTEX_ADAPTIVE_NP);
+#endif
+        alreadyCalled = true;
+      }
+      return true; // note, we never call destroy.
+    }
+
+    static bool fastAttrSet = setFastAttr();
+
+    pthread_mutexattr_t* Mutex::getFastAttr()
+    {
+      if (!fastAttrSet) // this is only possible in the single threaded startup code
+        fastAttrSet = setFastAttr();
+      return &fastAttr;
+    }
     // ==========================================================
   }
 }
@@ -69,6 +69,41 @@ namespace XbmcThreads
         return TryEnterCriticalSection(&mutex) ? true : false;
       }
     };
+
+    /**
+     * Critical sections are always recursive on windows, this one spins
+     *  briefly before sleeping, which suits the short critical sections
+     *  CMutex is meant for.
+     */
+    class Mutex
+    {
+      CRITICAL_SECTION mutex;
+    public:
+      inline Mutex()
+      {
+        InitializeCriticalSectionAndSpinCount(&mutex, 4000);
+      }
+
+      inline ~Mutex()
+      {
+        DeleteCriticalSection(&mutex);
+      }
+
+      inline void lock()
+      {
+        EnterCriticalSection(&mutex);
+      }
+
+      inline void unlock()
+      {
+        LeaveCriticalSection(&mutex);
+      }
+
+      inline bool try_lock()
+      {
+        return TryEnterCriticalSection(&mutex) ? true : false;
+      }
+    };
   }
 }
 
@@ -82,3 +117,8 @@ namespace XbmcThreads
  */
 class CCriticalSection : public XbmcThreads::CountingLockable<XbmcThreads::windows::RecursiveMutex> {};
 
+/**
+ * A CMutex is a non-recursive native mutex for hot paths, see CMutexLock.
+ *  Taking it again from the thread holding it is not allowed.
+ */
+class CMutex : public XbmcThreads::ProfiledLockable<XbmcThreads::windows::Mutex> {};
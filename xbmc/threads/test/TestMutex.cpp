@@ -0,0 +1,126 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "threads/SharedSection.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "threads/test/TestHelpers.h"
+
+#include <iostream>
+
+#define BENCHMARK_THREADS 4
+#define BENCHMARK_LOCKS   1000000
+
+//=============================================================================
+// Helper classes
+//=============================================================================
+
+template<class S, class L>
+class counter : public IRunnable
+{
+  S& sec;
+  volatile long* mutex;
+  int iterations;
+public:
+  volatile long count;
+
+  inline counter(S& o, volatile long* mutex_, int iterations_) :
+    sec(o), mutex(mutex_), iterations(iterations_), count(0) {}
+
+  void Run()
+  {
+    AtomicGuard g(mutex);
+    for (int i = 0; i < iterations; i++)
+    {
+      L lock(sec);
+      count++;
+    }
+  }
+};
+
+template<class S, class L> static unsigned int timeLocking(S& sec)
+{
+  volatile long mutex = 0;
+  counter<S, L>* counters[BENCHMARK_THREADS];
+  thread threads[BENCHMARK_THREADS];
+
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int i = 0; i < BENCHMARK_THREADS; i++)
+  {
+    counters[i] = new counter<S, L>(sec, &mutex, BENCHMARK_LOCKS / BENCHMARK_THREADS);
+    threads[i] = thread(*counters[i]);
+  }
+  for (int i = 0; i < BENCHMARK_THREADS; i++)
+    threads[i].join();
+  unsigned int iElapsed = XbmcThreads::SystemClockMillis() - iStart;
+
+  for (int i = 0; i < BENCHMARK_THREADS; i++)
+  {
+    EXPECT_EQ(BENCHMARK_LOCKS / BENCHMARK_THREADS, counters[i]->count);
+    delete counters[i];
+  }
+  return iElapsed;
+}
+
+//=============================================================================
+
+TEST(TestMutex, General)
+{
+  CMutex sec;
+
+  CMutexLock l1(sec);
+  EXPECT_TRUE(l1.owns_lock());
+  l1.Leave();
+  EXPECT_FALSE(l1.owns_lock());
+  EXPECT_TRUE(sec.try_lock());
+  sec.unlock();
+}
+
+TEST(TestMutex, Exclusion)
+{
+  volatile long mutex = 0;
+  CMutex sec;
+  counter<CMutex, CMutexLock> c(sec, &mutex, 1);
+
+  CMutexLock l1(sec);
+  thread waitThread(c);
+  EXPECT_TRUE(waitForThread(mutex,1,10000));
+  SleepMillis(10);
+  EXPECT_EQ(0, c.count);
+
+  l1.Leave();
+  EXPECT_TRUE(waitThread.timed_join(MILLIS(10000)));
+  EXPECT_EQ(1, c.count);
+}
+
+TEST(TestMutex, Benchmark)
+{
+  CCriticalSection critSection;
+  CMutex mutex;
+  CSharedSection sharedSection;
+
+  unsigned int iCritSection = timeLocking<CCriticalSection, CSingleLock>(critSection);
+  unsigned int iMutex = timeLocking<CMutex, CMutexLock>(mutex);
+  unsigned int iShared = timeLocking<CSharedSection, CSharedLock>(sharedSection);
+
+  std::cout << BENCHMARK_LOCKS << " locks from " << BENCHMARK_THREADS << " threads took " <<
+    iCritSection << " ms with CCriticalSection, " << iMutex << " ms with CMutex, " <<
+    iShared << " ms with CSharedSection (shared)" << std::endl;
+}
@@ -59,6 +59,31 @@ public:
   }
 };
 
+class upgrader : public IRunnable
+{
+  CSharedSection& sec;
+  CEvent* wait;
+  volatile long* mutex;
+public:
+  volatile bool haslock;
+  volatile bool upgraded;
+
+  inline upgrader(CSharedSection& o, volatile long* mutex_, CEvent* wait_ = NULL) :
+    sec(o), wait(wait_), mutex(mutex_), haslock(false), upgraded(false) {}
+
+  void Run()
+  {
+    AtomicGuard g(mutex);
+    CUpgradableLock lock(sec);
+    haslock = true;
+    if (wait)
+      wait->Wait();
+    lock.Upgrade();
+    upgraded = true;
+    haslock = false;
+  }
+};
+
 TEST(TestCritSection, General)
 {
   CCriticalSection sec;
@@ -222,3 +247,48 @@ TEST(TestMultipleSharedSection, General)
   }
 }
 
+TEST(TestSharedSection, UpgradableWithReaders)
+{
+  CSharedSection sec;
+
+  CUpgradableLock l1(sec);
+  CSharedLock l2(sec);     // readers may join the upgradable owner ...
+  EXPECT_FALSE(sec.try_lock()); // ... but writers may not
+
+  l2.Leave();
+  l1.Upgrade();
+  EXPECT_TRUE(l1.IsUpgraded());
+
+  l1.Downgrade();
+  EXPECT_FALSE(l1.IsUpgraded());
+  CSharedLock l3(sec);
+}
+
+TEST(TestSharedSection, UpgradeWaitsForReaders)
+{
+  volatile long mutex = 0;
+  CEvent event;
+
+  CSharedSection sec;
+
+  CSharedLock l1(sec); // get a shared lock
+
+  upgrader l2(sec,&mutex,&event);
+  thread waitThread(l2);
+  EXPECT_TRUE(waitForThread(mutex,1,10000));
+  SleepMillis(10);
+  EXPECT_TRUE(l2.haslock);  // upgradable ownership goes along with readers
+
+  event.Set();
+  SleepMillis(10);
+  EXPECT_FALSE(l2.upgraded);  // but the upgrade waits for them
+
+  l1.Leave();
+  EXPECT_TRUE(waitThread.timed_join(MILLIS(10000)));
+  EXPECT_TRUE(l2.upgraded);
+  EXPECT_FALSE(l2.haslock);
+
+  // and everything was released again
+  EXPECT_TRUE(sec.try_lock());
+  sec.unlock();
+}
@@ -22,31 +22,55 @@
 #include "filesystem/File.h"
 #include "Variant.h"
 
+#include <algorithm>
+
 using namespace XFILE;
 
-#define BUFFER_MAX 4096
+#define BUFFER_MAX 65536
+
+// longer strings (paths, plots) are rarely repeated and would only bloat the table
+#define STRING_TABLE_MAX_LENGTH 256
 
 CArchive::CArchive(CFile* pFile, int mode)
+{
+  Initialize(pFile, mode, BUFFER_MAX);
+}
+
+CArchive::CArchive(CFile* pFile, int mode, int readAhead)
+{
+  Initialize(pFile, mode, std::min(std::max(readAhead, 1), BUFFER_MAX));
+}
+
+void CArchive::Initialize(CFile* pFile, int mode, int readAhead)
 {
   m_pFile = pFile;
   m_iMode = mode;
+  m_readAhead = readAhead;
 
   m_pBuffer = new BYTE[BUFFER_MAX];
   memset(m_pBuffer, 0, BUFFER_MAX);
 
   m_BufferPos = 0;
+  m_BufferLength = 0;
+  m_stringTable = false;
 }
 
 CArchive::~CArchive()
 {
-  FlushBuffer();
+  Close();
   delete[] m_pBuffer;
   m_BufferPos = 0;
 }
 
 void CArchive::Close()
 {
-  FlushBuffer();
+  if (m_iMode == store)
+    FlushBuffer();
+  else if (m_BufferPos < m_BufferLength)
+  { // hand back what was read ahead, the caller may continue reading the file
+    m_pFile->Seek(m_BufferPos - m_BufferLength, SEEK_CUR);
+    m_BufferPos = m_BufferLength = 0;
+  }
 }
 
 bool CArchive::IsLoading()
@@ -59,6 +83,11 @@ bool CArchive::IsStoring()
   return (m_iMode == store);
 }
 
+void CArchive::EnableStringTable()
+{
+  m_stringTable = true;
+}
+
 CArchive& CArchive::operator<<(float f)
 {
   int size = sizeof(float);
@@ -157,48 +186,14 @@ CArchive& CArchive::operator<<(char c)
 
 CArchive& CArchive::operator<<(const std::string& str)
 {
-  *this << (int)str.size();
-
-  int size = str.size();
-  if (m_BufferPos + size >= BUFFER_MAX)
-    FlushBuffer();
-
-  int iBufferMaxParts=size/BUFFER_MAX;
-  for (int i=0; i<iBufferMaxParts; i++)
-  {
-    memcpy(&m_pBuffer[m_BufferPos], str.c_str()+(i*BUFFER_MAX), BUFFER_MAX);
-    m_BufferPos+=BUFFER_MAX;
-    FlushBuffer();
-  }
-
-  int iPos=iBufferMaxParts*BUFFER_MAX;
-  int iSizeLeft=size-iPos;
-  memcpy(&m_pBuffer[m_BufferPos], str.c_str()+iPos, iSizeLeft);
-  m_BufferPos+=iSizeLeft;
+  StoreString(str.c_str(), str.size());
 
   return *this;
 }
 
 CArchive& CArchive::operator<<(const CStdString& str)
 {
-  *this << str.GetLength();
-
-  int size = str.GetLength();
-  if (m_BufferPos + size >= BUFFER_MAX)
-    FlushBuffer();
-
-  int iBufferMaxParts=size/BUFFER_MAX;
-  for (int i=0; i<iBufferMaxParts; i++)
-  {
-    memcpy(&m_pBuffer[m_BufferPos], str.c_str()+(i*BUFFER_MAX), BUFFER_MAX);
-    m_BufferPos+=BUFFER_MAX;
-    FlushBuffer();
-  }
-
-  int iPos=iBufferMaxParts*BUFFER_MAX;
-  int iSizeLeft=size-iPos;
-  memcpy(&m_pBuffer[m_BufferPos], str.c_str()+iPos, iSizeLeft);
-  m_BufferPos+=iSizeLeft;
+  StoreString(str.c_str(), str.GetLength());
 
   return *this;
 }
@@ -308,81 +303,70 @@ CArchive& CArchive::operator<<(const std::vector<int>& iArray)
 
 CArchive& CArchive::operator>>(float& f)
 {
-  m_pFile->Read((void*)&f, sizeof(float));
+  ReadBuffer(&f, sizeof(float));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(double& d)
 {
-  m_pFile->Read((void*)&d, sizeof(double));
+  ReadBuffer(&d, sizeof(double));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(int& i)
 {
-  m_pFile->Read((void*)&i, sizeof(int));
+  ReadBuffer(&i, sizeof(int));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(unsigned int& i)
 {
-  m_pFile->Read((void*)&i, sizeof(unsigned int));
+  ReadBuffer(&i, sizeof(unsigned int));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(int64_t& i64)
 {
-  m_pFile->Read((void*)&i64, sizeof(int64_t));
+  ReadBuffer(&i64, sizeof(int64_t));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(uint64_t& ui64)
 {
-  m_pFile->Read((void*)&ui64, sizeof(uint64_t));
+  ReadBuffer(&ui64, sizeof(uint64_t));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(bool& b)
 {
-  m_pFile->Read((void*)&b, sizeof(bool));
+  ReadBuffer(&b, sizeof(bool));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(char& c)
 {
-  m_pFile->Read((void*)&c, sizeof(char));
+  ReadBuffer(&c, sizeof(char));
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(std::string& str)
 {
-  int iLength = 0;
-  *this >> iLength;
-
-  char *s = new char[iLength];
-  m_pFile->Read(s, iLength);
-  str.assign(s, iLength);
-  delete[] s;
+  LoadString(str);
 
   return *this;
 }
 
 CArchive& CArchive::operator>>(CStdString& str)
 {
-  int iLength = 0;
-  *this >> iLength;
-
-  m_pFile->Read((void*)str.GetBufferSetLength(iLength), iLength);
-  str.ReleaseBuffer();
-
+  LoadString(str);
 
   return *this;
 }
@@ -392,7 +376,7 @@ CArchive& CArchive::operator>>(CStdStringW& str)
   int iLength = 0;
   *this >> iLength;
 
-  m_pFile->Read((void*)str.GetBufferSetLength(iLength), iLength * sizeof(wchar_t));
+  ReadBuffer((void*)str.GetBufferSetLength(iLength), iLength * sizeof(wchar_t));
   str.ReleaseBuffer();
 
 
@@ -401,7 +385,7 @@ CArchive& CArchive::operator>>(CStdStringW& str)
 
 CArchive& CArchive::operator>>(SYSTEMTIME& time)
 {
-  m_pFile->Read((void*)&time, sizeof(SYSTEMTIME));
+  ReadBuffer(&time, sizeof(SYSTEMTIME));
 
   return *this;
 }
@@ -529,3 +513,94 @@ void CArchive::FlushBuffer()
     m_BufferPos = 0;
   }
 }
+
+bool CArchive::ReadBuffer(void* data, int size)
+{
+  uint8_t *dest = (uint8_t *)data;
+  while (size > 0)
+  {
+    if (m_BufferPos >= m_BufferLength)
+    {
+      m_BufferPos = m_BufferLength = 0;
+      if (size >= m_readAhead)
+        return (int)m_pFile->Read(dest, size) == size; // no point going through the buffer
+
+      m_BufferLength = (int)m_pFile->Read(m_pBuffer, m_readAhead);
+      if (m_BufferLength <= 0)
+      {
+        m_BufferLength = 0;
+        return false;
+      }
+    }
+
+    int chunk = std::min(size, m_BufferLength - m_BufferPos);
+    memcpy(dest, &m_pBuffer[m_BufferPos], chunk);
+    m_BufferPos += chunk;
+    dest += chunk;
+    size -= chunk;
+  }
+  return true;
+}
+
+void CArchive::StoreString(const char* str, int length)
+{
+  if (m_stringTable && length > 0 && length <= STRING_TABLE_MAX_LENGTH)
+  {
+    std::pair<std::map<std::string, int>::iterator, bool> stored =
+      m_storedStrings.insert(std::make_pair(std::string(str, length), (int)m_storedStrings.size()));
+    if (!stored.second)
+    { // stored before, a negative length refers back to it
+      *this << -(stored.first->second + 1);
+      return;
+    }
+  }
+
+  *this << length;
+
+  if (m_BufferPos + length >= BUFFER_MAX)
+    FlushBuffer();
+
+  int iBufferMaxParts=length/BUFFER_MAX;
+  for (int i=0; i<iBufferMaxParts; i++)
+  {
+    memcpy(&m_pBuffer[m_BufferPos], str+(i*BUFFER_MAX), BUFFER_MAX);
+    m_BufferPos+=BUFFER_MAX;
+    FlushBuffer();
+  }
+
+  int iPos=iBufferMaxParts*BUFFER_MAX;
+  int iSizeLeft=length-iPos;
+  memcpy(&m_pBuffer[m_BufferPos], str+iPos, iSizeLeft);
+  m_BufferPos+=iSizeLeft;
+}
+
+void CArchive::LoadString(std::string& str)
+{
+  int iLength = 0;
+  *this >> iLength;
+
+  if (iLength < 0)
+  {
+    unsigned int index = -(iLength + 1);
+    if (m_stringTable && index < m_loadedStrings.size())
+      str = m_loadedStrings[index];
+    else
+      str.clear();
+    return;
+  }
+
+  if (iLength <= m_BufferLength - m_BufferPos)
+  { // straight out of the buffer
+    str.assign((const char *)&m_pBuffer[m_BufferPos], iLength);
+    m_BufferPos += iLength;
+  }
+  else
+  {
+    str.resize(iLength);
+    if (!ReadBuffer(&str[0], iLength))
+      str.clear();
+  }
+
+  if (m_stringTable && iLength > 0 && iLength <= STRING_TABLE_MAX_LENGTH)
+    m_loadedStrings.push_back(str);
+}
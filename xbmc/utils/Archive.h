@@ -20,6 +20,9 @@
  *
  */
 
+#include <map>
+#include <string>
+#include <vector>
 #include "StdString.h"
 #include "system.h" // for SYSTEMTIME
 
@@ -82,15 +85,41 @@ public:
   bool IsLoading();
   bool IsStoring();
 
+  /*! \brief Store repeated strings only once
+   From here on every string is stored in full the first time only and later
+   occurrences refer back to it.  Saves space and time for archives with many
+   items sharing genres, artists, mimetypes and the like.  Must be enabled at the
+   same point when loading as it was when storing, so archives using it should
+   start with a version number.
+   */
+  void EnableStringTable();
+
   void Close();
 
   enum Mode {load = 0, store};
 
 protected:
+  /*! \brief Create an archive that reads ahead at most readAhead bytes when loading
+   A read ahead of 1 reads every field from the file on its own, the way loading
+   used to work.  Only meant for comparing against it.
+   */
+  CArchive(XFILE::CFile* pFile, int mode, int readAhead);
+
+  void Initialize(XFILE::CFile* pFile, int mode, int readAhead);
   void FlushBuffer();
+  bool ReadBuffer(void* data, int size);
+  void StoreString(const char* str, int length);
+  void LoadString(std::string& str);
+
   XFILE::CFile* m_pFile;
   int m_iMode;
   uint8_t *m_pBuffer;
   int m_BufferPos;
+  int m_BufferLength;                          ///< bytes read into the buffer when loading
+  int m_readAhead;                             ///< most bytes read into the buffer at once when loading
+
+  bool m_stringTable;
+  std::map<std::string, int> m_storedStrings;  ///< string -> index, when storing
+  std::vector<std::string> m_loadedStrings;    ///< index -> string, when loading
 };
 
@@ -22,7 +22,9 @@
 #include "Util.h"
 #include <fribidi/fribidi.h>
 #include "LangInfo.h"
+#include "threads/Atomics.h"
 #include "threads/SingleLock.h"
+#include "utils/EndianSwap.h"
 #include "log.h"
 
 #include <errno.h>
@@ -53,18 +55,31 @@
 #endif
 
 
-static iconv_t m_iconvStringCharsetToFontCharset = (iconv_t)-1;
-static iconv_t m_iconvSubtitleCharsetToW         = (iconv_t)-1;
-static iconv_t m_iconvUtf8ToStringCharset        = (iconv_t)-1;
-static iconv_t m_iconvStringCharsetToUtf8        = (iconv_t)-1;
-static iconv_t m_iconvUcs2CharsetToStringCharset = (iconv_t)-1;
-static iconv_t m_iconvUtf32ToStringCharset       = (iconv_t)-1;
-static iconv_t m_iconvWtoUtf8                    = (iconv_t)-1;
-static iconv_t m_iconvUtf16LEtoW                 = (iconv_t)-1;
-static iconv_t m_iconvUtf16BEtoUtf8              = (iconv_t)-1;
-static iconv_t m_iconvUtf16LEtoUtf8              = (iconv_t)-1;
-static iconv_t m_iconvUtf8toW                    = (iconv_t)-1;
-static iconv_t m_iconvUcs2CharsetToUtf8          = (iconv_t)-1;
+/* The iconv handles the conversions between fixed charsets are done with.
+   An iconv_t can't be used by two threads at once, so every converting thread
+   leases a set of handles of its own, see CConverterLease. */
+enum ConverterType
+{
+  ConverterSubtitleCharsetToW = 0,
+  ConverterUtf8ToStringCharset,
+  ConverterStringCharsetToUtf8,
+  ConverterUcs2CharsetToStringCharset,
+  ConverterUtf32ToStringCharset,
+  ConverterWtoUtf8,
+  ConverterUtf16LEtoW,
+  ConverterUtf16BEtoUtf8,
+  ConverterUtf16LEtoUtf8,
+  ConverterUtf8toW,
+  ConverterUcs2CharsetToUtf8,
+  ConverterCount
+};
+
+struct SConverters
+{
+  iconv_t      handles[ConverterCount];
+  long         generation;  // of the charset settings the handles were opened for
+  SConverters* next;
+};
 
 #if defined(FRIBIDI_CHAR_SET_NOT_FOUND)
 static FriBidiCharSet m_stringFribidiCharset     = FRIBIDI_CHAR_SET_NOT_FOUND;
@@ -76,7 +91,10 @@ static FriBidiCharSet m_stringFribidiCharset     = FRIBIDI_CHARSET_NOT_FOUND;
 #define FRIBIDI_NOTFOUND FRIBIDI_CHARSET_NOT_FOUND
 #endif
 
-static CCriticalSection            m_critSection;
+static CCriticalSection            m_critSection;     // libfribidi isn't threadsafe
+static CCriticalSection            m_poolSection;     // only held to take or return a set of handles
+static SConverters*                m_freeConverters = NULL;
+static volatile long               m_generation = 0;  // bumped when the charset settings change
 
 static struct SFribidMapping
 {
@@ -160,6 +178,203 @@ size_t iconv_const (void* cd, const char** inbuf, size_t *inbytesleft,
     return iconv((iconv_t)cd, iconv_param_adapter(inbuf), inbytesleft, outbuf, outbytesleft);
 }
 
+class CConverterLease
+{
+public:
+  CConverterLease()
+  {
+    {
+      CSingleLock lock(m_poolSection);
+      m_converters = m_freeConverters;
+      if (m_converters)
+        m_freeConverters = m_converters->next;
+    }
+
+    if (!m_converters)
+    {
+      m_converters = new SConverters;
+      for (int i = 0; i < ConverterCount; i++)
+        ICONV_PREPARE(m_converters->handles[i]);
+      m_converters->generation = m_generation;
+    }
+    else if (m_converters->generation != m_generation)
+    { // the charsets changed since these were opened
+      for (int i = 0; i < ConverterCount; i++)
+        ICONV_SAFE_CLOSE(m_converters->handles[i]);
+      m_converters->generation = m_generation;
+    }
+  }
+
+  ~CConverterLease()
+  {
+    CSingleLock lock(m_poolSection);
+    m_converters->next = m_freeConverters;
+    m_freeConverters = m_converters;
+  }
+
+  iconv_t& operator[](ConverterType type) { return m_converters->handles[type]; }
+
+private:
+  SConverters* m_converters;
+};
+
+/* Transcoding between the Unicode encodings without going through iconv.
+   Like the iconv conversions, they stop at the first NUL and skip anything
+   that isn't valid in the source encoding. */
+
+template<class CHAR>
+static inline uint32_t unitAt(const CHAR* src, size_t pos, bool swap)
+{
+  uint32_t unit = (uint32_t)src[pos];
+  if (swap)
+  {
+    if (sizeof(CHAR) == 2)
+      unit = Endian_Swap16((uint16_t)unit);
+    else if (sizeof(CHAR) == 4)
+      unit = Endian_Swap32(unit);
+  }
+  return unit;
+}
+
+/*! \brief Decode the code point at pos, advancing pos past it
+ \return false if there is no valid code point at pos (pos is advanced by one unit)
+ */
+template<class CHAR>
+static bool nextCodePoint(const CHAR* src, size_t length, size_t& pos, uint32_t& cp, bool swap)
+{
+  uint32_t unit = unitAt(src, pos++, swap);
+  if (sizeof(CHAR) == 1)
+  {
+    unit &= 0xff;
+    if (unit < 0x80)
+    {
+      cp = unit;
+      return true;
+    }
+
+    size_t trailing;
+    uint32_t min;
+    if ((unit & 0xe0) == 0xc0)
+    { trailing = 1; min = 0x80;    cp = unit & 0x1f; }
+    else if ((unit & 0xf0) == 0xe0)
+    { trailing = 2; min = 0x800;   cp = unit & 0x0f; }
+    else if ((unit & 0xf8) == 0xf0)
+    { trailing = 3; min = 0x10000; cp = unit & 0x07; }
+    else
+      return false;
+
+    if (pos + trailing > length)
+      return false;
+    for (size_t i = 0; i < trailing; i++)
+    {
+      uint32_t next = (unsigned char)src[pos + i];
+      if ((next & 0xc0) != 0x80)
+        return false;
+      cp = (cp << 6) | (next & 0x3f);
+    }
+    // no overlong forms, surrogates or anything beyond Unicode
+    if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+      return false;
+    pos += trailing;
+    return true;
+  }
+  else if (sizeof(CHAR) == 2)
+  {
+    if (unit < 0xd800 || unit > 0xdfff)
+    {
+      cp = unit;
+      return true;
+    }
+    if (unit > 0xdbff || pos >= length)
+      return false; // lone trailing or leading surrogate
+    uint32_t low = unitAt(src, pos, swap);
+    if (low < 0xdc00 || low > 0xdfff)
+      return false;
+    pos++;
+    cp = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+    return true;
+  }
+  else
+  {
+    if (unit > 0x10ffff || (unit >= 0xd800 && unit <= 0xdfff))
+      return false;
+    cp = unit;
+    return true;
+  }
+}
+
+template<class OUTPUT>
+static inline void appendCodePoint(OUTPUT& dest, uint32_t cp, bool swap)
+{
+  typedef typename OUTPUT::value_type CHAR;
+  if (sizeof(CHAR) == 1)
+  {
+    if (cp < 0x80)
+      dest += (CHAR)cp;
+    else if (cp < 0x800)
+    {
+      dest += (CHAR)(0xc0 | (cp >> 6));
+      dest += (CHAR)(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000)
+    {
+      dest += (CHAR)(0xe0 | (cp >> 12));
+      dest += (CHAR)(0x80 | ((cp >> 6) & 0x3f));
+      dest += (CHAR)(0x80 | (cp & 0x3f));
+    }
+    else
+    {
+      dest += (CHAR)(0xf0 | (cp >> 18));
+      dest += (CHAR)(0x80 | ((cp >> 12) & 0x3f));
+      dest += (CHAR)(0x80 | ((cp >> 6) & 0x3f));
+      dest += (CHAR)(0x80 | (cp & 0x3f));
+    }
+  }
+  else if (sizeof(CHAR) == 2)
+  {
+    if (cp < 0x10000)
+      dest += (CHAR)(swap ? Endian_Swap16((uint16_t)cp) : cp);
+    else
+    {
+      uint16_t high = 0xd800 + ((cp - 0x10000) >> 10);
+      uint16_t low  = 0xdc00 + ((cp - 0x10000) & 0x3ff);
+      dest += (CHAR)(swap ? Endian_Swap16(high) : high);
+      dest += (CHAR)(swap ? Endian_Swap16(low) : low);
+    }
+  }
+  else
+    dest += (CHAR)(swap ? Endian_Swap32(cp) : cp);
+}
+
+template<class INPUT,class OUTPUT>
+static void transcode(const INPUT& strSource, OUTPUT& strDest, bool swapSource = false, bool swapDest = false)
+{
+  OUTPUT result;
+  result.reserve(strSource.length() * (sizeof(typename OUTPUT::value_type) == 1 ? 3 : 1));
+
+  const typename INPUT::value_type* src = strSource.c_str();
+  size_t length = strSource.length();
+  size_t pos = 0;
+  uint32_t cp;
+  while (pos < length)
+  {
+    if (!nextCodePoint(src, length, pos, cp, swapSource))
+      continue;
+    if (!cp)
+      break;
+    appendCodePoint(result, cp, swapDest);
+  }
+  strDest = result;
+}
+
+#ifdef WORDS_BIGENDIAN
+static const bool swapLE = true;
+static const bool swapBE = false;
+#else
+static const bool swapLE = false;
+static const bool swapBE = true;
+#endif
+
 template<class INPUT,class OUTPUT>
 static bool convert_checked(iconv_t& type, int multiplier, const CStdString& strFromCharset, const CStdString& strToCharset, const INPUT& strSource, OUTPUT& strDest)
 {
@@ -273,6 +488,17 @@ static void convert(iconv_t& type, int multiplier, const CStdString& strFromChar
 
 using namespace std;
 
+/* Plain ASCII without line breaks is left as it is by logicalToVisualBiDi() */
+static bool needsBiDi(const CStdStringA& str)
+{
+  for (const unsigned char* c = (const unsigned char*)str.c_str(); *c; c++)
+  {
+    if (*c >= 0x80 || *c == '\n')
+      return true;
+  }
+  return false;
+}
+
 static void logicalToVisualBiDi(const CStdStringA& strSource, CStdStringA& strDest, FriBidiCharSet fribidiCharset, FriBidiCharType base = FRIBIDI_TYPE_LTR, bool* bWasFlipped =NULL)
 {
   // libfribidi is not threadsafe, so make sure we make it so
@@ -388,18 +614,8 @@ void CCharsetConverter::reset(void)
 {
   CSingleLock lock(m_critSection);
 
-  ICONV_SAFE_CLOSE(m_iconvStringCharsetToFontCharset);
-  ICONV_SAFE_CLOSE(m_iconvUtf8ToStringCharset);
-  ICONV_SAFE_CLOSE(m_iconvStringCharsetToUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUcs2CharsetToStringCharset);
-  ICONV_SAFE_CLOSE(m_iconvSubtitleCharsetToW);
-  ICONV_SAFE_CLOSE(m_iconvWtoUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUtf16BEtoUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUtf16LEtoUtf8);
-  ICONV_SAFE_CLOSE(m_iconvUtf32ToStringCharset);
-  ICONV_SAFE_CLOSE(m_iconvUtf8toW);
-  ICONV_SAFE_CLOSE(m_iconvUcs2CharsetToUtf8);
-
+  // sets of handles are reopened the next time they're leased
+  AtomicIncrement(&m_generation);
 
   m_stringFribidiCharset = FRIBIDI_NOTFOUND;
 
@@ -416,26 +632,31 @@ void CCharsetConverter::reset(void)
 void CCharsetConverter::utf8ToW(const CStdStringA& utf8String, CStdStringW &wString, bool bVisualBiDiFlip/*=true*/, bool forceLTRReadingOrder /*=false*/, bool* bWasFlipped/*=NULL*/)
 {
   // Try to flip hebrew/arabic characters, if any
-  if (bVisualBiDiFlip)
+  if (bVisualBiDiFlip && needsBiDi(utf8String))
   {
     CStdStringA strFlipped;
     FriBidiCharType charset = forceLTRReadingOrder ? FRIBIDI_TYPE_LTR : FRIBIDI_TYPE_PDF;
     logicalToVisualBiDi(utf8String, strFlipped, FRIBIDI_UTF8, charset, bWasFlipped);
-    CSingleLock lock(m_critSection);
-    convert(m_iconvUtf8toW,sizeof(wchar_t),UTF8_SOURCE,WCHAR_CHARSET,strFlipped,wString);
-  }
-  else
-  {
-    CSingleLock lock(m_critSection);
-    convert(m_iconvUtf8toW,sizeof(wchar_t),UTF8_SOURCE,WCHAR_CHARSET,utf8String,wString);
+    utf8ToW(strFlipped, wString, false);
+    return;
   }
+
+  if (bVisualBiDiFlip && bWasFlipped)
+    *bWasFlipped = false;
+#if defined(TARGET_DARWIN)
+  // UTF-8-MAC also composes decomposed characters, which is left to iconv
+  CConverterLease converters;
+  convert(converters[ConverterUtf8toW],sizeof(wchar_t),UTF8_SOURCE,WCHAR_CHARSET,utf8String,wString);
+#else
+  transcode(utf8String, wString);
+#endif
 }
 
 void CCharsetConverter::subtitleCharsetToW(const CStdStringA& strSource, CStdStringW& strDest)
 {
   // No need to flip hebrew/arabic as mplayer does the flipping
-  CSingleLock lock(m_critSection);
-  convert(m_iconvSubtitleCharsetToW,sizeof(wchar_t),g_langInfo.GetSubtitleCharSet(),WCHAR_CHARSET,strSource,strDest);
+  CConverterLease converters;
+  convert(converters[ConverterSubtitleCharsetToW],sizeof(wchar_t),g_langInfo.GetSubtitleCharSet(),WCHAR_CHARSET,strSource,strDest);
 }
 
 void CCharsetConverter::fromW(const CStdStringW& strSource,
@@ -458,8 +679,8 @@ void CCharsetConverter::toW(const CStdStringA& strSource,
 
 void CCharsetConverter::utf8ToStringCharset(const CStdStringA& strSource, CStdStringA& strDest)
 {
-  CSingleLock lock(m_critSection);
-  convert(m_iconvUtf8ToStringCharset,1,UTF8_SOURCE,g_langInfo.GetGuiCharSet(),strSource,strDest);
+  CConverterLease converters;
+  convert(converters[ConverterUtf8ToStringCharset],1,UTF8_SOURCE,g_langInfo.GetGuiCharSet(),strSource,strDest);
 }
 
 void CCharsetConverter::utf8ToStringCharset(CStdStringA& strSourceDest)
@@ -492,6 +713,13 @@ void CCharsetConverter::utf8To(const CStdStringA& strDestCharset, const CStdStri
 
 void CCharsetConverter::utf8To(const CStdStringA& strDestCharset, const CStdStringA& strSource, CStdString16& strDest)
 {
+#if !defined(TARGET_DARWIN)
+  if (strDestCharset == "UTF-16LE" || strDestCharset == "UTF-16BE")
+  {
+    transcode(strSource, strDest, false, strDestCharset == "UTF-16LE" ? swapLE : swapBE);
+    return;
+  }
+#endif
   iconv_t iconvString;
   ICONV_PREPARE(iconvString);
   if(!convert_checked(iconvString,UTF8_DEST_MULTIPLIER,UTF8_SOURCE,strDestCharset,strSource,strDest))
@@ -501,6 +729,13 @@ void CCharsetConverter::utf8To(const CStdStringA& strDestCharset, const CStdStri
 
 void CCharsetConverter::utf8To(const CStdStringA& strDestCharset, const CStdStringA& strSource, CStdString32& strDest)
 {
+#if !defined(TARGET_DARWIN)
+  if (strDestCharset == "UTF-32LE" || strDestCharset == "UTF-32BE")
+  {
+    transcode(strSource, strDest, false, strDestCharset == "UTF-32LE" ? swapLE : swapBE);
+    return;
+  }
+#endif
   iconv_t iconvString;
   ICONV_PREPARE(iconvString);
   if(!convert_checked(iconvString,UTF8_DEST_MULTIPLIER,UTF8_SOURCE,strDestCharset,strSource,strDest))
@@ -521,44 +756,37 @@ void CCharsetConverter::unknownToUTF8(const CStdStringA &source, CStdStringA &de
     dest = source;
   else
   {
-    CSingleLock lock(m_critSection);
-    convert(m_iconvStringCharsetToUtf8, UTF8_DEST_MULTIPLIER, g_langInfo.GetGuiCharSet(), "UTF-8", source, dest);
+    CConverterLease converters;
+    convert(converters[ConverterStringCharsetToUtf8], UTF8_DEST_MULTIPLIER, g_langInfo.GetGuiCharSet(), "UTF-8", source, dest);
   }
 }
 
 void CCharsetConverter::wToUTF8(const CStdStringW& strSource, CStdStringA &strDest)
 {
-  CSingleLock lock(m_critSection);
-  convert(m_iconvWtoUtf8,UTF8_DEST_MULTIPLIER,WCHAR_CHARSET,"UTF-8",strSource,strDest);
+  transcode(strSource, strDest);
 }
 
 void CCharsetConverter::utf16BEtoUTF8(const CStdString16& strSource, CStdStringA &strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUtf16BEtoUtf8,UTF8_DEST_MULTIPLIER,"UTF-16BE","UTF-8",strSource,strDest))
-    strDest.clear();
+  transcode(strSource, strDest, swapBE);
 }
 
 void CCharsetConverter::utf16LEtoUTF8(const CStdString16& strSource,
                                       CStdStringA &strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUtf16LEtoUtf8,UTF8_DEST_MULTIPLIER,"UTF-16LE","UTF-8",strSource,strDest))
-    strDest.clear();
+  transcode(strSource, strDest, swapLE);
 }
 
 void CCharsetConverter::ucs2ToUTF8(const CStdString16& strSource, CStdStringA& strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUcs2CharsetToUtf8,UTF8_DEST_MULTIPLIER,"UCS-2LE","UTF-8",strSource,strDest))
+  CConverterLease converters;
+  if(!convert_checked(converters[ConverterUcs2CharsetToUtf8],UTF8_DEST_MULTIPLIER,"UCS-2LE","UTF-8",strSource,strDest))
     strDest.clear();
 }
 
 void CCharsetConverter::utf16LEtoW(const CStdString16& strSource, CStdStringW &strDest)
 {
-  CSingleLock lock(m_critSection);
-  if(!convert_checked(m_iconvUtf16LEtoW,sizeof(wchar_t),"UTF-16LE",WCHAR_CHARSET,strSource,strDest))
-    strDest.clear();
+  transcode(strSource, strDest, swapLE);
 }
 
 void CCharsetConverter::ucs2CharsetToStringCharset(const CStdStringW& strSource, CStdStringA& strDest, bool swap)
@@ -578,22 +806,23 @@ void CCharsetConverter::ucs2CharsetToStringCharset(const CStdStringW& strSource,
       s++;
     }
   }
-  CSingleLock lock(m_critSection);
-  convert(m_iconvUcs2CharsetToStringCharset,4,"UTF-16LE",
+  CConverterLease converters;
+  convert(converters[ConverterUcs2CharsetToStringCharset],4,"UTF-16LE",
           g_langInfo.GetGuiCharSet(),strCopy,strDest);
 }
 
 void CCharsetConverter::utf32ToStringCharset(const unsigned long* strSource, CStdStringA& strDest)
 {
-  CSingleLock lock(m_critSection);
+  CConverterLease converters;
+  iconv_t& iconvUtf32ToStringCharset = converters[ConverterUtf32ToStringCharset];
 
-  if (m_iconvUtf32ToStringCharset == (iconv_t) - 1)
+  if (iconvUtf32ToStringCharset == (iconv_t) - 1)
   {
     CStdString strCharset=g_langInfo.GetGuiCharSet();
-    m_iconvUtf32ToStringCharset = iconv_open(strCharset.c_str(), "UTF-32LE");
+    iconvUtf32ToStringCharset = iconv_open(strCharset.c_str(), "UTF-32LE");
   }
 
-  if (m_iconvUtf32ToStringCharset != (iconv_t) - 1)
+  if (iconvUtf32ToStringCharset != (iconv_t) - 1)
   {
     const unsigned long* ptr=strSource;
     while (*ptr) ptr++;
@@ -603,7 +832,7 @@ void CCharsetConverter::utf32ToStringCharset(const unsigned long* strSource, CSt
     char *dst = strDest.GetBuffer(inBytes);
     size_t outBytes = inBytes;
 
-    if (iconv_const(m_iconvUtf32ToStringCharset, &src, &inBytes, &dst, &outBytes) == (size_t)-1)
+    if (iconv_const(iconvUtf32ToStringCharset, &src, &inBytes, &dst, &outBytes) == (size_t)-1)
     {
       CLog::Log(LOGERROR, "%s failed", __FUNCTION__);
       strDest.ReleaseBuffer();
@@ -611,7 +840,7 @@ void CCharsetConverter::utf32ToStringCharset(const unsigned long* strSource, CSt
       return;
     }
 
-    if (iconv(m_iconvUtf32ToStringCharset, NULL, NULL, &dst, &outBytes) == (size_t)-1)
+    if (iconv(iconvUtf32ToStringCharset, NULL, NULL, &dst, &outBytes) == (size_t)-1)
     {
       CLog::Log(LOGERROR, "%s failed cleanup", __FUNCTION__);
       strDest.ReleaseBuffer();
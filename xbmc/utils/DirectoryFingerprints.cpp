@@ -0,0 +1,382 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "system.h"
+#include "DirectoryFingerprints.h"
+#include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
+#include "threads/SingleLock.h"
+#include "utils/Archive.h"
+#include "utils/log.h"
+#include "utils/URIUtils.h"
+#include "URL.h"
+
+#include <algorithm>
+
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define JOURNAL_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+#endif
+
+#define FINGERPRINTS_VERSION 1
+
+using namespace std;
+using namespace XFILE;
+
+CDirectoryJournal::CDirectoryJournal() : CThread("CDirectoryJournal")
+{
+  m_fd = -1;
+  m_position = 1; // 0 is reserved for "not watched"
+  m_overflow = 0;
+}
+
+CDirectoryJournal::~CDirectoryJournal()
+{
+  StopThread();
+#ifdef HAVE_INOTIFY
+  if (m_fd >= 0)
+    close(m_fd);
+#endif
+}
+
+CDirectoryJournal &CDirectoryJournal::Get()
+{
+  static CDirectoryJournal sJournal;
+  return sJournal;
+}
+
+CStdString CDirectoryJournal::GetLocalPath(const CStdString &path)
+{
+  if (URIUtils::IsStack(path) || URIUtils::IsInArchive(path))
+    return "";
+
+  CStdString local = CSpecialProtocol::TranslatePath(path);
+  if (!CURL(local).GetProtocol().IsEmpty())
+    return "";
+
+  URIUtils::RemoveSlashAtEnd(local);
+  return local;
+}
+
+uint64_t CDirectoryJournal::Watch(const CStdString &path)
+{
+#ifdef HAVE_INOTIFY
+  CStdString local = GetLocalPath(path);
+  if (local.IsEmpty())
+    return 0;
+
+  CSingleLock lock(m_section);
+  if (m_paths.find(local) != m_paths.end())
+    return m_position;
+
+  if (m_fd < 0)
+  {
+    m_fd = inotify_init();
+    if (m_fd < 0)
+    {
+      CLog::Log(LOGERROR, "%s - unable to initialise inotify (%s)", __FUNCTION__, strerror(errno));
+      return 0;
+    }
+    Create();
+  }
+
+  int wd = inotify_add_watch(m_fd, local.c_str(), JOURNAL_EVENTS);
+  if (wd < 0)
+  { // most likely we've run into fs.inotify.max_user_watches
+    CLog::Log(LOGDEBUG, "%s - unable to watch %s (%s)", __FUNCTION__, local.c_str(), strerror(errno));
+    return 0;
+  }
+
+  Watched watched = { wd, m_position, 0 };
+  m_paths[local] = watched;
+  m_watches[wd] = local;
+  return m_position;
+#else
+  return 0;
+#endif
+}
+
+void CDirectoryJournal::Unwatch(const CStdString &path)
+{
+#ifdef HAVE_INOTIFY
+  CStdString local = GetLocalPath(path);
+  if (local.IsEmpty())
+    return;
+
+  CSingleLock lock(m_section);
+  map<CStdString, Watched>::iterator i = m_paths.find(local);
+  if (i == m_paths.end())
+    return;
+
+  // the IN_IGNORED event that follows finds no watch and is dropped
+  inotify_rm_watch(m_fd, i->second.wd);
+  m_watches.erase(i->second.wd);
+  m_paths.erase(i);
+#endif
+}
+
+bool CDirectoryJournal::IsUnchangedSince(const CStdString &path, uint64_t position)
+{
+  if (!position)
+    return false;
+
+  CStdString local = GetLocalPath(path);
+  if (local.IsEmpty())
+    return false;
+
+  CSingleLock lock(m_section);
+  if (m_overflow > position)
+    return false;
+
+  map<CStdString, Watched>::const_iterator i = m_paths.find(local);
+  if (i == m_paths.end())
+    return false;
+
+  return i->second.since <= position && i->second.changed <= position;
+}
+
+void CDirectoryJournal::Process()
+{
+#ifdef HAVE_INOTIFY
+  char buffer[16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  while (!m_bStop)
+  {
+    struct pollfd pfd = { m_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 500) <= 0)
+      continue;
+
+    ssize_t length = read(m_fd, buffer, sizeof(buffer));
+    if (length <= 0)
+      continue;
+
+    CSingleLock lock(m_section);
+    for (char *ptr = buffer; ptr < buffer + length; )
+    {
+      const struct inotify_event *event = (const struct inotify_event *)ptr;
+      ptr += sizeof(struct inotify_event) + event->len;
+
+      m_position++;
+      if (event->mask & IN_Q_OVERFLOW)
+      { // we've lost events, so nothing watched before now can be trusted
+        CLog::Log(LOGWARNING, "%s - inotify queue overflowed", __FUNCTION__);
+        m_overflow = m_position;
+        continue;
+      }
+
+      map<int, CStdString>::iterator watch = m_watches.find(event->wd);
+      if (watch == m_watches.end())
+        continue;
+
+      if (event->mask & IN_IGNORED)
+      { // the watch is gone (directory deleted or unmounted)
+        m_paths.erase(watch->second);
+        m_watches.erase(watch);
+        continue;
+      }
+
+      map<CStdString, Watched>::iterator path = m_paths.find(watch->second);
+      if (path != m_paths.end())
+        path->second.changed = m_position;
+    }
+  }
+#endif
+}
+
+CDirectoryFingerprints::CDirectoryFingerprints()
+{
+  m_trustModTime = TRUST_NONE;
+}
+
+bool CDirectoryFingerprints::Load(const CStdString &file, ModTimeTrust trustModTime)
+{
+  if (file == m_file && !m_nodes.empty())
+  { // still in memory from the last scan, which saved it
+    m_trustModTime = trustModTime;
+    return true;
+  }
+
+  Clear();
+  m_file = file;
+  m_trustModTime = trustModTime;
+
+  CFile fp;
+  if (!fp.Open(m_file))
+    return false;
+
+  CArchive ar(&fp, CArchive::load);
+  int version, count;
+  ar >> version;
+  if (version == FINGERPRINTS_VERSION)
+  {
+    ar >> count;
+    for (int i = 0; i < count; i++)
+    {
+      CStdString path;
+      Node node;
+      ar >> path;
+      ar >> node.fingerprint;
+      ar >> node.files;
+      ar >> node.subdirs;
+      node.journal = 0;
+      m_nodes[path] = node;
+    }
+  }
+  ar.Close();
+  fp.Close();
+
+  CLog::Log(LOGDEBUG, "%s - loaded %u fingerprints from %s", __FUNCTION__, (unsigned int)m_nodes.size(), m_file.c_str());
+  return !m_nodes.empty();
+}
+
+bool CDirectoryFingerprints::Save()
+{
+  if (m_file.IsEmpty())
+    return false;
+
+  CFile fp;
+  if (!fp.OpenForWrite(m_file, true)) // overwrite always
+  {
+    CLog::Log(LOGERROR, "%s - unable to write %s", __FUNCTION__, m_file.c_str());
+    return false;
+  }
+
+  CArchive ar(&fp, CArchive::store);
+  ar << (int)FINGERPRINTS_VERSION;
+  ar << (int)m_nodes.size();
+  for (map<CStdString, Node>::iterator i = m_nodes.begin(); i != m_nodes.end(); ++i)
+  {
+    ar << i->first;
+    ar << i->second.fingerprint;
+    ar << i->second.files;
+    ar << i->second.subdirs;
+  }
+  ar.Close();
+  fp.Close();
+  return true;
+}
+
+void CDirectoryFingerprints::Clear()
+{
+  for (map<CStdString, Node>::const_iterator i = m_nodes.begin(); i != m_nodes.end(); ++i)
+  {
+    if (i->second.journal)
+      CDirectoryJournal::Get().Unwatch(i->first);
+  }
+  for (map<CStdString, uint64_t>::const_iterator i = m_pending.begin(); i != m_pending.end(); ++i)
+  {
+    if (i->second)
+      CDirectoryJournal::Get().Unwatch(i->first);
+  }
+  m_nodes.clear();
+  m_pending.clear();
+}
+
+void CDirectoryFingerprints::BeginScan(const CStdString &path)
+{
+  m_pending[path] = CDirectoryJournal::Get().Watch(path);
+}
+
+void CDirectoryFingerprints::SetScanned(const CStdString &path, const vector<CStdString> &subdirs, int files)
+{
+  Node node;
+  node.fingerprint = GetFingerprint(path);
+  node.files = files;
+  node.subdirs.assign(subdirs.begin(), subdirs.end());
+  node.journal = 0;
+
+  map<CStdString, uint64_t>::iterator pending = m_pending.find(path);
+  if (pending != m_pending.end())
+  {
+    node.journal = pending->second;
+    m_pending.erase(pending);
+  }
+
+  // forget about subdirectories that are gone
+  map<CStdString, Node>::iterator old = m_nodes.find(path);
+  if (old != m_nodes.end())
+  {
+    vector<std::string> removed;
+    for (vector<std::string>::const_iterator i = old->second.subdirs.begin(); i != old->second.subdirs.end(); ++i)
+    {
+      if (find(node.subdirs.begin(), node.subdirs.end(), *i) == node.subdirs.end())
+        removed.push_back(*i);
+    }
+    for (vector<std::string>::const_iterator i = removed.begin(); i != removed.end(); ++i)
+      Remove(*i);
+  }
+
+  m_nodes[path] = node;
+}
+
+bool CDirectoryFingerprints::IsUnchanged(const CStdString &path, vector<CStdString> &subdirs, int &files)
+{
+  map<CStdString, Node>::const_iterator i = m_nodes.find(path);
+  if (i == m_nodes.end())
+    return false;
+
+  const Node &node = i->second;
+  if (!CDirectoryJournal::Get().IsUnchangedSince(path, node.journal))
+  {
+    if (m_trustModTime == TRUST_NONE || (m_trustModTime == TRUST_LEAVES && !node.subdirs.empty()))
+      return false;
+    if (node.fingerprint.IsEmpty() || GetFingerprint(path) != node.fingerprint)
+      return false;
+  }
+
+  subdirs.assign(node.subdirs.begin(), node.subdirs.end());
+  files = node.files;
+  return true;
+}
+
+void CDirectoryFingerprints::Remove(const CStdString &path)
+{
+  map<CStdString, Node>::iterator i = m_nodes.find(path);
+  if (i == m_nodes.end())
+    return;
+
+  vector<std::string> subdirs = i->second.subdirs;
+  if (i->second.journal)
+    CDirectoryJournal::Get().Unwatch(path);
+  m_nodes.erase(i);
+  for (vector<std::string>::const_iterator j = subdirs.begin(); j != subdirs.end(); ++j)
+    Remove(*j);
+}
+
+CStdString CDirectoryFingerprints::GetFingerprint(const CStdString &path)
+{
+  struct __stat64 buffer;
+  if (CFile::Stat(path, &buffer) == 0)
+  {
+    int64_t time = buffer.st_mtime;
+    if (!time)
+      time = buffer.st_ctime;
+    if (time)
+    {
+      CStdString fingerprint;
+      fingerprint.Format("%"PRId64, time);
+      return fingerprint;
+    }
+  }
+  return "";
+}
@@ -0,0 +1,188 @@
+#pragma once
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include "threads/CriticalSection.h"
+#include "threads/Thread.h"
+#include "utils/StdString.h"
+
+/*!
+ \brief Journal of changes made to local directories
+
+ Directories are watched with inotify (where available) and every change made
+ inside a watched directory is stamped with an increasing journal position.
+ Comparing against the position taken before a directory was listed tells
+ whether the listing is still current without touching the disk.  Unlike
+ modification times this also notices files that are rewritten in place.
+ */
+class CDirectoryJournal : public CThread
+{
+public:
+  static CDirectoryJournal &Get();
+
+  /*! \brief Start watching a directory for changes
+   \param path the directory to watch
+   \return the journal position from which changes to the directory are recorded, 0 if it can't be watched
+   */
+  uint64_t Watch(const CStdString &path);
+
+  /*! \brief Stop watching a directory
+   Positions handed out for the directory are no longer trusted afterwards, so anyone
+   else relying on them falls back to listing it.
+   \param path the directory to stop watching
+   */
+  void Unwatch(const CStdString &path);
+
+  /*! \brief Check whether a directory has changed since the given journal position
+   \param path the directory to check
+   \param position a journal position returned by Watch()
+   \return true if the directory has been watched since position and nothing in it changed, false otherwise
+   */
+  bool IsUnchangedSince(const CStdString &path, uint64_t position);
+
+protected:
+  CDirectoryJournal();
+  virtual ~CDirectoryJournal();
+
+  virtual void Process();
+
+private:
+  /*! \brief Translate a path to the local directory that gets watched
+   \return the local path, or an empty string if the path isn't local
+   */
+  static CStdString GetLocalPath(const CStdString &path);
+
+  typedef struct
+  {
+    int      wd;      ///< inotify watch descriptor
+    uint64_t since;   ///< position at which the watch was added
+    uint64_t changed; ///< position of the last change
+  } Watched;
+
+  CCriticalSection m_section;
+  int m_fd;
+  uint64_t m_position;
+  uint64_t m_overflow;                     ///< position at which events were last lost
+  std::map<int, CStdString> m_watches;     ///< watch descriptor -> local path
+  std::map<CStdString, Watched> m_paths;   ///< local path -> watch
+};
+
+/*!
+ \brief Tree of fingerprints of the directories of a library
+
+ Every directory the scanner lists gets a node holding a cheap fingerprint of
+ the directory (its modification time), the subdirectories it contained and
+ the number of files in it.  The tree is kept between sessions, so an update
+ scan can walk a source, skipping the listing and hashing of every directory
+ whose fingerprint didn't change and only visiting its known subdirectories.
+
+ Local directories are also handed to the CDirectoryJournal, which answers
+ without any I/O once a directory has been watched since it was last listed.
+ The watch is dropped again once the directory is forgotten.
+
+ Remote sources get no journal, and their servers don't reliably bump the
+ modification time of a parent when something deeper down changes, so there is
+ no summary that would let a whole subtree be skipped at once: every directory
+ of the tree is still visited, but each one costs a single stat() rather than a
+ listing and a hash of its items.
+ */
+class CDirectoryFingerprints
+{
+public:
+  /*! \brief Which directories an unchanged modification time is enough for
+   Files modified in place don't change the modification time of their directory,
+   and changes further down don't change it either, so without trusting it only
+   directories watched by the journal can be skipped.
+   */
+  enum ModTimeTrust
+  {
+    TRUST_NONE,   ///< never trust the modification time
+    TRUST_LEAVES, ///< trust it for directories without subdirectories
+    TRUST_ALL     ///< trust it for every directory
+  };
+
+  CDirectoryFingerprints();
+
+  /*! \brief Load the fingerprints from a file
+   Loading the file that is already loaded keeps the fingerprints in memory, along
+   with the journal positions they were listed at.
+   \param file the file the fingerprints are kept in.  Save() writes back to the same file.
+   \param trustModTime which directories an unchanged modification time is enough for
+   \return true if fingerprints were loaded, false if the file doesn't exist or is unreadable
+   */
+  bool Load(const CStdString &file, ModTimeTrust trustModTime);
+  bool Save();
+
+  /*! \brief Forget all fingerprints and stop watching their directories
+   */
+  void Clear();
+
+  /*! \brief Note that a directory is about to be listed
+   Must be called before the directory is listed, so that changes made while it is
+   being scanned aren't lost.
+   \param path the directory
+   */
+  void BeginScan(const CStdString &path);
+
+  /*! \brief Record what a listing of a directory found
+   Subdirectories that have disappeared since the last scan are forgotten along with
+   everything below them.
+   \param path the directory
+   \param subdirs the subdirectories it contains
+   \param files the number of files it contains
+   */
+  void SetScanned(const CStdString &path, const std::vector<CStdString> &subdirs, int files);
+
+  /*! \brief Check whether a directory has changed since it was last scanned
+   \param path the directory
+   \param subdirs [out] the subdirectories it contained when last scanned
+   \param files [out] the number of files it contained when last scanned
+   \return true if it is unchanged and doesn't need to be listed, false otherwise
+   */
+  bool IsUnchanged(const CStdString &path, std::vector<CStdString> &subdirs, int &files);
+
+  /*! \brief Forget a directory and everything below it, and stop watching them
+   \param path the directory
+   */
+  void Remove(const CStdString &path);
+
+  /*! \brief Retrieve the fingerprint of a directory
+   \param path the directory
+   \return its modification (or creation) time, or an empty string if it has neither
+   */
+  static CStdString GetFingerprint(const CStdString &path);
+
+private:
+  typedef struct
+  {
+    CStdString fingerprint;
+    std::vector<std::string> subdirs;
+    int files;
+    uint64_t journal;   ///< journal position when last listed (not persisted)
+  } Node;
+
+  CStdString m_file;
+  ModTimeTrust m_trustModTime;
+  std::map<CStdString, Node> m_nodes;
+  std::map<CStdString, uint64_t> m_pending;  ///< journal positions of the directories being listed
+};
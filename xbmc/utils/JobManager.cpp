@@ -20,6 +20,7 @@
 
 #include "JobManager.h"
 #include <algorithm>
+#include "threads/Atomics.h"
 #include "threads/SingleLock.h"
 #include "utils/log.h"
 
@@ -35,9 +36,10 @@ bool CJob::ShouldCancel(unsigned int progress, unsigned int total) const
   return false;
 }
 
-CJobWorker::CJobWorker(CJobManager *manager) : CThread("Jobworker")
+CJobWorker::CJobWorker(CJobManager *manager, unsigned int index) : CThread("Jobworker")
 {
   m_jobManager = manager;
+  m_index = index;
   Create(true); // start work immediately, and kill ourselves when we're done
 }
 
@@ -144,7 +146,8 @@ void CJobQueue::QueueNextJob()
   {
     CJobPointer &job = m_jobQueue.back();
     job.m_id = CJobManager::GetInstance().AddJob(job.m_job, this, m_priority);
-    m_processing.push_back(job);
+    if (job.m_id) // otherwise the manager is shut down and has deleted the job
+      m_processing.push_back(job);
     m_jobQueue.pop_back();
   }
 }
@@ -167,25 +170,38 @@ CJobManager &CJobManager::GetInstance()
 CJobManager::CJobManager()
 {
   m_jobCounter = 0;
+  m_jobsQueued = 0;
+  m_jobsProcessing = 0;
+  m_nextQueue = 0;
   m_running = true;
 }
 
 void CJobManager::CancelJobs()
 {
-  CSingleLock lock(m_section);
-  m_running = false;
-
-  // clear any pending jobs
-  for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
   {
-    for_each(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), mem_fun_ref(&CWorkItem::FreeJob));
-    m_jobQueue[priority].clear();
+    CSingleLock lock(m_section);
+    m_running = false;
   }
 
-  // cancel any callbacks on jobs still processing
-  for_each(m_processing.begin(), m_processing.end(), mem_fun_ref(&CWorkItem::Cancel));
+  for (unsigned int i = 0; i < CJOBMANAGER_WORKERS; i++)
+  {
+    CWorkerQueue &queue = m_queues[i];
+    CSingleLock lock(queue.m_section);
+
+    // clear any pending jobs
+    for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
+    {
+      AtomicSubtract(&m_jobsQueued, queue.m_jobQueue[priority].size());
+      for_each(queue.m_jobQueue[priority].begin(), queue.m_jobQueue[priority].end(), mem_fun_ref(&CWorkItem::FreeJob));
+      queue.m_jobQueue[priority].clear();
+    }
+
+    // cancel any callbacks on jobs still processing
+    for_each(queue.m_processing.begin(), queue.m_processing.end(), mem_fun_ref(&CWorkItem::Cancel));
+  }
 
   // tell our workers to finish
+  CSingleLock lock(m_section);
   while (m_workers.size())
   {
     lock.Leave();
@@ -195,92 +211,176 @@ void CJobManager::CancelJobs()
   }
 }
 
+void CJobManager::Restart()
+{
+  CSingleLock lock(m_section);
+  m_running = true;
+}
+
 CJobManager::~CJobManager()
 {
 }
 
 unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority)
 {
+  // held until the job is queued, so workers can't finish and jobs can't be
+  // cancelled in between
   CSingleLock lock(m_section);
+  if (!m_running)
+  {
+    delete job;
+    return 0;
+  }
 
   // create a work item for this job
-  CWorkItem work(job, m_jobCounter++, callback);
-  m_jobQueue[priority].push_back(work);
+  CWorkItem work(job, AtomicIncrement(&m_jobCounter), callback);
+
+  // jobs added by a worker (mostly follow-up jobs from a callback) go to its
+  // own queue, everyone else's take turns, so no single queue is fought over
+  unsigned int index;
+  CJobWorker *worker = dynamic_cast<CJobWorker *>(CThread::GetCurrentThread());
+  if (worker)
+    index = worker->GetIndex();
+  else
+    index = (unsigned long)AtomicIncrement(&m_nextQueue) % CJOBMANAGER_WORKERS;
 
-  StartWorkers(priority);
+  {
+    CWorkerQueue &queue = m_queues[index];
+    CSingleLock queueLock(queue.m_section);
+    queue.m_jobQueue[priority].push_back(work);
+    AtomicIncrement(&m_jobsQueued);
+  }
+
+  StartWorkers();
   return work.m_id;
 }
 
 void CJobManager::CancelJob(unsigned int jobID)
 {
-  CSingleLock lock(m_section);
-
-  // check whether we have this job in the queue
-  for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
+  for (unsigned int i = 0; i < CJOBMANAGER_WORKERS; i++)
   {
-    JobQueue::iterator i = find(m_jobQueue[priority].begin(), m_jobQueue[priority].end(), jobID);
-    if (i != m_jobQueue[priority].end())
+    CWorkerQueue &queue = m_queues[i];
+    CSingleLock lock(queue.m_section);
+
+    // check whether we have this job in the queue
+    for (unsigned int priority = CJob::PRIORITY_LOW; priority <= CJob::PRIORITY_HIGH; ++priority)
+    {
+      JobQueue::iterator j = find(queue.m_jobQueue[priority].begin(), queue.m_jobQueue[priority].end(), jobID);
+      if (j != queue.m_jobQueue[priority].end())
+      {
+        delete j->m_job;
+        queue.m_jobQueue[priority].erase(j);
+        AtomicDecrement(&m_jobsQueued);
+        return;
+      }
+    }
+    // or if we're processing it
+    Processing::iterator it = find(queue.m_processing.begin(), queue.m_processing.end(), jobID);
+    if (it != queue.m_processing.end())
     {
-      delete i->m_job;
-      m_jobQueue[priority].erase(i);
+      it->m_callback = NULL; // job is in progress, so only thing to do is to remove callback
       return;
     }
   }
-  // or if we're processing it
-  Processing::iterator it = find(m_processing.begin(), m_processing.end(), jobID);
-  if (it != m_processing.end())
-    it->m_callback = NULL; // job is in progress, so only thing to do is to remove callback
 }
 
-void CJobManager::StartWorkers(CJob::PRIORITY priority)
+void CJobManager::StartWorkers()
 {
+  // wake a sleeping worker, if there is one
+  m_jobEvent.Set();
+
   CSingleLock lock(m_section);
 
-  // check how many free threads we have
-  if (m_processing.size() >= GetMaxWorkers(priority))
+  // start another worker if there are more jobs than workers to run them
+  unsigned int jobs = (unsigned int)(m_jobsQueued + m_jobsProcessing);
+  if (m_workers.size() >= CJOBMANAGER_WORKERS || m_workers.size() >= jobs)
     return;
 
-  // do we have any sleeping threads?
-  if (m_processing.size() < m_workers.size())
+  // the new worker takes over the first queue without a worker
+  unsigned int index = 0;
+  for (Workers::const_iterator i = m_workers.begin(); i != m_workers.end(); )
   {
-    m_jobEvent.Set();
-    return;
+    if ((*i)->GetIndex() == index)
+    {
+      index++;
+      i = m_workers.begin();
+    }
+    else
+      ++i;
   }
-
-  // everyone is busy - we need more workers
-  m_workers.push_back(new CJobWorker(this));
+  m_workers.push_back(new CJobWorker(this, index));
 }
 
-CJob *CJobManager::PopJob()
+CJob *CJobManager::PopJob(unsigned int worker)
 {
-  CSingleLock lock(m_section);
+  if (m_jobsQueued <= 0)
+    return NULL;
+
   for (int priority = CJob::PRIORITY_HIGH; priority >= CJob::PRIORITY_LOW; --priority)
   {
-    if (m_jobQueue[priority].size() && m_processing.size() < GetMaxWorkers(CJob::PRIORITY(priority)))
-    {
-      CWorkItem job = m_jobQueue[priority].front();
-
-      // skip adding any paused types
-      if (priority <= CJob::PRIORITY_LOW)
-      {
-        std::vector<std::string>::iterator i = find(m_pausedTypes.begin(), m_pausedTypes.end(), job.m_job->GetType());
-        if (i != m_pausedTypes.end())
-          return NULL;
-      }
+    // reserve a worker for this priority before looking for a job
+    if (!ReserveWorker(CJob::PRIORITY(priority)))
+      return NULL; // lower priorities are allowed even fewer workers
 
-      m_jobQueue[priority].pop_front();
-      // add to the processing vector
-      m_processing.push_back(job);
-      job.m_job->m_callback = this;
-      return job.m_job;
+    // our own queue first, then steal from the others
+    for (unsigned int i = 0; i < CJOBMANAGER_WORKERS; i++)
+    {
+      CJob *job = PopJob(m_queues[(worker + i) % CJOBMANAGER_WORKERS], CJob::PRIORITY(priority));
+      if (job)
+        return job;
     }
+    // nothing runnable, so nobody needs waking: whoever failed to reserve because of us
+    // is looking at lower priorities as well, or is woken when a running job completes
+    AtomicDecrement(&m_jobsProcessing);
   }
   return NULL;
 }
 
+bool CJobManager::ReserveWorker(CJob::PRIORITY priority)
+{
+  long max = GetMaxWorkers(priority);
+  long processing;
+  do
+  {
+    processing = m_jobsProcessing;
+    if (processing >= max)
+      return false;
+  } while (cas(&m_jobsProcessing, processing, processing + 1) != processing);
+  return true;
+}
+
+void CJobManager::ReleaseWorker()
+{
+  AtomicDecrement(&m_jobsProcessing);
+  // a job finished, so a worker may have gone to sleep because this one was taken
+  if (m_jobsQueued > 0)
+    m_jobEvent.Set();
+}
+
+CJob *CJobManager::PopJob(CWorkerQueue &queue, CJob::PRIORITY priority)
+{
+  CSingleLock lock(queue.m_section);
+  JobQueue &jobs = queue.m_jobQueue[priority];
+  if (jobs.empty())
+    return NULL;
+
+  CWorkItem job = jobs.front();
+
+  // skip adding any paused types
+  if (priority <= CJob::PRIORITY_LOW && IsPaused(job.m_job->GetType()))
+    return NULL;
+
+  jobs.pop_front();
+  AtomicDecrement(&m_jobsQueued);
+  // add to the processing vector
+  queue.m_processing.push_back(job);
+  job.m_job->m_callback = this;
+  return job.m_job;
+}
+
 void CJobManager::Pause(const std::string &pausedType)
 {
-  CSingleLock lock(m_section);
+  CSingleLock lock(m_pausedSection);
   // just push it in so we get ref counting,
   // the queue will resume when all Pause requests
   // for a given type have been UnPaused.
@@ -289,15 +389,20 @@ void CJobManager::Pause(const std::string &pausedType)
 
 void CJobManager::UnPause(const std::string &pausedType)
 {
-  CSingleLock lock(m_section);
+  CSingleLock lock(m_pausedSection);
   std::vector<std::string>::iterator i = find(m_pausedTypes.begin(), m_pausedTypes.end(), pausedType);
   if (i != m_pausedTypes.end())
     m_pausedTypes.erase(i);
+  lock.Leave();
+
+  // the workers sleep until they're woken, so wake one for the jobs held back
+  if (m_jobsQueued > 0)
+    m_jobEvent.Set();
 }
 
 bool CJobManager::IsPaused(const std::string &pausedType)
 {
-  CSingleLock lock(m_section);
+  CSingleLock lock(m_pausedSection);
   std::vector<std::string>::iterator i = find(m_pausedTypes.begin(), m_pausedTypes.end(), pausedType);
   return (i != m_pausedTypes.end());
 }
@@ -305,34 +410,39 @@ bool CJobManager::IsPaused(const std::string &pausedType)
 int CJobManager::IsProcessing(const std::string &pausedType)
 {
   int jobsMatched = 0;
-  CSingleLock lock(m_section);
-  for(Processing::iterator it = m_processing.begin(); it < m_processing.end(); it++)
+  for (unsigned int i = 0; i < CJOBMANAGER_WORKERS; i++)
   {
-    if (pausedType == std::string(it->m_job->GetType()))
-      jobsMatched++;
+    CWorkerQueue &queue = m_queues[i];
+    CSingleLock lock(queue.m_section);
+    for(Processing::iterator it = queue.m_processing.begin(); it < queue.m_processing.end(); it++)
+    {
+      if (pausedType == std::string(it->m_job->GetType()))
+        jobsMatched++;
+    }
   }
   return jobsMatched;
 }
 
 CJob *CJobManager::GetNextJob(const CJobWorker *worker)
 {
-  CSingleLock lock(m_section);
   while (m_running)
   {
-    // grab a job off the queue if we have one
-    CJob *job = PopJob();
+    // grab a job off the queues if we have one
+    CJob *job = PopJob(worker->GetIndex());
     if (job)
+    {
+      // more jobs waiting - pass the wakeup on to another worker
+      if (m_jobsQueued > 0)
+        m_jobEvent.Set();
       return job;
-    // no jobs are left - sleep for 30 seconds to allow new jobs to come in
-    lock.Leave();
-    bool newJob = m_jobEvent.WaitMSec(30000);
-    lock.Enter();
-    if (!newJob)
-      break;
+    }
+    // no jobs are left - sleep until new jobs come in or a worker is released
+    m_jobEvent.Wait();
   }
-  // ensure no jobs have come in during the period after
-  // timeout and before we held the lock
-  CJob *job = PopJob();
+  // we're shutting down, but finish off a job that came in late. Looked for
+  // under the lock, so no job can be queued until we're no longer counted
+  CSingleLock lock(m_section);
+  CJob *job = PopJob(worker->GetIndex());
   if (job)
     return job;
   // have no jobs
@@ -342,17 +452,22 @@ CJob *CJobManager::GetNextJob(const CJobWorker *worker)
 
 bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const CJob *job) const
 {
-  CSingleLock lock(m_section);
-  // find the job in the processing queue, and check whether it's cancelled (no callback)
-  Processing::const_iterator i = find(m_processing.begin(), m_processing.end(), job);
-  if (i != m_processing.end())
+  for (unsigned int i = 0; i < CJOBMANAGER_WORKERS; i++)
   {
-    CWorkItem item(*i);
-    lock.Leave(); // leave section prior to call
-    if (item.m_callback)
+    const CWorkerQueue &queue = m_queues[i];
+    CSingleLock lock(queue.m_section);
+    // find the job in the processing queue, and check whether it's cancelled (no callback)
+    Processing::const_iterator it = find(queue.m_processing.begin(), queue.m_processing.end(), job);
+    if (it != queue.m_processing.end())
     {
-      item.m_callback->OnJobProgress(item.m_id, progress, total, job);
-      return false;
+      CWorkItem item(*it);
+      lock.Leave(); // leave section prior to call
+      if (item.m_callback)
+      {
+        item.m_callback->OnJobProgress(item.m_id, progress, total, job);
+        return false;
+      }
+      break;
     }
   }
   return true; // couldn't find the job, or it's been cancelled
@@ -360,13 +475,17 @@ bool CJobManager::OnJobProgress(unsigned int progress, unsigned int total, const
 
 void CJobManager::OnJobComplete(bool success, CJob *job)
 {
-  CSingleLock lock(m_section);
-  // remove the job from the processing queue
-  Processing::iterator i = find(m_processing.begin(), m_processing.end(), job);
-  if (i != m_processing.end())
+  for (unsigned int i = 0; i < CJOBMANAGER_WORKERS; i++)
   {
+    CWorkerQueue &queue = m_queues[i];
+    CSingleLock lock(queue.m_section);
+    // remove the job from the processing queue
+    Processing::iterator it = find(queue.m_processing.begin(), queue.m_processing.end(), job);
+    if (it == queue.m_processing.end())
+      continue;
+
     // tell any listeners we're done with the job, then delete it
-    CWorkItem item(*i);
+    CWorkItem item(*it);
     lock.Leave();
     try
     {
@@ -378,11 +497,13 @@ void CJobManager::OnJobComplete(bool success, CJob *job)
       CLog::Log(LOGERROR, "%s error processing job %s", __FUNCTION__, item.m_job->GetType());
     }
     lock.Enter();
-    Processing::iterator j = find(m_processing.begin(), m_processing.end(), job);
-    if (j != m_processing.end())
-      m_processing.erase(j);
+    Processing::iterator j = find(queue.m_processing.begin(), queue.m_processing.end(), job);
+    if (j != queue.m_processing.end())
+      queue.m_processing.erase(j);
     lock.Leave();
+    ReleaseWorker();
     item.FreeJob();
+    return;
   }
 }
 
@@ -397,6 +518,6 @@ void CJobManager::RemoveWorker(const CJobWorker *worker)
 
 unsigned int CJobManager::GetMaxWorkers(CJob::PRIORITY priority) const
 {
-  static const unsigned int max_workers = 5;
+  static const unsigned int max_workers = CJOBMANAGER_WORKERS;
   return max_workers - (CJob::PRIORITY_HIGH - priority);
 }
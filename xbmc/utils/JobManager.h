@@ -26,17 +26,27 @@
 #include "threads/Thread.h"
 #include "Job.h"
 
+/*! \brief the number of worker threads CJobManager runs jobs on
+ */
+#define CJOBMANAGER_WORKERS 5
+
 class CJobManager;
 
 class CJobWorker : public CThread
 {
 public:
-  CJobWorker(CJobManager *manager);
+  CJobWorker(CJobManager *manager, unsigned int index);
   virtual ~CJobWorker();
 
   void Process();
+
+  /*!
+   \brief The index of the job queue this worker owns in the CJobManager.
+   */
+  unsigned int GetIndex() const { return m_index; };
 private:
   CJobManager  *m_jobManager;
+  unsigned int  m_index;
 };
 
 /*!
@@ -158,6 +168,12 @@ private:
  priority levels.  Lower priority jobs are executed only if there are sufficient
  spare worker threads free to allow for higher priority jobs that may arise.
 
+ Jobs are run by a fixed number of worker threads, started as they are needed.
+ Every worker owns a queue of its own, so adding and picking up jobs only locks
+ that queue: jobs added from a worker go to its own queue, others are spread
+ over the queues in turn, and workers that run out of jobs steal them from the
+ queues of the others, highest priority first.
+
  \sa CJob and IJobCallback
  */
 class CJobManager
@@ -205,7 +221,8 @@ public:
    \param job a pointer to the job to add. The job should be subclassed from CJob
    \param callback a pointer to an IJobCallback instance to receive job progress and completion notices.
    \param priority the priority that this job should run at.
-   \return a unique identifier for this job, to be used with other interaction
+   \return a unique identifier for this job, to be used with other interaction, or 0 if
+   the job manager is shut down and the job has been deleted
    \sa CJob, IJobCallback, CancelJob()
    */
   unsigned int AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority = CJob::PRIORITY_LOW);
@@ -224,6 +241,13 @@ public:
    */
   void CancelJobs();
 
+  /*!
+   \brief Accept jobs again after CancelJobs()
+   Jobs added between CancelJobs() and Restart() are deleted without being processed.
+   \sa CancelJobs()
+   */
+  void Restart();
+
   /*!
    \brief Suspends queueing of the specified type until unpaused
    Useful to (for ex) stop queuing thumb jobs during video playback. Only affects PRIORITY_LOW or lower.
@@ -262,7 +286,7 @@ protected:
   friend class CJob;
 
   /*!
-   \brief Get a new job to process. Blocks until a new job is available, or a timeout has occurred.
+   \brief Get a new job to process. Blocks until a new job is available, or the job manager is shutting down.
    \param worker a pointer to the current CJobWorker instance requesting a job.
    \sa CJob
    */
@@ -295,27 +319,57 @@ private:
   CJobManager const& operator=(CJobManager const&);
   virtual ~CJobManager();
 
-  /*! \brief Pop a job off the job queue and add to the processing queue ready to process
+  typedef std::deque<CWorkItem>    JobQueue;
+  typedef std::vector<CWorkItem>   Processing;
+  typedef std::vector<CJobWorker*> Workers;
+
+  /*!
+   \brief The jobs queued on a worker, and those of them being processed.
+   Processed jobs stay with the queue they were taken from, whichever worker runs them.
+   */
+  class CWorkerQueue
+  {
+  public:
+    JobQueue         m_jobQueue[CJob::PRIORITY_HIGH+1];
+    Processing       m_processing;
+    CCriticalSection m_section;
+  };
+
+  /*! \brief Pop a job off the job queues and add to the processing queue ready to process
+   Looks in the worker's own queue first, then steals from the queues of the others.
+   \param worker index of the worker's queue.
    \return the job to process, NULL if no jobs are available
    */
-  CJob *PopJob();
+  CJob *PopJob(unsigned int worker);
+
+  /*! \brief Pop a job of the given priority off a queue and add to its processing queue
+   \return the job to process, NULL if the queue has no jobs of this priority that may run
+   */
+  CJob *PopJob(CWorkerQueue &queue, CJob::PRIORITY priority);
+
+  /*! \brief Count a worker as processing, unless the workers allowed for this priority are all taken
+   \return true if the worker was counted, false if it may not process a job of this priority
+   */
+  bool ReserveWorker(CJob::PRIORITY priority);
 
-  void StartWorkers(CJob::PRIORITY priority);
+  /*! \brief Stop counting a worker whose job completed, waking a sleeping worker if jobs are waiting for it */
+  void ReleaseWorker();
+
+  void StartWorkers();
   void RemoveWorker(const CJobWorker *worker);
   unsigned int GetMaxWorkers(CJob::PRIORITY priority) const;
 
-  unsigned int m_jobCounter;
+  volatile long m_jobCounter;
+  volatile long m_jobsQueued;       ///< number of jobs in all queues, so idle workers don't look through them in vain
+  volatile long m_jobsProcessing;   ///< number of jobs being processed, reserved before a job is popped
+  volatile long m_nextQueue;        ///< queue the next job from outside the workers goes to
 
-  typedef std::deque<CWorkItem>    JobQueue;
-  typedef std::vector<CWorkItem>   Processing;
-  typedef std::vector<CJobWorker*> Workers;
+  CWorkerQueue m_queues[CJOBMANAGER_WORKERS];
+  Workers      m_workers;
 
-  JobQueue   m_jobQueue[CJob::PRIORITY_HIGH+1];
-  Processing m_processing;
-  Workers    m_workers;
-
-  CCriticalSection m_section;
+  CCriticalSection m_section;       ///< protects m_workers and m_running, taken before the queue sections
   CEvent           m_jobEvent;
-  bool             m_running;
+  volatile bool    m_running;
+  CCriticalSection m_pausedSection; ///< protects m_pausedTypes, taken under the queue sections
   std::vector<std::string>  m_pausedTypes;
 };
@@ -738,7 +738,7 @@ string SortUtils::RemoveArticles(const string &label)
   for (unsigned int i = 0; i < g_advancedSettings.m_vecTokens.size(); ++i)
   {
     if (g_advancedSettings.m_vecTokens[i].size() < label.size() &&
-        strnicmp(g_advancedSettings.m_vecTokens[i].c_str(), label.c_str(), g_advancedSettings.m_vecTokens[i].size()) == 0)
+        StringUtils::StartsWith(label, g_advancedSettings.m_vecTokens[i]))
       return label.substr(g_advancedSettings.m_vecTokens[i].size());
   }
 
@@ -1569,6 +1569,26 @@ inline int ssicmp(const CT* pA1, const CT* pA2)
     return (int)(f - l);
 }
 
+// The "C" locale only knows about the ASCII letters, so for char there's no need
+// to copy the locale and look up its facet on every call
+inline int ssicmp(const char* pA1, const char* pA2)
+{
+    char f;
+    char l;
+
+    do
+    {
+      f = *(pA1++);
+      l = *(pA2++);
+      if ( f >= 'A' && f <= 'Z' )
+        f += 'a' - 'A';
+      if ( l >= 'A' && l <= 'Z' )
+        l += 'a' - 'A';
+    } while ( (f) && (f == l) );
+
+    return (int)(f - l);
+}
+
 // -----------------------------------------------------------------------------
 // ssupr/sslwr: Uppercase/Lowercase conversion functions
 // -----------------------------------------------------------------------------
@@ -2409,25 +2429,17 @@ public:
     // form a character takes up a different number of bytes than the
     // uppercase form, this would probably not work...
 
+#ifdef SS_NO_LOCALE
     std::transform(this->begin(),
              this->end(),
              this->begin(),
-#ifdef SS_NO_LOCALE
              SSToUpper<CT>());
 #else
-             std::bind2nd(SSToUpper<CT>(), loc));
+    // converting the whole range looks the facet up once instead of once per character
+    if ( !this->empty() )
+      ssupr(&(*this)[0], this->size(), loc);
 #endif
 
-    // ...but if it were, this would probably work better.  Also, this way
-    // seems to be a bit faster when anything other then the "C" locale is
-    // used...
-
-//    if ( !empty() )
-//    {
-//      ssupr(this->GetBuf(), this->size(), loc);
-//      this->RelBuf();
-//    }
-
     return *this;
   }
 
@@ -2437,24 +2449,17 @@ public:
     // form a character takes up a different number of bytes than the
     // uppercase form, this would probably not work...
 
+#ifdef SS_NO_LOCALE
     std::transform(this->begin(),
              this->end(),
              this->begin(),
-#ifdef SS_NO_LOCALE
              SSToLower<CT>());
 #else
-             std::bind2nd(SSToLower<CT>(), loc));
+    // converting the whole range looks the facet up once instead of once per character
+    if ( !this->empty() )
+      sslwr(&(*this)[0], this->size(), loc);
 #endif
 
-    // ...but if it were, this would probably work better.  Also, this way
-    // seems to be a bit faster when anything other then the "C" locale is
-    // used...
-
-//    if ( !empty() )
-//    {
-//      sslwr(this->GetBuf(), this->size(), loc);
-//      this->RelBuf();
-//    }
     return *this;
   }
 
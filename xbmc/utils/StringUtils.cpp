@@ -38,10 +38,61 @@
 #include <sstream>
 #include <time.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define FORMAT_BLOCK_SIZE 2048 // # of bytes to increment per try
 
 using namespace std;
 
+static inline unsigned char FoldCase(unsigned char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+#ifdef __SSE2__
+// toggles the case of the 26 letters starting at first in 16 bytes at once.
+// moving them to the bottom of the signed range lets a single compare find them.
+static inline __m128i ToggleCase(__m128i chars, char first)
+{
+  const __m128i shifted = _mm_add_epi8(chars, _mm_set1_epi8((char)(0x80 - first)));
+  const __m128i letters = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x80 + 26)));
+  return _mm_xor_si128(chars, _mm_and_si128(letters, _mm_set1_epi8(0x20)));
+}
+#endif
+
+// ASCII letters are changed here, everything else is left to the locale
+static void ChangeCase(string &str, char first, int (*convert)(int))
+{
+  if (str.empty())
+    return;
+
+  char *data = &str[0];
+  size_t size = str.size();
+  size_t i = 0;
+#ifdef __SSE2__
+  for (; i + 16 <= size; i += 16)
+  {
+    __m128i chars = _mm_loadu_si128((const __m128i *)(data + i));
+    if (_mm_movemask_epi8(chars) == 0)
+      _mm_storeu_si128((__m128i *)(data + i), ToggleCase(chars, first));
+    else
+    {
+      for (size_t j = i; j < i + 16; j++)
+        data[j] = convert(data[j]);
+    }
+  }
+#endif
+  for (; i < size; i++)
+  {
+    if (data[i] >= first && data[i] < first + 26)
+      data[i] ^= 0x20;
+    else if ((unsigned char)data[i] >= 0x80)
+      data[i] = convert(data[i]);
+  }
+}
+
 const char* ADDON_GUID_RE = "^(\\{){0,1}[0-9a-fA-F]{8}\\-[0-9a-fA-F]{4}\\-[0-9a-fA-F]{4}\\-[0-9a-fA-F]{4}\\-[0-9a-fA-F]{12}(\\}){0,1}$";
 
 /* empty string for use in returns by ref */
@@ -103,22 +154,81 @@ string StringUtils::FormatV(const char *fmt, va_list args)
 
 void StringUtils::ToUpper(string &str)
 {
-  transform(str.begin(), str.end(), str.begin(), ::toupper);
+  ChangeCase(str, 'a', ::toupper);
 }
 
 void StringUtils::ToLower(string &str)
 {
-  transform(str.begin(), str.end(), str.begin(), ::tolower);
+  ChangeCase(str, 'A', ::tolower);
 }
 
 bool StringUtils::EqualsNoCase(const std::string &str1, const std::string &str2)
 {
-  string tmp1 = str1;
-  string tmp2 = str2;
-  ToLower(tmp1);
-  ToLower(tmp2);
-  
-  return tmp1.compare(tmp2) == 0;
+  return str1.size() == str2.size() && CompareNoCase(str1.c_str(), str2.c_str(), str1.size()) == 0;
+}
+
+int StringUtils::CompareNoCase(const std::string &str1, const std::string &str2)
+{
+  int result = CompareNoCase(str1.c_str(), str2.c_str(), min(str1.size(), str2.size()));
+  if (result == 0 && str1.size() != str2.size())
+    result = str1.size() < str2.size() ? -1 : 1;
+  return result;
+}
+
+int StringUtils::CompareNoCase(const char *str1, const char *str2, size_t length)
+{
+  size_t i = 0;
+#ifdef __SSE2__
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i chars1 = ToggleCase(_mm_loadu_si128((const __m128i *)(str1 + i)), 'A');
+    __m128i chars2 = ToggleCase(_mm_loadu_si128((const __m128i *)(str2 + i)), 'A');
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(chars1, chars2)) != 0xFFFF)
+      break; // the loop below finds the difference
+  }
+#endif
+  for (; i < length; i++)
+  {
+    int result = FoldCase(str1[i]) - FoldCase(str2[i]);
+    if (result)
+      return result;
+  }
+  return 0;
+}
+
+size_t StringUtils::FindNoCase(const std::string &str, const std::string &find, size_t start /* = 0 */)
+{
+  size_t length = find.size();
+  if (start > str.size() || length > str.size() - start)
+    return string::npos;
+  if (length == 0)
+    return start;
+
+  const char *data = str.c_str();
+  const char *rest = find.c_str() + 1;
+  unsigned char first = FoldCase(find[0]);
+  size_t last = str.size() - length; // the last position a match can start at
+  size_t i = start;
+#ifdef __SSE2__
+  // look for the first character 16 positions at a time and only compare the rest where it was found
+  const __m128i firsts = _mm_set1_epi8((char)first);
+  for (; i + 15 <= last; i += 16)
+  {
+    __m128i chars = ToggleCase(_mm_loadu_si128((const __m128i *)(data + i)), 'A');
+    int found = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, firsts));
+    for (size_t j = i; found; j++, found >>= 1)
+    {
+      if ((found & 1) && CompareNoCase(data + j + 1, rest, length - 1) == 0)
+        return j;
+    }
+  }
+#endif
+  for (; i <= last; i++)
+  {
+    if (FoldCase(data[i]) == first && CompareNoCase(data + i + 1, rest, length - 1) == 0)
+      return i;
+  }
+  return string::npos;
 }
 
 string StringUtils::Left(const string &str, size_t count)
@@ -181,37 +291,61 @@ int StringUtils::Replace(string &str, char oldChar, char newChar)
 
 int StringUtils::Replace(std::string &str, const std::string &oldStr, const std::string &newStr)
 {
+  if (oldStr.empty())
+    return 0;
+
+  size_t index = str.find(oldStr);
+  if (index == string::npos)
+    return 0;
+
   int replacedChars = 0;
-  size_t index = 0;
-  
-  while (index < str.size() && (index = str.find(oldStr, index)) != string::npos)
+  if (oldStr.size() == newStr.size())
+  { // nothing has to move
+    do
+    {
+      str.replace(index, oldStr.size(), newStr);
+      replacedChars++;
+    } while ((index = str.find(oldStr, index + newStr.size())) != string::npos);
+    return replacedChars;
+  }
+
+  // build the result in one go instead of moving the rest of the string for every replacement
+  string result;
+  result.reserve(str.size());
+  size_t last = 0;
+  do
   {
-    str.replace(index, oldStr.size(), newStr);
-    index += newStr.size();
+    result.append(str, last, index - last);
+    result.append(newStr);
+    last = index + oldStr.size();
     replacedChars++;
-  }
-  
+  } while ((index = str.find(oldStr, last)) != string::npos);
+  result.append(str, last, string::npos);
+  str.swap(result);
+
   return replacedChars;
 }
 
 bool StringUtils::StartsWith(const std::string &str, const std::string &str2, bool useCase /* = false */)
 {
-  std::string left = StringUtils::Left(str, str2.size());
-  
+  if (str.size() < str2.size())
+    return false;
+
   if (useCase)
-    return left.compare(str2) == 0;
+    return str.compare(0, str2.size(), str2) == 0;
 
-  return StringUtils::EqualsNoCase(left, str2);
+  return CompareNoCase(str.c_str(), str2.c_str(), str2.size()) == 0;
 }
 
 bool StringUtils::EndsWith(const std::string &str, const std::string &str2, bool useCase /* = false */)
 {
-  std::string right = StringUtils::Right(str, str2.size());
-  
+  if (str.size() < str2.size())
+    return false;
+
   if (useCase)
-    return right.compare(str2) == 0;
+    return str.compare(str.size() - str2.size(), str2.size(), str2) == 0;
 
-  return StringUtils::EqualsNoCase(right, str2);
+  return CompareNoCase(str.c_str() + str.size() - str2.size(), str2.c_str(), str2.size()) == 0;
 }
 
 void StringUtils::JoinString(const CStdStringArray &strings, const CStdString& delimiter, CStdString& result)
@@ -243,62 +377,39 @@ CStdString StringUtils::Join(const vector<string> &strings, const CStdString& de
 // Splits the string input into pieces delimited by delimiter.
 // if 2 delimiters are in a row, it will include the empty string between them.
 // added MaxStrings parameter to restrict the number of returned substrings (like perl and python)
-int StringUtils::SplitString(const CStdString& input, const CStdString& delimiter, CStdStringArray &results, unsigned int iMaxStrings /* = 0 */)
+int StringUtils::SplitRanges(const string& input, const string& delimiter, vector<StringRange> &results, unsigned int iMaxStrings /* = 0 */)
 {
-  int iPos = -1;
-  int newPos = -1;
-  int sizeS2 = delimiter.GetLength();
-  int isize = input.GetLength();
-
   results.clear();
 
-  vector<unsigned int> positions;
-
-  newPos = input.Find (delimiter, 0);
-
-  if ( newPos < 0 )
+  size_t start = 0;
+  size_t pos = input.find(delimiter);
+  while (pos != string::npos && (iMaxStrings == 0 || results.size() + 1 < iMaxStrings))
   {
-    results.push_back(input);
-    return 1;
+    StringRange range = { input.c_str() + start, pos - start };
+    results.push_back(range);
+    start = pos + delimiter.size();
+
+    size_t next = input.find(delimiter, start);
+    if (next == pos) // an empty delimiter is found at the same place over and over
+      break;
+    pos = next;
   }
 
-  while ( newPos > iPos )
-  {
-    positions.push_back(newPos);
-    iPos = newPos;
-    newPos = input.Find (delimiter, iPos + sizeS2);
-  }
+  StringRange range = { input.c_str() + start, input.size() - start };
+  results.push_back(range);
+  return results.size();
+}
 
-  // numFound is the number of delimiters which is one less
-  // than the number of substrings
-  unsigned int numFound = positions.size();
-  if (iMaxStrings > 0 && numFound >= iMaxStrings)
-    numFound = iMaxStrings - 1;
+int StringUtils::SplitString(const CStdString& input, const CStdString& delimiter, CStdStringArray &results, unsigned int iMaxStrings /* = 0 */)
+{
+  vector<StringRange> ranges;
+  SplitRanges(input, delimiter, ranges, iMaxStrings);
+
+  results.clear();
+  results.reserve(ranges.size());
+  for (vector<StringRange>::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+    results.push_back(CStdString(it->data, it->length));
 
-  for ( unsigned int i = 0; i <= numFound; i++ )
-  {
-    CStdString s;
-    if ( i == 0 )
-    {
-      if ( i == numFound )
-        s = input;
-      else
-        s = input.Mid( i, positions[i] );
-    }
-    else
-    {
-      int offset = positions[i - 1] + sizeS2;
-      if ( offset < isize )
-      {
-        if ( i == numFound )
-          s = input.Mid(offset);
-        else if ( i > 0 )
-          s = input.Mid( positions[i - 1] + sizeS2,
-                         positions[i] - positions[i - 1] - sizeS2 );
-      }
-    }
-    results.push_back(s);
-  }
   // return the number of substrings
   return results.size();
 }
@@ -312,12 +423,13 @@ CStdStringArray StringUtils::SplitString(const CStdString& input, const CStdStri
 
 vector<string> StringUtils::Split(const CStdString& input, const CStdString& delimiter, unsigned int iMaxStrings /* = 0 */)
 {
-  CStdStringArray result;
-  SplitString(input, delimiter, result, iMaxStrings);
+  vector<StringRange> ranges;
+  SplitRanges(input, delimiter, ranges, iMaxStrings);
 
   vector<string> strArray;
-  for (unsigned int index = 0; index < result.size(); index++)
-    strArray.push_back(result.at(index));
+  strArray.reserve(ranges.size());
+  for (vector<StringRange>::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+    strArray.push_back(it->str());
 
   return strArray;
 }
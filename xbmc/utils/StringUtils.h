@@ -36,6 +36,17 @@
 #include "XBDateTime.h"
 #include "utils/StdString.h"
 
+/*! \brief A piece of a string that is referenced rather than copied
+ Only valid as long as the string it was taken from is neither changed nor destroyed.
+ */
+struct StringRange
+{
+  const char *data;
+  size_t length;
+
+  std::string str() const { return std::string(data, length); }
+};
+
 class StringUtils
 {
 public:
@@ -55,6 +66,22 @@ public:
   static void ToUpper(std::string &str);
   static void ToLower(std::string &str);
   static bool EqualsNoCase(const std::string &str1, const std::string &str2);
+  /*! \brief Compare two strings ignoring the case of ASCII letters
+   \return negative if str1 < str2, positive if str1 > str2, 0 if they are equal
+   */
+  static int CompareNoCase(const std::string &str1, const std::string &str2);
+  /*! \brief Compare the first length bytes of two buffers ignoring the case of ASCII letters
+   Unlike strnicmp this doesn't stop at the end of a string, so both buffers must hold at least length bytes.
+   \return negative if str1 < str2, positive if str1 > str2, 0 if they are equal
+   */
+  static int CompareNoCase(const char *str1, const char *str2, size_t length);
+  /*! \brief Find a string ignoring the case of ASCII letters
+   \param str the string to search in
+   \param find the string to search for
+   \param start the position to start searching from
+   \return the position of the first match or std::string::npos if there is none
+   */
+  static size_t FindNoCase(const std::string &str, const std::string &find, size_t start = 0);
   static std::string Left(const std::string &str, size_t count);
   static std::string Mid(const std::string &str, size_t first, size_t count = std::string::npos);
   static std::string Right(const std::string &str, size_t count);
@@ -72,6 +99,14 @@ public:
   static int SplitString(const CStdString& input, const CStdString& delimiter, CStdStringArray &results, unsigned int iMaxStrings = 0);
   static CStdStringArray SplitString(const CStdString& input, const CStdString& delimiter, unsigned int iMaxStrings = 0);
   static std::vector<std::string> Split(const CStdString& input, const CStdString& delimiter, unsigned int iMaxStrings = 0);
+  /*! \brief Split a string like SplitString() does, without copying the pieces
+   \param input the string to split. It has to outlive the results.
+   \param delimiter the delimiter between the pieces
+   \param results [out] the pieces. Reusing the same vector avoids any allocation.
+   \param iMaxStrings the maximum number of pieces (0 for no limit)
+   \return the number of pieces
+   */
+  static int SplitRanges(const std::string& input, const std::string& delimiter, std::vector<StringRange> &results, unsigned int iMaxStrings = 0);
   static int FindNumber(const CStdString& strInput, const CStdString &strFind);
   static int64_t AlphaNumericCompare(const wchar_t *left, const wchar_t *right);
   static long TimeStringToSeconds(const CStdString &timeString);
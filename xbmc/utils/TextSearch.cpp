@@ -40,6 +40,18 @@ bool CTextSearch::IsValid(void) const
   return m_AND.size() > 0 || m_OR.size() > 0 || m_NOT.size() > 0;
 }
 
+bool CTextSearch::GetRequiredTerms(vector<CStdString> &terms) const
+{
+  if (m_AND.size() > 0)
+  {
+    terms = m_AND;
+    return true;
+  }
+
+  terms = m_OR;
+  return false;
+}
+
 bool CTextSearch::Search(const CStdString &strHaystack) const
 {
   if (strHaystack.IsEmpty() || !IsValid())
@@ -38,6 +38,9 @@ public:
   bool Search(const CStdString &strHaystack) const;
   bool IsValid(void) const;
 
+  /* get the terms a haystack has to contain to match. returns true if it has to contain all of them, false if one of them is enough */
+  bool GetRequiredTerms(std::vector<CStdString> &terms) const;
+
 private:
   void GetAndCutNextTerm(CStdString &strSearchTerm, CStdString &strNextTerm);
   void ExtractSearchTerms(const CStdString &strSearchTerm, TextSearchDefault defaultSearchMode);
@@ -274,14 +274,14 @@ bool URIUtils::GetParentPath(const CStdString& strPath, CStdString& strParent)
     CFileItemList items;
     dir.GetDirectory(strPath,items);
     GetDirectory(items[0]->GetPath(),items[0]->m_strDVDLabel);
-    if (items[0]->m_strDVDLabel.Mid(0,6).Equals("rar://") || items[0]->m_strDVDLabel.Mid(0,6).Equals("zip://"))
+    if (StringUtils::StartsWith(items[0]->m_strDVDLabel, "rar://") || StringUtils::StartsWith(items[0]->m_strDVDLabel, "zip://"))
       GetParentPath(items[0]->m_strDVDLabel, strParent);
     else
       strParent = items[0]->m_strDVDLabel;
     for( int i=1;i<items.Size();++i)
     {
       GetDirectory(items[i]->GetPath(),items[i]->m_strDVDLabel);
-      if (items[0]->m_strDVDLabel.Mid(0,6).Equals("rar://") || items[0]->m_strDVDLabel.Mid(0,6).Equals("zip://"))
+      if (StringUtils::StartsWith(items[0]->m_strDVDLabel, "rar://") || StringUtils::StartsWith(items[0]->m_strDVDLabel, "zip://"))
         items[i]->SetPath(GetParentPath(items[i]->m_strDVDLabel));
       else
         items[i]->SetPath(items[i]->m_strDVDLabel);
@@ -420,16 +420,16 @@ bool URIUtils::IsOnDVD(const CStdString& strFile)
     return (GetDriveType(strFile.Left(2)) == DRIVE_CDROM);
 #endif
 
-  if (strFile.Left(4).CompareNoCase("dvd:") == 0)
+  if (StringUtils::StartsWith(strFile, "dvd:"))
     return true;
 
-  if (strFile.Left(4).CompareNoCase("udf:") == 0)
+  if (StringUtils::StartsWith(strFile, "udf:"))
     return true;
 
-  if (strFile.Left(8).CompareNoCase("iso9660:") == 0)
+  if (StringUtils::StartsWith(strFile, "iso9660:"))
     return true;
 
-  if (strFile.Left(5).CompareNoCase("cdda:") == 0)
+  if (StringUtils::StartsWith(strFile, "cdda:"))
     return true;
 
   return false;
@@ -497,7 +497,7 @@ bool URIUtils::IsOnLAN(const CStdString& strPath)
 
 bool URIUtils::IsMultiPath(const CStdString& strPath)
 {
-  return strPath.Left(10).Equals("multipath:");
+  return StringUtils::StartsWith(strPath, "multipath:");
 }
 
 bool URIUtils::IsHD(const CStdString& strFileName)
@@ -524,7 +524,7 @@ bool URIUtils::IsDVD(const CStdString& strFile)
     return true;
 
 #if defined(_WIN32)
-  if (strFile.Left(6).Equals("dvd://"))
+  if (StringUtils::StartsWith(strFile, "dvd://"))
     return true;
 
   if(strFile.Mid(1) != ":\\"
@@ -543,7 +543,7 @@ bool URIUtils::IsDVD(const CStdString& strFile)
 
 bool URIUtils::IsStack(const CStdString& strFile)
 {
-  return strFile.Left(6).Equals("stack:");
+  return StringUtils::StartsWith(strFile, "stack:");
 }
 
 bool URIUtils::IsRAR(const CStdString& strFile)
@@ -628,12 +628,10 @@ bool URIUtils::IsArchive(const CStdString& strFile)
 
 bool URIUtils::IsSpecial(const CStdString& strFile)
 {
-  CStdString strFile2(strFile);
-
   if (IsStack(strFile))
-    strFile2 = CStackDirectory::GetFirstStackedFile(strFile);
+    return StringUtils::StartsWith(CStackDirectory::GetFirstStackedFile(strFile), "special:");
 
-  return strFile2.Left(8).Equals("special:");
+  return StringUtils::StartsWith(strFile, "special:");
 }
 
 bool URIUtils::IsPlugin(const CStdString& strFile)
@@ -662,22 +660,20 @@ bool URIUtils::IsSourcesPath(const CStdString& strPath)
 
 bool URIUtils::IsCDDA(const CStdString& strFile)
 {
-  return strFile.Left(5).Equals("cdda:");
+  return StringUtils::StartsWith(strFile, "cdda:");
 }
 
 bool URIUtils::IsISO9660(const CStdString& strFile)
 {
-  return strFile.Left(8).Equals("iso9660:");
+  return StringUtils::StartsWith(strFile, "iso9660:");
 }
 
 bool URIUtils::IsSmb(const CStdString& strFile)
 {
-  CStdString strFile2(strFile);
-
   if (IsStack(strFile))
-    strFile2 = CStackDirectory::GetFirstStackedFile(strFile);
+    return StringUtils::StartsWith(CStackDirectory::GetFirstStackedFile(strFile), "smb:");
 
-  return strFile2.Left(4).Equals("smb:");
+  return StringUtils::StartsWith(strFile, "smb:");
 }
 
 bool URIUtils::IsURL(const CStdString& strFile)
@@ -692,8 +688,8 @@ bool URIUtils::IsFTP(const CStdString& strFile)
   if (IsStack(strFile))
     strFile2 = CStackDirectory::GetFirstStackedFile(strFile);
 
-  return strFile2.Left(4).Equals("ftp:")  ||
-         strFile2.Left(5).Equals("ftps:");
+  return StringUtils::StartsWith(strFile2, "ftp:")  ||
+         StringUtils::StartsWith(strFile2, "ftps:");
 }
 
 bool URIUtils::IsInternetStream(const CURL& url, bool bStrictCheck /* = false */)
@@ -729,42 +725,42 @@ bool URIUtils::IsInternetStream(const CURL& url, bool bStrictCheck /* = false */
 
 bool URIUtils::IsDAAP(const CStdString& strFile)
 {
-  return strFile.Left(5).Equals("daap:");
+  return StringUtils::StartsWith(strFile, "daap:");
 }
 
 bool URIUtils::IsUPnP(const CStdString& strFile)
 {
-  return strFile.Left(5).Equals("upnp:");
+  return StringUtils::StartsWith(strFile, "upnp:");
 }
 
 bool URIUtils::IsTuxBox(const CStdString& strFile)
 {
-  return strFile.Left(7).Equals("tuxbox:");
+  return StringUtils::StartsWith(strFile, "tuxbox:");
 }
 
 bool URIUtils::IsMythTV(const CStdString& strFile)
 {
-  return strFile.Left(5).Equals("myth:");
+  return StringUtils::StartsWith(strFile, "myth:");
 }
 
 bool URIUtils::IsHDHomeRun(const CStdString& strFile)
 {
-  return strFile.Left(10).Equals("hdhomerun:");
+  return StringUtils::StartsWith(strFile, "hdhomerun:");
 }
 
 bool URIUtils::IsSlingbox(const CStdString& strFile)
 {
-  return strFile.Left(6).Equals("sling:");
+  return StringUtils::StartsWith(strFile, "sling:");
 }
 
 bool URIUtils::IsVTP(const CStdString& strFile)
 {
-  return strFile.Left(4).Equals("vtp:");
+  return StringUtils::StartsWith(strFile, "vtp:");
 }
 
 bool URIUtils::IsHTSP(const CStdString& strFile)
 {
-  return strFile.Left(5).Equals("htsp:");
+  return StringUtils::StartsWith(strFile, "htsp:");
 }
 
 bool URIUtils::IsLiveTV(const CStdString& strFile)
@@ -777,8 +773,8 @@ bool URIUtils::IsLiveTV(const CStdString& strFile)
   || IsHDHomeRun(strFile)
   || IsSlingbox(strFile)
   || IsHTSP(strFile)
-  || strFile.Left(4).Equals("sap:")
-  ||(strFileWithoutSlash.Right(4).Equals(".pvr") && !strFileWithoutSlash.Left(16).Equals("pvr://recordings")))
+  || StringUtils::StartsWith(strFile, "sap:")
+  ||(StringUtils::EndsWith(strFileWithoutSlash, ".pvr") && !StringUtils::StartsWith(strFileWithoutSlash, "pvr://recordings")))
     return true;
 
   if (IsMythTV(strFile) && CMythDirectory::IsLiveTV(strFile))
@@ -792,54 +788,50 @@ bool URIUtils::IsPVRRecording(const CStdString& strFile)
   CStdString strFileWithoutSlash(strFile);
   RemoveSlashAtEnd(strFileWithoutSlash);
 
-  return strFileWithoutSlash.Right(4).Equals(".pvr") &&
-         strFile.Left(16).Equals("pvr://recordings");
+  return StringUtils::EndsWith(strFileWithoutSlash, ".pvr") &&
+         StringUtils::StartsWith(strFile, "pvr://recordings");
 }
 
 bool URIUtils::IsMusicDb(const CStdString& strFile)
 {
-  return strFile.Left(8).Equals("musicdb:");
+  return StringUtils::StartsWith(strFile, "musicdb:");
 }
 
 bool URIUtils::IsNfs(const CStdString& strFile)
 {
-  CStdString strFile2(strFile);
-  
   if (IsStack(strFile))
-    strFile2 = CStackDirectory::GetFirstStackedFile(strFile);
-  
-  return strFile2.Left(4).Equals("nfs:");
+    return StringUtils::StartsWith(CStackDirectory::GetFirstStackedFile(strFile), "nfs:");
+
+  return StringUtils::StartsWith(strFile, "nfs:");
 }
 
 bool URIUtils::IsAfp(const CStdString& strFile)
 {
-  CStdString strFile2(strFile);
-  
   if (IsStack(strFile))
-    strFile2 = CStackDirectory::GetFirstStackedFile(strFile);
-  
-  return strFile2.Left(4).Equals("afp:");
+    return StringUtils::StartsWith(CStackDirectory::GetFirstStackedFile(strFile), "afp:");
+
+  return StringUtils::StartsWith(strFile, "afp:");
 }
 
 
 bool URIUtils::IsVideoDb(const CStdString& strFile)
 {
-  return strFile.Left(8).Equals("videodb:");
+  return StringUtils::StartsWith(strFile, "videodb:");
 }
 
 bool URIUtils::IsLastFM(const CStdString& strFile)
 {
-  return strFile.Left(7).Equals("lastfm:");
+  return StringUtils::StartsWith(strFile, "lastfm:");
 }
 
 bool URIUtils::IsBluray(const CStdString& strFile)
 {
-  return strFile.Left(7).Equals("bluray:");
+  return StringUtils::StartsWith(strFile, "bluray:");
 }
 
 bool URIUtils::IsAndroidApp(const CStdString &path)
 {
-  return path.Left(11).Equals("androidapp:");
+  return StringUtils::StartsWith(path, "androidapp:");
 }
 
 bool URIUtils::IsDOSPath(const CStdString &path)
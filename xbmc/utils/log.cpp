@@ -22,6 +22,7 @@
 #include "log.h"
 #include "stdio_utf8.h"
 #include "stat_utf8.h"
+#include "threads/Atomics.h"
 #include "threads/CriticalSection.h"
 #include "threads/SingleLock.h"
 #include "threads/Thread.h"
@@ -31,6 +32,13 @@
 #elif defined(TARGET_WINDOWS)
 #include "win32/WIN32Util.h"
 #endif
+#if defined(TARGET_POSIX)
+#include <signal.h>
+#include <unistd.h>
+#endif
+#include <stdlib.h>
+
+#define LOG_WRITE_INTERVAL 100 // ms between batches
 
 #define critSec XBMC_GLOBAL_USE(CLog::CLogGlobals).critSec
 #define m_file XBMC_GLOBAL_USE(CLog::CLogGlobals).m_file
@@ -38,10 +46,123 @@
 #define m_repeatLogLevel XBMC_GLOBAL_USE(CLog::CLogGlobals).m_repeatLogLevel
 #define m_repeatLine XBMC_GLOBAL_USE(CLog::CLogGlobals).m_repeatLine
 #define m_logLevel XBMC_GLOBAL_USE(CLog::CLogGlobals).m_logLevel
+#define m_queue XBMC_GLOBAL_USE(CLog::CLogGlobals).m_queue
+#define m_enqueuePos XBMC_GLOBAL_USE(CLog::CLogGlobals).m_enqueuePos
+#define m_dequeuePos XBMC_GLOBAL_USE(CLog::CLogGlobals).m_dequeuePos
+#define m_dropped XBMC_GLOBAL_USE(CLog::CLogGlobals).m_dropped
+#define m_writer XBMC_GLOBAL_USE(CLog::CLogGlobals).m_writer
+#define m_wake XBMC_GLOBAL_USE(CLog::CLogGlobals).m_wake
+#define m_writing XBMC_GLOBAL_USE(CLog::CLogGlobals).m_writing
 
 static char levelNames[][8] =
 {"DEBUG", "INFO", "NOTICE", "WARNING", "ERROR", "SEVERE", "FATAL", "NONE"};
 
+static const char* prefixFormat = "%02.2d:%02.2d:%02.2d T:%"PRIu64" %7s: ";
+
+struct CLog::LogLine
+{
+  int        level;
+  SYSTEMTIME time;
+  uint64_t   thread;
+  CStdString data;
+};
+
+class CLog::CLogWriter : public CThread
+{
+public:
+  CLogWriter() : CThread("CLogWriter") {}
+
+protected:
+  virtual void Process()
+  {
+    while (!m_bStop)
+    {
+      AbortableWait(m_wake, LOG_WRITE_INTERVAL);
+      CLog::WriteQueued();
+    }
+  }
+};
+
+#if defined(TARGET_POSIX)
+static volatile int crashFd = -1; // descriptor of the log file for the crash handler
+
+/* write a number padded to at least the given digits, async-signal-safe */
+static char *AppendNumber(char *buffer, uint64_t value, int digits)
+{
+  char reversed[20];
+  int count = 0;
+  do
+  {
+    reversed[count++] = '0' + (char)(value % 10);
+    value /= 10;
+  } while (value && count < (int)sizeof(reversed));
+  while (count < digits && count < (int)sizeof(reversed))
+    reversed[count++] = '0';
+  while (count)
+    *buffer++ = reversed[--count];
+  return buffer;
+}
+
+/* Write out the lines still waiting in the queue when we crash. Only uses what is
+   async-signal-safe: the lines are formatted already, so the prefix is put together
+   by hand and everything goes out with write(2), without the lock or stdio. Lines the
+   writer has taken off the queue but not flushed yet are lost. */
+static void CrashHandler(int signum)
+{
+  int fd = crashFd;
+  if (fd >= 0)
+  {
+    long last = m_enqueuePos;
+    for (long pos = m_dequeuePos; pos != last; pos++)
+    {
+      CLog::CLogGlobals::QueueSlot &slot = m_queue[pos & (LOG_QUEUE_SIZE - 1)];
+      if (slot.sequence != pos + 1 || !slot.line)
+        continue;
+
+      const CLog::LogLine &line = *slot.line;
+      char prefix[64];
+      char *end = prefix;
+      end = AppendNumber(end, line.time.wHour, 2);
+      *end++ = ':';
+      end = AppendNumber(end, line.time.wMinute, 2);
+      *end++ = ':';
+      end = AppendNumber(end, line.time.wSecond, 2);
+      *end++ = ' ';
+      *end++ = 'T';
+      *end++ = ':';
+      end = AppendNumber(end, line.thread, 1);
+      *end++ = ' ';
+      const char *level = levelNames[line.level];
+      for (size_t length = strlen(level); length < 7; length++)
+        *end++ = ' ';
+      while (*level)
+        *end++ = *level++;
+      *end++ = ':';
+      *end++ = ' ';
+
+      if (write(fd, prefix, end - prefix) < 0 ||
+          write(fd, line.data.c_str(), line.data.size()) < 0 ||
+          write(fd, LINE_ENDING, strlen(LINE_ENDING)) < 0)
+        break;
+    }
+  }
+  // the handler was reset, so this carries on with the crash
+  raise(signum);
+}
+
+static void SetCrashHandler(int signum)
+{
+  struct sigaction action, old;
+  if (sigaction(signum, NULL, &old) != 0 || old.sa_handler != SIG_DFL)
+    return; // someone else handles it
+
+  action.sa_handler = CrashHandler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESETHAND;
+  sigaction(signum, &action, NULL);
+}
+#endif
+
 CLog::CLog()
 {}
 
@@ -50,10 +171,14 @@ CLog::~CLog()
 
 void CLog::Close()
 {
-  
+  StopWriter();
+
   CSingleLock waitLock(critSec);
   if (m_file)
   {
+#if defined(TARGET_POSIX)
+    crashFd = -1;
+#endif
     fclose(m_file);
     m_file = NULL;
   }
@@ -62,8 +187,6 @@ void CLog::Close()
 
 void CLog::Log(int loglevel, const char *format, ... )
 {
-  static const char* prefixFormat = "%02.2d:%02.2d:%02.2d T:%"PRIu64" %7s: ";
-  CSingleLock waitLock(critSec);
 #if !(defined(_DEBUG) || defined(PROFILE))
   if (m_logLevel > LOG_LEVEL_NORMAL ||
      (m_logLevel > LOG_LEVEL_NONE && loglevel >= LOGNOTICE))
@@ -72,66 +195,193 @@ void CLog::Log(int loglevel, const char *format, ... )
     if (!m_file)
       return;
 
-    SYSTEMTIME time;
-    GetLocalTime(&time);
-
-    CStdString strPrefix, strData;
+    LogLine *line = new LogLine;
+    line->level = loglevel;
+    GetLocalTime(&line->time);
+    line->thread = (uint64_t)CThread::GetCurrentThreadId();
 
-    strData.reserve(16384);
     va_list va;
     va_start(va, format);
-    strData.FormatV(format,va);
+    line->data.FormatV(format,va);
     va_end(va);
 
-    if (m_repeatLogLevel == loglevel && m_repeatLine == strData)
-    {
-      m_repeatCount++;
-      return;
-    }
-    else if (m_repeatCount)
+    if (!Enqueue(line))
     {
-      CStdString strData2;
-      strPrefix.Format(prefixFormat, time.wHour, time.wMinute, time.wSecond, (uint64_t)CThread::GetCurrentThreadId(), levelNames[m_repeatLogLevel]);
-
-      strData2.Format("Previous line repeats %d times." LINE_ENDING, m_repeatCount);
-      fputs(strPrefix.c_str(), m_file);
-      fputs(strData2.c_str(), m_file);
-      OutputDebugString(strData2);
-      m_repeatCount = 0;
+      if (loglevel < LOGSEVERE)
+      {
+        AtomicIncrement(&m_dropped);
+        delete line;
+        return;
+      }
+      // too important to drop, make room for it
+      WriteQueued();
+      if (!Enqueue(line))
+      {
+        AtomicIncrement(&m_dropped);
+        delete line;
+      }
     }
-    
-    m_repeatLine      = strData;
-    m_repeatLogLevel  = loglevel;
 
-    unsigned int length = 0;
-    while ( length != strData.length() )
+    // severe errors may well be the last thing we get to log, and without
+    // a writer (before Init() or after shutdown) nobody else writes lines out
+    if (loglevel >= LOGSEVERE || !m_writer)
+      WriteQueued();
+  }
+}
+
+bool CLog::Enqueue(LogLine *line)
+{
+  long pos = m_enqueuePos;
+  while (true)
+  {
+    CLogGlobals::QueueSlot &slot = m_queue[pos & (LOG_QUEUE_SIZE - 1)];
+    long diff = AtomicAdd(&slot.sequence, 0) - pos;
+    if (diff == 0)
     {
-      length = strData.length();
-      strData.TrimRight(" ");
-      strData.TrimRight('\n');
-      strData.TrimRight("\r");
+      // the slot is free, claim it
+      if (cas(&m_enqueuePos, pos, pos + 1) == pos)
+      {
+        slot.line = line;
+        AtomicIncrement(&slot.sequence); // publish it
+        break;
+      }
+      pos = m_enqueuePos;
     }
+    else if (diff < 0)
+      return false; // the slot hasn't been read yet, the queue is full
+    else
+      pos = m_enqueuePos; // someone else claimed it
+  }
 
-    if (!length)
-      return;
-    
-    OutputDebugString(strData);
+  if (pos - m_dequeuePos >= LOG_QUEUE_SIZE / 2)
+    m_wake.Set();
+  return true;
+}
+
+CLog::LogLine *CLog::Dequeue()
+{
+  // only called with critSec held, so there is a single reader
+  CLogGlobals::QueueSlot &slot = m_queue[m_dequeuePos & (LOG_QUEUE_SIZE - 1)];
+  if (AtomicAdd(&slot.sequence, 0) != m_dequeuePos + 1)
+    return NULL;
+
+  LogLine *line = slot.line;
+  slot.line = NULL;
+  AtomicAdd(&slot.sequence, LOG_QUEUE_SIZE - 1); // free for the next round
+  m_dequeuePos++;
+  return line;
+}
+
+void CLog::WriteQueued()
+{
+  CSingleLock waitLock(critSec);
+  m_writing = true;
+  LogLine *line;
+  bool written = false;
+  while ((line = Dequeue()) != NULL)
+  {
+    WriteLine(*line);
+    delete line;
+    written = true;
+  }
+
+  long dropped = m_dropped;
+  if (dropped > 0)
+  {
+    AtomicSubtract(&m_dropped, dropped);
+    LogLine notice;
+    notice.level = LOGWARNING;
+    GetLocalTime(&notice.time);
+    notice.thread = (uint64_t)CThread::GetCurrentThreadId();
+    notice.data.Format("%ld log lines were dropped, they came in faster than they could be written", dropped);
+    WriteLine(notice);
+    written = true;
+  }
 
-    /* fixup newline alignment, number of spaces should equal prefix length */
-    strData.Replace("\n", LINE_ENDING"                                            ");
-    strData += LINE_ENDING;
+  if (written && m_file)
+    fflush(m_file);
+  m_writing = false;
+}
 
-    strPrefix.Format(prefixFormat, time.wHour, time.wMinute, time.wSecond, (uint64_t)CThread::GetCurrentThreadId(), levelNames[loglevel]);
+void CLog::WriteLine(const LogLine &line)
+{
+  if (!m_file)
+    return;
+
+  CStdString strPrefix;
+  if (m_repeatLogLevel == line.level && m_repeatLine == line.data)
+  {
+    m_repeatCount++;
+    return;
+  }
+  else if (m_repeatCount)
+  {
+    CStdString strData2;
+    strPrefix.Format(prefixFormat, line.time.wHour, line.time.wMinute, line.time.wSecond, line.thread, levelNames[m_repeatLogLevel]);
+
+    strData2.Format("Previous line repeats %d times." LINE_ENDING, m_repeatCount);
+    fputs(strPrefix.c_str(), m_file);
+    fputs(strData2.c_str(), m_file);
+    OutputDebugString(strData2);
+    m_repeatCount = 0;
+  }
+
+  m_repeatLine      = line.data;
+  m_repeatLogLevel  = line.level;
+
+  CStdString strData(line.data);
+  unsigned int length = 0;
+  while ( length != strData.length() )
+  {
+    length = strData.length();
+    strData.TrimRight(" ");
+    strData.TrimRight('\n');
+    strData.TrimRight("\r");
+  }
+
+  if (!length)
+    return;
+
+  OutputDebugString(strData);
+
+  /* fixup newline alignment, number of spaces should equal prefix length */
+  strData.Replace("\n", LINE_ENDING"                                            ");
+  strData += LINE_ENDING;
+
+  strPrefix.Format(prefixFormat, line.time.wHour, line.time.wMinute, line.time.wSecond, line.thread, levelNames[line.level]);
 
 //print to adb
 #if defined(TARGET_ANDROID) && defined(_DEBUG)
   CXBMCApp::android_printf("%s%s",strPrefix.c_str(), strData.c_str());
 #endif
 
-    fputs(strPrefix.c_str(), m_file);
-    fputs(strData.c_str(), m_file);
-    fflush(m_file);
+  fputs(strPrefix.c_str(), m_file);
+  fputs(strData.c_str(), m_file);
+}
+
+void CLog::Flush()
+{
+  // whoever holds the lock when we crash might never let go of it, and if
+  // it's us the lines and the file may be half written
+  CSingleTryLock waitLock(critSec);
+  if (waitLock.IsOwner() && !m_writing)
+    WriteQueued();
+}
+
+void CLog::StopWriter()
+{
+  CLogWriter *writer;
+  {
+    CSingleLock waitLock(critSec);
+    writer = m_writer;
+    m_writer = NULL; // from now on lines are written as they come in
+  }
+  if (writer)
+  {
+    writer->StopThread();
+    delete writer;
   }
+  WriteQueued();
 }
 
 bool CLog::Init(const char* path)
@@ -168,6 +418,31 @@ bool CLog::Init(const char* path)
   {
     unsigned char BOM[3] = {0xEF, 0xBB, 0xBF};
     fwrite(BOM, sizeof(BOM), 1, m_file);
+
+    if (!m_writer)
+    {
+      m_writer = new CLogWriter();
+      m_writer->Create();
+    }
+
+#if defined(TARGET_POSIX)
+    crashFd = fileno(m_file);
+#endif
+    static bool handlersSet = false;
+    if (!handlersSet)
+    {
+      // write out what's queued on exit. Severe and fatal lines are written right
+      // away, and on a crash the handler writes out the lines still queued.
+      atexit(StopWriter);
+#if defined(TARGET_POSIX)
+      SetCrashHandler(SIGSEGV);
+      SetCrashHandler(SIGBUS);
+      SetCrashHandler(SIGFPE);
+      SetCrashHandler(SIGILL);
+      SetCrashHandler(SIGABRT);
+#endif
+      handlersSet = true;
+    }
   }
 
   return m_file != NULL;
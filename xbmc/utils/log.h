@@ -25,28 +25,67 @@
 
 #include "commons/ilog.h"
 #include "threads/CriticalSection.h"
+#include "threads/Event.h"
 #include "utils/GlobalsHandling.h"
 
+/*! \brief number of lines that can wait for the log writer, a power of two */
+#define LOG_QUEUE_SIZE 4096
+
 #ifdef __GNUC__
 #define ATTRIB_LOG_FORMAT __attribute__((format(printf,2,3)))
 #else
 #define ATTRIB_LOG_FORMAT
 #endif
 
+/*!
+ \brief The log file.
+
+ Log() only formats the line and hands it to a queue without taking any lock,
+ a writer thread takes the lines off the queue and writes them out in batches.
+ When the queue is full, lines are dropped and counted rather than blocking
+ the logging thread. Severe and fatal errors, and lines logged while there is
+ no writer thread, are written out right away. On POSIX systems a crash handler
+ writes out the lines still queued when the process dies of a signal.
+ */
 class CLog
 {
 public:
+  struct LogLine;
+  class CLogWriter;
 
   class CLogGlobals
   {
   public:
-    CLogGlobals() : m_file(NULL), m_repeatCount(0), m_repeatLogLevel(-1), m_logLevel(LOG_LEVEL_DEBUG) {}
+    CLogGlobals() : m_file(NULL), m_repeatCount(0), m_repeatLogLevel(-1), m_logLevel(LOG_LEVEL_DEBUG),
+                    m_enqueuePos(0), m_dequeuePos(0), m_dropped(0), m_writer(NULL), m_writing(false)
+    {
+      for (long i = 0; i < LOG_QUEUE_SIZE; i++)
+      {
+        m_queue[i].sequence = i;
+        m_queue[i].line = NULL;
+      }
+    }
     FILE*       m_file;
     int         m_repeatCount;
     int         m_repeatLogLevel;
     std::string m_repeatLine;
     int         m_logLevel;
-    CCriticalSection critSec;
+    CCriticalSection critSec;   // held while writing to the file
+
+    /* Lines waiting to be written. A slot may be filled when its sequence
+       equals the enqueue position and read once it is one more than that. */
+    struct QueueSlot
+    {
+      volatile long sequence;
+      LogLine*      line;
+    };
+    QueueSlot     m_queue[LOG_QUEUE_SIZE];
+    volatile long m_enqueuePos;
+    volatile long m_dequeuePos; // only advanced with critSec held
+    volatile long m_dropped;    // lines dropped because the queue was full
+    CLogWriter*   m_writer;
+    bool          m_writing;    // set with critSec held while lines are written out
+    CEvent        m_wake;       // wakes the writer before its time when the queue fills up
   };
 
   CLog();
@@ -57,7 +96,19 @@ public:
   static bool Init(const char* path);
   static void SetLogLevel(int level);
   static int  GetLogLevel();
+
+  /*!
+   \brief Write out all queued lines now, for use from the windows crash dump filter.
+   Does nothing if another thread is busy writing, or if the crash happened while this
+   thread was writing. Not async-signal-safe, so it must not be called from a signal handler.
+   */
+  static void Flush();
 private:
+  static bool Enqueue(LogLine *line);
+  static LogLine *Dequeue();
+  static void WriteQueued();
+  static void WriteLine(const LogLine &line);
+  static void StopWriter();
   static void OutputDebugString(const std::string& line);
 };
 
@@ -21,11 +21,18 @@
 #include "utils/Archive.h"
 #include "utils/Variant.h"
 #include "filesystem/File.h"
+#include "music/tags/MusicInfoTag.h"
+#include "threads/SystemClock.h"
+#include "FileItem.h"
 
 #include "test/TestUtils.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_ITEMS 50000
+
 class TestArchive : public testing::Test
 {
 protected:
@@ -398,3 +405,140 @@ TEST_F(TestArchive, MultiTypeArchive)
   EXPECT_EQ(2, iArray_var.at(2));
   EXPECT_EQ(3, iArray_var.at(3));
 }
+
+TEST_F(TestArchive, StringTableArchive)
+{
+  ASSERT_TRUE(file);
+  CStdString CStdString_ref = "repeated", CStdString_var = "";
+  std::string string_ref = "other", string_var = "";
+  std::vector<std::string> strArray_ref, strArray_var;
+  strArray_ref.push_back("repeated");
+  strArray_ref.push_back("");
+  strArray_ref.push_back("other");
+  int int_ref = 3, int_var = 0;
+
+  CArchive arstore(file, CArchive::store);
+  arstore.EnableStringTable();
+  arstore << CStdString_ref;
+  arstore << string_ref;
+  arstore << strArray_ref;
+  arstore << CStdString_ref;
+  arstore << int_ref;
+  arstore.Close();
+
+  ASSERT_TRUE((file->Seek(0, SEEK_SET) == 0));
+  CArchive arload(file, CArchive::load);
+  arload.EnableStringTable();
+  arload >> CStdString_var;
+  arload >> string_var;
+  arload >> strArray_var;
+  CStdString_var.clear();
+  arload >> CStdString_var;
+  arload >> int_var;
+  arload.Close();
+
+  EXPECT_STREQ(CStdString_ref.c_str(), CStdString_var.c_str());
+  EXPECT_STREQ(string_ref.c_str(), string_var.c_str());
+  ASSERT_EQ(3U, strArray_var.size());
+  EXPECT_STREQ("repeated", strArray_var.at(0).c_str());
+  EXPECT_STREQ("", strArray_var.at(1).c_str());
+  EXPECT_STREQ("other", strArray_var.at(2).c_str());
+  EXPECT_EQ(int_ref, int_var);
+}
+
+TEST_F(TestArchive, CloseReturnsUnreadData)
+{
+  ASSERT_TRUE(file);
+  int int_ref = 3, int_var = 0;
+
+  CArchive arstore(file, CArchive::store);
+  arstore << int_ref;
+  arstore << int_ref + 1;
+  arstore.Close();
+
+  ASSERT_TRUE((file->Seek(0, SEEK_SET) == 0));
+  CArchive arload(file, CArchive::load);
+  arload >> int_var;
+  arload.Close();
+
+  EXPECT_EQ(int_ref, int_var);
+  EXPECT_EQ((int64_t)sizeof(int), file->GetPosition());
+}
+
+/* loads the way CArchive used to, reading every field from the file on its own */
+class CUnbufferedArchive : public CArchive
+{
+public:
+  CUnbufferedArchive(XFILE::CFile *file) : CArchive(file, CArchive::load, 1) {}
+};
+
+static unsigned int LoadFileItemsUnbuffered(XFILE::CFile *file, CFileItemList &items)
+{
+  file->Seek(0, SEEK_SET);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  CUnbufferedArchive ar(file);
+  ar >> items;
+  ar.Close();
+  return XbmcThreads::SystemClockMillis() - iStart;
+}
+
+static unsigned int ArchiveFileItems(XFILE::CFile *file, CFileItemList &items, bool stringTable)
+{
+  file->Seek(0, SEEK_SET);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  CArchive ar(file, items.Size() ? CArchive::store : CArchive::load);
+  if (stringTable)
+    ar.EnableStringTable();
+  if (ar.IsStoring())
+    ar << items;
+  else
+    ar >> items;
+  ar.Close();
+  return XbmcThreads::SystemClockMillis() - iStart;
+}
+
+TEST_F(TestArchive, FileItemListBenchmark)
+{
+  ASSERT_TRUE(file);
+  CFileItemList items;
+  for (int i = 0; i < BENCHMARK_ITEMS; i++)
+  {
+    CStdString strNumber;
+    strNumber.Format("%05i", i);
+    CFileItemPtr item(new CFileItem("Track " + strNumber));
+    item->SetPath("smb://server/music/Artist " + strNumber.Left(2) + "/Album " + strNumber.Left(3) + "/" + strNumber + ".mp3");
+    item->SetMimeType("audio/mpeg");
+    item->GetMusicInfoTag()->SetTitle("Track " + strNumber);
+    item->GetMusicInfoTag()->SetArtist("Artist " + strNumber.Left(2));
+    item->GetMusicInfoTag()->SetAlbum("Album " + strNumber.Left(3));
+    item->GetMusicInfoTag()->SetGenre("Genre " + strNumber.Right(1));
+    item->GetMusicInfoTag()->SetTrackNumber(i % 100);
+    item->GetMusicInfoTag()->SetLoaded();
+    items.Add(item);
+  }
+
+  for (int table = 0; table < 2; table++)
+  {
+    unsigned int iSave = ArchiveFileItems(file, items, table == 1);
+    int64_t iBytes = file->GetPosition();
+
+    CFileItemList loaded;
+    unsigned int iLoad = ArchiveFileItems(file, loaded, table == 1);
+
+    ASSERT_EQ(BENCHMARK_ITEMS, loaded.Size());
+    EXPECT_STREQ(items[BENCHMARK_ITEMS - 1]->GetPath().c_str(), loaded[BENCHMARK_ITEMS - 1]->GetPath().c_str());
+    EXPECT_STREQ("Album 499", loaded[BENCHMARK_ITEMS - 1]->GetMusicInfoTag()->GetAlbum().c_str());
+    EXPECT_STREQ("audio/mpeg", loaded[BENCHMARK_ITEMS - 1]->GetMimeType().c_str());
+    std::cout << BENCHMARK_ITEMS << " items " << (table ? "with" : "without") << " string table: " <<
+      iBytes << " bytes, saved in " << iSave << " ms, loaded in " << iLoad << " ms" << std::endl;
+
+    if (!table)
+    { // the baseline: loading without reading ahead
+      CFileItemList unbuffered;
+      unsigned int iUnbuffered = LoadFileItemsUnbuffered(file, unbuffered);
+      ASSERT_EQ(BENCHMARK_ITEMS, unbuffered.Size());
+      EXPECT_STREQ(items[BENCHMARK_ITEMS - 1]->GetPath().c_str(), unbuffered[BENCHMARK_ITEMS - 1]->GetPath().c_str());
+      std::cout << BENCHMARK_ITEMS << " items without read ahead: loaded in " << iUnbuffered << " ms" << std::endl;
+    }
+  }
+}
@@ -19,10 +19,64 @@
  */
 
 #include "settings/GUISettings.h"
+#include "threads/SystemClock.h"
+#include "threads/Thread.h"
 #include "utils/CharsetConverter.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_CONVERSIONS 100000
+#define BENCHMARK_THREADS     4
+
+static const char benchmarkUtf8[] = "\xEF\xBC\xB4\xEF\xBD\x85\xEF\xBD\x93\xEF\xBD\x94 test benchmark t\xC3\xABst b\xC3\xA9nchm\xC3\xA4rk \xF0\x9F\x90\xAD";
+
+class ConversionRunner : public IRunnable
+{
+public:
+  ConversionRunner(bool iconv) : m_iconv(iconv) {}
+  virtual void Run()
+  {
+    CStdStringA source(benchmarkUtf8), utf8;
+    CStdStringW wide;
+    for (int i = 0; i < BENCHMARK_CONVERSIONS / BENCHMARK_THREADS; i++)
+    {
+      if (m_iconv)
+      {
+        g_charsetConverter.toW(source, wide, "UTF-8");
+        g_charsetConverter.fromW(wide, utf8, "UTF-8");
+      }
+      else
+      {
+        g_charsetConverter.utf8ToW(source, wide, false);
+        g_charsetConverter.wToUTF8(wide, utf8);
+      }
+    }
+  }
+private:
+  bool m_iconv;
+};
+
+static unsigned int RunConversions(bool iconv)
+{
+  ConversionRunner runner(iconv);
+  CThread* threads[BENCHMARK_THREADS];
+
+  unsigned int start = XbmcThreads::SystemClockMillis();
+  for (int i = 0; i < BENCHMARK_THREADS; i++)
+  {
+    threads[i] = new CThread(&runner, "ConversionRunner");
+    threads[i]->Create();
+  }
+  for (int i = 0; i < BENCHMARK_THREADS; i++)
+  {
+    threads[i]->WaitForThreadExit(0xFFFFFFFF);
+    delete threads[i];
+  }
+  return XbmcThreads::SystemClockMillis() - start;
+}
+
 static const uint16_t refutf16LE1[] = { 0xff54, 0xff45, 0xff53, 0xff54,
                                         0xff3f, 0xff55, 0xff54, 0xff46,
                                         0xff11, 0xff16, 0xff2c, 0xff25,
@@ -393,3 +447,44 @@ TEST_F(TestCharsetConverter, fromW)
   g_charsetConverter.fromW(refstrw1, varstra1, "UTF-16LE");
   EXPECT_STREQ(refstra1.c_str(), varstra1.c_str());
 }
+
+TEST_F(TestCharsetConverter, utf8RoundTrip)
+{
+  refstra1 = benchmarkUtf8;
+  varstrw1.clear();
+  g_charsetConverter.utf8ToW(refstra1, varstrw1, false);
+  g_charsetConverter.wToUTF8(varstrw1, varstra1);
+  EXPECT_STREQ(refstra1.c_str(), varstra1.c_str());
+
+  /* the same as iconv would make of it */
+  refstrw1.clear();
+  g_charsetConverter.toW(refstra1, refstrw1, "UTF-8");
+  EXPECT_TRUE(refstrw1 == varstrw1);
+
+  /* invalid sequences are skipped */
+  refstra1 = "a\xC0\xAFz\xED\xA0\x80q";
+  g_charsetConverter.utf8ToW(refstra1, varstrw1, false);
+  EXPECT_STREQ(L"azq", varstrw1.c_str());
+}
+
+TEST_F(TestCharsetConverter, utf16RoundTrip)
+{
+  refstra1 = benchmarkUtf8;
+  g_charsetConverter.utf8To("UTF-16LE", refstra1, varstr16_1);
+  g_charsetConverter.utf16LEtoUTF8(varstr16_1, varstra1);
+  EXPECT_STREQ(refstra1.c_str(), varstra1.c_str());
+
+  g_charsetConverter.utf8To("UTF-16BE", refstra1, varstr16_1);
+  g_charsetConverter.utf16BEtoUTF8(varstr16_1, varstra1);
+  EXPECT_STREQ(refstra1.c_str(), varstra1.c_str());
+}
+
+TEST_F(TestCharsetConverter, Benchmark)
+{
+  unsigned int builtin = RunConversions(false);
+  unsigned int iconv = RunConversions(true);
+
+  std::cout << BENCHMARK_CONVERSIONS << " UTF-8 to wide string and back conversions on " <<
+    BENCHMARK_THREADS << " threads took " << builtin << " ms built in, " << iconv <<
+    " ms with iconv" << std::endl;
+}
@@ -0,0 +1,126 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "utils/DirectoryFingerprints.h"
+#include "utils/URIUtils.h"
+#include "filesystem/File.h"
+#include "test/TestUtils.h"
+
+#include "gtest/gtest.h"
+
+class TestDirectoryFingerprints : public testing::Test
+{
+protected:
+  TestDirectoryFingerprints()
+  {
+    file = XBMC_CREATETEMPFILE(".dat");
+    path = URIUtils::GetDirectory(XBMC_TEMPFILEPATH(file));
+  }
+  ~TestDirectoryFingerprints()
+  {
+    EXPECT_TRUE(XBMC_DELETETEMPFILE(file));
+  }
+  XFILE::CFile *file;
+  CStdString path;
+};
+
+TEST_F(TestDirectoryFingerprints, GetFingerprint)
+{
+  EXPECT_FALSE(CDirectoryFingerprints::GetFingerprint(path).IsEmpty());
+  EXPECT_TRUE(CDirectoryFingerprints::GetFingerprint(path + "nonexistent/").IsEmpty());
+}
+
+TEST_F(TestDirectoryFingerprints, IsUnchanged)
+{
+  ASSERT_TRUE(file);
+  CDirectoryFingerprints fingerprints;
+  fingerprints.Load(XBMC_TEMPFILEPATH(file), CDirectoryFingerprints::TRUST_ALL);
+
+  std::vector<CStdString> subdirs, result;
+  int files = 0;
+  EXPECT_FALSE(fingerprints.IsUnchanged(path, result, files));
+
+  subdirs.push_back(path + "a/");
+  subdirs.push_back(path + "b/");
+  fingerprints.BeginScan(path);
+  fingerprints.SetScanned(path, subdirs, 3);
+  EXPECT_TRUE(fingerprints.IsUnchanged(path, result, files));
+  EXPECT_EQ(subdirs, result);
+  EXPECT_EQ(3, files);
+}
+
+TEST_F(TestDirectoryFingerprints, RemoveVanished)
+{
+  ASSERT_TRUE(file);
+  CDirectoryFingerprints fingerprints;
+  fingerprints.Load(XBMC_TEMPFILEPATH(file), CDirectoryFingerprints::TRUST_ALL);
+
+  std::vector<CStdString> subdirs, result;
+  int files = 0;
+  subdirs.push_back(path);
+  fingerprints.SetScanned(path, std::vector<CStdString>(), 1);
+  fingerprints.SetScanned("/parent/", subdirs, 0);
+  EXPECT_TRUE(fingerprints.IsUnchanged(path, result, files));
+
+  // the subdirectory has gone away, along with everything below it
+  fingerprints.SetScanned("/parent/", std::vector<CStdString>(), 0);
+  EXPECT_FALSE(fingerprints.IsUnchanged(path, result, files));
+}
+
+TEST_F(TestDirectoryFingerprints, SaveLoad)
+{
+  ASSERT_TRUE(file);
+  CDirectoryFingerprints fingerprints;
+  fingerprints.Load(XBMC_TEMPFILEPATH(file), CDirectoryFingerprints::TRUST_ALL);
+
+  std::vector<CStdString> subdirs, result;
+  int files = 0;
+  subdirs.push_back(path + "a/");
+  fingerprints.SetScanned(path, subdirs, 2);
+  EXPECT_TRUE(fingerprints.Save());
+
+  CDirectoryFingerprints loaded;
+  EXPECT_TRUE(loaded.Load(XBMC_TEMPFILEPATH(file), CDirectoryFingerprints::TRUST_ALL));
+  EXPECT_TRUE(loaded.IsUnchanged(path, result, files));
+  EXPECT_EQ(subdirs, result);
+  EXPECT_EQ(2, files);
+
+  // without trusting the modification time only the journal can tell
+  // that a directory hasn't changed, and it doesn't persist
+  EXPECT_TRUE(loaded.Load(XBMC_TEMPFILEPATH(file), CDirectoryFingerprints::TRUST_NONE));
+  EXPECT_FALSE(loaded.IsUnchanged(path, result, files));
+}
+
+TEST_F(TestDirectoryFingerprints, TrustLeaves)
+{
+  ASSERT_TRUE(file);
+  CDirectoryFingerprints fingerprints;
+  fingerprints.Load(XBMC_TEMPFILEPATH(file), CDirectoryFingerprints::TRUST_LEAVES);
+
+  std::vector<CStdString> subdirs, result;
+  int files = 0;
+  fingerprints.SetScanned(path, subdirs, 1);
+  EXPECT_TRUE(fingerprints.IsUnchanged(path, result, files));
+
+  // a change below a directory doesn't show in its modification time
+  subdirs.push_back(path + "a/");
+  fingerprints.SetScanned(path, subdirs, 1);
+  EXPECT_FALSE(fingerprints.IsUnchanged(path, result, files));
+}
@@ -20,10 +20,17 @@
 
 #include "utils/JobManager.h"
 #include "settings/GUISettings.h"
+#include "threads/Atomics.h"
+#include "threads/SystemClock.h"
 #include "utils/SystemInfo.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_JOBS     20000
+#define BENCHMARK_LATENCY  1000
+
 /* CSysInfoJob::GetInternetState() will test for network connectivity. */
 class TestJobManager : public testing::Test
 {
@@ -42,6 +49,8 @@ protected:
                             EDIT_CONTROL_HIDDEN_INPUT,true,733);
     g_guiSettings.AddInt(net, "network.bandwidth", 14041, 0, 0, 512, 100*1024,
                          SPIN_CONTROL_INT_PLUS, 14048, 351);
+    /* the tests before may have cancelled the jobs */
+    CJobManager::GetInstance().Restart();
   }
 
   ~TestJobManager()
@@ -50,6 +59,43 @@ protected:
   }
 };
 
+/* A job that does nothing but count itself. */
+class CountingJob : public CJob
+{
+public:
+  CountingJob(volatile long *counter, const char *type = "") : m_counter(counter), m_type(type) {}
+  virtual bool DoWork() { AtomicIncrement(m_counter); return true; }
+  virtual const char *GetType() const { return m_type; }
+private:
+  volatile long *m_counter;
+  const char *m_type;
+};
+
+/* Counts the jobs that completed. */
+class CompletionCounter : public IJobCallback
+{
+public:
+  CompletionCounter() : m_completed(0) {}
+  virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job)
+  {
+    AtomicIncrement(&m_completed);
+    m_event.Set();
+  }
+  bool Wait(long completed, unsigned int timeout = 60000)
+  {
+    while (m_completed < completed)
+    {
+      if (!m_event.WaitMSec(timeout))
+        return false;
+    }
+    return true;
+  }
+
+  volatile long m_completed;
+private:
+  CEvent m_event;
+};
+
 TEST_F(TestJobManager, AddJob)
 {
   CJob* job = new CSysInfoJob();
@@ -88,3 +134,65 @@ TEST_F(TestJobManager, IsProcessing)
 
   CJobManager::GetInstance().CancelJobs();
 }
+
+TEST_F(TestJobManager, Restart)
+{
+  static volatile long done = 0;
+  static CompletionCounter counter;
+
+  CJobManager::GetInstance().CancelJobs();
+  EXPECT_EQ(0u, CJobManager::GetInstance().AddJob(new CountingJob(&done), &counter));
+
+  CJobManager::GetInstance().Restart();
+  EXPECT_NE(0u, CJobManager::GetInstance().AddJob(new CountingJob(&done), &counter));
+  EXPECT_TRUE(counter.Wait(1));
+  EXPECT_EQ(1, done);
+}
+
+TEST_F(TestJobManager, UnPauseWakesWorkers)
+{
+  static volatile long done = 0;
+  static CompletionCounter counter;
+
+  CJobManager::GetInstance().Pause("counting");
+  CJobManager::GetInstance().AddJob(new CountingJob(&done, "counting"), &counter, CJob::PRIORITY_LOW);
+  EXPECT_FALSE(counter.Wait(1, 100));
+
+  /* the workers sleep until they're woken, so unpausing has to wake one */
+  CJobManager::GetInstance().UnPause("counting");
+  EXPECT_TRUE(counter.Wait(1));
+  EXPECT_EQ(1, done);
+}
+
+TEST_F(TestJobManager, ThroughputBenchmark)
+{
+  static volatile long done = 0;
+  static CompletionCounter counter; // the last callback may still be returning when we're done
+
+  unsigned int start = XbmcThreads::SystemClockMillis();
+  for (int i = 0; i < BENCHMARK_JOBS; i++)
+    CJobManager::GetInstance().AddJob(new CountingJob(&done), &counter, CJob::PRIORITY(i % (CJob::PRIORITY_HIGH + 1)));
+  EXPECT_TRUE(counter.Wait(BENCHMARK_JOBS));
+  unsigned int elapsed = XbmcThreads::SystemClockMillis() - start;
+
+  EXPECT_EQ(BENCHMARK_JOBS, done);
+  EXPECT_EQ(BENCHMARK_JOBS, counter.m_completed);
+  std::cout << BENCHMARK_JOBS << " jobs took " << elapsed << " ms" << std::endl;
+}
+
+TEST_F(TestJobManager, LatencyBenchmark)
+{
+  static volatile long done = 0;
+  static CompletionCounter counter;
+
+  unsigned int start = XbmcThreads::SystemClockMillis();
+  for (int i = 0; i < BENCHMARK_LATENCY; i++)
+  {
+    CJobManager::GetInstance().AddJob(new CountingJob(&done), &counter, CJob::PRIORITY_NORMAL);
+    ASSERT_TRUE(counter.Wait(i + 1));
+  }
+  unsigned int elapsed = XbmcThreads::SystemClockMillis() - start;
+
+  EXPECT_EQ(BENCHMARK_LATENCY, done);
+  std::cout << BENCHMARK_LATENCY << " jobs run one at a time took " << elapsed << " ms" << std::endl;
+}
@@ -27,6 +27,13 @@
 #include "utils/log.h"
 #include "filesystem/File.h"
 #include "filesystem/SpecialProtocol.h"
+#include "threads/SystemClock.h"
+#include "utils/StringUtils.h"
+
+#include <iostream>
+
+#define BENCHMARK_FILES 1000
+#define BENCHMARK_LOOPS 20
 
 TEST(TestRegExp, RegFind)
 {
@@ -180,3 +187,42 @@ TEST_F(TestRegExpLog, DumpOvector)
 
   EXPECT_TRUE(XFILE::CFile::Delete(logfile));
 }
+
+TEST(TestRegExp, PrefilterBenchmark)
+{
+  /* the default movie exclude expression only needs to run on names that contain "sample" at all */
+  CRegExp regex(true);
+  EXPECT_TRUE(regex.RegComp("[!-._ \\\\/]sample[-._ \\\\/]"));
+
+  std::vector<std::string> files;
+  for (int i = 0; i < BENCHMARK_FILES; i++)
+    files.push_back(StringUtils::Format("/media/movies/Some Movie %d (2012)/Some.Movie.%d.2012.1080p.%s.mkv",
+                                        i, i, i % 10 ? "BluRay.x264" : "SAMPLE"));
+
+  unsigned int iFound(0);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+      if (regex.RegFind(*it) >= 0)
+        iFound++;
+    }
+  }
+  unsigned int iRegExp = XbmcThreads::SystemClockMillis() - iStart;
+
+  iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+      if (StringUtils::FindNoCase(*it, "sample") != std::string::npos && regex.RegFind(*it) >= 0)
+        iFound--;
+    }
+  }
+  unsigned int iPrefiltered = XbmcThreads::SystemClockMillis() - iStart;
+
+  EXPECT_EQ((unsigned int)0, iFound);
+  std::cout << BENCHMARK_LOOPS * BENCHMARK_FILES << " file names took " << iRegExp << " ms, prefiltered " <<
+    iPrefiltered << " ms" << std::endl;
+}
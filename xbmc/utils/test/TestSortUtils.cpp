@@ -18,11 +18,36 @@
  *
  */
 
+#include "settings/AdvancedSettings.h"
+#include "threads/SystemClock.h"
 #include "utils/SortUtils.h"
+#include "utils/StringUtils.h"
 #include "utils/Variant.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_LABELS 1000
+#define BENCHMARK_LOOPS  200
+
+class TestSortUtilsArticles : public testing::Test
+{
+protected:
+  TestSortUtilsArticles()
+  {
+    m_tokens = g_advancedSettings.m_vecTokens;
+    const char *tokens[] = { "the ", "the.", "the_", "a ", "an ", "der ", "die ", "das " };
+    g_advancedSettings.m_vecTokens.assign(tokens, tokens + sizeof(tokens) / sizeof(tokens[0]));
+  }
+  ~TestSortUtilsArticles()
+  {
+    g_advancedSettings.m_vecTokens = m_tokens;
+  }
+
+  std::vector<CStdString> m_tokens;
+};
+
 TEST(TestSortUtils, Sort_SortBy)
 {
   SortItems items;
@@ -131,3 +156,35 @@ TEST(TestSortUtils, GetFieldsForSorting)
   EXPECT_EQ(FieldTrackNumber, *it);
   EXPECT_EQ((unsigned int)4, fields.size());
 }
+
+TEST_F(TestSortUtilsArticles, RemoveArticles)
+{
+  EXPECT_STREQ("Movie", SortUtils::RemoveArticles("The Movie").c_str());
+  EXPECT_STREQ("Movie", SortUtils::RemoveArticles("THE.Movie").c_str());
+  EXPECT_STREQ("Theory", SortUtils::RemoveArticles("Theory").c_str());
+  EXPECT_STREQ("The ", SortUtils::RemoveArticles("The ").c_str());
+  EXPECT_STREQ("Anthem", SortUtils::RemoveArticles("Anthem").c_str());
+}
+
+TEST_F(TestSortUtilsArticles, Benchmark)
+{
+  const char *labels[] = { "The Movie %d", "A Song %d", "Das Album %d", "Album %d", "Anthology %d" };
+  std::vector<std::string> strings;
+  for (int i = 0; i < BENCHMARK_LABELS; i++)
+    strings.push_back(StringUtils::Format(labels[i % 5], i));
+
+  unsigned int iRemoved(0);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (std::vector<std::string>::const_iterator it = strings.begin(); it != strings.end(); ++it)
+    {
+      if (SortUtils::RemoveArticles(*it).size() != it->size())
+        iRemoved++;
+    }
+  }
+  unsigned int iElapsed = XbmcThreads::SystemClockMillis() - iStart;
+
+  EXPECT_EQ((unsigned int)(BENCHMARK_LOOPS * BENCHMARK_LABELS * 3 / 5), iRemoved);
+  std::cout << BENCHMARK_LOOPS * BENCHMARK_LABELS << " labels took " << iElapsed << " ms" << std::endl;
+}
@@ -19,9 +19,15 @@
  */
 
 #include "utils/StringUtils.h"
+#include "threads/SystemClock.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_STRINGS 1000
+#define BENCHMARK_LOOPS   200
+
 TEST(TestStringUtils, Format)
 {
   std::string refstr = "test 25 2.7 ff FF";
@@ -59,6 +65,34 @@ TEST(TestStringUtils, EqualsNoCase)
   EXPECT_TRUE(StringUtils::EqualsNoCase(refstr, "tEsT"));
 }
 
+TEST(TestStringUtils, CompareNoCase)
+{
+  EXPECT_EQ(0, StringUtils::CompareNoCase("TeSt", "tEsT"));
+  EXPECT_GT(0, StringUtils::CompareNoCase("test", "TEST2"));
+  EXPECT_LT(0, StringUtils::CompareNoCase("tesu", "TEST"));
+  EXPECT_GT(0, StringUtils::CompareNoCase("[", "a")); /* '[' lies between the upper and lower case letters */
+
+  /* long enough to be compared 16 bytes at a time */
+  EXPECT_EQ(0, StringUtils::CompareNoCase("A long STRING that is Compared in blocks",
+                                          "a LONG string THAT is compared IN BLOCKS"));
+  EXPECT_GT(0, StringUtils::CompareNoCase("A long STRING that is Compared in blocks",
+                                          "a LONG string THAT is compared IN BLOCKZ"));
+  EXPECT_EQ(0, StringUtils::CompareNoCase("Only THE first 8 bytes", "only the FIRST 8 BYTES", 8));
+}
+
+TEST(TestStringUtils, FindNoCase)
+{
+  std::string refstr = "/Path/To/Some Movie (2012)/some.MOVIE.sample.mkv";
+
+  EXPECT_EQ(14, (int)StringUtils::FindNoCase(refstr, "movie"));
+  EXPECT_EQ(32, (int)StringUtils::FindNoCase(refstr, "movie", 15));
+  EXPECT_EQ(38, (int)StringUtils::FindNoCase(refstr, "SAMPLE"));
+  EXPECT_EQ(44, (int)StringUtils::FindNoCase(refstr, ".MKV"));
+  EXPECT_EQ(std::string::npos, StringUtils::FindNoCase(refstr, "trailer"));
+  EXPECT_EQ(std::string::npos, StringUtils::FindNoCase(refstr, "mkv.", 40));
+  EXPECT_EQ(3, (int)StringUtils::FindNoCase(refstr, "", 3));
+}
+
 TEST(TestStringUtils, Left)
 {
   std::string refstr, varstr;
@@ -169,6 +203,13 @@ TEST(TestStringUtils, Replace)
   
   EXPECT_EQ(StringUtils::Replace(varstr, "s", "x"), 0);
   EXPECT_STREQ(refstr.c_str(), varstr.c_str());
+
+  varstr = "test test";
+  EXPECT_EQ(StringUtils::Replace(varstr, "t", "[t]"), 4);
+  EXPECT_STREQ("[t]es[t] [t]es[t]", varstr.c_str());
+
+  EXPECT_EQ(StringUtils::Replace(varstr, "[t]", ""), 4);
+  EXPECT_STREQ("es es", varstr.c_str());
 }
 
 TEST(TestStringUtils, StartsWith)
@@ -286,6 +327,28 @@ TEST(TestStringUtils, Split)
   EXPECT_STREQ("n", varresults.at(6).c_str());
 }
 
+TEST(TestStringUtils, SplitRanges)
+{
+  std::vector<StringRange> varresults;
+  std::string input = "g,h,ij,,n";
+
+  EXPECT_EQ(5, StringUtils::SplitRanges(input, ",", varresults));
+  EXPECT_STREQ("g", varresults.at(0).str().c_str());
+  EXPECT_STREQ("h", varresults.at(1).str().c_str());
+  EXPECT_STREQ("ij", varresults.at(2).str().c_str());
+  EXPECT_EQ((size_t)0, varresults.at(3).length);
+  EXPECT_STREQ("n", varresults.at(4).str().c_str());
+
+  /* the pieces point into the input */
+  EXPECT_EQ(input.c_str() + 4, varresults.at(2).data);
+
+  EXPECT_EQ(3, StringUtils::SplitRanges(input, ",", varresults, 3));
+  EXPECT_STREQ("ij,,n", varresults.at(2).str().c_str());
+
+  EXPECT_EQ(1, StringUtils::SplitRanges("", ",", varresults));
+  EXPECT_EQ((size_t)0, varresults.at(0).length);
+}
+
 TEST(TestStringUtils, FindNumber)
 {
   EXPECT_EQ(3, StringUtils::FindNumber("aabcaadeaa", "aa"));
@@ -462,3 +525,103 @@ TEST(TestStringUtils, FindBestMatch)
   EXPECT_EQ(refint, varint);
   EXPECT_EQ(refdouble, vardouble);
 }
+
+static void FillBenchmarkStrings(std::vector<std::string> &strings)
+{
+  for (int i = 0; i < BENCHMARK_STRINGS; i++)
+    strings.push_back(StringUtils::Format("smb://Server/Media/Movies/The Movie %04d (20%02d)/The.Movie.%04d.720p.BluRay.x264-GROUP.mkv",
+                                          i, i % 13, i));
+}
+
+TEST(TestStringUtils, CaseBenchmark)
+{
+  std::vector<std::string> strings;
+  FillBenchmarkStrings(strings);
+  std::string find = "bluray.x264";
+
+  unsigned int iFound(0);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (unsigned int i = 0; i < strings.size(); i++)
+    {
+      if (StringUtils::EqualsNoCase(strings[i], strings[(i + 1) % strings.size()]) ||
+          StringUtils::StartsWith(strings[i], "SMB://SERVER/MEDIA/MOVIES/") ||
+          StringUtils::EndsWith(strings[i], ".MKV"))
+        iFound++;
+      if (StringUtils::FindNoCase(strings[i], find) != std::string::npos)
+        iFound++;
+    }
+  }
+  unsigned int iCompare = XbmcThreads::SystemClockMillis() - iStart;
+  EXPECT_EQ((unsigned int)(2 * BENCHMARK_LOOPS * BENCHMARK_STRINGS), iFound);
+
+  iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (unsigned int i = 0; i < strings.size(); i++)
+    {
+      std::string str(strings[i]);
+      StringUtils::ToLower(str);
+      StringUtils::ToUpper(str);
+    }
+  }
+  unsigned int iConvert = XbmcThreads::SystemClockMillis() - iStart;
+
+  iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (unsigned int i = 0; i < strings.size(); i++)
+    {
+      CStdString str(strings[i]);
+      if (str.CompareNoCase(strings[(i + 1) % strings.size()].c_str()) == 0)
+        iFound++;
+      str.ToLower();
+    }
+  }
+  unsigned int iStdString = XbmcThreads::SystemClockMillis() - iStart;
+
+  std::cout << BENCHMARK_LOOPS * BENCHMARK_STRINGS << " strings: comparing and searching took " << iCompare <<
+    " ms, changing case took " << iConvert << " ms, CStdString compare and lower case took " << iStdString << " ms" << std::endl;
+}
+
+TEST(TestStringUtils, SplitBenchmark)
+{
+  std::vector<std::string> strings;
+  FillBenchmarkStrings(strings);
+
+  unsigned int iPieces(0);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (unsigned int i = 0; i < strings.size(); i++)
+      iPieces += StringUtils::Split(strings[i], "/").size();
+  }
+  unsigned int iSplit = XbmcThreads::SystemClockMillis() - iStart;
+
+  std::vector<StringRange> ranges;
+  iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (unsigned int i = 0; i < strings.size(); i++)
+      iPieces -= StringUtils::SplitRanges(strings[i], "/", ranges);
+  }
+  unsigned int iRanges = XbmcThreads::SystemClockMillis() - iStart;
+  EXPECT_EQ((unsigned int)0, iPieces);
+
+  iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (unsigned int i = 0; i < strings.size(); i++)
+    {
+      std::string str(strings[i]);
+      StringUtils::Replace(str, ".", " ");
+      StringUtils::Replace(str, "Movie", "Film");
+      StringUtils::Replace(str, " ", "%20");
+    }
+  }
+  unsigned int iReplace = XbmcThreads::SystemClockMillis() - iStart;
+
+  std::cout << BENCHMARK_LOOPS * BENCHMARK_STRINGS << " strings: Split() took " << iSplit << " ms, SplitRanges() took " <<
+    iRanges << " ms, Replace() took " << iReplace << " ms" << std::endl;
+}
@@ -20,10 +20,16 @@
 
 #include "utils/URIUtils.h"
 #include "settings/AdvancedSettings.h"
+#include "threads/SystemClock.h"
 #include "URL.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_PATHS 1000
+#define BENCHMARK_LOOPS 100
+
 class TestURIUtils : public testing::Test
 {
 protected:
@@ -577,3 +583,36 @@ TEST_F(TestURIUtils, UpdateUrlEncoding)
   EXPECT_FALSE(URIUtils::UpdateUrlEncoding(oldUrl));
   EXPECT_STRCASEEQ(newUrl.c_str(), oldUrl.c_str());
 }
+
+TEST_F(TestURIUtils, Benchmark)
+{
+  std::vector<CStdString> paths;
+  for (int i = 0; i < BENCHMARK_PATHS; i++)
+  {
+    CStdString path;
+    path.Format("%s/Media/TV Shows/Some Show/Season %d/Some.Show.S%02dE%02d.720p.HDTV.x264.mkv",
+                i % 3 ? "smb://server" : "/home/user", i % 10, i % 10, i % 24);
+    paths.push_back(path);
+  }
+
+  unsigned int iRemote(0);
+  unsigned int iStart = XbmcThreads::SystemClockMillis();
+  for (int iLoop = 0; iLoop < BENCHMARK_LOOPS; iLoop++)
+  {
+    for (std::vector<CStdString>::const_iterator it = paths.begin(); it != paths.end(); ++it)
+    {
+      CStdString strDirectory = URIUtils::GetDirectory(*it);
+      URIUtils::AddSlashAtEnd(strDirectory);
+      if (URIUtils::GetExtension(*it).IsEmpty() || URIUtils::GetFileName(*it).IsEmpty())
+        continue;
+      if (URIUtils::IsSmb(*it) && !URIUtils::IsStack(*it) && !URIUtils::IsSpecial(*it) &&
+          !URIUtils::IsMultiPath(*it) && !URIUtils::IsMusicDb(*it) && !URIUtils::IsVideoDb(*it) &&
+          !URIUtils::IsUPnP(*it) && !URIUtils::IsHTSP(*it) && !URIUtils::IsNfs(*it))
+        iRemote++;
+    }
+  }
+  unsigned int iElapsed = XbmcThreads::SystemClockMillis() - iStart;
+
+  EXPECT_EQ((unsigned int)(BENCHMARK_LOOPS * (BENCHMARK_PATHS - (BENCHMARK_PATHS + 2) / 3)), iRemote);
+  std::cout << BENCHMARK_LOOPS * BENCHMARK_PATHS << " paths took " << iElapsed << " ms" << std::endl;
+}
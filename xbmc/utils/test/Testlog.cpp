@@ -22,11 +22,16 @@
 #include "utils/RegExp.h"
 #include "filesystem/File.h"
 #include "filesystem/SpecialProtocol.h"
+#include "threads/SystemClock.h"
 
 #include "test/TestUtils.h"
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#define BENCHMARK_LINES 100000
+
 class Testlog : public testing::Test
 {
 protected:
@@ -146,3 +151,43 @@ TEST_F(Testlog, SetLogLevel)
   CLog::Close();
   EXPECT_TRUE(XFILE::CFile::Delete(logfile));
 }
+
+TEST_F(Testlog, Benchmark)
+{
+  CStdString logfile;
+  logfile = CSpecialProtocol::TranslatePath("special://temp/") + "xbmc.log";
+  EXPECT_TRUE(CLog::Init(CSpecialProtocol::TranslatePath("special://temp/")));
+
+  unsigned int start = XbmcThreads::SystemClockMillis();
+  for (int i = 0; i < BENCHMARK_LINES; i++)
+    CLog::Log(LOGDEBUG, "benchmark log message %d", i);
+  unsigned int logged = XbmcThreads::SystemClockMillis() - start;
+  CLog::Close();
+  unsigned int written = XbmcThreads::SystemClockMillis() - start;
+
+  CStdString logstring;
+  char buf[4096];
+  unsigned int bytesread;
+  XFILE::CFile file;
+  EXPECT_TRUE(file.Open(logfile));
+  while ((bytesread = file.Read(buf, sizeof(buf) - 1)) > 0)
+  {
+    buf[bytesread] = '\0';
+    logstring.append(buf);
+  }
+  file.Close();
+
+  /* lines the writer couldn't keep up with are dropped, but not silently */
+  int lines = 0;
+  for (size_t pos = logstring.find("benchmark log message"); pos != std::string::npos; pos = logstring.find("benchmark log message", pos + 1))
+    lines++;
+  if (lines < BENCHMARK_LINES)
+  {
+    EXPECT_NE(std::string::npos, logstring.find("log lines were dropped"));
+  }
+
+  std::cout << BENCHMARK_LINES << " lines were logged in " << logged <<
+    " ms and written in " << written << " ms, " << BENCHMARK_LINES - lines << " were dropped" << std::endl;
+
+  EXPECT_TRUE(XFILE::CFile::Delete(logfile));
+}
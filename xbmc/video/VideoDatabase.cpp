@@ -50,6 +50,7 @@
 #include "addons/AddonInstaller.h"
 #include "interfaces/AnnouncementManager.h"
 #include "dbwrappers/dataset.h"
+#include "dbwrappers/DatabaseRecords.h"
 #include "utils/LabelFormatter.h"
 #include "XBDateTime.h"
 #include "URL.h"
@@ -609,9 +610,20 @@ int CVideoDatabase::AddPath(const CStdString& strPath, const CStdString &strDate
   CStdString strSQL;
   try
   {
+    if (InBulkImport())
+    {
+      map<CStdString, int>::const_iterator it = m_pathCache.find(strPath);
+      if (it != m_pathCache.end())
+        return it->second;
+    }
+
     int idPath = GetPathId(strPath);
     if (idPath >= 0)
+    {
+      if (InBulkImport())
+        m_pathCache[strPath] = idPath;
       return idPath; // already have the path
+    }
 
     if (NULL == m_pDB.get()) return -1;
     if (NULL == m_pDS.get()) return -1;
@@ -629,6 +641,8 @@ int CVideoDatabase::AddPath(const CStdString& strPath, const CStdString &strDate
       strSQL=PrepareSQL("insert into path (idPath, strPath, strContent, strScraper) values (NULL,'%s','','')", strPath1.c_str());
     m_pDS->exec(strSQL.c_str());
     idPath = (int)m_pDS->lastinsertid();
+    if (InBulkImport())
+      m_pathCache[strPath] = idPath;
     return idPath;
   }
   catch (...)
@@ -1246,6 +1260,18 @@ int CVideoDatabase::AddToTable(const CStdString& table, const CStdString& firstF
     if (NULL == m_pDB.get()) return -1;
     if (NULL == m_pDS.get()) return -1;
 
+    // values are matched with like, so cache them case insensitively
+    CStdString key(value);
+    key.ToLower();
+    if (InBulkImport())
+    {
+      map<CStdString, int> &cache = m_tableCache[table];
+      map<CStdString, int>::const_iterator it = cache.find(key);
+      if (it != cache.end())
+        return it->second;
+    }
+
+    int id;
     CStdString strSQL = PrepareSQL("select %s from %s where %s like '%s'", firstField.c_str(), table.c_str(), secondField.c_str(), value.c_str());
     m_pDS->query(strSQL.c_str());
     if (m_pDS->num_rows() == 0)
@@ -1254,15 +1280,16 @@ int CVideoDatabase::AddToTable(const CStdString& table, const CStdString& firstF
       // doesnt exists, add it
       strSQL = PrepareSQL("insert into %s (%s, %s) values(NULL, '%s')", table.c_str(), firstField.c_str(), secondField.c_str(), value.c_str());      
       m_pDS->exec(strSQL.c_str());
-      int id = (int)m_pDS->lastinsertid();
-      return id;
+      id = (int)m_pDS->lastinsertid();
     }
     else
     {
-      int id = m_pDS->fv(firstField).get_asInt();
+      id = m_pDS->fv(firstField).get_asInt();
       m_pDS->close();
-      return id;
     }
+    if (InBulkImport())
+      m_tableCache[table][key] = id;
+    return id;
   }
   catch (...)
   {
@@ -1311,26 +1338,38 @@ int CVideoDatabase::AddActor(const CStdString& strActor, const CStdString& thumb
     if (NULL == m_pDB.get()) return -1;
     if (NULL == m_pDS.get()) return -1;
     int idActor = -1;
-    CStdString strSQL=PrepareSQL("select idActor from actors where strActor like '%s'", strActor.c_str());
-    m_pDS->query(strSQL.c_str());
-    if (m_pDS->num_rows() == 0)
-    {
-      m_pDS->close();
-      // doesnt exists, add it
-      strSQL=PrepareSQL("insert into actors (idActor, strActor, strThumb) values( NULL, '%s','%s')", strActor.c_str(),thumbURLs.c_str());
-      m_pDS->exec(strSQL.c_str());
-      idActor = (int)m_pDS->lastinsertid();
-    }
+    bool added = false;
+    CStdString key(strActor);
+    key.ToLower();
+    map<CStdString, int>::const_iterator it = m_actorCache.find(key);
+    if (InBulkImport() && it != m_actorCache.end())
+      idActor = it->second;
     else
     {
-      idActor = m_pDS->fv("idActor").get_asInt();
-      m_pDS->close();
-      // update the thumb url's
-      if (!thumbURLs.IsEmpty())
+      CStdString strSQL=PrepareSQL("select idActor from actors where strActor like '%s'", strActor.c_str());
+      m_pDS->query(strSQL.c_str());
+      if (m_pDS->num_rows() == 0)
       {
-        strSQL=PrepareSQL("update actors set strThumb='%s' where idActor=%i",thumbURLs.c_str(),idActor);
+        m_pDS->close();
+        // doesnt exists, add it
+        strSQL=PrepareSQL("insert into actors (idActor, strActor, strThumb) values( NULL, '%s','%s')", strActor.c_str(),thumbURLs.c_str());
         m_pDS->exec(strSQL.c_str());
+        idActor = (int)m_pDS->lastinsertid();
+        added = true;
+      }
+      else
+      {
+        idActor = m_pDS->fv("idActor").get_asInt();
+        m_pDS->close();
       }
+      if (InBulkImport())
+        m_actorCache[key] = idActor;
+    }
+    // update the thumb url's
+    if (!added && !thumbURLs.IsEmpty())
+    {
+      CStdString strSQL=PrepareSQL("update actors set strThumb='%s' where idActor=%i",thumbURLs.c_str(),idActor);
+      m_pDS->exec(strSQL.c_str());
     }
     // add artwork
     if (!thumb.IsEmpty())
@@ -3187,19 +3226,11 @@ CVideoInfoTag CVideoDatabase::GetDetailsForMovie(auto_ptr<Dataset> &pDS, bool ne
   return GetDetailsForMovie(pDS->get_sql_record(), needsCast);
 }
 
-CVideoInfoTag CVideoDatabase::GetDetailsForMovie(const dbiplus::sql_record* const record, bool needsCast /* = false */)
+void CVideoDatabase::GetMovieFromRecord(const dbiplus::sql_record* const record, CVideoInfoTag &details)
 {
-  CVideoInfoTag details;
-
-  if (record == NULL)
-    return details;
-
-  DWORD time = XbmcThreads::SystemClockMillis();
-  int idMovie = record->at(0).get_asInt();
-
   GetDetailsFromDB(record, VIDEODB_ID_MIN, VIDEODB_ID_MAX, DbMovieOffsets, details);
 
-  details.m_iDbId = idMovie;
+  details.m_iDbId = record->at(0).get_asInt();
   details.m_type = "movie";
   
   details.m_iSetId = record->at(VIDEODB_DETAILS_MOVIE_SET_ID).get_asInt();
@@ -3214,6 +3245,36 @@ CVideoInfoTag CVideoDatabase::GetDetailsForMovie(const dbiplus::sql_record* cons
   details.m_resumePoint.timeInSeconds = record->at(VIDEODB_DETAILS_MOVIE_RESUME_TIME).get_asInt();
   details.m_resumePoint.totalTimeInSeconds = record->at(VIDEODB_DETAILS_MOVIE_TOTAL_TIME).get_asInt();
   details.m_resumePoint.type = CBookmark::RESUME;
+}
+
+void CVideoDatabase::GetFileItemForMovie(const dbiplus::sql_record* const record, CFileItem* item, const CStdString &strBaseDir)
+{
+  CVideoInfoTag movie;
+  GetMovieFromRecord(record, movie);
+  item->SetFromVideoInfoTag(movie);
+
+  CVideoDbUrl itemUrl;
+  if (!itemUrl.FromString(strBaseDir))
+    return;
+
+  CStdString path; path.Format("%ld", movie.m_iDbId);
+  itemUrl.AppendPath(path);
+  item->SetPath(itemUrl.ToString());
+
+  item->SetOverlayImage(CGUIListItem::ICON_OVERLAY_UNWATCHED,movie.m_playCount > 0);
+}
+
+CVideoInfoTag CVideoDatabase::GetDetailsForMovie(const dbiplus::sql_record* const record, bool needsCast /* = false */)
+{
+  CVideoInfoTag details;
+
+  if (record == NULL)
+    return details;
+
+  DWORD time = XbmcThreads::SystemClockMillis();
+  int idMovie = record->at(0).get_asInt();
+
+  GetMovieFromRecord(record, details);
 
   movieTime += XbmcThreads::SystemClockMillis() - time; time = XbmcThreads::SystemClockMillis();
 
@@ -5866,6 +5927,9 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
     // get data from returned rows
     items.Reserve(results.size());
     const query_data &data = m_pDS->get_result_set().records;
+    boost::shared_ptr<CDatabaseRecords> records;
+    if (items.GetRecordBacked())
+      records.reset(new CDatabaseRecords(&CVideoDatabase::GetFileItemForMovie, videoUrl.ToString()));
     for (DatabaseResults::const_iterator it = results.begin(); it != results.end(); it++)
     {
       unsigned int targetRow = (unsigned int)it->at(FieldRow).asInteger();
@@ -5878,11 +5942,23 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
 
       const dbiplus::sql_record* const record = data.at(targetRow);
 
-      CVideoInfoTag movie = GetDetailsForMovie(record);
+      CVideoInfoTag movie;
+      if (records) // only the path is needed up front
+        movie.m_strPath = record->at(VIDEODB_DETAILS_MOVIE_PATH).get_asString();
+      else
+        movie = GetDetailsForMovie(record);
       if (g_settings.GetMasterProfile().getLockMode() == LOCK_MODE_EVERYONE ||
           g_passwordManager.bMasterUser                                   ||
           g_passwordManager.IsDatabasePathUnlocked(movie.m_strPath, g_settings.m_videoSources))
       {
+        if (records)
+        {
+          CFileItemPtr pItem(new CFileItem);
+          pItem->SetRecord(records, records->Add(m_pDS.get(), targetRow));
+          items.Add(pItem);
+          continue;
+        }
+
         CFileItemPtr pItem(new CFileItem(movie));
 
         CVideoDbUrl itemUrl = videoUrl;
@@ -8912,14 +8988,49 @@ void CVideoDatabase::InvalidatePathHash(const CStdString& strPath)
 
 bool CVideoDatabase::CommitTransaction()
 {
-  if (CDatabase::CommitTransaction())
+  if (!CDatabase::CommitTransaction())
+    return false;
+
+  // during a bulk import this only released a savepoint, EndBulkImport() commits again
+  if (!InBulkImport())
   { // number of items in the db has likely changed, so recalculate
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MOVIES, HasContent(VIDEODB_CONTENT_MOVIES));
     g_infoManager.SetLibraryBool(LIBRARY_HAS_TVSHOWS, HasContent(VIDEODB_CONTENT_TVSHOWS));
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MUSICVIDEOS, HasContent(VIDEODB_CONTENT_MUSICVIDEOS));
-    return true;
   }
-  return false;
+  return true;
+}
+
+void CVideoDatabase::ClearBulkImportCaches()
+{
+  m_pathCache.clear();
+  m_actorCache.clear();
+  m_tableCache.clear();
+}
+
+void CVideoDatabase::GetBulkImportIndexes(std::vector<std::string> &indexes) const
+{
+  // the reverse direction of the link tables - lookups while adding go via the first index
+  static const char *reverse[] = {
+    "CREATE UNIQUE INDEX ix_genrelinkmovie_2 ON genrelinkmovie ( idMovie, idGenre)",
+    "CREATE UNIQUE INDEX ix_countrylinkmovie_2 ON countrylinkmovie ( idMovie, idCountry)",
+    "CREATE UNIQUE INDEX ix_actorlinkmovie_2 ON actorlinkmovie ( idMovie, idActor )",
+    "CREATE UNIQUE INDEX ix_directorlinkmovie_2 ON directorlinkmovie ( idMovie, idDirector )",
+    "CREATE UNIQUE INDEX ix_writerlinkmovie_2 ON writerlinkmovie ( idMovie, idWriter )",
+    "CREATE UNIQUE INDEX ix_studiolinkmovie_2 ON studiolinkmovie ( idMovie, idStudio)",
+    "CREATE UNIQUE INDEX ix_directorlinktvshow_2 ON directorlinktvshow ( idShow, idDirector )",
+    "CREATE UNIQUE INDEX ix_actorlinktvshow_2 ON actorlinktvshow ( idShow, idActor )",
+    "CREATE UNIQUE INDEX ix_studiolinktvshow_2 ON studiolinktvshow ( idShow, idStudio)",
+    "CREATE UNIQUE INDEX ix_genrelinktvshow_2 ON genrelinktvshow ( idShow, idGenre)",
+    "CREATE UNIQUE INDEX ix_movielinktvshow_2 ON movielinktvshow ( idMovie, idShow)",
+    "CREATE UNIQUE INDEX ix_actorlinkepisode_2 ON actorlinkepisode ( idEpisode, idActor )",
+    "CREATE UNIQUE INDEX ix_directorlinkepisode_2 ON directorlinkepisode ( idEpisode, idDirector )",
+    "CREATE UNIQUE INDEX ix_writerlinkepisode_2 ON writerlinkepisode ( idEpisode, idWriter )",
+    "CREATE UNIQUE INDEX ix_artistlinkmusicvideo_2 ON artistlinkmusicvideo ( idMVideo, idArtist)",
+    "CREATE UNIQUE INDEX ix_genrelinkmusicvideo_2 ON genrelinkmusicvideo ( idMVideo, idGenre)",
+    "CREATE UNIQUE INDEX ix_studiolinkmusicvideo_2 ON studiolinkmusicvideo ( idMVideo, idStudio)",
+    "CREATE UNIQUE INDEX ix_directorlinkmusicvideo_2 ON directorlinkmusicvideo ( idMVideo, idDirector )" };
+  indexes.insert(indexes.end(), reverse, reverse + sizeof(reverse) / sizeof(reverse[0]));
 }
 
 void CVideoDatabase::SetDetail(const CStdString& strDetail, int id, int field,
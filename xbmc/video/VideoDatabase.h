@@ -750,6 +750,8 @@ protected:
   CVideoInfoTag GetDetailsByTypeAndId(VIDEODB_CONTENT_TYPE type, int id);
   CVideoInfoTag GetDetailsForMovie(std::auto_ptr<dbiplus::Dataset> &pDS, bool needsCast = false);
   CVideoInfoTag GetDetailsForMovie(const dbiplus::sql_record* const record, bool needsCast = false);
+  static void GetMovieFromRecord(const dbiplus::sql_record* const record, CVideoInfoTag &details);
+  static void GetFileItemForMovie(const dbiplus::sql_record* const record, CFileItem* item, const CStdString &strBaseDir);
   CVideoInfoTag GetDetailsForTvShow(std::auto_ptr<dbiplus::Dataset> &pDS, bool needsCast = false);
   CVideoInfoTag GetDetailsForTvShow(const dbiplus::sql_record* const record, bool needsCast = false);
   CVideoInfoTag GetDetailsForEpisode(std::auto_ptr<dbiplus::Dataset> &pDS, bool needsCast = false);
@@ -761,7 +763,7 @@ protected:
   void GetCast(const CStdString &table, const CStdString &table_id, int type_id, std::vector<SActorInfo> &cast);
 
   void GetDetailsFromDB(std::auto_ptr<dbiplus::Dataset> &pDS, int min, int max, const SDbTableOffsets *offsets, CVideoInfoTag &details, int idxOffset = 2);
-  void GetDetailsFromDB(const dbiplus::sql_record* const record, int min, int max, const SDbTableOffsets *offsets, CVideoInfoTag &details, int idxOffset = 2);
+  static void GetDetailsFromDB(const dbiplus::sql_record* const record, int min, int max, const SDbTableOffsets *offsets, CVideoInfoTag &details, int idxOffset = 2);
   CStdString GetValueString(const CVideoInfoTag &details, int min, int max, const SDbTableOffsets *offsets) const;
 
   void CleanupTags();
@@ -769,6 +771,8 @@ protected:
 private:
   virtual bool CreateTables();
   virtual bool UpdateOldVersion(int version);
+  virtual void GetBulkImportIndexes(std::vector<std::string> &indexes) const;
+  virtual void ClearBulkImportCaches();
 
   /*! \brief (Re)Create the generic database views for movies, tvshows,
      episodes and music videos
@@ -811,7 +815,7 @@ private:
   virtual int GetExportVersion() const { return 1; };
   const char *GetBaseDBName() const { return "MyVideos"; };
 
-  void ConstructPath(CStdString& strDest, const CStdString& strPath, const CStdString& strFileName);
+  static void ConstructPath(CStdString& strDest, const CStdString& strPath, const CStdString& strFileName);
   void SplitPath(const CStdString& strFileNameAndPath, CStdString& strPath, CStdString& strFileName);
   void InvalidatePathHash(const CStdString& strPath);
 
@@ -827,4 +831,9 @@ private:
 
   void AnnounceRemove(std::string content, int id);
   void AnnounceUpdate(std::string content, int id);
+
+  // ids looked up or added during a bulk import
+  std::map<CStdString, int> m_pathCache;
+  std::map<CStdString, int> m_actorCache;
+  std::map<std::string, std::map<CStdString, int> > m_tableCache;
 };
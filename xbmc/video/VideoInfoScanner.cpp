@@ -50,6 +50,7 @@
 #include "TextureCache.h"
 #include "GUIUserMessages.h"
 #include "URL.h"
+#include "utils/DirectoryFingerprints.h"
 
 using namespace std;
 using namespace XFILE;
@@ -105,6 +106,12 @@ namespace VIDEO
       // result in unexpected behaviour.
       m_bCanInterrupt = false;
 
+      // the fast hash already trusts the modification times of folders without subfolders, so we do too.
+      // Folders with subfolders aren't trusted: their items may be handled without recursing into them
+      // (DVD folders, non-recursive sources), so a change further down wouldn't be noticed.
+      m_fingerprints.Load(URIUtils::AddFileToFolder(g_settings.GetDatabaseFolder(), "VideoFingerprints.dat"),
+                          CDirectoryFingerprints::TRUST_LEAVES);
+
       bool bCancelled = false;
       while (!bCancelled && m_pathsToScan.size())
       {
@@ -118,6 +125,7 @@ namespace VIDEO
         if (!DoScan(directory))
           bCancelled = true;
       }
+      m_fingerprints.Save();
 
       if (!bCancelled)
       {
@@ -228,6 +236,8 @@ namespace VIDEO
     CFileItemList items;
     bool foundDirectly = false;
     bool bSkip = false;
+    bool listed = false;
+    vector<CStdString> subdirs;
 
     SScanSettings settings;
     ScraperPtr info = m_database.GetScraperForPath(strDirectory, settings, foundDirectly);
@@ -253,8 +263,18 @@ namespace VIDEO
         m_handle->SetTitle(g_localizeStrings.Get(str));
       }
 
-      CStdString fastHash = GetFastHash(strDirectory);
-      if (m_database.GetPathHash(strDirectory, dbHash) && !fastHash.IsEmpty() && fastHash == dbHash)
+      int files = 0;
+      if (m_fingerprints.IsUnchanged(strDirectory, subdirs, files) && m_database.GetPathHash(strDirectory, dbHash))
+      { // nothing in the folder changed - only its subfolders need checking
+        CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping dir '%s' due to unchanged fingerprint", strDirectory.c_str());
+        hash = dbHash;
+        bSkip = true;
+        for (vector<CStdString>::const_iterator i = subdirs.begin(); i != subdirs.end(); ++i)
+          items.Add(CFileItemPtr(new CFileItem(*i, true)));
+      }
+
+      CStdString fastHash = bSkip ? "" : GetFastHash(strDirectory);
+      if (!bSkip && m_database.GetPathHash(strDirectory, dbHash) && !fastHash.IsEmpty() && fastHash == dbHash)
       { // fast hashes match - no need to process anything
         CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping dir '%s' due to no change (fasthash)", strDirectory.c_str());
         hash = fastHash;
@@ -262,8 +282,10 @@ namespace VIDEO
       }
       if (!bSkip)
       { // need to fetch the folder
+        m_fingerprints.BeginScan(strDirectory);
         CDirectory::GetDirectory(strDirectory, items, g_settings.m_videoExtensions);
         items.Stack();
+        listed = true;
         // compute hash
         GetPathHash(items, hash);
         if (hash != dbHash && !hash.IsEmpty())
@@ -342,6 +364,22 @@ namespace VIDEO
       m_database.SetPathHash(strDirectory, hash);
     }
 
+    // remember the folder if it made it into the database unchanged
+    if (listed && !m_bStop && m_database.GetPathHash(strDirectory, dbHash) && dbHash == hash)
+    {
+      int files = 0;
+      subdirs.clear();
+      for (int i = 0; i < items.Size(); ++i)
+      {
+        CFileItemPtr pItem = items[i];
+        if (pItem->m_bIsFolder && !pItem->IsParentFolder() && !pItem->IsPlayList())
+          subdirs.push_back(pItem->GetPath());
+        else
+          files++;
+      }
+      m_fingerprints.SetScanned(strDirectory, subdirs, files);
+    }
+
     if (m_handle)
       OnDirectoryScanned(strDirectory);
 
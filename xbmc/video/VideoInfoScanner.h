@@ -22,6 +22,7 @@
 #include "VideoDatabase.h"
 #include "addons/Scraper.h"
 #include "NfoFile.h"
+#include "utils/DirectoryFingerprints.h"
 
 class CRegExp;
 class CFileItem;
@@ -237,6 +238,7 @@ namespace VIDEO
     std::set<CStdString> m_pathsToScan;
     std::set<CStdString> m_pathsToCount;
     std::set<int> m_pathsToClean;
+    CDirectoryFingerprints m_fingerprints; ///< directories known to be unchanged since the last scan
     CNfoFile m_nfoReader;
   };
 }
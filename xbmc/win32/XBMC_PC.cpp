@@ -34,6 +34,8 @@
 // Minidump creation function
 LONG WINAPI CreateMiniDump( EXCEPTION_POINTERS* pEp )
 {
+  // write out what's still queued for the log before we go
+  CLog::Flush();
   win32_exception::write_minidump(pEp);
   return pEp->ExceptionRecord->ExceptionCode;;
 }